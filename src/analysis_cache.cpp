@@ -0,0 +1,268 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Analysis cache implementation.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+
+#include "analysis_cache.h"
+#include "utils.h"
+
+
+namespace AnalysisCache
+{
+
+const char FILE_ID[8] = { 'S', 'T', 'K', 'Y', 'A', 'N', 'L', 'C' };
+
+/// Has to be increased whenever the file layout (or the meaning of the stored data) changes
+const uint32_t FILE_VERSION = 3;
+
+const char *FILE_SUFFIX = ".stackistry_cache";
+
+/// FNV-1a hash of the values passed to Add()
+class c_Fingerprint
+{
+    uint64_t m_Hash = 14695981039346656037ULL;
+
+public:
+    c_Fingerprint &Add(const void *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            m_Hash ^= static_cast<const uint8_t *>(data)[i];
+            m_Hash *= 1099511628211ULL;
+        }
+        return *this;
+    }
+
+    template<typename T>
+    c_Fingerprint &Add(const T &value) { return Add(&value, sizeof(value)); }
+
+    c_Fingerprint &Add(const std::string &s) { return Add(s.size()).Add(s.data(), s.size()); }
+
+    c_Fingerprint &Add(const std::vector<struct SKRY_point> &points)
+    {
+        Add(points.size());
+        for (const struct SKRY_point &pt: points)
+            Add(pt.x).Add(pt.y);
+        return *this;
+    }
+
+    uint64_t Get() const { return m_Hash; }
+};
+
+static void AddFile(c_Fingerprint &fp, const std::string &fileName)
+{
+    fp.Add(fileName);
+
+    GStatBuf fileStat;
+    if (0 == g_stat(fileName.c_str(), &fileStat))
+        fp.Add((int64_t)fileStat.st_size).Add((int64_t)fileStat.st_mtime);
+    else
+        fp.Add((int64_t)-1);
+}
+
+uint64_t GetKey(const Job_t &job)
+{
+    // A part is keyed as the whole job (see Job::SelectPart())
+    const bool isPart = (job.part.count > 1);
+
+    c_Fingerprint fp;
+
+    // The input
+    if (job.imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES)
+        for (const std::string &fileName: job.imageFileNames)
+            AddFile(fp, fileName);
+    else
+        AddFile(fp, job.sourcePath);
+
+    fp.Add(job.imgSeq.GetImageCount())
+      .Add(isPart ? job.part.jobActiveFlags.data() : job.imgSeq.GetImgActiveFlags(), job.imgSeq.GetImageCount());
+    fp.Add(job.cfaPattern);
+    fp.Add(job.roi.x).Add(job.roi.y).Add(job.roi.width).Add(job.roi.height).Add(job.binning);
+
+    // Image alignment (quality is estimated in the aligned images)
+    fp.Add(job.alignmentMethod)
+      .Add(Utils::Const::imgAlignmentRefBlockSize)
+      .Add(Utils::Const::Defaults::placementBrightnessThreshold)
+      .Add(job.automaticAnchorPlacement)
+      .Add(isPart ? job.part.jobAnchors : Job::GetAnchors(job)); // in automatic mode, the precomputed anchor (if still valid)
+
+    // Quality estimation
+    fp.Add(Utils::Const::qualityEstimationAreaSize).Add(Utils::Const::qualityEstimationDetailScale);
+
+    return fp.Get();
+}
+
+std::string GetPath(const Job_t &job)
+{
+    if (job.imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES)
+        return Glib::build_filename(job.sourcePath, FILE_SUFFIX);
+    else
+        return job.sourcePath + FILE_SUFFIX;
+}
+
+template<typename T>
+static void Write(std::ofstream &file, const T &value)
+{
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool Read(std::ifstream &file, T &value)
+{
+    return !file.read(reinterpret_cast<char *>(&value), sizeof(value)).fail();
+}
+
+static void WritePoint(std::ofstream &file, const struct SKRY_point &pt)
+{
+    Write(file, (int32_t)pt.x);
+    Write(file, (int32_t)pt.y);
+}
+
+static bool ReadPoint(std::ifstream &file, struct SKRY_point &pt)
+{
+    int32_t x, y;
+    if (!Read(file, x) || !Read(file, y))
+        return false;
+
+    pt.x = x;
+    pt.y = y;
+    return true;
+}
+
+/// Guards against allocating huge arrays due to a corrupted file
+const uint64_t MAX_NUM_ELEMENTS = 1ULL << 32;
+
+// File layout: FILE_ID, FILE_VERSION, key (uint64), number of active images (uint64), quality of each one (double);
+// alignment present (uint8), then (if present) offset of each image (2x int32), intersection (4x int32),
+// number of anchors (uint64) and their positions (2x int32)
+
+Data_t Load(const Job_t &job)
+{
+    Data_t data;
+
+    std::ifstream file(GetPath(job).c_str(), std::ios_base::in | std::ios_base::binary);
+    if (file.fail())
+        return data;
+
+    char fileId[sizeof(FILE_ID)];
+    uint32_t version;
+    uint64_t key, numImages;
+    const size_t numActive = (job.part.count > 1 ? std::count(job.part.jobActiveFlags.begin(), job.part.jobActiveFlags.end(), 1)
+                                                 : job.imgSeq.GetActiveImageCount());
+    if (!Read(file, fileId) || 0 != memcmp(fileId, FILE_ID, sizeof(FILE_ID)) ||
+        !Read(file, version) || version != FILE_VERSION ||
+        !Read(file, key) || key != GetKey(job) ||
+        !Read(file, numImages) || numImages != numActive || numImages > MAX_NUM_ELEMENTS)
+    {
+        return data;
+    }
+
+    data.quality.framesChrono.resize(numImages);
+    for (SKRY_quality_t &quality: data.quality.framesChrono)
+    {
+        double value;
+        if (!Read(file, value))
+            return Data_t();
+        quality = value;
+    }
+    data.quality.valid = true;
+
+    uint8_t hasAlignment;
+    if (!Read(file, hasAlignment) || !hasAlignment)
+        return data;
+
+    auto &alignment = data.alignment;
+    alignment.imgOffsets.resize(numImages);
+    for (struct SKRY_point &offset: alignment.imgOffsets)
+        if (!ReadPoint(file, offset))
+            return data;
+
+    int32_t rect[4];
+    uint64_t numAnchors;
+    if (!Read(file, rect) || !Read(file, numAnchors) || numAnchors > MAX_NUM_ELEMENTS)
+        return data;
+    alignment.intersection = { rect[0], rect[1], (unsigned)rect[2], (unsigned)rect[3] };
+
+    alignment.anchors.resize(numAnchors);
+    for (struct SKRY_point &anchor: alignment.anchors)
+        if (!ReadPoint(file, anchor))
+            return data;
+    alignment.valid = true;
+
+    return data;
+}
+
+bool Save(const Job_t &job, const Data_t &data)
+{
+    if (!data.quality.valid)
+        return true;
+
+    const std::string path = GetPath(job);
+
+    // Write to a temporary file first, so that an interrupted save does not leave a damaged cache
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (file.fail())
+            return false;
+
+        file.write(FILE_ID, sizeof(FILE_ID));
+        Write(file, FILE_VERSION);
+
+        Write(file, GetKey(job));
+        Write(file, (uint64_t)data.quality.framesChrono.size());
+        for (SKRY_quality_t quality: data.quality.framesChrono)
+            Write(file, (double)quality);
+
+        const auto &alignment = data.alignment;
+        const bool hasAlignment = (alignment.valid && alignment.imgOffsets.size() == data.quality.framesChrono.size());
+        Write(file, (uint8_t)hasAlignment);
+        if (hasAlignment)
+        {
+            for (const struct SKRY_point &offset: alignment.imgOffsets)
+                WritePoint(file, offset);
+
+            const struct SKRY_rect &isc = alignment.intersection;
+            const int32_t rect[4] = { isc.x, isc.y, (int32_t)isc.width, (int32_t)isc.height };
+            Write(file, rect);
+
+            Write(file, (uint64_t)alignment.anchors.size());
+            for (const struct SKRY_point &anchor: alignment.anchors)
+                WritePoint(file, anchor);
+        }
+
+        if (file.fail())
+            return false;
+    }
+
+    g_remove(path.c_str());
+    return (0 == g_rename(tmpPath.c_str(), path.c_str()));
+}
+
+} // namespace AnalysisCache
@@ -0,0 +1,80 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Analysis cache header.
+*/
+
+#ifndef STACKISTRY_ANALYSIS_CACHE_HEADER
+#define STACKISTRY_ANALYSIS_CACHE_HEADER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <skry/skry_cpp.hpp>
+
+#include "job.h"
+
+
+/// Results of the analysis phases, stored in a file next to the job's input
+/** The data is keyed by a fingerprint of the input (file sizes and
+    modification times, active frames) and of the image alignment and quality
+    estimation settings; e.g. changing the quality threshold keeps it valid.
+    libskry's phases cannot be constructed from precomputed results; the frame
+    quality is published as soon as a job starts (for the quality graph and
+    frame selection), and the parts of a distributed job use the whole job's
+    alignment and quality (see Job::SelectPart()). */
+namespace AnalysisCache
+{
+    struct Data_t
+    {
+        struct
+        {
+            bool valid = false;
+            std::vector<SKRY_quality_t> framesChrono;
+        } quality;
+
+        struct
+        {
+            bool valid = false;
+            std::vector<struct SKRY_point> imgOffsets; ///< Element [i]: offset of active image 'i' relative to the first one
+            struct SKRY_rect intersection;
+            std::vector<struct SKRY_point> anchors; ///< Positions in the first active image (empty for SKRY_IMG_ALGN_CENTROID)
+        } alignment;
+    };
+
+    /// Returns the fingerprint of the input and settings the cached data of 'job' depends on
+    /** For a part of a distributed job, it is the whole job's fingerprint. */
+    uint64_t GetKey(const Job_t &job);
+
+    /// Returns the path of the cache file of 'job'
+    /** All parts of a distributed job (see Job::SelectPart()) share the whole job's file. */
+    std::string GetPath(const Job_t &job);
+
+    /// Returns the cached data of 'job'; data not matching the job's current input and settings is not valid
+    /** If the file does not exist or cannot be read, nothing is valid. */
+    Data_t Load(const Job_t &job);
+
+    /// Stores the valid data (keyed by the current input and settings of 'job'); returns 'false' on failure
+    /** Data without valid quality is not stored. Must not be called for a part of a distributed job. */
+    bool Save(const Job_t &job, const Data_t &data);
+}
+
+#endif // STACKISTRY_ANALYSIS_CACHE_HEADER
@@ -0,0 +1,737 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Benchmark program file.
+*/
+
+#include <algorithm>
+#include <cmath>   // for M_PI
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cairomm/context.h>
+#include <cairomm/surface.h>
+#include <glib/gstdio.h>
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+#include <glibmm/threads.h>
+#include <glibmm/timer.h>
+#include <skry/skry.h>
+
+#include "img_pyramid.h"
+#include "job.h"
+#include "ser_writer.h"
+#include "utils.h"
+#include "version.h"
+#include "worker.h"
+
+
+namespace Vars
+{
+    /// Signaled by the worker (from its thread) on every progress notification
+    Glib::Threads::Mutex notificationMtx;
+    Glib::Threads::Cond notificationCond;
+    bool notificationPending = false;
+}
+
+struct Settings_t
+{
+    // Synthetic input
+    unsigned width = 640;
+    unsigned height = 480;
+    unsigned bitsPerChannel = 8;
+    unsigned numFrames = 100;
+    enum SKRY_CFA_pattern cfaPattern = SKRY_CFA_NONE;
+    double jitter = 3.0;  ///< Std. deviation of the frames' translation (in pixels)
+    double seeing = 1.0;  ///< Amplitude of the frames' local distortion (in pixels)
+    bool imageSeries = false;
+    unsigned seed = 1;
+
+    // Execution
+    unsigned numRuns = 1;
+    unsigned threadBudget = 0;
+    unsigned readAheadDepth = Utils::Const::Defaults::ReadAheadFrames;
+    unsigned displayRepetitions = 20;
+    std::string outputFile; ///< Empty: standard output
+    std::string workDir; ///< Empty: a new temporary directory
+    bool keepFiles = false;
+};
+
+/// Viewport size used by the display benchmarks
+const int VIEWPORT_WIDTH = 1280;
+const int VIEWPORT_HEIGHT = 800;
+
+static double ClockSec()
+{
+    return g_get_monotonic_time() * 1.0e-6;
+}
+
+static void PrintUsage(const char *exeName)
+{
+    std::cout <<
+        "Stackistry " << VERSION_MAJOR << "." << VERSION_MINOR << "." << VERSION_SUBMINOR << " - benchmark\n\n"
+        "Usage: " << Glib::path_get_basename(exeName) << " [options]\n\n"
+        "Generates a synthetic recording, processes it and measures image display conversion and scaling.\n"
+        "The results are written as JSON.\n\n"
+        "Synthetic input:\n"
+        "  --size WxH                       frame size (default: 640x480)\n"
+        "  --bits N                         8 or 16 bits per pixel (default: 8)\n"
+        "  --frames N                       number of frames (default: 100)\n"
+        "  --cfa PATTERN                    generate raw color frames (e.g. RGGB)\n"
+        "  --jitter F                       std. deviation of the frames' shift in pixels (default: 3)\n"
+        "  --seeing F                       amplitude of local distortion in pixels (default: 1)\n"
+        "  --series                         generate a TIFF image series (always 16-bit) instead of a SER video\n"
+        "  --seed N                         random seed (default: 1)\n"
+        "\n"
+        "Execution:\n"
+        "  --runs N                         number of processing runs (default: 1)\n"
+        "  -t, --threads N                  total number of processing threads (default: all CPUs)\n"
+        "  --read-ahead N                   number of frames read ahead in background (default: 8, 0 = off)\n"
+        "  --display-reps N                 repetitions of each display measurement (default: 20)\n"
+        "  -o, --output FILE                write results to FILE (default: standard output)\n"
+        "  --work-dir DIR                   create the input in DIR (default: a temporary directory)\n"
+        "  --keep                           do not delete the input afterwards\n"
+        "  -h, --help                       show this text\n";
+}
+
+template<typename T>
+static bool ParseValue(const char *str, T &result)
+{
+    std::stringstream ss(str);
+    ss >> result;
+    return !ss.fail() && ss.eof();
+}
+
+static bool ParseSize(const char *str, unsigned &width, unsigned &height)
+{
+    const char *sep = strchr(str, 'x');
+    return sep && ParseValue(std::string(str, sep).c_str(), width) && ParseValue(sep + 1, height)
+           && width >= 64 && height >= 64;
+}
+
+//------------------------------ Synthetic input ------------------------------
+
+/// Planet-like scene: a limb-darkened disc with bands and spots, plus fine detail
+/** Values are in [0; 1]; in case of raw color output, there are 3 planes (R, G, B). */
+class c_Scene
+{
+    unsigned m_Width, m_Height;
+    std::vector<std::vector<float>> m_Planes;
+    std::vector<std::vector<float>> m_BlurredPlanes;
+
+public:
+    c_Scene(unsigned width, unsigned height, unsigned numChannels, std::mt19937 &rng)
+    : m_Width(width), m_Height(height)
+    {
+        std::uniform_real_distribution<double> uniform(0, 1);
+
+        const double radius = 0.35 * std::min(width, height);
+        const double cx = 0.5 * width, cy = 0.5 * height;
+
+        struct Spot_t { double x, y, r, depth; };
+        std::vector<Spot_t> spots;
+        for (int i = 0; i < 12; i++)
+            spots.push_back({ cx + (uniform(rng) - 0.5) * radius, cy + (uniform(rng) - 0.5) * radius,
+                              radius * (0.02 + 0.06 * uniform(rng)), 0.2 + 0.4 * uniform(rng) });
+
+        const double bandPhase = 2 * M_PI * uniform(rng);
+        const double channelGain[3] = { 1.0, 0.85, 0.65 };
+
+        m_Planes.assign(numChannels, std::vector<float>(width * height));
+        for (unsigned y = 0; y < height; y++)
+            for (unsigned x = 0; x < width; x++)
+            {
+                const double dx = (x - cx) / radius, dy = (y - cy) / radius;
+                const double r2 = dx*dx + dy*dy;
+                double value = 0.03; // sky background
+                if (r2 < 1)
+                {
+                    value = 0.25 + 0.65 * std::sqrt(1 - r2); // limb darkening
+                    value *= 0.85 + 0.15 * std::sin(9 * dy + bandPhase);
+                    value *= 0.95 + 0.05 * std::sin(0.7 * x) * std::sin(0.9 * y);
+                    for (const Spot_t &spot: spots)
+                    {
+                        const double d2 = ((x - spot.x) * (x - spot.x) + (y - spot.y) * (y - spot.y)) / (spot.r * spot.r);
+                        value *= 1 - spot.depth * std::exp(-d2);
+                    }
+                }
+
+                for (unsigned ch = 0; ch < numChannels; ch++)
+                    m_Planes[ch][x + y * width] = value * (numChannels == 3 ? channelGain[ch] : 1.0);
+            }
+
+        for (const std::vector<float> &plane: m_Planes)
+            m_BlurredPlanes.push_back(BoxBlur(plane, 2));
+    }
+
+    /// Returns the (bilinearly interpolated) value at (x, y), blended with the blurred scene by 'blur' (in [0; 1])
+    float Sample(unsigned channel, double x, double y, float blur) const
+    {
+        x = std::max(0.0, std::min(x, m_Width - 1.001));
+        y = std::max(0.0, std::min(y, m_Height - 1.001));
+        const unsigned x0 = (unsigned)x, y0 = (unsigned)y;
+        const float tx = x - x0, ty = y - y0;
+
+        auto interpolate = [&](const std::vector<float> &p)
+        {
+            const float *v = &p[x0 + y0 * m_Width];
+            return (1-ty) * ((1-tx) * v[0] + tx * v[1]) + ty * ((1-tx) * v[m_Width] + tx * v[m_Width + 1]);
+        };
+
+        return (1 - blur) * interpolate(m_Planes[channel]) + blur * interpolate(m_BlurredPlanes[channel]);
+    }
+
+private:
+    std::vector<float> BoxBlur(const std::vector<float> &src, int radius) const
+    {
+        std::vector<float> horz(src.size()), result(src.size());
+        for (unsigned y = 0; y < m_Height; y++)
+            for (unsigned x = 0; x < m_Width; x++)
+            {
+                float sum = 0;
+                for (int k = -radius; k <= radius; k++)
+                    sum += src[std::max(0, std::min((int)m_Width - 1, (int)x + k)) + y * m_Width];
+                horz[x + y * m_Width] = sum / (2 * radius + 1);
+            }
+        for (unsigned y = 0; y < m_Height; y++)
+            for (unsigned x = 0; x < m_Width; x++)
+            {
+                float sum = 0;
+                for (int k = -radius; k <= radius; k++)
+                    sum += horz[x + std::max(0, std::min((int)m_Height - 1, (int)y + k)) * m_Width];
+                result[x + y * m_Width] = sum / (2 * radius + 1);
+            }
+        return result;
+    }
+};
+
+/// Returns the index (0 = red, 1 = green, 2 = blue) of the filter color at (x, y)
+static unsigned GetCfaChannel(enum SKRY_CFA_pattern pattern, unsigned x, unsigned y)
+{
+    const char color = SKRY_CFA_pattern_str[pattern][(x % 2) + 2 * (y % 2)];
+    return (color == 'R' ? 0 : (color == 'G' ? 1 : 2));
+}
+
+/// Creates a SER video with translated, distorted and variably blurred views of a synthetic scene
+static bool GenerateVideo(const Settings_t &settings, const std::string &fileName)
+{
+    std::mt19937 rng(settings.seed);
+    std::normal_distribution<double> normal(0, 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    const bool isRaw = (settings.cfaPattern != SKRY_CFA_NONE);
+    const c_Scene scene(settings.width, settings.height, isRaw ? 3 : 1, rng);
+
+    c_SerWriter writer(fileName);
+    if (!writer || !writer.WriteHeader(SER::ColorId::MONO, settings.width, settings.height,
+                                       settings.bitsPerChannel, settings.numFrames, "Stackistry benchmark"))
+    {
+        return false;
+    }
+
+    const double maxValue = (1 << settings.bitsPerChannel) - 1;
+    const double noiseStdDev = 0.01;
+    // Spatial frequency of the local distortion (corresponds to a period of ~100 pixels)
+    const double distortionFreq = 2 * M_PI / 100;
+
+    std::vector<uint8_t> row8(settings.width);
+    std::vector<uint16_t> row16(settings.width);
+    for (unsigned frame = 0; frame < settings.numFrames; frame++)
+    {
+        const double shiftX = settings.jitter * normal(rng), shiftY = settings.jitter * normal(rng);
+        const double distortion = settings.seeing * (0.3 + 1.4 * uniform(rng));
+        const double phaseX = 2 * M_PI * uniform(rng), phaseY = 2 * M_PI * uniform(rng);
+        const float blur = uniform(rng);
+
+        for (unsigned y = 0; y < settings.height; y++)
+        {
+            for (unsigned x = 0; x < settings.width; x++)
+            {
+                const double srcX = x - shiftX + distortion * std::sin(distortionFreq * y + phaseX);
+                const double srcY = y - shiftY + distortion * std::sin(distortionFreq * x + phaseY);
+                const unsigned channel = (isRaw ? GetCfaChannel(settings.cfaPattern, x, y) : 0);
+
+                const double value = scene.Sample(channel, srcX, srcY, blur) + noiseStdDev * normal(rng);
+                const double clamped = std::max(0.0, std::min(maxValue, value * maxValue + 0.5));
+                if (settings.bitsPerChannel == 8)
+                    row8[x] = (uint8_t)clamped;
+                else
+                    row16[x] = (uint16_t)clamped;
+            }
+
+            if (!writer.WriteRow(settings.bitsPerChannel == 8 ? (const void *)row8.data() : (const void *)row16.data()))
+                return false;
+        }
+    }
+
+    return writer.Close();
+}
+
+/// Saves the frames of 'videoFileName' as 16-bit TIFF files in 'dir'; returns their names (empty on failure)
+static std::vector<std::string> ConvertToImageSeries(const std::string &videoFileName, const std::string &dir)
+{
+    enum SKRY_result result;
+    libskry::c_ImageSequence video = libskry::c_ImageSequence::InitVideoFile(videoFileName.c_str(), &result);
+    if (!video)
+        return { };
+
+    std::vector<std::string> fileNames;
+    for (size_t i = 0; i < video.GetImageCount(); i++)
+    {
+        libskry::c_Image img = video.GetImageByIdx(i, &result);
+        if (!img)
+            return { };
+
+        std::ostringstream name;
+        name << "frame_" << std::setw(5) << std::setfill('0') << i << ".tif";
+        fileNames.push_back(Glib::build_filename(dir, name.str()));
+
+        libskry::c_Image img16 = libskry::c_Image::ConvertPixelFormat(img, SKRY_PIX_MONO16);
+        if (SKRY_SUCCESS != img16.Save(fileNames.back().c_str(), SKRY_TIFF_16))
+            return { };
+    }
+    video.Deactivate();
+
+    return fileNames;
+}
+
+//------------------------------ Processing ------------------------------
+
+static void OnWorkerProgress()
+{
+    Glib::Threads::Mutex::Lock lock(Vars::notificationMtx);
+    Vars::notificationPending = true;
+    Vars::notificationCond.signal();
+}
+
+static std::shared_ptr<Job_t> CreateJob(const Settings_t &settings, const std::string &videoFileName,
+                                        const std::vector<std::string> &imageFileNames)
+{
+    std::shared_ptr<Job_t> job;
+    enum SKRY_result result = SKRY_SUCCESS;
+    if (settings.imageSeries)
+    {
+        job = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitImageList(imageFileNames) });
+        job->sourcePath = Glib::path_get_dirname(imageFileNames[0]);
+        job->imageFileNames = imageFileNames;
+    }
+    else
+    {
+        job = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitVideoFile(videoFileName.c_str(), &result) });
+        job->sourcePath = videoFileName;
+    }
+
+    if (!job->imgSeq)
+    {
+        std::cerr << "Could not open the synthetic input: " << Utils::GetErrorMsg(result) << std::endl;
+        return nullptr;
+    }
+
+    Job::SetDefaultSettings(*job);
+    job->outputSaveMode = Utils::Const::OutputSaveMode::NONE;
+    if (settings.cfaPattern != SKRY_CFA_NONE)
+    {
+        job->cfaPattern = settings.cfaPattern;
+        job->imgSeq.ReinterpretAsCFA(job->cfaPattern);
+    }
+
+    return job;
+}
+
+/// Processes 'job' to completion; returns 'false' on failure
+static bool ProcessJob(const std::shared_ptr<Job_t> &job)
+{
+    Worker::c_Worker worker(job, sigc::ptr_fun(&OnWorkerProgress));
+    worker.StartProcessing();
+
+    while (true)
+    {
+        { Glib::Threads::Mutex::Lock lock(Vars::notificationMtx);
+            gint64 endTime = g_get_monotonic_time() + G_TIME_SPAN_SECOND;
+            while (!Vars::notificationPending)
+                if (!Vars::notificationCond.wait_until(Vars::notificationMtx, endTime))
+                    break;
+            Vars::notificationPending = false;
+        }
+
+        worker.AcknowledgeNotification();
+        if (!worker.IsRunning())
+            break;
+    }
+    worker.WaitUntilFinished();
+
+    if ((worker.GetLastResult() != SKRY_SUCCESS && worker.GetLastResult() != SKRY_LAST_STEP) || !job->stackedImg.Get())
+    {
+        std::cerr << "Processing failed: " << Utils::GetErrorMsg(worker.GetLastResult()) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------ Display ------------------------------
+
+struct DisplayResult_t
+{
+    std::string name;
+    double megapixelsPerSec;
+};
+
+/// Measures Utils::ConvertImgToSurface(), reusing the destination surface like the visualization does
+static DisplayResult_t MeasureConversion(const std::string &name, const libskry::c_Image &img, unsigned repetitions,
+                                         Cairo::RefPtr<Cairo::ImageSurface> &surface)
+{
+    surface = Utils::ConvertImgToSurface(img);
+    Glib::Timer timer;
+    for (unsigned i = 0; i < repetitions; i++)
+        Utils::ConvertImgToSurface(img, surface);
+    const double elapsed = timer.elapsed();
+
+    return { name, (elapsed > 0 ? 1.0e-6 * img.GetWidth() * img.GetHeight() * repetitions / elapsed : 0) };
+}
+
+/// Measures drawing of 'img' zoomed by 'zoom' into a viewport, along the same paths as c_ImageViewer
+/** Results are given in megapixels of the viewport per second. */
+static std::vector<DisplayResult_t> MeasureScaling(const Cairo::RefPtr<Cairo::ImageSurface> &img, double zoom, unsigned repetitions)
+{
+    auto viewport = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    auto cr = Cairo::Context::create(viewport);
+    const std::vector<Cairo::Rectangle> clipRects = { { 0, 0, (double)VIEWPORT_WIDTH, (double)VIEWPORT_HEIGHT } };
+    const Cairo::Filter filter = Utils::GetFilter(Utils::Const::Defaults::interpolation);
+    const double viewportMPix = 1.0e-6 * VIEWPORT_WIDTH * VIEWPORT_HEIGHT;
+    const std::string zoomStr = std::to_string((int)std::round(zoom * 100));
+
+    auto toResult = [&](const std::string &name, double elapsed, unsigned numDraws)
+    {
+        return DisplayResult_t { name + "_zoom" + zoomStr, (elapsed > 0 ? viewportMPix * numDraws / elapsed : 0) };
+    };
+
+    std::vector<DisplayResult_t> results;
+
+    Glib::Timer timer;
+    for (unsigned i = 0; i < repetitions; i++)
+    {
+        auto src = Cairo::SurfacePattern::create(img);
+        src->set_matrix(Cairo::Matrix(1/zoom, 0, 0, 1/zoom, 0, 0));
+        src->set_filter(filter);
+        cr->set_source(src);
+        cr->rectangle(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+        cr->fill();
+    }
+    results.push_back(toResult("directScaling", timer.elapsed(), repetitions));
+
+    c_ImagePyramid pyramid;
+    pyramid.SetImage(img);
+    double coldElapsed = 0;
+    for (unsigned i = 0; i < repetitions; i++)
+    {
+        pyramid.Invalidate();
+        timer.start();
+        pyramid.Draw(cr, zoom, filter, clipRects);
+        coldElapsed += timer.elapsed();
+    }
+    results.push_back(toResult("pyramidFirstDraw", coldElapsed, repetitions));
+
+    timer.start();
+    for (unsigned i = 0; i < repetitions; i++)
+        pyramid.Draw(cr, zoom, filter, clipRects);
+    results.push_back(toResult("pyramidRedraw", timer.elapsed(), repetitions));
+
+    return results;
+}
+
+//------------------------------ Results ------------------------------
+
+static std::string GetSimdFlags()
+{
+    std::string flags;
+#if defined(__SSE2__)
+    flags += " sse2";
+#endif
+#if defined(__SSSE3__)
+    flags += " ssse3";
+#endif
+#if defined(__AVX2__)
+    flags += " avx2";
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    flags += " neon";
+#endif
+    return flags.empty() ? flags : flags.substr(1);
+}
+
+static void WriteResults(std::ostream &out, const Settings_t &settings, uint64_t inputBytes,
+                         const std::vector<std::shared_ptr<Job_t>> &runs,
+                         const std::vector<DisplayResult_t> &display)
+{
+    out << std::setprecision(6)
+        << "{\n"
+        << "  \"build\": {\n"
+        << "    \"stackistryVersion\": \"" << VERSION_MAJOR << "." << VERSION_MINOR << "." << VERSION_SUBMINOR << "\",\n"
+        << "    \"libskryVersion\": \"" << LIBSKRY_MAJOR_VERSION << "." << LIBSKRY_MINOR_VERSION << "." << LIBSKRY_SUBMINOR_VERSION << "\",\n"
+#if defined(__VERSION__)
+        << "    \"compiler\": " << Utils::JsonString(__VERSION__) << ",\n"
+#endif
+        << "    \"simd\": " << Utils::JsonString(GetSimdFlags()) << "\n"
+        << "  },\n"
+        << "  \"input\": {\n"
+        << "    \"type\": \"" << (settings.imageSeries ? "tiffSeries" : "ser") << "\",\n"
+        << "    \"width\": " << settings.width << ",\n"
+        << "    \"height\": " << settings.height << ",\n"
+        << "    \"bitsPerChannel\": " << (settings.imageSeries ? 16 : settings.bitsPerChannel) << ",\n"
+        << "    \"cfa\": \"" << (settings.cfaPattern == SKRY_CFA_NONE ? "" : SKRY_CFA_pattern_str[settings.cfaPattern]) << "\",\n"
+        << "    \"numFrames\": " << settings.numFrames << ",\n"
+        << "    \"jitter\": " << settings.jitter << ",\n"
+        << "    \"seeing\": " << settings.seeing << ",\n"
+        << "    \"seed\": " << settings.seed << ",\n"
+        << "    \"numBytes\": " << inputBytes << "\n"
+        << "  },\n"
+        << "  \"threadBudget\": " << settings.threadBudget << ",\n"
+        << "  \"readAheadDepth\": " << settings.readAheadDepth << ",\n"
+        << "  \"runs\": [";
+
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        out << (i > 0 ? "," : "") << "\n";
+        Job::WriteProfile(out, *runs[i], *runs[i]->profile.Get());
+    }
+
+    out << "  ],\n"
+        << "  \"display\": {\n"
+        << "    \"viewportWidth\": " << VIEWPORT_WIDTH << ",\n"
+        << "    \"viewportHeight\": " << VIEWPORT_HEIGHT << ",\n"
+        << "    \"megapixelsPerSec\": {";
+    for (size_t i = 0; i < display.size(); i++)
+        out << (i > 0 ? "," : "") << "\n      " << Utils::JsonString(display[i].name) << ": " << display[i].megapixelsPerSec;
+    out << "\n    }\n"
+        << "  },\n"
+        << "  \"peakMemoryBytes\": " << Utils::GetPeakMemoryUsage() << "\n"
+        << "}\n";
+}
+
+//------------------------------ Main ------------------------------
+
+static bool ParseArguments(int argc, char *argv[], Settings_t &settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const char *val = (i + 1 < argc ? argv[i + 1] : nullptr);
+        bool valid = (val != nullptr);
+
+        if (arg == "--series")
+        {
+            settings.imageSeries = true;
+            continue;
+        }
+        else if (arg == "--keep")
+        {
+            settings.keepFiles = true;
+            continue;
+        }
+        else if (!val)
+            valid = false;
+        else if (arg == "--size")
+            valid = ParseSize(val, settings.width, settings.height);
+        else if (arg == "--bits")
+            valid = ParseValue(val, settings.bitsPerChannel) && (settings.bitsPerChannel == 8 || settings.bitsPerChannel == 16);
+        else if (arg == "--frames")
+            valid = ParseValue(val, settings.numFrames) && settings.numFrames >= 2;
+        else if (arg == "--cfa")
+        {
+            valid = false;
+            for (unsigned pattern = 0; pattern < SKRY_CFA_MAX; pattern++)
+                if (pattern != SKRY_CFA_NONE && 0 == strcmp(val, SKRY_CFA_pattern_str[pattern]))
+                {
+                    settings.cfaPattern = (enum SKRY_CFA_pattern)pattern;
+                    valid = true;
+                }
+        }
+        else if (arg == "--jitter")
+            valid = ParseValue(val, settings.jitter) && settings.jitter >= 0;
+        else if (arg == "--seeing")
+            valid = ParseValue(val, settings.seeing) && settings.seeing >= 0;
+        else if (arg == "--seed")
+            valid = ParseValue(val, settings.seed);
+        else if (arg == "--runs")
+            valid = ParseValue(val, settings.numRuns) && settings.numRuns > 0;
+        else if (arg == "-t" || arg == "--threads")
+            valid = ParseValue(val, settings.threadBudget);
+        else if (arg == "--read-ahead")
+            valid = ParseValue(val, settings.readAheadDepth);
+        else if (arg == "--display-reps")
+            valid = ParseValue(val, settings.displayRepetitions) && settings.displayRepetitions > 0;
+        else if (arg == "-o" || arg == "--output")
+            settings.outputFile = val;
+        else if (arg == "--work-dir")
+        {
+            settings.workDir = val;
+            valid = Glib::file_test(settings.workDir, Glib::FileTest::FILE_TEST_IS_DIR);
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return false;
+        }
+        i++;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+        if (0 == strcmp(argv[i], "-h") || 0 == strcmp(argv[i], "--help"))
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+
+    Settings_t settings;
+    if (!ParseArguments(argc, argv, settings))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Utils::SetAppLaunchPath(argv[0]);
+    SKRY_initialize();
+    SKRY_set_clock_func(ClockSec);
+
+    bool createdWorkDir = false;
+    if (settings.workDir.empty())
+    {
+        gchar *tmpDir = g_dir_make_tmp("stackistry_bench_XXXXXX", nullptr);
+        if (!tmpDir)
+        {
+            std::cerr << "Could not create a temporary directory." << std::endl;
+            return 1;
+        }
+        settings.workDir = tmpDir;
+        g_free(tmpDir);
+        createdWorkDir = true;
+    }
+
+    const std::string videoFileName = Glib::build_filename(settings.workDir, "bench.ser");
+    std::vector<std::string> imageFileNames;
+    int exitCode = 0;
+
+    std::cerr << "Generating " << settings.numFrames << " frames in " << settings.workDir << "..." << std::endl;
+    if (!GenerateVideo(settings, videoFileName))
+    {
+        std::cerr << "Could not create " << videoFileName << std::endl;
+        exitCode = 1;
+    }
+    else if (settings.imageSeries && (imageFileNames = ConvertToImageSeries(videoFileName, settings.workDir)).empty())
+    {
+        std::cerr << "Could not create the image series." << std::endl;
+        exitCode = 1;
+    }
+
+    uint64_t inputBytes = 0;
+    for (const std::string &fileName: settings.imageSeries ? imageFileNames : std::vector<std::string>{ videoFileName })
+    {
+        GStatBuf stat;
+        if (0 == g_stat(fileName.c_str(), &stat))
+            inputBytes += stat.st_size;
+    }
+
+    Worker::SetVisualizationEnabled(false);
+    Worker::SetThreadBudget(settings.threadBudget);
+    Worker::SetReadAheadDepth(settings.readAheadDepth);
+
+    std::vector<std::shared_ptr<Job_t>> runs;
+    std::vector<DisplayResult_t> display;
+    for (unsigned run = 0; run < settings.numRuns && exitCode == 0; run++)
+    {
+        std::cerr << "Processing (run " << run + 1 << " of " << settings.numRuns << ")..." << std::endl;
+        std::shared_ptr<Job_t> job = CreateJob(settings, videoFileName, imageFileNames);
+        if (!job || !ProcessJob(job))
+        {
+            exitCode = 1;
+            break;
+        }
+        runs.push_back(job);
+
+        if (run == 0)
+        {
+            std::cerr << "Measuring display..." << std::endl;
+
+            enum SKRY_result result;
+            libskry::c_Image frame = job->imgSeq.GetImageByIdx(job->imgSeq.GetAbsoluteImgIdx(0), &result);
+            Cairo::RefPtr<Cairo::ImageSurface> frameSurface, stackSurface;
+            if (frame)
+                display.push_back(MeasureConversion("convertFrame", frame, settings.displayRepetitions, frameSurface));
+            display.push_back(MeasureConversion("convertStack", *job->stackedImg.Get(), settings.displayRepetitions, stackSurface));
+
+            if (stackSurface)
+                for (double zoom: { 0.25, 0.5, 2.0 })
+                    for (const DisplayResult_t &scaling: MeasureScaling(stackSurface, zoom, settings.displayRepetitions))
+                        display.push_back(scaling);
+        }
+        job->imgSeq.Deactivate();
+    }
+
+    if (exitCode == 0)
+    {
+        if (settings.outputFile.empty())
+            WriteResults(std::cout, settings, inputBytes, runs, display);
+        else
+        {
+            std::ofstream file(settings.outputFile.c_str());
+            WriteResults(file, settings, inputBytes, runs, display);
+            if (file.fail())
+            {
+                std::cerr << "Could not write " << settings.outputFile << std::endl;
+                exitCode = 1;
+            }
+            else
+                std::cerr << "Results saved as " << settings.outputFile << std::endl;
+        }
+    }
+
+    runs.clear();
+    if (!settings.keepFiles)
+    {
+        for (const std::string &fileName: imageFileNames)
+            g_remove(fileName.c_str());
+        g_remove(videoFileName.c_str());
+        if (createdWorkDir)
+            g_rmdir(settings.workDir.c_str());
+    }
+
+    SKRY_deinitialize();
+
+    return exitCode;
+}
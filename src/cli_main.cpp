@@ -0,0 +1,688 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Command-line (headless) batch processing program file.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+#include <glibmm/threads.h>
+#include <glibmm/timer.h>
+#include <skry/skry.h>
+
+#include "image_writer.h"
+#include "job.h"
+#include "partial_stack.h"
+#include "utils.h"
+#include "version.h"
+#include "worker.h"
+
+
+namespace Vars
+{
+    /// Signaled by workers (from their threads) on every progress notification
+    Glib::Threads::Mutex notificationMtx;
+    Glib::Threads::Cond notificationCond;
+    bool notificationPending = false;
+}
+
+struct Settings_t
+{
+    unsigned maxConcurrentJobs = 1;
+    unsigned threadBudget = 0; ///< 0 = all logical CPUs
+    unsigned readAheadDepth = Utils::Const::Defaults::ReadAheadFrames;
+    bool exportInactiveFramesQuality = false;
+    bool verbose = false;
+    std::string mergeOutput; ///< If not empty, the inputs are partial stacks to be merged into this file
+};
+
+static double ClockSec()
+{
+    return 1.0/1000000 * std::chrono::duration_cast<std::chrono::microseconds>
+               (std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+static void PrintUsage(const char *exeName)
+{
+    std::cout <<
+        "Stackistry " << VERSION_MAJOR << "." << VERSION_MINOR << "." << VERSION_SUBMINOR << " - headless batch processing\n\n"
+        "Usage: " << Glib::path_get_basename(exeName) << " [options] INPUT...\n\n"
+        "INPUT is a video file (AVI, SER) or a directory containing an image series (BMP, TIFF);\n"
+        "with --merge, a partial stack.\n"
+        "The settings below are applied to all inputs.\n\n"
+        "Output:\n"
+        "  -o, --output-dir DIR             save results in DIR (default: next to the input)\n"
+        "  -f, --format FMT                 bmp8, tiff16, png8, tiff32f or fits32f\n"
+        "                                   (default: tiff16)\n"
+        "  --export-quality                 save frame quality data next to the stack\n"
+        "  --export-inactive                include inactive frames in the quality data\n"
+        "\n"
+        "Processing:\n"
+        "  --alignment METHOD               anchors or centroid (default: anchors)\n"
+        "  --anchors X,Y[;X,Y...]           video stabilization anchors (default: automatic)\n"
+        "  --roi X,Y,W,H                    process only this region of the images\n"
+        "                                   (ref. points are then relative to the region)\n"
+        "  --criterion CRIT                 percent, relative or number (default: percent)\n"
+        "  --threshold N[,N...]             quality threshold, interpreted according to --criterion;\n"
+        "                                   each additional value produces another stack\n"
+        "  --ref-points X,Y[;X,Y...]        reference points (default: automatic)\n"
+        "  --ref-pt-spacing N               automatic ref. points spacing in pixels\n"
+        "  --ref-pt-brightness F            min. brightness of automatic ref. points [0; 1]\n"
+        "  --ref-pt-structure-threshold F   structure detection threshold\n"
+        "  --ref-pt-structure-scale N       structure scale\n"
+        "  --ref-pt-block-size N            reference block size in pixels\n"
+        "  --ref-pt-search-radius N         search radius in pixels\n"
+        "  --flat-field FILE                flat-field image\n"
+        "  --cfa PATTERN                    treat mono images as raw color (e.g. RGGB)\n"
+        "  --overlap-quality-read           read quality estimation input during video stabilization\n"
+        "  --analysis-cache                 store frame quality (and alignment, for --part) next to the input\n"
+        "                                   and reuse it\n"
+        "  --bin N                          quick look: bin frames N x N (2 or 3) before processing;\n"
+        "                                   other settings still refer to full resolution\n"
+        "\n"
+        "Execution:\n"
+        "  -j, --jobs N                     number of jobs processed simultaneously (default: 1)\n"
+        "  -t, --threads N                  total number of processing threads (default: all CPUs)\n"
+        "  --read-ahead N                   number of frames read ahead in background (default: 8, 0 = off)\n"
+        "  -v, --verbose                    print processing phase changes and per-phase timings\n"
+        "  -h, --help                       show this text\n"
+        "\n"
+        "Distributed stacking:\n"
+        "  --analyze                        only align the frames and estimate their quality, and store\n"
+        "                                   the results in the analysis cache (needed by --part)\n"
+        "  --part I/N                       process only the I-th of N equal ranges of the frames (e.g. on\n"
+        "                                   machine I of N) using the analysis of all frames, and save\n"
+        "                                   the result as a partial stack\n"
+        "  --merge FILE                     merge the partial stacks given as INPUT into FILE (in the format\n"
+        "                                   given by -f); other options are ignored\n";
+}
+
+template<typename T>
+static bool ParseValue(const char *str, T &result)
+{
+    std::stringstream ss(str);
+    ss >> result;
+    return !ss.fail() && ss.eof();
+}
+
+/// Parses a rectangle in the form "X,Y,W,H"
+static bool ParseRect(const char *str, struct SKRY_rect &rect)
+{
+    char sep[3];
+    int width, height;
+    std::stringstream parser(str);
+    parser >> rect.x >> sep[0] >> rect.y >> sep[1] >> width >> sep[2] >> height;
+    if (parser.fail() || !(parser >> std::ws).eof() || sep[0] != ',' || sep[1] != ',' || sep[2] != ',' ||
+        rect.x < 0 || rect.y < 0 || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+    rect.width = width;
+    rect.height = height;
+    return true;
+}
+
+/// Parses a job part in the form "I/N" (I counted from 1)
+static bool ParsePart(const char *str, unsigned &index, unsigned &count)
+{
+    char sep;
+    std::stringstream parser(str);
+    parser >> index >> sep >> count;
+    if (parser.fail() || !(parser >> std::ws).eof() || sep != '/' || index == 0 || index > count)
+        return false;
+
+    index--;
+    return true;
+}
+
+/// Parses a list of points in the form "X,Y;X,Y;..."
+static bool ParsePoints(const char *str, std::vector<struct SKRY_point> &points)
+{
+    points.clear();
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ';'))
+    {
+        struct SKRY_point pt;
+        char sep;
+        std::stringstream parser(item);
+        parser >> pt.x >> sep >> pt.y;
+        if (parser.fail() || sep != ',')
+            return false;
+        points.push_back(pt);
+    }
+    return !points.empty();
+}
+
+static bool ParseOutputFormat(const char *str, ImageWriter::OutputFormat_t &fmt)
+{
+    const struct { const char *name; ImageWriter::OutputFormat_t fmt; } formats[] =
+    {
+        { "bmp8",    SKRY_BMP_8 },
+        { "tiff16",  SKRY_TIFF_16 },
+        { "png8",    SKRY_PNG_8 },
+        { "tiff32f", ImageWriter::OwnFormat::TIFF_32F },
+        { "fits32f", ImageWriter::OwnFormat::FITS_32F }
+    };
+
+    for (auto &f: formats)
+        if (0 == strcmp(str, f.name))
+        {
+            for (auto &descr: Utils::Vars::outputFormatDescription)
+                if (descr.outputFmt == f.fmt)
+                {
+                    fmt = f.fmt;
+                    return true;
+                }
+
+            std::cerr << "Output format " << str << " is not supported by this build of libskry." << std::endl;
+            return false;
+        }
+
+    return false;
+}
+
+/// Creates a job for the specified video file or image series directory
+static std::shared_ptr<Job_t> CreateJob(const std::string &path)
+{
+    std::shared_ptr<Job_t> job;
+
+    if (Glib::file_test(path, Glib::FileTest::FILE_TEST_IS_DIR))
+    {
+        std::vector<std::string> fileNames;
+        Glib::Dir dir(path);
+        for (const std::string &name: dir)
+        {
+            std::string fullPath = Glib::build_filename(path, name);
+            if (Glib::file_test(fullPath, Glib::FileTest::FILE_TEST_IS_REGULAR))
+                fileNames.push_back(fullPath);
+        }
+        std::sort(fileNames.begin(), fileNames.end());
+
+        if (fileNames.size() <= 1)
+        {
+            std::cerr << path << ": at least two image files are required." << std::endl;
+            return nullptr;
+        }
+
+        job = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitImageList(fileNames) });
+        job->sourcePath = path;
+        job->imageFileNames = fileNames;
+    }
+    else
+    {
+        enum SKRY_result result;
+        job = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitVideoFile(path.c_str(), &result) });
+        if (!job->imgSeq)
+        {
+            std::cerr << "Could not open video file " << path << ": " << Utils::GetErrorMsg(result) << std::endl;
+            return nullptr;
+        }
+        job->sourcePath = path;
+    }
+
+    if (!job->imgSeq)
+    {
+        std::cerr << path << ": failed to initialize image sequence." << std::endl;
+        return nullptr;
+    }
+
+    Job::SetDefaultSettings(*job);
+    return job;
+}
+
+/// Returns 'true' if 'opt' is a job setting; 'takesValue' indicates if it is followed by a value
+static bool IsJobOption(const std::string &opt, bool &takesValue)
+{
+    const char *const valueOpts[] =
+    {
+        "-o", "--output-dir", "-f", "--format", "--alignment", "--anchors", "--roi", "--criterion", "--threshold",
+        "--ref-points", "--ref-pt-spacing", "--ref-pt-brightness", "--ref-pt-structure-threshold",
+        "--ref-pt-structure-scale", "--ref-pt-block-size", "--ref-pt-search-radius", "--flat-field", "--cfa", "--bin",
+        "--part"
+    };
+
+    takesValue = (std::find_if(std::begin(valueOpts), std::end(valueOpts),
+                               [&opt](const char *o) { return opt == o; }) != std::end(valueOpts));
+
+    return takesValue || opt == "--export-quality" || opt == "--overlap-quality-read" || opt == "--analysis-cache" ||
+           opt == "--analyze";
+}
+
+/// Applies a job setting specified in the command line; returns 'false' on invalid value
+static bool ApplyJobOption(const std::string &opt, const char *val, Job_t &job)
+{
+    if (opt == "--export-quality")
+    {
+        job.exportQualityData = true;
+        return true;
+    }
+    else if (opt == "--overlap-quality-read")
+    {
+        job.overlapQualityRead = true;
+        return true;
+    }
+    else if (opt == "--analysis-cache")
+    {
+        job.useAnalysisCache = true;
+        return true;
+    }
+    else if (opt == "--analyze")
+    {
+        job.useAnalysisCache = true;
+        job.analysisOnly = true;
+        return true;
+    }
+    else if (opt == "-o" || opt == "--output-dir")
+    {
+        job.outputSaveMode = Utils::Const::OutputSaveMode::SPECIFIED_PATH;
+        job.destDir = val;
+        return Glib::file_test(job.destDir, Glib::FileTest::FILE_TEST_IS_DIR);
+    }
+    else if (opt == "-f" || opt == "--format")
+        return ParseOutputFormat(val, job.outputFmt);
+    else if (opt == "--alignment")
+    {
+        if (0 == strcmp(val, "anchors"))
+            job.alignmentMethod = SKRY_IMG_ALGN_ANCHORS;
+        else if (0 == strcmp(val, "centroid"))
+            job.alignmentMethod = SKRY_IMG_ALGN_CENTROID;
+        else
+            return false;
+        return true;
+    }
+    else if (opt == "--anchors")
+    {
+        job.automaticAnchorPlacement = false;
+        return ParsePoints(val, job.anchors);
+    }
+    else if (opt == "--roi")
+    {
+        return ParseRect(val, job.roi);
+    }
+    else if (opt == "--bin")
+        return ParseValue(val, job.binning) && job.binning >= 1 && job.binning <= Utils::Const::maxQuickLookBinning;
+    else if (opt == "--criterion")
+    {
+        if (0 == strcmp(val, "percent"))
+            job.quality.criterion = SKRY_quality_criterion::SKRY_PERCENTAGE_BEST;
+        else if (0 == strcmp(val, "relative"))
+            job.quality.criterion = SKRY_quality_criterion::SKRY_MIN_REL_QUALITY;
+        else if (0 == strcmp(val, "number"))
+            job.quality.criterion = SKRY_quality_criterion::SKRY_NUMBER_BEST;
+        else
+            return false;
+        return true;
+    }
+    else if (opt == "--threshold")
+    {
+        // The first value is the main threshold; each of the others produces an additional stack
+        std::vector<unsigned> thresholds;
+        if (!Utils::ParseUnsignedList(val, thresholds) || thresholds.empty())
+            return false;
+        job.quality.threshold = thresholds[0];
+        job.quality.additionalThresholds.assign(thresholds.begin() + 1, thresholds.end());
+        return true;
+    }
+    else if (opt == "--ref-points")
+    {
+        job.automaticRefPointsPlacement = false;
+        return ParsePoints(val, job.refPoints);
+    }
+    else if (opt == "--ref-pt-spacing")
+        return ParseValue(val, job.refPtAutoPlacementParams.spacing);
+    else if (opt == "--ref-pt-brightness")
+        return ParseValue(val, job.refPtAutoPlacementParams.brightnessThreshold);
+    else if (opt == "--ref-pt-structure-threshold")
+        return ParseValue(val, job.refPtAutoPlacementParams.structureThreshold);
+    else if (opt == "--ref-pt-structure-scale")
+        return ParseValue(val, job.refPtAutoPlacementParams.structureScale);
+    else if (opt == "--ref-pt-block-size")
+        return ParseValue(val, job.refPtBlockSize);
+    else if (opt == "--ref-pt-search-radius")
+        return ParseValue(val, job.refPtSearchRadius);
+    else if (opt == "--flat-field")
+    {
+        job.flatFieldFileName = val;
+        return Glib::file_test(job.flatFieldFileName, Glib::FileTest::FILE_TEST_IS_REGULAR);
+    }
+    else if (opt == "--part")
+    {
+        // Selected by SelectJobPart() after all other settings
+        unsigned index, count;
+        return ParsePart(val, index, count);
+    }
+    else if (opt == "--cfa")
+    {
+        for (unsigned pattern = 0; pattern < SKRY_CFA_MAX; pattern++)
+            if (0 == strcmp(val, SKRY_CFA_pattern_str[pattern]))
+            {
+                job.cfaPattern = (enum SKRY_CFA_pattern)pattern;
+                job.imgSeq.ReinterpretAsCFA(job.cfaPattern);
+                return true;
+            }
+        return false;
+    }
+
+    return false;
+}
+
+/// Selects the part of 'job' given by the "--part" option (if any); returns 'false' on failure
+static bool SelectJobPart(const std::vector<std::pair<std::string, const char *>> &jobOptions, Job_t &job)
+{
+    for (auto &option: jobOptions)
+        if (option.first == "--part")
+        {
+            if (job.analysisOnly)
+            {
+                std::cerr << "--analyze applies to the whole job; it cannot be combined with --part" << std::endl;
+                return false;
+            }
+
+            unsigned index, count;
+            if (!ParsePart(option.second, index, count) || !Job::SelectPart(job, index, count))
+            {
+                std::cerr << job.sourcePath << ": cannot select part " << option.second
+                          << " (too few active frames?)" << std::endl;
+                return false;
+            }
+        }
+
+    return true;
+}
+
+/// Saves the results of a finished job; returns 'false' if processing or saving failed
+static bool FinalizeJob(Worker::c_Worker &worker, const Settings_t &settings, double elapsedSec)
+{
+    Job_t &job = *worker.GetJob();
+
+    worker.WaitUntilFinished();
+
+    bool success = (worker.GetLastResult() == SKRY_SUCCESS || worker.GetLastResult() == SKRY_LAST_STEP)
+                   && (job.analysisOnly || job.stackedImg.Get());
+
+    if (success)
+    {
+        if (job.exportQualityData && job.quality.data.Get())
+        {
+            std::string qualityPath = Job::GetQualityDataPath(job);
+            if (!Job::ExportQualityData(qualityPath, job, settings.exportInactiveFramesQuality))
+                std::cerr << "Could not save frame quality data as " << qualityPath << std::endl;
+        }
+
+        if (job.exportQualityData && job.profile.Get())
+        {
+            std::string profilePath = Job::GetProfilePath(job);
+            if (!Job::ExportProfile(profilePath, job))
+                std::cerr << "Could not save processing profile as " << profilePath << std::endl;
+        }
+
+        if (job.outputSaveMode != Utils::Const::OutputSaveMode::NONE && !job.analysisOnly)
+            success = Job::AutoSaveStack(job);
+    }
+
+    job.imgSeq.Deactivate();
+
+    std::cout << job.sourcePath << ": "
+              << (success ? (job.analysisOnly ? "analyzed" : "processed") : "error: " + Utils::GetErrorMsg(worker.GetLastResult()))
+              << " (" << std::fixed << std::setprecision(2) << elapsedSec << " s)" << std::endl;
+
+    if (settings.verbose && job.profile.Get())
+        std::cout << Job::FormatProfile(*job.profile.Get()) << std::endl;
+
+    return success;
+}
+
+static void OnWorkerProgress()
+{
+    Glib::Threads::Mutex::Lock lock(Vars::notificationMtx);
+    Vars::notificationPending = true;
+    Vars::notificationCond.signal();
+}
+
+/// Returns the number of failed jobs
+static unsigned ProcessJobs(std::queue<std::shared_ptr<Job_t>> &jobs, const Settings_t &settings)
+{
+    struct RunningJob_t
+    {
+        std::unique_ptr<Worker::c_Worker> worker;
+        Glib::Timer timer;
+        Worker::ProcPhase lastPhase;
+    };
+    std::list<RunningJob_t> runningJobs;
+    unsigned numFailed = 0;
+
+    Worker::SetVisualizationEnabled(false);
+    Worker::SetThreadBudget(settings.threadBudget);
+    Worker::SetReadAheadDepth(settings.readAheadDepth);
+
+    while (!jobs.empty() || !runningJobs.empty())
+    {
+        while (!jobs.empty() && runningJobs.size() < settings.maxConcurrentJobs)
+        {
+            runningJobs.emplace_back();
+            RunningJob_t &runningJob = runningJobs.back();
+            runningJob.worker.reset(new Worker::c_Worker(jobs.front(), sigc::ptr_fun(&OnWorkerProgress)));
+            runningJob.lastPhase = Worker::ProcPhase::IDLE;
+            jobs.pop();
+
+            runningJob.timer.start();
+            runningJob.worker->StartProcessing();
+        }
+
+        { Glib::Threads::Mutex::Lock lock(Vars::notificationMtx);
+            // The timeout is only a safeguard; workers notify us on every change of state
+            gint64 endTime = g_get_monotonic_time() + G_TIME_SPAN_SECOND;
+            while (!Vars::notificationPending)
+                if (!Vars::notificationCond.wait_until(Vars::notificationMtx, endTime))
+                    break;
+            Vars::notificationPending = false;
+        }
+
+        for (auto runningJob = runningJobs.begin(); runningJob != runningJobs.end(); )
+        {
+            Worker::c_Worker &worker = *runningJob->worker;
+            worker.AcknowledgeNotification();
+
+            if (settings.verbose && worker.GetPhase() != runningJob->lastPhase)
+            {
+                runningJob->lastPhase = worker.GetPhase();
+                std::cout << worker.GetJob()->sourcePath << ": " << Worker::GetProcPhaseStr(runningJob->lastPhase) << std::endl;
+            }
+
+            if (worker.IsRunning())
+            {
+                runningJob++;
+                continue;
+            }
+
+            if (!FinalizeJob(worker, settings, runningJob->timer.elapsed()))
+                numFailed++;
+
+            runningJob = runningJobs.erase(runningJob);
+        }
+    }
+
+    return numFailed;
+}
+
+/// Merges the partial stacks 'inputs' and saves the result as 'outputFile'; returns 'false' on failure
+static bool MergePartialStacks(const std::vector<std::string> &inputs, const std::string &outputFile,
+                               const ImageWriter::OutputFormat_t &outputFmt)
+{
+    size_t numFrames;
+    std::string errorMsg;
+    std::shared_ptr<const libskry::c_Image> merged = PartialStack::Merge(inputs, numFrames, errorMsg);
+    if (!merged)
+    {
+        std::cerr << errorMsg << std::endl;
+        return false;
+    }
+
+    enum SKRY_result result = ImageWriter::Save(*merged, outputFile, outputFmt);
+    if (result != SKRY_SUCCESS)
+    {
+        std::cerr << "Could not save " << outputFile << ": " << Utils::GetErrorMsg(result) << std::endl;
+        return false;
+    }
+
+    std::cout << outputFile << ": merged " << inputs.size() << " partial stacks (" << numFrames << " frames)" << std::endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Utils::SetAppLaunchPath(argv[0]);
+
+    SKRY_initialize();
+    SKRY_set_clock_func(ClockSec);
+    Utils::EnumerateSupportedOutputFmts();
+
+    Settings_t settings;
+    std::vector<std::string> inputs;
+    /// Job settings (option, value) applied to every input after it is opened
+    std::vector<std::pair<std::string, const char *>> jobOptions;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool takesValue;
+
+        if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-v" || arg == "--verbose")
+            settings.verbose = true;
+        else if (arg == "--export-inactive")
+            settings.exportInactiveFramesQuality = true;
+        else if (arg == "--merge")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            settings.mergeOutput = argv[++i];
+        }
+        else if (arg == "-j" || arg == "--jobs" || arg == "-t" || arg == "--threads" || arg == "--read-ahead")
+        {
+            unsigned val;
+            if (i + 1 >= argc || !ParseValue(argv[i+1], val) || ((arg == "-j" || arg == "--jobs") && val == 0))
+            {
+                std::cerr << "Invalid value for " << arg << std::endl;
+                return 1;
+            }
+            if (arg == "-j" || arg == "--jobs")
+                settings.maxConcurrentJobs = val;
+            else if (arg == "--read-ahead")
+                settings.readAheadDepth = val;
+            else
+                settings.threadBudget = val;
+            i++;
+        }
+        else if (IsJobOption(arg, takesValue))
+        {
+            if (takesValue && i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            jobOptions.push_back({ arg, takesValue ? argv[++i] : nullptr });
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        else
+            inputs.push_back(arg);
+    }
+
+    if (inputs.empty())
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (!settings.mergeOutput.empty())
+    {
+        ImageWriter::OutputFormat_t outputFmt = Utils::Const::Defaults::outputFmt;
+        for (auto &option: jobOptions)
+            if ((option.first == "-f" || option.first == "--format") && !ParseOutputFormat(option.second, outputFmt))
+            {
+                std::cerr << "Invalid value for " << option.first << ": " << option.second << std::endl;
+                return 1;
+            }
+
+        const bool success = MergePartialStacks(inputs, settings.mergeOutput, outputFmt);
+        SKRY_deinitialize();
+        return success ? 0 : 1;
+    }
+
+    std::queue<std::shared_ptr<Job_t>> jobs;
+    unsigned numFailed = 0;
+    for (const std::string &input: inputs)
+    {
+        std::shared_ptr<Job_t> job = CreateJob(input);
+        if (!job)
+        {
+            numFailed++;
+            continue;
+        }
+
+        for (auto &option: jobOptions)
+            if (!ApplyJobOption(option.first, option.second, *job))
+            {
+                std::cerr << "Invalid value for " << option.first << ": " << (option.second ? option.second : "")  << std::endl;
+                return 1;
+            }
+
+        if (!SelectJobPart(jobOptions, *job))
+            return 1;
+
+        jobs.push(job);
+    }
+
+    // Measured from here on, so that it includes only the actual processing
+    Glib::Timer totalTimer;
+    numFailed += ProcessJobs(jobs, settings);
+    double totalSec = totalTimer.elapsed();
+
+    std::cout << "Processing time: " << std::fixed << std::setprecision(2) << totalSec << " s" << std::endl;
+
+    SKRY_deinitialize();
+
+    return numFailed ? 1 : 0;
+}
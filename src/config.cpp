@@ -21,6 +21,7 @@ File description:
     Application configuration implementation.
 */
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -37,6 +38,7 @@ namespace Group
 {
     const char *UI = "UI";
     const char *Output = "Output";
+    const char *Processing = "Processing";
 }
 
 namespace Key
@@ -58,6 +60,11 @@ namespace Key
     const char *LastOpenDir = "LastOpenDir";
     const char *mainWndPanedPos = "MainWndPanedPos";
     const char *numQualityHistBins = "NumQualityHistogramBins";
+    const char *maxConcurrentJobs = "MaxConcurrentJobs";
+    const char *workerThreadBudget = "WorkerThreadBudget";
+    const char *frameCacheSizeMiB = "FrameCacheSizeMiB";
+    const char *readAheadFrames = "ReadAheadFrames";
+    const char *visualizationMaxFps = "VisualizationMaxFps";
 
     const char *exportInactiveFramesQuality = "ExportInactiveFramesQuality";
 
@@ -234,6 +241,26 @@ c_Property<size_t> NumQualityHistogramBins(
     []() { return (size_t)GetUnsignedVal(Group::UI, Key::numQualityHistBins, Utils::Const::Defaults::NumQualityHistogramBins); },
     [](const size_t &n) { configFile.set_integer(Group::UI, Key::numQualityHistBins, n); });
 
+c_Property<unsigned> MaxConcurrentJobs(
+    []() { return std::max(1U, GetUnsignedVal(Group::Processing, Key::maxConcurrentJobs, Utils::Const::Defaults::MaxConcurrentJobs)); },
+    [](const unsigned &n) { configFile.set_integer(Group::Processing, Key::maxConcurrentJobs, n); });
+
+c_Property<unsigned> WorkerThreadBudget(
+    []() { return GetUnsignedVal(Group::Processing, Key::workerThreadBudget, Utils::Const::Defaults::WorkerThreadBudget); },
+    [](const unsigned &n) { configFile.set_integer(Group::Processing, Key::workerThreadBudget, n); });
+
+c_Property<int> FrameCacheSizeMiB(
+    []() { return std::max(0, GetIntVal(Group::Processing, Key::frameCacheSizeMiB, Utils::Const::Defaults::FrameCacheSizeMiB)); },
+    [](const int &size) { configFile.set_integer(Group::Processing, Key::frameCacheSizeMiB, size); });
+
+c_Property<int> ReadAheadFrames(
+    []() { return std::max(0, GetIntVal(Group::Processing, Key::readAheadFrames, Utils::Const::Defaults::ReadAheadFrames)); },
+    [](const int &n) { configFile.set_integer(Group::Processing, Key::readAheadFrames, n); });
+
+c_Property<unsigned> VisualizationMaxFps(
+    []() { return GetUnsignedVal(Group::Processing, Key::visualizationMaxFps, Utils::Const::Defaults::VisualizationMaxFps); },
+    [](const unsigned &fps) { configFile.set_integer(Group::Processing, Key::visualizationMaxFps, fps); });
+
 
 bool Initialize()
 {
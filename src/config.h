@@ -78,6 +78,17 @@ namespace Configuration
     extern c_Property<bool> ExportInactiveFramesQuality;
     extern c_Property<size_t> NumQualityHistogramBins;
 
+    /// Max. number of jobs processed simultaneously
+    extern c_Property<unsigned> MaxConcurrentJobs;
+    /// Total number of worker threads shared by all running jobs; 0 = all logical CPUs
+    extern c_Property<unsigned> WorkerThreadBudget;
+    /// Memory budget of the decoded frame cache (in MiB); 0 disables the cache
+    extern c_Property<int> FrameCacheSizeMiB;
+    /// Number of frames read ahead during processing; 0 disables reading ahead
+    extern c_Property<int> ReadAheadFrames;
+    /// Max. number of visualization images rendered per second during processing
+    extern c_Property<unsigned> VisualizationMaxFps;
+
     /// format: <language>_<country>, e.g. "pl_PL"; empty = system default language
     extern c_Property<std::string> UILanguage;
 }
@@ -0,0 +1,167 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Flat-field creation and cache implementation.
+*/
+
+#include <cstdint>
+#include <map>
+
+#include <glib/gstdio.h>
+#include <glibmm/threads.h>
+
+#include "flat_field.h"
+
+
+c_FlatFieldCreation::c_FlatFieldCreation(libskry::c_ImageSequence &imgSeq)
+: m_ImgSeq(imgSeq)
+{ }
+
+enum SKRY_result c_FlatFieldCreation::Step()
+{
+    if (m_NextImgIdx >= m_ImgSeq.GetActiveImageCount())
+        return SKRY_LAST_STEP;
+
+    enum SKRY_result result;
+    libskry::c_Image img = m_ImgSeq.GetImageByIdx(m_ImgSeq.GetAbsoluteImgIdx(m_NextImgIdx), &result);
+    if (!img)
+        return result;
+
+    // The image's own copy is used for the final result (and provides its size)
+    libskry::c_Image monoImg = libskry::c_Image::ConvertPixelFormat(img, SKRY_PIX_MONO32F);
+    if (!monoImg)
+        return SKRY_OUT_OF_MEMORY;
+
+    const unsigned width = monoImg.GetWidth(),
+                   height = monoImg.GetHeight();
+
+    if (m_NextImgIdx == 0)
+        m_Sum.assign((size_t)width * height, 0);
+    else if (m_Sum.size() != (size_t)width * height || width != m_FlatField.GetWidth())
+        return SKRY_INVALID_IMG_DIMENSIONS;
+
+    #pragma omp parallel for
+    for (unsigned y = 0; y < height; y++)
+    {
+        const float *src = static_cast<const float *>(monoImg.GetLine(y));
+        double *sum = &m_Sum[(size_t)y * width];
+        for (unsigned x = 0; x < width; x++)
+            sum[x] += src[x];
+    }
+
+    if (m_NextImgIdx == 0)
+        m_FlatField = std::move(monoImg);
+
+    m_NextImgIdx++;
+    if (m_NextImgIdx < m_ImgSeq.GetActiveImageCount())
+        return SKRY_SUCCESS;
+
+    const double numImages = m_NextImgIdx;
+    #pragma omp parallel for
+    for (unsigned y = 0; y < height; y++)
+    {
+        float *dest = static_cast<float *>(m_FlatField.GetLine(y));
+        const double *sum = &m_Sum[(size_t)y * width];
+        for (unsigned x = 0; x < width; x++)
+            dest[x] = (float)(sum[x] / numImages);
+    }
+    m_Sum = std::vector<double>();
+
+    return SKRY_LAST_STEP;
+}
+
+namespace FlatFieldCache
+{
+
+/// Max. number of cached flat-fields; the least recently used ones are removed first
+const size_t MAX_ENTRIES = 4;
+
+struct Entry_t
+{
+    std::shared_ptr<const libskry::c_Image> img;
+    int64_t modificationTime;
+    int64_t fileSize;
+    uint64_t lastUse; ///< Value of 'Vars::useCounter' at the last access
+};
+
+namespace Vars
+{
+    Glib::Threads::Mutex mtx; ///< Guards all the variables below
+
+    std::map<std::string, Entry_t> entries; ///< Key: file name
+    uint64_t useCounter = 0;
+}
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(Vars::mtx)
+
+std::shared_ptr<const libskry::c_Image> Get(const std::string &fileName, enum SKRY_result &result)
+{
+    GStatBuf stat;
+    if (0 != g_stat(fileName.c_str(), &stat))
+    {
+        result = SKRY_CANNOT_OPEN_FILE;
+        return nullptr;
+    }
+
+    { LOCK();
+        auto it = Vars::entries.find(fileName);
+        if (it != Vars::entries.end())
+        {
+            if (it->second.modificationTime == (int64_t)stat.st_mtime && it->second.fileSize == (int64_t)stat.st_size)
+            {
+                it->second.lastUse = ++Vars::useCounter;
+                result = SKRY_SUCCESS;
+                return it->second.img;
+            }
+            else
+                Vars::entries.erase(it);
+        }
+    }
+
+    // Loading is done without locking; if several jobs load the same file at once, the last one is cached
+    libskry::c_Image loaded = libskry::c_Image::Load(fileName.c_str(), &result);
+    if (!loaded)
+        return nullptr;
+
+    auto img = std::make_shared<libskry::c_Image>(libskry::c_Image::ConvertPixelFormat(loaded, SKRY_PIX_MONO32F));
+    if (!*img)
+    {
+        result = SKRY_OUT_OF_MEMORY;
+        return nullptr;
+    }
+
+    { LOCK();
+        if (Vars::entries.size() >= MAX_ENTRIES && !Vars::entries.count(fileName))
+        {
+            auto lru = Vars::entries.begin();
+            for (auto it = Vars::entries.begin(); it != Vars::entries.end(); it++)
+                if (it->second.lastUse < lru->second.lastUse)
+                    lru = it;
+            Vars::entries.erase(lru);
+        }
+
+        Vars::entries[fileName] = { img, (int64_t)stat.st_mtime, (int64_t)stat.st_size, ++Vars::useCounter };
+    }
+
+    result = SKRY_SUCCESS;
+    return img;
+}
+
+} // namespace FlatFieldCache
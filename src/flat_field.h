@@ -0,0 +1,74 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Flat-field creation and cache header.
+*/
+
+#ifndef STACKISTRY_FLAT_FIELD_HEADER
+#define STACKISTRY_FLAT_FIELD_HEADER
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <skry/skry_cpp.hpp>
+
+
+/// Creates a flat-field: the average of the active images of a sequence (converted to MONO32F)
+/** Works in steps (one image each), like the libskry processing phases.
+    The rows of each image are accumulated in parallel. */
+class c_FlatFieldCreation
+{
+public:
+    c_FlatFieldCreation(libskry::c_ImageSequence &imgSeq);
+
+    c_FlatFieldCreation(const c_FlatFieldCreation &) = delete;
+    c_FlatFieldCreation &operator =(const c_FlatFieldCreation &) = delete;
+
+    /// Returns SKRY_LAST_STEP after the last image
+    /** Returns SKRY_INVALID_IMG_DIMENSIONS if the images differ in size. */
+    enum SKRY_result Step();
+
+    /// Index (within the active images' subset) of the image added by the last Step()
+    size_t GetCurrentImgIdx() const { return m_NextImgIdx - 1; }
+
+    /// Returns the flat-field (MONO32F); valid after Step() has returned SKRY_LAST_STEP
+    const libskry::c_Image &GetFlatField() const { return m_FlatField; }
+
+private:
+    libskry::c_ImageSequence &m_ImgSeq;
+    size_t m_NextImgIdx = 0; ///< Index within the active images' subset
+
+    std::vector<double> m_Sum; ///< Sum of the images' pixel values
+    libskry::c_Image m_FlatField;
+};
+
+/// Flat-fields loaded from files, shared by all jobs
+/** All functions are thread-safe. */
+namespace FlatFieldCache
+{
+    /// Returns the flat-field stored in 'fileName', converted to MONO32F (the format used by stacking)
+    /** The file is loaded only if it is not cached yet or it has been modified
+        since it was cached. Returns null on failure. */
+    std::shared_ptr<const libskry::c_Image> Get(const std::string &fileName, enum SKRY_result &result);
+}
+
+#endif // STACKISTRY_FLAT_FIELD_HEADER
@@ -0,0 +1,244 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Decoded frame cache implementation.
+*/
+
+#include <cstdint>
+#include <map>
+#include <utility>
+
+#include <glibmm/threads.h>
+
+#include "frame_cache.h"
+
+
+namespace FrameCache
+{
+
+typedef std::pair<SeqId_t, size_t> Key_t; ///< Image sequence ID and absolute image index
+
+struct Entry_t
+{
+    std::shared_ptr<const libskry::c_Image> img;
+    size_t numBytes;
+    uint64_t lastUse; ///< Value of 'Vars::useCounter' at the last access
+};
+
+struct ScanState_t
+{
+    size_t pos; ///< Absolute index of the image currently processed
+    bool morePassesFollow;
+    size_t imgCount;
+};
+
+/// Frames are evicted in the order of increasing rank, then decreasing score
+struct Priority_t
+{
+    int rank;
+    uint64_t score;
+
+    bool IsEvictedBefore(const Priority_t &p) const
+    {
+        return rank < p.rank || (rank == p.rank && score > p.score);
+    }
+};
+
+namespace Vars
+{
+    Glib::Threads::Mutex mtx; ///< Guards all the variables below
+
+    std::map<Key_t, Entry_t> entries;
+    std::map<SeqId_t, ScanState_t> scanStates;
+
+    size_t budget = 0;
+    size_t usedBytes = 0;
+    uint64_t useCounter = 0;
+    SeqId_t lastSeqId = 0;
+
+    size_t hits = 0, misses = 0, evictions = 0;
+}
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(Vars::mtx)
+
+static size_t GetImageSize(const libskry::c_Image &img)
+{
+    enum SKRY_pixel_format fmt = img.GetPixelFormat();
+    return (size_t)img.GetWidth() * img.GetHeight() * NUM_CHANNELS[fmt] * BITS_PER_CHANNEL[fmt] / 8;
+}
+
+/// Must be called with 'Vars::mtx' locked
+static Priority_t GetPriority(const Key_t &key, uint64_t lastUse)
+{
+    auto scanState = Vars::scanStates.find(key.first);
+    if (scanState == Vars::scanStates.end())
+    {
+        // Not being processed: least recently used first
+        return { 1, Vars::useCounter - lastUse };
+    }
+
+    const ScanState_t &scan = scanState->second;
+    if (key.second > scan.pos)
+    {
+        // Will be read later by the current processing phase
+        return { 2, key.second - scan.pos };
+    }
+    else if (scan.morePassesFollow)
+    {
+        // Will be read by the next processing phase
+        return { 2, scan.imgCount - scan.pos + key.second };
+    }
+    else
+    {
+        // Will not be needed anymore
+        return { 0, 0 };
+    }
+}
+
+/// Returns the cached frame to be evicted first; must be called with 'Vars::mtx' locked
+static std::map<Key_t, Entry_t>::iterator FindVictim()
+{
+    auto victim = Vars::entries.end();
+    Priority_t victimPriority = { 0, 0 };
+
+    for (auto entry = Vars::entries.begin(); entry != Vars::entries.end(); entry++)
+    {
+        Priority_t priority = GetPriority(entry->first, entry->second.lastUse);
+        if (victim == Vars::entries.end() || priority.IsEvictedBefore(victimPriority))
+        {
+            victim = entry;
+            victimPriority = priority;
+        }
+    }
+
+    return victim;
+}
+
+/// Must be called with 'Vars::mtx' locked
+static void Evict(std::map<Key_t, Entry_t>::iterator entry)
+{
+    Vars::usedBytes -= entry->second.numBytes;
+    Vars::entries.erase(entry);
+    Vars::evictions++;
+}
+
+/// Must be called with 'Vars::mtx' locked
+static void EvictToFit(size_t budget)
+{
+    while (Vars::usedBytes > budget && !Vars::entries.empty())
+        Evict(FindVictim());
+}
+
+SeqId_t CreateSeqId()
+{
+    LOCK();
+    return ++Vars::lastSeqId;
+}
+
+void SetBudget(size_t numBytes)
+{
+    LOCK();
+    Vars::budget = numBytes;
+    EvictToFit(Vars::budget);
+}
+
+std::shared_ptr<const libskry::c_Image> GetImage(SeqId_t seqId, const libskry::c_ImageSequence &imgSeq, size_t absImgIdx,
+                                                  enum SKRY_result *result)
+{
+    const Key_t key(seqId, absImgIdx);
+
+    { LOCK();
+        auto entry = Vars::entries.find(key);
+        if (entry != Vars::entries.end())
+        {
+            Vars::hits++;
+            entry->second.lastUse = ++Vars::useCounter;
+            if (result)
+                *result = SKRY_SUCCESS;
+            return entry->second.img;
+        }
+        Vars::misses++;
+    }
+
+    // Decode without holding the lock, so that other sequences' frames can be served meanwhile
+    libskry::c_Image decoded = imgSeq.GetImageByIdx(absImgIdx, result);
+    if (!decoded)
+        return nullptr;
+
+    auto img = std::make_shared<const libskry::c_Image>(std::move(decoded));
+    const size_t numBytes = GetImageSize(*img);
+
+    LOCK();
+    if (numBytes > Vars::budget || Vars::entries.count(key))
+        return img;
+
+    const uint64_t lastUse = ++Vars::useCounter;
+    const Priority_t newPriority = GetPriority(key, lastUse);
+
+    while (Vars::usedBytes + numBytes > Vars::budget)
+    {
+        auto victim = FindVictim();
+        if (!GetPriority(victim->first, victim->second.lastUse).IsEvictedBefore(newPriority))
+        {
+            // The new frame would be the first to go; do not cache it
+            // (e.g. during a sequential pass this keeps the frames needed soonest)
+            return img;
+        }
+        Evict(victim);
+    }
+
+    Vars::entries[key] = Entry_t { img, numBytes, lastUse };
+    Vars::usedBytes += numBytes;
+
+    return img;
+}
+
+void SetScanPosition(SeqId_t seqId, const libskry::c_ImageSequence &imgSeq, size_t absImgIdx, bool morePassesFollow)
+{
+    LOCK();
+    Vars::scanStates[seqId] = ScanState_t { absImgIdx, morePassesFollow, imgSeq.GetImageCount() };
+}
+
+void ClearScanPosition(SeqId_t seqId)
+{
+    LOCK();
+    Vars::scanStates.erase(seqId);
+}
+
+void Invalidate(SeqId_t seqId)
+{
+    LOCK();
+    Vars::scanStates.erase(seqId);
+
+    auto entry = Vars::entries.lower_bound(Key_t(seqId, 0));
+    while (entry != Vars::entries.end() && entry->first.first == seqId)
+    {
+        Vars::usedBytes -= entry->second.numBytes;
+        entry = Vars::entries.erase(entry);
+    }
+}
+
+Stats_t GetStats()
+{
+    LOCK();
+    return Stats_t { Vars::hits, Vars::misses, Vars::evictions, Vars::entries.size(), Vars::usedBytes, Vars::budget };
+}
+
+} // namespace FrameCache
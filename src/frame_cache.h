@@ -0,0 +1,88 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Decoded frame cache header.
+*/
+
+#ifndef STACKISTRY_FRAME_CACHE_HEADER
+#define STACKISTRY_FRAME_CACHE_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <skry/skry_cpp.hpp>
+
+
+/// Memory-bounded cache of decoded frames, shared by all image sequences
+/** Serves the frame reads performed by Stackistry itself (visualization,
+    frame selection, anchor and reference point selection); the frames
+    read internally by libskry's processing phases are not affected.
+
+    Image sequences are identified by IDs obtained from CreateSeqId(); unlike
+    the sequences' addresses, the IDs are never reused, so frames of a destroyed
+    sequence cannot be returned for a new one.
+
+    All functions are thread-safe, but reading frames of a single image sequence
+    must not be performed from multiple threads at once (a libskry restriction). */
+namespace FrameCache
+{
+    typedef uint64_t SeqId_t;
+
+    /// Returns a new ID to identify an image sequence with
+    SeqId_t CreateSeqId();
+
+    struct Stats_t
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t numFrames;   ///< Number of cached frames
+        size_t usedBytes;
+        size_t budgetBytes;
+    };
+
+    /// Sets the max. amount of memory used by the cache; 0 disables caching
+    void SetBudget(size_t numBytes);
+
+    /// Returns the specified frame (from the cache or decoded by 'imgSeq')
+    /** Returns null on failure. */
+    std::shared_ptr<const libskry::c_Image> GetImage(SeqId_t seqId, const libskry::c_ImageSequence &imgSeq,
+                                                      size_t absImgIdx, ///< Index within all images of 'imgSeq'
+                                                      enum SKRY_result *result = nullptr);
+
+    /// Informs the cache that 'imgSeq' is being read sequentially by a processing phase
+    /** Used for choosing frames to evict: the frames which will be needed soonest
+        are kept. 'morePassesFollow' indicates if any further processing phase will
+        read the sequence again. */
+    void SetScanPosition(SeqId_t seqId, const libskry::c_ImageSequence &imgSeq, size_t absImgIdx, bool morePassesFollow);
+
+    /// Informs the cache that the sequence is no longer being processed
+    void ClearScanPosition(SeqId_t seqId);
+
+    /// Removes all cached frames of the sequence
+    /** Has to be called when its decoded frames change (e.g. after ReinterpretAsCFA());
+        should be called when it is destroyed, to free the memory sooner. */
+    void Invalidate(SeqId_t seqId);
+
+    Stats_t GetStats();
+}
+
+#endif // STACKISTRY_FRAME_CACHE_HEADER
@@ -0,0 +1,271 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Frame list tree model implementation.
+*/
+
+#include <algorithm>
+#include <bitset>
+
+#include "frame_list_model.h"
+
+
+static int CountBits(uint64_t word)
+{
+    return std::bitset<64>(word).count();
+}
+
+Glib::RefPtr<c_FrameListModel> c_FrameListModel::Create(size_t numFrames, const uint8_t *activeFlags)
+{
+    return Glib::RefPtr<c_FrameListModel>(new c_FrameListModel(numFrames, activeFlags));
+}
+
+c_FrameListModel::c_FrameListModel(size_t numFrames, const uint8_t *activeFlags)
+: Glib::ObjectBase(typeid(c_FrameListModel)),
+  Glib::Object(),
+  m_NumFrames(numFrames),
+  m_ActiveBits((numFrames + BITS_PER_WORD - 1) / BITS_PER_WORD, 0),
+  m_Stamp(g_random_int())
+{
+    for (size_t i = 0; i < numFrames; i++)
+        if (activeFlags[i])
+        {
+            m_ActiveBits[i / BITS_PER_WORD] |= (Word_t)1 << (i % BITS_PER_WORD);
+            m_NumActive++;
+        }
+}
+
+template<typename Op>
+void c_FrameListModel::ModifyRange(size_t first, size_t end, Op op)
+{
+    end = std::min(end, m_NumFrames);
+    if (first >= end)
+        return;
+
+    const size_t firstWord = first / BITS_PER_WORD,
+                 lastWord = (end - 1) / BITS_PER_WORD;
+
+    for (size_t w = firstWord; w <= lastWord; w++)
+    {
+        Word_t mask = ~(Word_t)0;
+        if (w == firstWord)
+            mask &= ~(Word_t)0 << (first % BITS_PER_WORD);
+        if (w == lastWord && end % BITS_PER_WORD != 0)
+            mask &= ~(Word_t)0 >> (BITS_PER_WORD - end % BITS_PER_WORD);
+
+        m_NumActive -= CountBits(m_ActiveBits[w]);
+        m_ActiveBits[w] = op(m_ActiveBits[w], mask);
+        m_NumActive += CountBits(m_ActiveBits[w]);
+    }
+
+    // A single edit is reported to the views as usual; for bulk changes,
+    // signal_ActiveChanged() receivers are expected to redraw the views
+    if (end - first == 1)
+    {
+        iterator iter(this);
+        SetRow(iter, first);
+        row_changed(get_path(iter), iter);
+    }
+
+    m_ActiveChangedSignal.emit(first, end);
+}
+
+void c_FrameListModel::SetActive(size_t first, size_t end, bool active)
+{
+    ModifyRange(first, end, [active](Word_t word, Word_t mask) { return active ? word | mask : word & ~mask; });
+}
+
+void c_FrameListModel::ToggleActive(size_t first, size_t end)
+{
+    ModifyRange(first, end, [](Word_t word, Word_t mask) { return word ^ mask; });
+}
+
+void c_FrameListModel::SetActiveFlags(const uint8_t *activeFlags)
+{
+    std::fill(m_ActiveBits.begin(), m_ActiveBits.end(), 0);
+    m_NumActive = 0;
+    for (size_t i = 0; i < m_NumFrames; i++)
+        if (activeFlags[i])
+        {
+            m_ActiveBits[i / BITS_PER_WORD] |= (Word_t)1 << (i % BITS_PER_WORD);
+            m_NumActive++;
+        }
+
+    m_ActiveChangedSignal.emit(0, m_NumFrames);
+}
+
+std::vector<uint8_t> c_FrameListModel::GetActiveFlags() const
+{
+    std::vector<uint8_t> result(m_NumFrames);
+    for (size_t i = 0; i < m_NumFrames; i++)
+        result[i] = IsActive(i);
+
+    return result;
+}
+
+bool c_FrameListModel::GetRow(const iterator &iter, size_t &row) const
+{
+    if (iter.get_stamp() != m_Stamp)
+        return false;
+
+    row = GPOINTER_TO_SIZE(iter.gobj()->user_data);
+    return row < m_NumFrames;
+}
+
+void c_FrameListModel::SetRow(iterator &iter, size_t row) const
+{
+    iter.set_stamp(m_Stamp);
+    iter.gobj()->user_data = GSIZE_TO_POINTER(row);
+}
+
+Gtk::TreeModelFlags c_FrameListModel::get_flags_vfunc() const
+{
+    return Gtk::TREE_MODEL_LIST_ONLY | Gtk::TREE_MODEL_ITERS_PERSIST;
+}
+
+int c_FrameListModel::get_n_columns_vfunc() const
+{
+    return m_Columns.size();
+}
+
+GType c_FrameListModel::get_column_type_vfunc(int index) const
+{
+    if (index < 0 || index >= (int)m_Columns.size())
+        return G_TYPE_INVALID;
+
+    return m_Columns.types()[index];
+}
+
+bool c_FrameListModel::iter_next_vfunc(const iterator &iter, iterator &iterNext) const
+{
+    size_t row;
+    if (!GetRow(iter, row) || row + 1 >= m_NumFrames)
+    {
+        iterNext = iterator();
+        return false;
+    }
+
+    SetRow(iterNext, row + 1);
+    return true;
+}
+
+bool c_FrameListModel::get_iter_vfunc(const Path &path, iterator &iter) const
+{
+    if (path.size() != 1 || path[0] < 0 || (size_t)path[0] >= m_NumFrames)
+    {
+        iter = iterator();
+        return false;
+    }
+
+    SetRow(iter, path[0]);
+    return true;
+}
+
+bool c_FrameListModel::iter_children_vfunc(const iterator &parent, iterator &iter) const
+{
+    // A list has no children
+    iter = iterator();
+    return false;
+}
+
+bool c_FrameListModel::iter_parent_vfunc(const iterator &child, iterator &iter) const
+{
+    iter = iterator();
+    return false;
+}
+
+bool c_FrameListModel::iter_nth_child_vfunc(const iterator &parent, int n, iterator &iter) const
+{
+    iter = iterator();
+    return false;
+}
+
+bool c_FrameListModel::iter_nth_root_child_vfunc(int n, iterator &iter) const
+{
+    if (n < 0 || (size_t)n >= m_NumFrames)
+    {
+        iter = iterator();
+        return false;
+    }
+
+    SetRow(iter, n);
+    return true;
+}
+
+bool c_FrameListModel::iter_has_child_vfunc(const iterator &iter) const
+{
+    return false;
+}
+
+int c_FrameListModel::iter_n_children_vfunc(const iterator &iter) const
+{
+    return 0;
+}
+
+int c_FrameListModel::iter_n_root_children_vfunc() const
+{
+    return m_NumFrames;
+}
+
+Gtk::TreeModel::Path c_FrameListModel::get_path_vfunc(const iterator &iter) const
+{
+    Path path;
+    size_t row;
+    if (GetRow(iter, row))
+        path.push_back(row);
+
+    return path;
+}
+
+void c_FrameListModel::get_value_vfunc(const iterator &iter, int column, Glib::ValueBase &value) const
+{
+    size_t row;
+    if (!GetRow(iter, row))
+        return;
+
+    if (column == m_Columns.index.index())
+    {
+        Glib::Value<size_t> val;
+        val.init(Glib::Value<size_t>::value_type());
+        val.set(row);
+        value.init(Glib::Value<size_t>::value_type());
+        value = val;
+    }
+    else if (column == m_Columns.active.index())
+    {
+        Glib::Value<bool> val;
+        val.init(Glib::Value<bool>::value_type());
+        val.set(IsActive(row));
+        value.init(Glib::Value<bool>::value_type());
+        value = val;
+    }
+}
+
+void c_FrameListModel::set_value_impl(const iterator &row, int column, const Glib::ValueBase &value)
+{
+    size_t frameIdx;
+    if (column != m_Columns.active.index() || !GetRow(row, frameIdx))
+        return;
+
+    Glib::Value<bool> val;
+    val.init(value.gobj());
+    if (val.get() != IsActive(frameIdx))
+        SetActive(frameIdx, val.get());
+}
@@ -0,0 +1,134 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Frame list tree model header.
+*/
+
+#ifndef STACKISTRY_FRAME_LIST_MODEL_HEADER
+#define STACKISTRY_FRAME_LIST_MODEL_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glibmm/object.h>
+#include <gtkmm/treemodel.h>
+
+
+/// List model of image sequence frames and their "active" flags
+/** The rows are not stored; each one is generated on request from its index
+    and a bitset of active flags. Bulk changes of the flags are performed on
+    whole words of the bitset and reported with a single signal. */
+class c_FrameListModel: public Glib::Object, public Gtk::TreeModel
+{
+public:
+    class c_Columns: public Gtk::TreeModelColumnRecord
+    {
+    public:
+        Gtk::TreeModelColumn<size_t> index;
+        Gtk::TreeModelColumn<bool> active;
+
+        c_Columns()
+        {
+            add(index);
+            add(active);
+        }
+    };
+
+    /// 'activeFlags' has 'numFrames' elements (0 or 1)
+    static Glib::RefPtr<c_FrameListModel> Create(size_t numFrames, const uint8_t *activeFlags);
+
+    const c_Columns &GetColumns() const { return m_Columns; }
+
+    size_t GetNumFrames() const { return m_NumFrames; }
+    size_t GetNumActive() const { return m_NumActive; }
+
+    bool IsActive(size_t frameIdx) const
+    {
+        return (m_ActiveBits[frameIdx / BITS_PER_WORD] >> (frameIdx % BITS_PER_WORD)) & 1;
+    }
+
+    void SetActive(size_t frameIdx, bool active) { SetActive(frameIdx, frameIdx + 1, active); }
+
+    /// Sets the active state of frames [first; end)
+    void SetActive(size_t first, size_t end, bool active);
+
+    /// Toggles the active state of frames [first; end)
+    void ToggleActive(size_t first, size_t end);
+
+    /// 'activeFlags' has GetNumFrames() elements (0 or 1)
+    void SetActiveFlags(const uint8_t *activeFlags);
+
+    /// Returns GetNumFrames() elements (0 or 1)
+    std::vector<uint8_t> GetActiveFlags() const;
+
+    /// Emitted after the active state of frames [first; end) has changed
+    sigc::signal<void, size_t, size_t> signal_ActiveChanged()
+    {
+        return m_ActiveChangedSignal;
+    }
+
+protected:
+    c_FrameListModel(size_t numFrames, const uint8_t *activeFlags);
+
+    // Gtk::TreeModel implementation --------------
+
+    Gtk::TreeModelFlags get_flags_vfunc() const override;
+    int get_n_columns_vfunc() const override;
+    GType get_column_type_vfunc(int index) const override;
+    bool iter_next_vfunc(const iterator &iter, iterator &iterNext) const override;
+    bool get_iter_vfunc(const Path &path, iterator &iter) const override;
+    bool iter_children_vfunc(const iterator &parent, iterator &iter) const override;
+    bool iter_parent_vfunc(const iterator &child, iterator &iter) const override;
+    bool iter_nth_child_vfunc(const iterator &parent, int n, iterator &iter) const override;
+    bool iter_nth_root_child_vfunc(int n, iterator &iter) const override;
+    bool iter_has_child_vfunc(const iterator &iter) const override;
+    int iter_n_children_vfunc(const iterator &iter) const override;
+    int iter_n_root_children_vfunc() const override;
+    Path get_path_vfunc(const iterator &iter) const override;
+    void get_value_vfunc(const iterator &iter, int column, Glib::ValueBase &value) const override;
+    void set_value_impl(const iterator &row, int column, const Glib::ValueBase &value) override;
+
+private:
+    typedef uint64_t Word_t;
+    static const size_t BITS_PER_WORD = 64;
+
+    c_Columns m_Columns;
+
+    const size_t m_NumFrames;
+    std::vector<Word_t> m_ActiveBits;
+    size_t m_NumActive = 0;
+
+    /// Identifies iterators created by this model
+    const int m_Stamp;
+
+    sigc::signal<void, size_t, size_t> m_ActiveChangedSignal;
+
+    /// Applies 'op(word, mask)' to the words covering frames [first; end)
+    template<typename Op>
+    void ModifyRange(size_t first, size_t end, Op op);
+
+    /// Returns false if 'iter' is not a valid iterator of this model
+    bool GetRow(const iterator &iter, size_t &row) const;
+
+    void SetRow(iterator &iter, size_t row) const;
+};
+
+#endif // STACKISTRY_FRAME_LIST_MODEL_HEADER
@@ -0,0 +1,295 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Background frame preview loader implementation.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+
+#include <cairomm/context.h>
+
+#include "frame_cache.h"
+#include "frame_preview.h"
+#include "utils.h"
+
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(m_Mtx)
+
+/// Max. amount of memory used by the decoded frames around the current position
+const size_t RING_BUDGET = 256 * 1024*1024;
+
+const size_t MAX_RING_RADIUS = 16;
+
+/// Max. number of thumbnails kept (the ones set via SetThumbnailIndices() are never discarded)
+const size_t MAX_NUM_THUMBNAILS = 4096;
+
+static size_t Distance(size_t a, size_t b)
+{
+    return (a > b ? a - b : b - a);
+}
+
+c_FramePreviewLoader::c_FramePreviewLoader(const libskry::c_ImageSequence &imgSeq, FrameCache::SeqId_t frameCacheId,
+                                           unsigned frameWidth, unsigned frameHeight,
+                                           const sigc::slot<void> &frameReadyNotification)
+: m_ImgSeq(imgSeq), m_FrameCacheId(frameCacheId), m_NumImages(imgSeq.GetImageCount()),
+  m_FrameWidth(frameWidth), m_FrameHeight(frameHeight),
+  m_FrameReadyNotification(frameReadyNotification)
+{
+    // The ring extends 'm_RingRadius' frames forward and half as many backward
+    const size_t frameBytes = std::max((size_t)1, (size_t)frameWidth * frameHeight * 4);
+    m_RingRadius = std::max((size_t)1, std::min(MAX_RING_RADIUS, RING_BUDGET / frameBytes * 2 / 3));
+
+    m_Thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &c_FramePreviewLoader::ThreadFunc));
+}
+
+c_FramePreviewLoader::~c_FramePreviewLoader()
+{
+    { LOCK();
+        m_StopRequested = true;
+        m_Cond.signal();
+    }
+    m_Thread->join();
+}
+
+void c_FramePreviewLoader::SetPosition(size_t imgIdx)
+{
+    LOCK();
+    if (imgIdx != m_Position)
+        m_Direction = (imgIdx > m_Position ? 1 : -1);
+    m_Position = imgIdx;
+    m_Cond.signal();
+}
+
+void c_FramePreviewLoader::SetThumbnailIndices(const std::vector<size_t> &indices, int thumbnailHeight)
+{
+    LOCK();
+    if (thumbnailHeight != m_ThumbnailHeight)
+        m_Thumbnails.clear();
+
+    m_ThumbnailIndices = indices;
+    std::sort(m_ThumbnailIndices.begin(), m_ThumbnailIndices.end());
+    m_ThumbnailHeight = thumbnailHeight;
+    m_Cond.signal();
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> c_FramePreviewLoader::GetFrame(size_t imgIdx)
+{
+    LOCK();
+    auto frame = m_Frames.find(imgIdx);
+    if (frame == m_Frames.end())
+        return Cairo::RefPtr<Cairo::ImageSurface>(nullptr);
+    else
+        return frame->second;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> c_FramePreviewLoader::GetThumbnail(size_t imgIdx)
+{
+    LOCK();
+    auto thumbnail = m_Thumbnails.find(imgIdx);
+    if (thumbnail == m_Thumbnails.end())
+        return Cairo::RefPtr<Cairo::ImageSurface>(nullptr);
+    else
+        return thumbnail->second;
+}
+
+/// Returns the element of 'images' with the key nearest to 'imgIdx' (or images.end() if empty)
+static std::map<size_t, Cairo::RefPtr<Cairo::ImageSurface>>::const_iterator
+    FindNearest(const std::map<size_t, Cairo::RefPtr<Cairo::ImageSurface>> &images, size_t imgIdx)
+{
+    auto next = images.lower_bound(imgIdx);
+    if (next == images.begin())
+        return next;
+
+    auto prev = std::prev(next);
+    if (next == images.end() || Distance(prev->first, imgIdx) < Distance(next->first, imgIdx))
+        return prev;
+    else
+        return next;
+}
+
+c_FramePreviewLoader::Preview_t c_FramePreviewLoader::GetNearestPreview(size_t imgIdx)
+{
+    LOCK();
+    auto frame = FindNearest(m_Frames, imgIdx);
+    auto thumbnail = FindNearest(m_Thumbnails, imgIdx);
+
+    if (frame != m_Frames.end() &&
+        (thumbnail == m_Thumbnails.end() ||
+         Distance(frame->first, imgIdx) <= 2 * Distance(thumbnail->first, imgIdx)))
+    {
+        return Preview_t { frame->second, frame->first, false };
+    }
+    else if (thumbnail != m_Thumbnails.end())
+        return Preview_t { thumbnail->second, thumbnail->first, true };
+    else
+        return Preview_t { Cairo::RefPtr<Cairo::ImageSurface>(nullptr), 0, false };
+}
+
+bool c_FramePreviewLoader::IsInRing(size_t imgIdx) const
+{
+    const bool ahead = (m_Direction > 0 ? imgIdx >= m_Position : imgIdx <= m_Position);
+    return Distance(imgIdx, m_Position) <= (ahead ? m_RingRadius : m_RingRadius / 2);
+}
+
+bool c_FramePreviewLoader::GetNextFrameToDecode(size_t &imgIdx, bool &keepFullFrame)
+{
+    auto isNeeded = [this](size_t idx) { return !m_Frames.count(idx) && !m_Failed.count(idx); };
+
+    keepFullFrame = true;
+
+    if (m_Position < m_NumImages && isNeeded(m_Position))
+    {
+        imgIdx = m_Position;
+        return true;
+    }
+
+    for (size_t dist = 1; dist <= m_RingRadius; dist++)
+    {
+        // Ahead of the current position (in the browsing direction) first
+        for (int dir: { m_Direction, -m_Direction })
+        {
+            if (dir != m_Direction && dist > m_RingRadius / 2)
+                continue;
+
+            if (dir < 0 && dist > m_Position)
+                continue;
+
+            const size_t idx = m_Position + dir * (ptrdiff_t)dist;
+            if (idx < m_NumImages && isNeeded(idx))
+            {
+                imgIdx = idx;
+                return true;
+            }
+        }
+    }
+
+    if (m_ThumbnailHeight > 0)
+    {
+        keepFullFrame = false;
+        for (size_t idx: m_ThumbnailIndices)
+            if (idx < m_NumImages && !m_Thumbnails.count(idx) && !m_Failed.count(idx))
+            {
+                imgIdx = idx;
+                return true;
+            }
+    }
+
+    return false;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> c_FramePreviewLoader::CreateThumbnail(const Cairo::RefPtr<Cairo::ImageSurface> &frame,
+                                                                         int height) const
+{
+    const int width = std::max(1, (int)std::round((double)height * m_FrameWidth / m_FrameHeight));
+    auto thumbnail = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, width, height);
+
+    auto src = Cairo::SurfacePattern::create(frame);
+    src->set_matrix(Cairo::Matrix((double)frame->get_width() / width, 0, 0, (double)frame->get_height() / height, 0, 0));
+    src->set_filter(Cairo::Filter::FILTER_GOOD);
+
+    auto cr = Cairo::Context::create(thumbnail);
+    cr->set_source(src);
+    cr->paint();
+    thumbnail->flush();
+
+    return thumbnail;
+}
+
+void c_FramePreviewLoader::StoreThumbnail(size_t imgIdx, const Cairo::RefPtr<Cairo::ImageSurface> &thumbnail)
+{
+    m_Thumbnails[imgIdx] = thumbnail;
+
+    // Discard the thumbnail furthest from the current position, unless it is one of 'm_ThumbnailIndices'
+    while (m_Thumbnails.size() > MAX_NUM_THUMBNAILS)
+    {
+        auto furthest = m_Thumbnails.end();
+        for (auto it = m_Thumbnails.begin(); it != m_Thumbnails.end(); it++)
+            if (!std::binary_search(m_ThumbnailIndices.begin(), m_ThumbnailIndices.end(), it->first) &&
+                (furthest == m_Thumbnails.end() ||
+                 Distance(it->first, m_Position) > Distance(furthest->first, m_Position)))
+            {
+                furthest = it;
+            }
+
+        if (furthest == m_Thumbnails.end())
+            break;
+
+        m_Thumbnails.erase(furthest);
+    }
+}
+
+void c_FramePreviewLoader::ThreadFunc()
+{
+    LOCK();
+    while (!m_StopRequested)
+    {
+        size_t imgIdx;
+        bool keepFullFrame;
+        if (!GetNextFrameToDecode(imgIdx, keepFullFrame))
+        {
+            m_Cond.wait(m_Mtx);
+            continue;
+        }
+
+        const int thumbnailHeight = m_ThumbnailHeight;
+
+        lock.release();
+
+        Cairo::RefPtr<Cairo::ImageSurface> frame, thumbnail;
+        std::shared_ptr<const libskry::c_Image> img = FrameCache::GetImage(m_FrameCacheId, m_ImgSeq, imgIdx);
+        if (img)
+            frame = Utils::ConvertImgToSurface(*img);
+        if (frame && thumbnailHeight > 0)
+            thumbnail = CreateThumbnail(frame, thumbnailHeight);
+
+        lock.acquire();
+
+        if (!frame)
+        {
+            m_Failed.insert(imgIdx);
+            continue;
+        }
+
+        if (thumbnail && thumbnailHeight == m_ThumbnailHeight)
+            StoreThumbnail(imgIdx, thumbnail);
+
+        if (keepFullFrame)
+        {
+            // The position may have changed in the meantime; keep only the frames still in the ring
+            for (auto it = m_Frames.begin(); it != m_Frames.end();)
+            {
+                if (!IsInRing(it->first))
+                    it = m_Frames.erase(it);
+                else
+                    it++;
+            }
+
+            if (IsInRing(imgIdx))
+                m_Frames[imgIdx] = frame;
+        }
+
+        lock.release();
+        m_FrameReadyNotification();
+        lock.acquire();
+    }
+}
@@ -0,0 +1,126 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Background frame preview loader header.
+*/
+
+#ifndef STACKISTRY_FRAME_PREVIEW_HEADER
+#define STACKISTRY_FRAME_PREVIEW_HEADER
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <cairomm/surface.h>
+#include <glibmm/threads.h>
+#include <sigc++/sigc++.h>
+#include <skry/skry_cpp.hpp>
+
+#include "frame_cache.h"
+
+
+/// Decodes frames of an image sequence in a background thread for interactive browsing
+/** The frame at the current position is decoded first, followed by a ring of
+    frames around it (more of them in the direction of the last position change).
+    When there is nothing else to do, thumbnails of the frames set via
+    SetThumbnailIndices() are created.
+
+    While the loader exists, no other thread may read frames of the image sequence. */
+class c_FramePreviewLoader
+{
+public:
+    struct Preview_t
+    {
+        Cairo::RefPtr<Cairo::ImageSurface> img; ///< Null if nothing is available
+        size_t imgIdx; ///< Index of the frame shown by 'img'
+        bool isThumbnail;
+    };
+
+    /** 'frameWidth', 'frameHeight': size of the sequence's images.
+         'frameReadyNotification' will be called from the loader thread. */
+    c_FramePreviewLoader(const libskry::c_ImageSequence &imgSeq, FrameCache::SeqId_t frameCacheId,
+                         unsigned frameWidth, unsigned frameHeight,
+                         const sigc::slot<void> &frameReadyNotification);
+
+    /// Stops the loader thread
+    ~c_FramePreviewLoader();
+
+    c_FramePreviewLoader(const c_FramePreviewLoader &) = delete;
+    c_FramePreviewLoader &operator =(const c_FramePreviewLoader &) = delete;
+
+    /// Sets the frame to decode next; 'imgIdx' is an index within all images of the sequence
+    void SetPosition(size_t imgIdx);
+
+    /// Sets frames whose thumbnails are created in the background ('thumbnailHeight' in pixels)
+    void SetThumbnailIndices(const std::vector<size_t> &indices, int thumbnailHeight);
+
+    /// Returns the decoded frame 'imgIdx' or null if it is not available (yet)
+    Cairo::RefPtr<Cairo::ImageSurface> GetFrame(size_t imgIdx);
+
+    /// Returns the thumbnail of frame 'imgIdx' or null if it is not available (yet)
+    Cairo::RefPtr<Cairo::ImageSurface> GetThumbnail(size_t imgIdx);
+
+    /// Returns the decoded frame or thumbnail which is the nearest to 'imgIdx'
+    /** A full frame is preferred over a thumbnail of a closer frame,
+        as long as it is not much further away. */
+    Preview_t GetNearestPreview(size_t imgIdx);
+
+private:
+    const libskry::c_ImageSequence &m_ImgSeq;
+    const FrameCache::SeqId_t m_FrameCacheId;
+    const size_t m_NumImages;
+    const int m_FrameWidth, m_FrameHeight;
+    size_t m_RingRadius; ///< Number of frames kept decoded on each side of the current position
+
+    sigc::slot<void> m_FrameReadyNotification;
+
+    Glib::Threads::Thread *m_Thread = nullptr;
+    Glib::Threads::Mutex m_Mtx; ///< Guards all the variables below
+    Glib::Threads::Cond m_Cond;
+    bool m_StopRequested = false;
+
+    size_t m_Position = 0;
+    int m_Direction = 1; ///< Direction of the last position change (1 or -1)
+
+    std::map<size_t, Cairo::RefPtr<Cairo::ImageSurface>> m_Frames;     ///< Key: frame index
+    std::map<size_t, Cairo::RefPtr<Cairo::ImageSurface>> m_Thumbnails; ///< Key: frame index
+    std::set<size_t> m_Failed; ///< Frames which could not be decoded
+
+    std::vector<size_t> m_ThumbnailIndices;
+    int m_ThumbnailHeight = 0;
+
+    void ThreadFunc();
+
+    /// Chooses the next frame to decode; returns false if there is none
+    /** 'keepFullFrame' is set to false if only the thumbnail of the frame is needed.
+        Must be called with 'm_Mtx' locked. */
+    bool GetNextFrameToDecode(size_t &imgIdx, bool &keepFullFrame);
+
+    /// Returns true if 'imgIdx' is within the ring around the current position; must be called with 'm_Mtx' locked
+    bool IsInRing(size_t imgIdx) const;
+
+    /// Must be called with 'm_Mtx' locked
+    void StoreThumbnail(size_t imgIdx, const Cairo::RefPtr<Cairo::ImageSurface> &thumbnail);
+
+    Cairo::RefPtr<Cairo::ImageSurface> CreateThumbnail(const Cairo::RefPtr<Cairo::ImageSurface> &frame, int height) const;
+};
+
+#endif // STACKISTRY_FRAME_PREVIEW_HEADER
@@ -22,7 +22,9 @@ File description:
 */
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <utility>
 
 #include <glibmm/i18n.h>
 #include <gtkmm/button.h>
@@ -32,6 +34,7 @@ File description:
 #include <gtkmm/scrolledwindow.h>
 
 #include "config.h"
+#include "frame_cache.h"
 #include "frame_select.h"
 #include "utils.h"
 
@@ -39,11 +42,31 @@ File description:
 const guint KEY_DEACTIVATE_FRAMES = GDK_KEY_Delete;
 const guint KEY_TOGGLE_FRAMES = GDK_KEY_space;
 
+const int THUMBNAIL_HEIGHT = 48; //TODO: make it relative to screen's DPI
+
+/// Returns 'img' scaled to the specified size
+static Cairo::RefPtr<Cairo::ImageSurface> ScaleImage(const Cairo::RefPtr<Cairo::ImageSurface> &img, int width, int height)
+{
+    auto result = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, width, height);
+
+    auto src = Cairo::SurfacePattern::create(img);
+    src->set_matrix(Cairo::Matrix((double)img->get_width() / width, 0, 0, (double)img->get_height() / height, 0, 0));
+    src->set_filter(Cairo::Filter::FILTER_BILINEAR);
+
+    auto cr = Cairo::Context::create(result);
+    cr->set_source(src);
+    cr->paint();
+    result->flush();
+
+    return result;
+}
+
 Gtk::Box *c_FrameSelectDlg::CreateVisualizationBox()
 {
     auto box = Gtk::manage(new Gtk::VBox());
     box->pack_start(m_ImgView, Gtk::PackOptions::PACK_EXPAND_WIDGET, Utils::Const::widgetPaddingInPixels);
     box->pack_start(m_VideoPos, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+    box->pack_start(m_ThumbnailStrip, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
     box->show();
     return box;
 }
@@ -55,43 +78,41 @@ void c_FrameSelectDlg::OnSyncToggled()
     m_FrameList.view.get_cursor(path, focusCol);
 
     if (m_SyncListWSlider.get_active() && !path.empty()) // 'path' will be always filled
-        m_VideoPos.set_value((*m_FrameList.data->get_iter(path))[m_FrameList.columns.index]);
+        m_VideoPos.set_value(path[0]);
 }
 
 Gtk::Box *c_FrameSelectDlg::CreateFrameListBox()
 {
     get_action_area()->set_border_width(10);
 
-    m_FrameList.data = Gtk::ListStore::create(m_FrameList.columns);
+    const size_t numImages = m_ImgSeq.GetImageCount();
+    const c_FrameListModel::c_Columns &columns = m_FrameList.data->GetColumns();
+
     m_FrameList.view.set_model(m_FrameList.data);
     m_FrameList.view.set_activate_on_single_click(false);
-    m_FrameList.view.append_column_editable(_("Active"), m_FrameList.columns.active);
-    m_FrameList.view.append_column(_("Index"), m_FrameList.columns.index);
-
-    m_FrameList.view.show();
-    const uint8_t *activeFlags = m_ImgSeq.GetImgActiveFlags();
-    for (size_t i = 0; i < m_ImgSeq.GetImageCount(); i++)
+    m_FrameList.view.append_column_editable(_("Active"), columns.active);
+    m_FrameList.view.append_column(_("Index"), columns.index);
+
+    // With fixed-size columns and rows, the view does not have to measure all rows
+    // (only the visible ones are ever rendered)
+    int indexWidth, indexHeight;
+    m_FrameList.view.create_pango_layout(Glib::ustring::format(numImages))->get_pixel_size(indexWidth, indexHeight);
+    for (Gtk::TreeViewColumn *column: m_FrameList.view.get_columns())
     {
-        auto row = *m_FrameList.data->append();
-        row[m_FrameList.columns.index] = i;
-        row[m_FrameList.columns.active] = (1 == activeFlags[i]);
+        column->set_sizing(Gtk::TreeViewColumnSizing::TREE_VIEW_COLUMN_FIXED);
+        int headerWidth, headerHeight;
+        m_FrameList.view.create_pango_layout(column->get_title())->get_pixel_size(headerWidth, headerHeight);
+        column->set_fixed_width(std::max(headerWidth, indexWidth) + 4 * Utils::Const::widgetPaddingInPixels);
     }
-    m_FrameList.view.columns_autosize();
+    m_FrameList.view.set_fixed_height_mode(true);
+
+    m_FrameList.view.show();
     m_FrameList.view.get_selection()->set_mode(Gtk::SelectionMode::SELECTION_MULTIPLE);
     m_FrameList.view.set_cursor(Gtk::TreeModel::Path("0"));
     m_FrameList.view.signal_cursor_changed().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnFrameListCursorChanged));
     m_FrameList.view.signal_key_press_event().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnListKeyPress), false);
 
-    m_FrameList.data->signal_row_changed().connect(sigc::slot<void, const Gtk::TreeModel::Path&, const Gtk::TreeModel::iterator&>(
-        [this](const Gtk::TreeModel::Path &path, const Gtk::TreeModel::iterator &iter)
-        {
-            // If "active" state of the currently displayed frame changed, refresh it
-            if ((*iter)[m_FrameList.columns.index] == (size_t)m_VideoPos.get_value())
-            {
-                m_ImgView.Refresh();;
-            }
-        }
-    ));
+    m_FrameList.data->signal_ActiveChanged().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnActiveFramesChanged));
 
     auto listScrWin = Gtk::manage(new Gtk::ScrolledWindow());
     listScrWin->add(m_FrameList.view);
@@ -116,26 +137,119 @@ Gtk::Box *c_FrameSelectDlg::CreateFrameListBox()
     btnBox->pack_start(m_SyncListWSlider, Gtk::PackOptions::PACK_SHRINK);
     btnBox->show();
 
+    for (Gtk::SpinButton *spin: { &m_Range.first, &m_Range.last })
+    {
+        spin->set_adjustment(Gtk::Adjustment::create(0, 0, numImages - 1, 1, 100));
+        spin->set_digits(0);
+    }
+    m_Range.last.set_value(numImages - 1);
+
+    auto btnActRange = Gtk::manage(new Gtk::Button(_("Activate")));
+    btnActRange->signal_clicked().connect([this]() { OnSetRangeActive(true); });
+    auto btnDeactRange = Gtk::manage(new Gtk::Button(_("Deactivate")));
+    btnDeactRange->signal_clicked().connect([this]() { OnSetRangeActive(false); });
+
+    auto rangeBox = Utils::PackIntoBox<Gtk::HBox>({ Gtk::manage(new Gtk::Label(_("Frames"))), &m_Range.first,
+                                                    Gtk::manage(new Gtk::Label(_("to"))), &m_Range.last });
+    auto rangeBtnBox = Utils::PackIntoBox<Gtk::HBox>({ btnActRange, btnDeactRange });
+
+    m_KeepBest.percentage.set_adjustment(Gtk::Adjustment::create(50, 1, 100, 1, 10));
+    m_KeepBest.percentage.set_digits(0);
+    auto btnKeepBest = Gtk::manage(new Gtk::Button(_("Keep best")));
+    btnKeepBest->set_tooltip_text(_("Activate only the specified percentage of the best-quality frames "
+                                    "(requires quality data from previous processing)"));
+    btnKeepBest->signal_clicked().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnKeepBest));
+    auto keepBestBox = Utils::PackIntoBox<Gtk::HBox>({ btnKeepBest, &m_KeepBest.percentage, Gtk::manage(new Gtk::Label("%")) });
+    keepBestBox->set_sensitive(!m_Quality.empty());
+
+    m_NumActiveLabel.set_halign(Gtk::Align::ALIGN_START);
+    m_NumActiveLabel.show();
+    UpdateNumActiveLabel();
+
     auto box = Gtk::manage(new Gtk::VBox());
     box->pack_start(*btnBox, Gtk::PackOptions::PACK_SHRINK);
     box->pack_start(*listScrWin, Gtk::PackOptions::PACK_EXPAND_WIDGET);
+    box->pack_start(m_NumActiveLabel, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+    box->pack_start(*rangeBox, Gtk::PackOptions::PACK_SHRINK);
+    box->pack_start(*rangeBtnBox, Gtk::PackOptions::PACK_SHRINK);
+    box->pack_start(*keepBestBox, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
     box->show();
     return box;
 }
 
 void c_FrameSelectDlg::OnActivateAll()
 {
-    for (auto &row: m_FrameList.data->children())
-        row[m_FrameList.columns.active] = true;
+    m_FrameList.data->SetActive(0, m_FrameList.data->GetNumFrames(), true);
+}
+
+void c_FrameSelectDlg::OnSetRangeActive(bool active)
+{
+    size_t first = m_Range.first.get_value_as_int(),
+           last = m_Range.last.get_value_as_int();
+    if (first > last)
+        std::swap(first, last);
+
+    m_FrameList.data->SetActive(first, last + 1, active);
+}
+
+void c_FrameSelectDlg::OnKeepBest()
+{
+    if (m_Quality.empty())
+        return;
+
+    // Frames have quality values assigned in the order of the active flags the dialog was created with
+    std::vector<size_t> order(m_Quality.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    const size_t numToKeep = std::max((size_t)1,
+        (size_t)std::round(m_KeepBest.percentage.get_value() / 100.0 * m_Quality.size()));
+
+    std::nth_element(order.begin(), order.begin() + (numToKeep - 1), order.end(),
+                     [this](size_t a, size_t b) { return m_Quality[a] > m_Quality[b]; });
+
+    std::vector<uint8_t> activeFlags(m_FrameList.data->GetNumFrames(), 0);
+    for (size_t i = 0; i < numToKeep; i++)
+        activeFlags[m_QualityFrameIndices[order[i]]] = 1;
+
+    m_FrameList.data->SetActiveFlags(activeFlags.data());
+}
+
+void c_FrameSelectDlg::OnActiveFramesChanged(size_t first, size_t end)
+{
+    // If "active" state of the currently displayed frame changed, refresh it
+    const size_t currentIdx = (size_t)m_VideoPos.get_value();
+    if (currentIdx >= first && currentIdx < end)
+        m_ImgView.Refresh();
+
+    if (end - first > 1)
+        m_FrameList.view.queue_draw();
+
+    UpdateNumActiveLabel();
+}
+
+void c_FrameSelectDlg::UpdateNumActiveLabel()
+{
+    m_NumActiveLabel.set_text(Glib::ustring::compose(_("Active: %1 of %2"),
+                                                     m_FrameList.data->GetNumActive(),
+                                                     m_FrameList.data->GetNumFrames()));
 }
 
 void c_FrameSelectDlg::InitControls()
 {
-    libskry::c_Image firstImg = m_ImgSeq.GetImageByIdx(0);
+    auto firstImg = FrameCache::GetImage(m_FrameCacheId, m_ImgSeq, 0);
     if (!firstImg)
         std::cout << "Failed to load first image " << std::endl;
     else
-        m_ImgView.SetImage(firstImg);
+    {
+        m_ImgView.SetImage(*firstImg);
+        m_DisplayingFullFrame = true;
+
+        m_FrameWidth = firstImg->GetWidth();
+        m_FrameHeight = firstImg->GetHeight();
+        m_FrameReadyDispatcher.connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnFrameReady));
+        signal_show().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::StartPreviewLoader));
+    }
 
     m_ImgView.signal_DrawImageArea().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnDrawImage));
     m_ImgView.show();
@@ -147,6 +261,15 @@ void c_FrameSelectDlg::InitControls()
     m_VideoPos.signal_value_changed().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnVideoPosScroll));
     m_VideoPos.show();
 
+    m_ThumbnailStrip.set_size_request(-1, THUMBNAIL_HEIGHT);
+    m_ThumbnailStrip.add_events(Gdk::EventMask::BUTTON_PRESS_MASK | Gdk::EventMask::BUTTON1_MOTION_MASK);
+    m_ThumbnailStrip.signal_draw().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnDrawThumbnailStrip));
+    m_ThumbnailStrip.signal_size_allocate().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnThumbnailStripResized));
+    m_ThumbnailStrip.signal_button_press_event().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnThumbnailStripBtnPress));
+    m_ThumbnailStrip.signal_motion_notify_event().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnThumbnailStripMotion));
+    if (m_FrameWidth > 0)
+        m_ThumbnailStrip.show();
+
     auto hbox = Gtk::manage(new Gtk::HBox());
     hbox->pack_start(*CreateFrameListBox(), Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
     hbox->pack_start(*CreateVisualizationBox(), Gtk::PackOptions::PACK_EXPAND_WIDGET, Utils::Const::widgetPaddingInPixels);
@@ -162,9 +285,21 @@ void c_FrameSelectDlg::InitControls()
     add_button(_("Cancel"), Gtk::RESPONSE_CANCEL);
 }
 
-c_FrameSelectDlg::c_FrameSelectDlg(libskry::c_ImageSequence &imgSeq)
-: Gtk::Dialog(), m_ImgSeq(imgSeq)
+c_FrameSelectDlg::c_FrameSelectDlg(libskry::c_ImageSequence &imgSeq, FrameCache::SeqId_t frameCacheId,
+                                   const std::vector<SKRY_quality_t> &quality)
+: Gtk::Dialog(), m_ImgSeq(imgSeq), m_FrameCacheId(frameCacheId)
 {
+    const uint8_t *activeFlags = imgSeq.GetImgActiveFlags();
+    m_FrameList.data = c_FrameListModel::Create(imgSeq.GetImageCount(), activeFlags);
+
+    if (quality.size() == m_FrameList.data->GetNumActive())
+    {
+        m_Quality = quality;
+        for (size_t i = 0; i < imgSeq.GetImageCount(); i++)
+            if (activeFlags[i])
+                m_QualityFrameIndices.push_back(i);
+    }
+
     set_title(_("Select frames for processing"));
     InitControls();
     signal_response().connect(sigc::mem_fun(*this, &c_FrameSelectDlg::OnResponse));
@@ -174,16 +309,82 @@ c_FrameSelectDlg::c_FrameSelectDlg(libskry::c_ImageSequence &imgSeq)
 void c_FrameSelectDlg::OnResponse(int responseId)
 {
     Utils::SavePosSize(*this, Configuration::FrameSelectDlgPosSize);
+
+    // The caller may modify the image sequence as soon as run() returns
+    m_PreviewLoader.reset();
+}
+
+void c_FrameSelectDlg::StartPreviewLoader()
+{
+    if (m_PreviewLoader)
+        return;
+
+    // From now on the frames are read only by the loader's thread
+    m_PreviewLoader.reset(new c_FramePreviewLoader(m_ImgSeq, m_FrameCacheId, m_FrameWidth, m_FrameHeight,
+                                                   sigc::mem_fun(m_FrameReadyDispatcher, &Glib::Dispatcher::emit)));
+
+    m_PreviewLoader->SetPosition((size_t)m_VideoPos.get_value());
+    if (!m_ThumbnailIndices.empty())
+        m_PreviewLoader->SetThumbnailIndices(m_ThumbnailIndices, THUMBNAIL_HEIGHT);
+}
+
+void c_FrameSelectDlg::ShowFrame(size_t imgIdx)
+{
+    Cairo::RefPtr<Cairo::ImageSurface> frame = m_PreviewLoader->GetFrame(imgIdx);
+    if (frame)
+    {
+        if (!m_DisplayingFullFrame || frame != m_DisplayedSrc)
+            m_ImgView.SetImage(frame);
+        m_DisplayedSrc = frame;
+        m_DisplayingFullFrame = true;
+        return;
+    }
+
+    m_DisplayingFullFrame = false;
+
+    c_FramePreviewLoader::Preview_t preview = m_PreviewLoader->GetNearestPreview(imgIdx);
+    if (preview.img && preview.img != m_DisplayedSrc)
+    {
+        if (preview.isThumbnail)
+            m_ImgView.SetImage(ScaleImage(preview.img, m_FrameWidth, m_FrameHeight));
+        else
+            m_ImgView.SetImage(preview.img);
+
+        m_DisplayedSrc = preview.img;
+    }
+}
+
+void c_FrameSelectDlg::OnFrameReady()
+{
+    if (!m_PreviewLoader)
+        return; // an outdated notification, ignore
+
+    if (!m_DisplayingFullFrame)
+        ShowFrame((size_t)m_VideoPos.get_value());
+
+    m_ThumbnailStrip.queue_draw();
 }
 
 void c_FrameSelectDlg::OnVideoPosScroll()
 {
-    libskry::c_Image img = m_ImgSeq.GetImageByIdx((int)m_VideoPos.get_value());
+    const size_t imgIdx = (size_t)m_VideoPos.get_value();
 
-    if (!img)
-        std::cout << "Failed to load image " << m_VideoPos.get_value() << std::endl;
+    if (m_PreviewLoader)
+    {
+        // Show the nearest available preview immediately; the frame itself will be shown by OnFrameReady()
+        m_PreviewLoader->SetPosition(imgIdx);
+        ShowFrame(imgIdx);
+        m_ThumbnailStrip.queue_draw();
+    }
     else
-        m_ImgView.SetImage(img);
+    {
+        auto img = FrameCache::GetImage(m_FrameCacheId, m_ImgSeq, imgIdx);
+
+        if (!img)
+            std::cout << "Failed to load image " << imgIdx << std::endl;
+        else
+            m_ImgView.SetImage(*img);
+    }
 
     if (m_SyncListWSlider.get_active())
         m_FrameList.view.set_cursor(Gtk::TreeModel::Path(Glib::ustring::format((size_t)m_VideoPos.get_value())));
@@ -191,7 +392,7 @@ void c_FrameSelectDlg::OnVideoPosScroll()
 
 bool c_FrameSelectDlg::OnDrawImage(const Cairo::RefPtr<Cairo::Context>& cr)
 {
-    if (!m_FrameList.data->children()[(size_t)m_VideoPos.get_value()][m_FrameList.columns.active])
+    if (!m_FrameList.data->IsActive((size_t)m_VideoPos.get_value()))
     {
         int w = m_ImgView.GetImage()->get_width(),
             h = m_ImgView.GetImage()->get_height();
@@ -220,19 +421,14 @@ void c_FrameSelectDlg::OnFrameListCursorChanged()
         Gtk::TreeViewColumn *focus_column;
         m_FrameList.view.get_cursor(path, focus_column);
 
-        m_VideoPos.set_value(((*m_FrameList.data->get_iter(path))[m_FrameList.columns.index]));
+        if (!path.empty())
+            m_VideoPos.set_value(path[0]);
     }
 }
 
 std::vector<uint8_t> c_FrameSelectDlg::GetActiveFlags() const
 {
-    std::vector<uint8_t> result;
-    result.reserve(m_ImgSeq.GetImageCount());
-
-    for (auto &row: m_FrameList.data->children())
-        result.push_back(row[m_FrameList.columns.active]);
-
-    return result;
+    return m_FrameList.data->GetActiveFlags();
 }
 
 bool c_FrameSelectDlg::OnListKeyPress(GdkEventKey *event)
@@ -242,13 +438,20 @@ bool c_FrameSelectDlg::OnListKeyPress(GdkEventKey *event)
     {
         bool toggle = (event->keyval == KEY_TOGGLE_FRAMES);
 
-        for (auto &row: m_FrameList.view.get_selection()->get_selected_rows())
+        // Selected rows are sorted; process them as ranges of consecutive rows
+        std::vector<Gtk::TreeModel::Path> selected = m_FrameList.view.get_selection()->get_selected_rows();
+        size_t i = 0;
+        while (i < selected.size())
         {
-            auto iter = m_FrameList.data->get_iter(row);
+            const size_t first = selected[i][0];
+            size_t end = first + 1;
+            while (++i < selected.size() && (size_t)selected[i][0] == end)
+                end++;
+
             if (toggle)
-                (*iter)[m_FrameList.columns.active] = !(*iter)[m_FrameList.columns.active];
+                m_FrameList.data->ToggleActive(first, end);
             else
-                (*iter)[m_FrameList.columns.active] = false;
+                m_FrameList.data->SetActive(first, end, false);
         }
 
         return true; // prevent normal handling of GDK_KEY_space (after our toggle,
@@ -257,3 +460,81 @@ bool c_FrameSelectDlg::OnListKeyPress(GdkEventKey *event)
 
     return false;
 }
+
+int c_FrameSelectDlg::GetThumbnailWidth() const
+{
+    return std::max(1, (int)std::round((double)THUMBNAIL_HEIGHT * m_FrameWidth / m_FrameHeight));
+}
+
+size_t c_FrameSelectDlg::GetThumbnailStripFrameAt(double x) const
+{
+    const int stripWidth = std::max(1, (int)m_ThumbnailIndices.size() * GetThumbnailWidth());
+    const double relPos = std::min(std::max(x / stripWidth, 0.0), 1.0);
+    return std::min((size_t)(relPos * m_ImgSeq.GetImageCount()), m_ImgSeq.GetImageCount() - 1);
+}
+
+void c_FrameSelectDlg::OnThumbnailStripResized(Gtk::Allocation &allocation)
+{
+    if (m_FrameWidth == 0)
+        return;
+
+    const size_t numImages = m_ImgSeq.GetImageCount();
+    const size_t numSlots = std::min(numImages, (size_t)std::max(1, allocation.get_width() / GetThumbnailWidth()));
+    if (numSlots == m_ThumbnailIndices.size())
+        return;
+
+    // Each thumbnail shows the middle frame of its range
+    m_ThumbnailIndices.clear();
+    for (size_t i = 0; i < numSlots; i++)
+        m_ThumbnailIndices.push_back((2*i + 1) * numImages / (2*numSlots));
+
+    if (m_PreviewLoader)
+        m_PreviewLoader->SetThumbnailIndices(m_ThumbnailIndices, THUMBNAIL_HEIGHT);
+}
+
+bool c_FrameSelectDlg::OnDrawThumbnailStrip(const Cairo::RefPtr<Cairo::Context> &cr)
+{
+    if (!m_PreviewLoader)
+        return true;
+
+    const int thumbWidth = GetThumbnailWidth();
+    const int height = m_ThumbnailStrip.get_allocated_height();
+
+    cr->set_source_rgb(0.2, 0.2, 0.2);
+    cr->paint();
+
+    for (size_t i = 0; i < m_ThumbnailIndices.size(); i++)
+    {
+        Cairo::RefPtr<Cairo::ImageSurface> thumbnail = m_PreviewLoader->GetThumbnail(m_ThumbnailIndices[i]);
+        if (thumbnail)
+        {
+            cr->set_source(thumbnail, i * thumbWidth, 0);
+            cr->rectangle(i * thumbWidth, 0, thumbnail->get_width(), thumbnail->get_height());
+            cr->fill();
+        }
+    }
+
+    // Current position
+    const double x = (double)m_VideoPos.get_value() / m_ImgSeq.GetImageCount() * m_ThumbnailIndices.size() * thumbWidth;
+    cr->set_line_width(2);
+    cr->set_source_rgb(1, 0.8, 0);
+    cr->move_to(x, 0);
+    cr->line_to(x, height);
+    cr->stroke();
+
+    return true;
+}
+
+bool c_FrameSelectDlg::OnThumbnailStripBtnPress(GdkEventButton *event)
+{
+    if (event->button == 1)
+        m_VideoPos.set_value(GetThumbnailStripFrameAt(event->x));
+
+    return true;
+}
+
+bool c_FrameSelectDlg::OnThumbnailStripMotion(GdkEventMotion *event)
+{
+    m_VideoPos.set_value(GetThumbnailStripFrameAt(event->x));
+    return true;
+}
@@ -25,65 +25,105 @@ File description:
 #define STACKISTRY_FRAME_SELECT_DIALOG
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <cairomm/context.h>
+#include <glibmm/dispatcher.h>
 #include <gtkmm/dialog.h>
-#include <gtkmm/liststore.h>
+#include <gtkmm/drawingarea.h>
+#include <gtkmm/label.h>
 #include <gtkmm/scale.h>
+#include <gtkmm/spinbutton.h>
 #include <gtkmm/togglebutton.h>
 #include <gtkmm/treeview.h>
 #include <skry/skry_cpp.hpp>
 
+#include "frame_list_model.h"
+#include "frame_preview.h"
 #include "img_viewer.h"
 
 
 class c_FrameSelectDlg: public Gtk::Dialog
 {
 public:
-    c_FrameSelectDlg(libskry::c_ImageSequence &imgSeq);
+    /// 'quality': quality of the active frames of 'imgSeq' in chronological order (may be empty)
+    c_FrameSelectDlg(libskry::c_ImageSequence &imgSeq, FrameCache::SeqId_t frameCacheId,
+                     const std::vector<SKRY_quality_t> &quality);
 
     /// Element count = number of images in 'imgSeq'
     std::vector<uint8_t> GetActiveFlags() const;
 
 private:
-    class c_FrameListModelColumns: public Gtk::TreeModelColumnRecord
-    {
-    public:
-        Gtk::TreeModelColumn<size_t> index;
-        Gtk::TreeModelColumn<bool> active;
-
-        c_FrameListModelColumns()
-        {
-            add(index);
-            add(active);
-        }
-    };
-
     libskry::c_ImageSequence &m_ImgSeq;
+    FrameCache::SeqId_t m_FrameCacheId;
 
     c_ImageViewer m_ImgView;
     Gtk::Scale m_VideoPos;
+    Gtk::DrawingArea m_ThumbnailStrip;
+    std::vector<size_t> m_ThumbnailIndices; ///< Frames shown in 'm_ThumbnailStrip'
     Gtk::ToggleButton m_SyncListWSlider;
     struct
     {
-        c_FrameListModelColumns      columns;
-        Glib::RefPtr<Gtk::ListStore> data;
-        Gtk::TreeView                view;
+        Glib::RefPtr<c_FrameListModel> data;
+        Gtk::TreeView                  view;
     } m_FrameList;
 
+    Gtk::Label m_NumActiveLabel;
+
+    struct
+    {
+        Gtk::SpinButton first, last;
+    } m_Range;
+
+    struct
+    {
+        Gtk::SpinButton percentage;
+    } m_KeepBest;
+
+    /// Quality of the frames active when the dialog was created (chronological order); may be empty
+    std::vector<SKRY_quality_t> m_Quality;
+    std::vector<size_t> m_QualityFrameIndices; ///< Frame index corresponding to each element of 'm_Quality'
+
+    unsigned m_FrameWidth = 0, m_FrameHeight = 0;
+
+    /// Signaled by 'm_PreviewLoader' from its thread
+    Glib::Dispatcher m_FrameReadyDispatcher;
+
+    /// Exists while the dialog is shown (and only if the first frame could be loaded)
+    std::unique_ptr<c_FramePreviewLoader> m_PreviewLoader;
+
+    /// Surface obtained from 'm_PreviewLoader' currently displayed by 'm_ImgView'
+    Cairo::RefPtr<Cairo::ImageSurface> m_DisplayedSrc;
+    bool m_DisplayingFullFrame = false;
+
     void InitControls();
     Gtk::Box *CreateVisualizationBox();
     Gtk::Box *CreateFrameListBox();
+    void StartPreviewLoader();
+    int GetThumbnailWidth() const;
+    /// Shows frame 'imgIdx' if decoded, otherwise the nearest available preview
+    void ShowFrame(size_t imgIdx);
+    /// Returns the frame corresponding to the horizontal position 'x' in 'm_ThumbnailStrip'
+    size_t GetThumbnailStripFrameAt(double x) const;
+    void UpdateNumActiveLabel();
 
     // Signal handlers ----------------------------
     void OnVideoPosScroll();
     void OnActivateAll();
+    void OnSetRangeActive(bool active);
+    void OnKeepBest();
+    void OnActiveFramesChanged(size_t first, size_t end);
     void OnSyncToggled();
     bool OnDrawImage(const Cairo::RefPtr<Cairo::Context>& cr);
     void OnFrameListCursorChanged();
     void OnResponse(int responseId);
     bool OnListKeyPress(GdkEventKey *event);
+    void OnFrameReady();
+    bool OnDrawThumbnailStrip(const Cairo::RefPtr<Cairo::Context> &cr);
+    void OnThumbnailStripResized(Gtk::Allocation &allocation);
+    bool OnThumbnailStripBtnPress(GdkEventButton *event);
+    bool OnThumbnailStripMotion(GdkEventMotion *event);
 };
 
 #endif // STACKISTRY_FRAME_SELECT_DIALOG
@@ -0,0 +1,309 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    OpenGL image display widget implementation.
+*/
+
+#if defined(USE_OPENGL)
+
+#include <iostream>
+
+#include <epoxy/gl.h>
+
+#include "gl_image_view.h"
+
+
+namespace
+{
+
+const char *VERTEX_SHADER =
+    "#version 150\n"
+    "in vec2 unitPos;\n"
+    "uniform vec2 viewportSize;\n"
+    "uniform vec2 rectOrigin;\n"
+    "uniform vec2 rectSize;\n"
+    "out vec2 texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pos = rectOrigin + unitPos * rectSize;\n"
+    "    texCoord = unitPos;\n"
+    "    gl_Position = vec4(2.0 * pos.x / viewportSize.x - 1.0, 1.0 - 2.0 * pos.y / viewportSize.y, 0.0, 1.0);\n"
+    "}\n";
+
+const char *FRAGMENT_SHADER =
+    "#version 150\n"
+    "in vec2 texCoord;\n"
+    "uniform sampler2D img;\n"
+    "out vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = vec4(texture(img, texCoord).rgb, 1.0);\n"
+    "}\n";
+
+/// Returns 0 on failure
+GLuint CompileShader(GLenum type, const char *source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        char log[1024] = { 0 };
+        glGetShaderInfoLog(shader, sizeof(log) - 1, nullptr, log);
+        std::cerr << "Could not compile shader: " << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+/// Returns 0 on failure
+GLuint CreateProgram()
+{
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    if (!vertexShader || !fragmentShader)
+    {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, 0, "unitPos");
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        std::cerr << "Could not link shader program." << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+} // anonymous namespace
+
+c_GLImageView::c_GLImageView()
+{
+    set_has_alpha(true); // the widget's background shows through outside the image
+    set_auto_render(false);
+}
+
+bool c_GLImageView::IsUsable() const
+{
+    return m_IsInitialized &&
+           (!m_Img || (m_Img->get_width() <= m_MaxTextureSize && m_Img->get_height() <= m_MaxTextureSize));
+}
+
+void c_GLImageView::on_realize()
+{
+    Gtk::GLArea::on_realize();
+
+    m_IsInitialized = false;
+    make_current();
+    try
+    {
+        throw_if_error();
+    }
+    catch (const Glib::Error &error)
+    {
+        std::cerr << "OpenGL display not available: " << error.what() << std::endl;
+        return;
+    }
+
+    m_Program = CreateProgram();
+    if (!m_Program)
+        return;
+
+    m_UniformViewportSize = glGetUniformLocation(m_Program, "viewportSize");
+    m_UniformRectOrigin = glGetUniformLocation(m_Program, "rectOrigin");
+    m_UniformRectSize = glGetUniformLocation(m_Program, "rectSize");
+    m_UniformImg = glGetUniformLocation(m_Program, "img");
+
+    // A unit square drawn as a triangle strip; scaled and positioned by the vertex shader
+    const GLfloat unitSquare[] = { 0, 0,  1, 0,  0, 1,  1, 1 };
+
+    glGenVertexArrays(1, &m_VertexArray);
+    glBindVertexArray(m_VertexArray);
+    glGenBuffers(1, &m_VertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unitSquare), unitSquare, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glBindVertexArray(0);
+
+    glGenTextures(1, &m_Texture);
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_MaxTextureSize);
+
+    m_TextureWidth = m_TextureHeight = 0; // the texture is new
+    m_IsInitialized = true;
+}
+
+void c_GLImageView::on_unrealize()
+{
+    make_current();
+    if (m_IsInitialized)
+    {
+        glDeleteTextures(1, &m_Texture);
+        glDeleteBuffers(1, &m_VertexBuffer);
+        glDeleteVertexArrays(1, &m_VertexArray);
+        glDeleteProgram(m_Program);
+        m_IsInitialized = false;
+    }
+
+    Gtk::GLArea::on_unrealize();
+}
+
+void c_GLImageView::SetImage(const Cairo::RefPtr<Cairo::ImageSurface> &img)
+{
+    m_Img = img;
+    m_TextureWidth = m_TextureHeight = 0;
+    m_TextureAreaInvalid = false;
+    queue_render();
+}
+
+void c_GLImageView::InvalidateImageArea(const Gdk::Rectangle &area)
+{
+    if (!m_Img)
+        return;
+
+    if (m_TextureAreaInvalid)
+        m_InvalidArea.join(area);
+    else
+        m_InvalidArea = area;
+
+    m_InvalidArea.intersect(Gdk::Rectangle(0, 0, m_Img->get_width(), m_Img->get_height()));
+    m_TextureAreaInvalid = !m_InvalidArea.has_zero_area();
+    queue_render();
+}
+
+void c_GLImageView::SetView(double xPos, double yPos, double zoom, Utils::Const::InterpolationMethod interpolation)
+{
+    if (xPos != m_XPos || yPos != m_YPos || zoom != m_Zoom || interpolation != m_Interpolation)
+    {
+        m_XPos = xPos;
+        m_YPos = yPos;
+        m_Zoom = zoom;
+        m_Interpolation = interpolation;
+        queue_render();
+    }
+}
+
+void c_GLImageView::UploadTexture()
+{
+    const bool wholeImage = (m_TextureWidth != m_Img->get_width() || m_TextureHeight != m_Img->get_height());
+    if (!wholeImage && !m_TextureAreaInvalid)
+        return;
+
+    m_Img->flush();
+    const unsigned char *data = m_Img->get_data();
+
+    // Cairo RGB24 pixels are 32-bit values 0xXXRRGGBB in native byte order
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_Img->get_stride() / 4);
+    if (wholeImage)
+    {
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Img->get_width(), m_Img->get_height(), 0,
+                     GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, data);
+        m_TextureWidth = m_Img->get_width();
+        m_TextureHeight = m_Img->get_height();
+    }
+    else
+    {
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, m_InvalidArea.get_x());
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, m_InvalidArea.get_y());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, m_InvalidArea.get_x(), m_InvalidArea.get_y(),
+                        m_InvalidArea.get_width(), m_InvalidArea.get_height(),
+                        GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, data);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    m_TextureAreaInvalid = false;
+    m_MipmapsValid = false;
+}
+
+bool c_GLImageView::on_render(const Glib::RefPtr<Gdk::GLContext> &/*context*/)
+{
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!IsUsable() || !m_Img)
+        return true;
+
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    UploadTexture();
+
+    // Counterparts of the Cairo filters used by Utils::GetFilter(); for "best", trilinear
+    // filtering of mipmaps avoids aliasing when zooming out
+    GLint minFilter = GL_LINEAR, magFilter = GL_LINEAR;
+    switch (m_Interpolation)
+    {
+        case Utils::Const::InterpolationMethod::FAST: minFilter = magFilter = GL_NEAREST; break;
+        case Utils::Const::InterpolationMethod::GOOD: break;
+        case Utils::Const::InterpolationMethod::BEST:
+            minFilter = GL_LINEAR_MIPMAP_LINEAR;
+            if (!m_MipmapsValid)
+            {
+                glGenerateMipmap(GL_TEXTURE_2D);
+                m_MipmapsValid = true;
+            }
+            break;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+
+    glUseProgram(m_Program);
+    glUniform2f(m_UniformViewportSize, get_allocated_width(), get_allocated_height());
+    glUniform2f(m_UniformRectOrigin, m_XPos, m_YPos);
+    glUniform2f(m_UniformRectSize, m_Zoom * m_TextureWidth, m_Zoom * m_TextureHeight);
+    glUniform1i(m_UniformImg, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(m_VertexArray);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    return true;
+}
+
+#endif // USE_OPENGL
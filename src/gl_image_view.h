@@ -0,0 +1,85 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    OpenGL image display widget header.
+*/
+
+#ifndef STACKISTRY_GL_IMAGE_VIEW_HEADER
+#define STACKISTRY_GL_IMAGE_VIEW_HEADER
+
+#if defined(USE_OPENGL)
+
+#include <cairomm/surface.h>
+#include <gdkmm/rectangle.h>
+#include <gtkmm/glarea.h>
+
+#include "utils.h"
+
+
+/// Draws an image scaled and translated by the GPU
+/** The image is uploaded as a texture once (and again only after it has been
+    modified), so that zooming and scrolling do not require any work of the CPU
+    cores (which may be busy with stacking). If OpenGL cannot be used (or the image
+    exceeds the max. texture size), IsUsable() returns 'false' and nothing is drawn. */
+class c_GLImageView: public Gtk::GLArea
+{
+public:
+    c_GLImageView();
+
+    /// Returns 'true' if the widget has been realized and can draw the current image
+    bool IsUsable() const;
+
+    /// Sets the image to display (null = none); it is uploaded on the next rendering
+    void SetImage(const Cairo::RefPtr<Cairo::ImageSurface> &img);
+
+    /// Informs that the specified area of the image has been modified; it is uploaded on the next rendering
+    void InvalidateImageArea(const Gdk::Rectangle &area);
+
+    /// Sets the image's position (of its top-left corner) within the widget, zoom factor and interpolation
+    void SetView(double xPos, double yPos, double zoom, Utils::Const::InterpolationMethod interpolation);
+
+protected:
+    void on_realize() override;
+    void on_unrealize() override;
+    bool on_render(const Glib::RefPtr<Gdk::GLContext> &context) override;
+
+private:
+    bool m_IsInitialized = false;
+    int m_MaxTextureSize = 0;
+
+    unsigned m_Program = 0, m_VertexArray = 0, m_VertexBuffer = 0, m_Texture = 0;
+    int m_UniformViewportSize = -1, m_UniformRectOrigin = -1, m_UniformRectSize = -1, m_UniformImg = -1;
+
+    Cairo::RefPtr<Cairo::ImageSurface> m_Img;
+    /// Size of the image in the texture; 0 if nothing has been uploaded
+    int m_TextureWidth = 0, m_TextureHeight = 0;
+    bool m_TextureAreaInvalid = false;
+    Gdk::Rectangle m_InvalidArea; ///< Area of 'm_Img' to be uploaded (if 'm_TextureAreaInvalid')
+    bool m_MipmapsValid = false;
+
+    double m_XPos = 0, m_YPos = 0, m_Zoom = 1;
+    Utils::Const::InterpolationMethod m_Interpolation = Utils::Const::Defaults::interpolation;
+
+    void UploadTexture();
+};
+
+#endif // USE_OPENGL
+
+#endif // STACKISTRY_GL_IMAGE_VIEW_HEADER
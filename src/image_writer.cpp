@@ -0,0 +1,304 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Streaming image writer implementation.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "image_writer.h"
+#include "utils.h"
+#include "version.h"
+
+
+namespace ImageWriter
+{
+
+/// Passes the rows of 'img' converted to 'pixFmt' to 'writeRow', from top to bottom (or from bottom to top if 'bottomUp')
+/** Returns 'false' if out of memory or if 'writeRow' failed. */
+static bool ForEachConvertedRow(const libskry::c_Image &img, enum SKRY_pixel_format pixFmt, bool bottomUp,
+                                const std::function<bool(const void *row)> &writeRow)
+{
+    const enum SKRY_pixel_format srcFmt = img.GetPixelFormat();
+    const unsigned height = img.GetHeight();
+    const unsigned stripHeight = Utils::Const::imageWriterStripHeight;
+    const size_t srcRowBytes = (size_t)img.GetWidth() * NUM_CHANNELS[srcFmt] * BITS_PER_CHANNEL[srcFmt] / 8;
+
+    for (unsigned stripStart = 0; stripStart < height; stripStart += stripHeight)
+    {
+        const unsigned numRows = std::min(stripHeight, height - stripStart);
+        const unsigned y0 = (bottomUp ? height - stripStart - numRows : stripStart);
+
+        if (srcFmt == pixFmt)
+        {
+            for (unsigned i = 0; i < numRows; i++)
+                if (!writeRow(img.GetLine(bottomUp ? y0 + numRows - 1 - i : y0 + i)))
+                    return false;
+
+            continue;
+        }
+
+        libskry::c_Image strip(img.GetWidth(), numRows, srcFmt, nullptr, false);
+        if (!strip)
+            return false;
+        for (unsigned i = 0; i < numRows; i++)
+            memcpy(strip.GetLine(i), img.GetLine(y0 + i), srcRowBytes);
+
+        libskry::c_Image convStrip = libskry::c_Image::ConvertPixelFormat(strip, pixFmt);
+        if (!convStrip)
+            return false;
+        for (unsigned i = 0; i < numRows; i++)
+            if (!writeRow(convStrip.GetLine(bottomUp ? numRows - 1 - i : i)))
+                return false;
+    }
+
+    return true;
+}
+
+static bool IsHostLittleEndian()
+{
+    const uint16_t value = 1;
+    return *reinterpret_cast<const uint8_t *>(&value) == 1;
+}
+
+/// Appends 'value' in the host's byte order
+template<typename T>
+static void Put(std::vector<uint8_t> &buf, T value)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    buf.insert(buf.end(), bytes, bytes + sizeof(value));
+}
+
+namespace TIFF
+{
+    enum FieldType: uint16_t { SHORT = 3, LONG = 4 };
+
+    /// Appends a directory entry with a single value (stored in the entry itself)
+    static void PutEntry(std::vector<uint8_t> &buf, uint16_t tag, FieldType type, uint32_t value)
+    {
+        Put<uint16_t>(buf, tag);
+        Put<uint16_t>(buf, type);
+        Put<uint32_t>(buf, 1);
+        if (type == SHORT)
+        {
+            Put<uint16_t>(buf, value);
+            Put<uint16_t>(buf, 0);
+        }
+        else
+            Put<uint32_t>(buf, value);
+    }
+
+    /// Appends a directory entry with one SHORT value per channel; if they do not fit in the entry, they are stored at 'offset'
+    static void PutChannelsEntry(std::vector<uint8_t> &buf, uint16_t tag, unsigned numChannels, uint16_t value, uint32_t offset)
+    {
+        if (numChannels == 1)
+            PutEntry(buf, tag, SHORT, value);
+        else
+        {
+            Put<uint16_t>(buf, tag);
+            Put<uint16_t>(buf, SHORT);
+            Put<uint32_t>(buf, numChannels);
+            Put<uint32_t>(buf, offset);
+        }
+    }
+}
+
+/// Writes an uncompressed TIFF file with a single strip
+static enum SKRY_result SaveTiff(const libskry::c_Image &img, const std::string &fileName, enum SKRY_pixel_format pixFmt)
+{
+    const unsigned numChannels = NUM_CHANNELS[pixFmt];
+    const unsigned bitsPerChannel = BITS_PER_CHANNEL[pixFmt];
+    const size_t rowBytes = (size_t)img.GetWidth() * numChannels * bitsPerChannel / 8;
+    const size_t dataBytes = rowBytes * img.GetHeight();
+    if (dataBytes > UINT32_MAX)
+        return SKRY_INVALID_IMG_DIMENSIONS;
+
+    const unsigned numEntries = 11;
+    const uint32_t dirEnd = 8 + 2 + numEntries * 12 + 4;
+    // Per-channel values (if there is more than one channel) are stored after the directory
+    const uint32_t bitsPerSampleOffset = dirEnd;
+    const uint32_t sampleFmtOffset = bitsPerSampleOffset + 2 * numChannels;
+    const uint32_t dataOffset = (numChannels > 1 ? sampleFmtOffset + 2 * numChannels : dirEnd);
+
+    // The header is written in the host's byte order, so that the pixel values can be written as they are
+    std::vector<uint8_t> header;
+    header.push_back(IsHostLittleEndian() ? 'I' : 'M');
+    header.push_back(header.back());
+    Put<uint16_t>(header, 42);
+    Put<uint32_t>(header, 8); // offset of the image file directory
+
+    const uint16_t sampleFmt = (bitsPerChannel == 32 ? 3 : 1); // IEEE floating point or unsigned integer
+
+    Put<uint16_t>(header, numEntries);
+    TIFF::PutEntry(header, 256, TIFF::LONG, img.GetWidth());
+    TIFF::PutEntry(header, 257, TIFF::LONG, img.GetHeight());
+    TIFF::PutChannelsEntry(header, 258, numChannels, bitsPerChannel, bitsPerSampleOffset);
+    TIFF::PutEntry(header, 259, TIFF::SHORT, 1); // no compression
+    TIFF::PutEntry(header, 262, TIFF::SHORT, numChannels == 3 ? 2 : 1); // RGB or "black is zero"
+    TIFF::PutEntry(header, 273, TIFF::LONG, dataOffset); // strip offset
+    TIFF::PutEntry(header, 277, TIFF::SHORT, numChannels);
+    TIFF::PutEntry(header, 278, TIFF::LONG, img.GetHeight()); // rows per strip
+    TIFF::PutEntry(header, 279, TIFF::LONG, dataBytes); // strip byte count
+    TIFF::PutEntry(header, 284, TIFF::SHORT, 1); // interleaved channels
+    TIFF::PutChannelsEntry(header, 339, numChannels, sampleFmt, sampleFmtOffset);
+    Put<uint32_t>(header, 0); // no more directories
+
+    if (numChannels > 1)
+    {
+        for (unsigned ch = 0; ch < numChannels; ch++)
+            Put<uint16_t>(header, bitsPerChannel);
+        for (unsigned ch = 0; ch < numChannels; ch++)
+            Put<uint16_t>(header, sampleFmt);
+    }
+
+    std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    if (file.fail())
+        return SKRY_CANNOT_CREATE_FILE;
+
+    bool writeFailed = false;
+    bool success = ForEachConvertedRow(img, pixFmt, false,
+        [&file, &writeFailed, rowBytes](const void *row) -> bool
+        {
+            file.write(static_cast<const char *>(row), rowBytes);
+            writeFailed = file.fail();
+            return !writeFailed;
+        });
+
+    file.close();
+    if (!success)
+        return (writeFailed || file.fail() ? SKRY_CANNOT_CREATE_FILE : SKRY_OUT_OF_MEMORY);
+
+    return (file.fail() ? SKRY_CANNOT_CREATE_FILE : SKRY_SUCCESS);
+}
+
+namespace FITS
+{
+    const size_t BLOCK_SIZE = 2880;
+    const size_t CARD_SIZE = 80;
+
+    static void PutCard(std::string &header, const char *keyword, const std::string &value)
+    {
+        char card[CARD_SIZE + 1];
+        snprintf(card, sizeof(card), "%-8s= %20s", keyword, value.c_str());
+        header += card;
+        header.append(CARD_SIZE - strlen(card), ' ');
+    }
+
+    static void PutCard(std::string &header, const char *keyword, long value)
+    {
+        PutCard(header, keyword, std::to_string(value));
+    }
+}
+
+/// Writes a FITS file with 32-bit floating-point values
+/** Color images are stored as 3 planes (one per channel); rows are stored from the bottom up. */
+static enum SKRY_result SaveFits(const libskry::c_Image &img, const std::string &fileName, enum SKRY_pixel_format pixFmt)
+{
+    const unsigned numChannels = NUM_CHANNELS[pixFmt];
+    const unsigned width = img.GetWidth();
+
+    std::string header;
+    FITS::PutCard(header, "SIMPLE", "T");
+    FITS::PutCard(header, "BITPIX", -32);
+    FITS::PutCard(header, "NAXIS", numChannels > 1 ? 3 : 2);
+    FITS::PutCard(header, "NAXIS1", width);
+    FITS::PutCard(header, "NAXIS2", img.GetHeight());
+    if (numChannels > 1)
+        FITS::PutCard(header, "NAXIS3", numChannels);
+    header += std::string("CREATOR = 'Stackistry ") + std::to_string(VERSION_MAJOR) + "." + std::to_string(VERSION_MINOR)
+              + "." + std::to_string(VERSION_SUBMINOR) + "'";
+    header.resize((header.size() + FITS::CARD_SIZE - 1) / FITS::CARD_SIZE * FITS::CARD_SIZE, ' ');
+    header += "END";
+    header.resize((header.size() + FITS::BLOCK_SIZE - 1) / FITS::BLOCK_SIZE * FITS::BLOCK_SIZE, ' ');
+
+    std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    file.write(header.data(), header.size());
+    if (file.fail())
+        return SKRY_CANNOT_CREATE_FILE;
+
+    // FITS values are big-endian
+    std::vector<uint8_t> rowBuf(width * sizeof(float));
+    bool writeFailed = false;
+    for (unsigned ch = 0; ch < numChannels; ch++)
+    {
+        bool success = ForEachConvertedRow(img, pixFmt, true,
+            [&](const void *row) -> bool
+            {
+                const float *values = static_cast<const float *>(row);
+                for (unsigned x = 0; x < width; x++)
+                {
+                    uint32_t bits;
+                    memcpy(&bits, &values[x * numChannels + ch], sizeof(bits));
+                    for (int i = 0; i < 4; i++)
+                        rowBuf[x * 4 + i] = (bits >> (24 - 8 * i)) & 0xFF;
+                }
+                file.write(reinterpret_cast<const char *>(rowBuf.data()), rowBuf.size());
+                writeFailed = file.fail();
+                return !writeFailed;
+            });
+
+        if (!success)
+            return (writeFailed ? SKRY_CANNOT_CREATE_FILE : SKRY_OUT_OF_MEMORY);
+    }
+
+    const size_t dataBytes = (size_t)width * img.GetHeight() * numChannels * sizeof(float);
+    const std::vector<char> padding((FITS::BLOCK_SIZE - dataBytes % FITS::BLOCK_SIZE) % FITS::BLOCK_SIZE, 0);
+    file.write(padding.data(), padding.size());
+    file.close();
+
+    return (file.fail() ? SKRY_CANNOT_CREATE_FILE : SKRY_SUCCESS);
+}
+
+unsigned GetBitsPerChannel(const OutputFormat_t &outputFmt)
+{
+    return (outputFmt.IsOwn() ? 32 : OUTPUT_FMT_BITS_PER_CHANNEL[outputFmt.skry]);
+}
+
+enum SKRY_result Save(const libskry::c_Image &img, const std::string &fileName, const OutputFormat_t &outputFmt)
+{
+    const enum SKRY_pixel_format pixFmt = Utils::FindMatchingFormat(outputFmt, NUM_CHANNELS[img.GetPixelFormat()]);
+    if (pixFmt == SKRY_PIX_INVALID)
+        return SKRY_UNSUPPORTED_PIXEL_FORMAT;
+
+    // Strips of a palettized image would need the palette, and libskry's formats are saved in one go
+    if (img.GetPixelFormat() == SKRY_PIX_PAL8 || (!outputFmt.IsOwn() && outputFmt.skry != SKRY_TIFF_16))
+    {
+        libskry::c_Image convImg = libskry::c_Image::ConvertPixelFormat(img, pixFmt);
+        if (!convImg)
+            return SKRY_OUT_OF_MEMORY;
+
+        return (img.GetPixelFormat() == SKRY_PIX_PAL8 ? Save(convImg, fileName, outputFmt)
+                                                      : convImg.Save(fileName.c_str(), outputFmt.skry));
+    }
+
+    if (outputFmt.own == OwnFormat::FITS_32F)
+        return SaveFits(img, fileName, pixFmt);
+    else
+        return SaveTiff(img, fileName, pixFmt);
+}
+
+} // namespace ImageWriter
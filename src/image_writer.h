@@ -0,0 +1,70 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Streaming image writer header.
+*/
+
+#ifndef STACKISTRY_IMAGE_WRITER_HEADER
+#define STACKISTRY_IMAGE_WRITER_HEADER
+
+#include <string>
+
+#include <skry/skry_cpp.hpp>
+
+
+/// Saving of images without a converted copy of the whole image
+/** Rows are converted to the output pixel format and written in strips
+    of Utils::Const::imageWriterStripHeight rows. */
+namespace ImageWriter
+{
+    /// Output formats written by Stackistry itself
+    enum class OwnFormat { NONE = 0, TIFF_32F, FITS_32F };
+
+    /// One of libskry's output formats or one written by Stackistry itself
+    struct OutputFormat_t
+    {
+        OwnFormat own;
+        enum SKRY_output_format skry; ///< Used only if 'own' is OwnFormat::NONE
+
+        OutputFormat_t(): OutputFormat_t(SKRY_TIFF_16) { }
+        OutputFormat_t(enum SKRY_output_format skryFmt): own(OwnFormat::NONE), skry(skryFmt) { }
+        OutputFormat_t(OwnFormat ownFmt): own(ownFmt), skry(SKRY_TIFF_16) { }
+
+        /// Returns 'true' if the format cannot be passed to libskry
+        bool IsOwn() const { return own != OwnFormat::NONE; }
+
+        bool operator ==(const OutputFormat_t &other) const
+        {
+            return own == other.own && (IsOwn() || skry == other.skry);
+        }
+        bool operator !=(const OutputFormat_t &other) const { return !(*this == other); }
+    };
+
+    /// Counterpart of libskry's OUTPUT_FMT_BITS_PER_CHANNEL[] which also handles Stackistry's own formats
+    unsigned GetBitsPerChannel(const OutputFormat_t &outputFmt);
+
+    /// Saves 'img' as 'fileName' in 'outputFmt'
+    /** TIFF and FITS files are written strip by strip. The 8-bit formats are saved by libskry
+        (after converting the whole image, which is small at this bit depth).
+        Floating-point values are written as they are (the expected range is [0; 1]). */
+    enum SKRY_result Save(const libskry::c_Image &img, const std::string &fileName, const OutputFormat_t &outputFmt);
+}
+
+#endif // STACKISTRY_IMAGE_WRITER_HEADER
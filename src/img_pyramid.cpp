@@ -0,0 +1,209 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Multi-resolution tiled image implementation.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <utility>
+
+#include "img_pyramid.h"
+
+
+const int TILE_SIZE = 256;
+
+/// Max. amount of memory used by the rendered tiles
+const size_t TILE_CACHE_BUDGET = 64 * 1024*1024;
+
+/// Smaller images are drawn directly
+const size_t MIN_NUM_PIXELS = 2048 * 2048;
+
+/// Returns 'src' downsampled 2x (by averaging 2x2 blocks)
+static Cairo::RefPtr<Cairo::ImageSurface> Downsample(const Cairo::RefPtr<Cairo::ImageSurface> &src)
+{
+    src->flush();
+
+    const int srcWidth = src->get_width(), srcHeight = src->get_height();
+    const int destWidth = (srcWidth + 1) / 2, destHeight = (srcHeight + 1) / 2;
+    auto dest = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, destWidth, destHeight);
+
+    for (int y = 0; y < destHeight; y++)
+    {
+        const uint32_t *srcRow0 = reinterpret_cast<const uint32_t *>(src->get_data() + 2*y * src->get_stride());
+        const uint32_t *srcRow1 = reinterpret_cast<const uint32_t *>(src->get_data() +
+                                                                     std::min(2*y + 1, srcHeight - 1) * src->get_stride());
+        uint32_t *destRow = reinterpret_cast<uint32_t *>(dest->get_data() + y * dest->get_stride());
+
+        for (int x = 0; x < destWidth; x++)
+        {
+            const int x0 = 2*x, x1 = std::min(2*x + 1, srcWidth - 1);
+            const uint32_t p[4] = { srcRow0[x0], srcRow0[x1], srcRow1[x0], srcRow1[x1] };
+
+            uint32_t result = 0;
+            for (int shift: { 0, 8, 16 })
+            {
+                uint32_t sum = 0;
+                for (uint32_t pixel: p)
+                    sum += (pixel >> shift) & 0xFF;
+                result |= ((sum + 2) / 4) << shift;
+            }
+            destRow[x] = result;
+        }
+    }
+
+    dest->mark_dirty();
+    return dest;
+}
+
+bool c_ImagePyramid::IsWorthUsing(const Cairo::RefPtr<Cairo::ImageSurface> &img)
+{
+    return img && img->get_format() == Cairo::Format::FORMAT_RGB24 &&
+           (size_t)img->get_width() * img->get_height() >= MIN_NUM_PIXELS;
+}
+
+void c_ImagePyramid::SetImage(const Cairo::RefPtr<Cairo::ImageSurface> &img)
+{
+    m_Levels.clear();
+    if (img)
+        m_Levels.push_back(img);
+
+    m_Tiles.clear();
+    m_TilesLRU.clear();
+    m_TilesBytes = 0;
+}
+
+void c_ImagePyramid::Invalidate()
+{
+    if (!m_Levels.empty())
+        SetImage(m_Levels[0]);
+}
+
+const Cairo::RefPtr<Cairo::ImageSurface> &c_ImagePyramid::GetLevel(size_t level)
+{
+    while (m_Levels.size() <= level)
+        m_Levels.push_back(Downsample(m_Levels.back()));
+
+    return m_Levels[level];
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> c_ImagePyramid::RenderTile(int col, int row, double zoom, Cairo::Filter filter)
+{
+    const Cairo::RefPtr<Cairo::ImageSurface> &img = m_Levels[0];
+
+    const int fullWidth = zoom * img->get_width(),
+              fullHeight = zoom * img->get_height();
+
+    const int tileX = col * TILE_SIZE, tileY = row * TILE_SIZE;
+    const int tileWidth = std::min(TILE_SIZE, fullWidth - tileX),
+              tileHeight = std::min(TILE_SIZE, fullHeight - tileY);
+
+    // Use the smallest level which is still not smaller than the zoomed image
+    size_t level = 0;
+    while (zoom * (2 << level) <= 1.0 && GetLevel(level)->get_width() > 1 && GetLevel(level)->get_height() > 1)
+        level++;
+
+    const Cairo::RefPtr<Cairo::ImageSurface> &levelImg = GetLevel(level);
+    const double xScale = (double)levelImg->get_width() / img->get_width() / zoom,
+                 yScale = (double)levelImg->get_height() / img->get_height() / zoom;
+
+    auto src = Cairo::SurfacePattern::create(levelImg);
+    src->set_matrix(Cairo::Matrix(xScale, 0, 0, yScale, tileX * xScale, tileY * yScale));
+    src->set_filter(filter);
+
+    auto tile = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, tileWidth, tileHeight);
+    auto cr = Cairo::Context::create(tile);
+    cr->set_source(src);
+    cr->paint();
+    tile->flush();
+
+    return tile;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> c_ImagePyramid::GetTile(int col, int row, double zoom, Cairo::Filter filter)
+{
+    const TileKey_t key((int)std::round(zoom * 1000), (int)filter, col, row);
+
+    auto tile = m_Tiles.find(key);
+    if (tile != m_Tiles.end())
+    {
+        m_TilesLRU.splice(m_TilesLRU.begin(), m_TilesLRU, tile->second.lruPos);
+        return tile->second.surface;
+    }
+
+    Cairo::RefPtr<Cairo::ImageSurface> surface = RenderTile(col, row, zoom, filter);
+    const size_t numBytes = (size_t)surface->get_stride() * surface->get_height();
+
+    // Keep at least the new tile, even if it exceeds the budget
+    while (m_TilesBytes + numBytes > TILE_CACHE_BUDGET && !m_TilesLRU.empty())
+    {
+        auto oldest = m_Tiles.find(m_TilesLRU.back());
+        m_TilesBytes -= (size_t)oldest->second.surface->get_stride() * oldest->second.surface->get_height();
+        m_Tiles.erase(oldest);
+        m_TilesLRU.pop_back();
+    }
+
+    m_TilesLRU.push_front(key);
+    m_Tiles[key] = Tile_t { surface, m_TilesLRU.begin() };
+    m_TilesBytes += numBytes;
+
+    return surface;
+}
+
+void c_ImagePyramid::Draw(const Cairo::RefPtr<Cairo::Context> &cr, double zoom, Cairo::Filter filter,
+                          const std::vector<Cairo::Rectangle> &clipRects)
+{
+    if (m_Levels.empty() || zoom <= 0)
+        return;
+
+    const int fullWidth = zoom * m_Levels[0]->get_width(),
+              fullHeight = zoom * m_Levels[0]->get_height();
+    if (fullWidth <= 0 || fullHeight <= 0)
+        return;
+
+    const int numCols = (fullWidth + TILE_SIZE - 1) / TILE_SIZE,
+              numRows = (fullHeight + TILE_SIZE - 1) / TILE_SIZE;
+
+    // Clip rectangles may share tiles; draw each one once
+    std::set<std::pair<int, int>> tilesToDraw;
+    for (const Cairo::Rectangle &rect: clipRects)
+    {
+        const int col0 = std::max(0, (int)std::floor(rect.x / TILE_SIZE)),
+                  col1 = std::min(numCols - 1, (int)std::floor((rect.x + rect.width) / TILE_SIZE)),
+                  row0 = std::max(0, (int)std::floor(rect.y / TILE_SIZE)),
+                  row1 = std::min(numRows - 1, (int)std::floor((rect.y + rect.height) / TILE_SIZE));
+
+        for (int row = row0; row <= row1; row++)
+            for (int col = col0; col <= col1; col++)
+                tilesToDraw.insert(std::make_pair(col, row));
+    }
+
+    for (const auto &colRow: tilesToDraw)
+    {
+        Cairo::RefPtr<Cairo::ImageSurface> tile = GetTile(colRow.first, colRow.second, zoom, filter);
+
+        const int tileX = colRow.first * TILE_SIZE, tileY = colRow.second * TILE_SIZE;
+        cr->set_source(tile, tileX, tileY);
+        cr->rectangle(tileX, tileY, tile->get_width(), tile->get_height());
+        cr->fill();
+    }
+}
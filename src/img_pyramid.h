@@ -0,0 +1,83 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Multi-resolution tiled image header.
+*/
+
+#ifndef STACKISTRY_IMAGE_PYRAMID_HEADER
+#define STACKISTRY_IMAGE_PYRAMID_HEADER
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <cairomm/context.h>
+#include <cairomm/surface.h>
+
+
+/// Draws zoomed views of a large image using a mip-map pyramid and a cache of rendered tiles
+/** Pyramid levels (each one half the size of the previous) are built on first use.
+    Drawing at a zoom factor Z filters the nearest level not smaller than Z, and only
+    for the tiles not drawn before at the same zoom factor and filter. The tiles
+    are cached up to a memory limit (the least recently used ones are discarded). */
+class c_ImagePyramid
+{
+public:
+    /// Returns true if drawing 'img' should be done via c_ImagePyramid (i.e. if the image is large)
+    static bool IsWorthUsing(const Cairo::RefPtr<Cairo::ImageSurface> &img);
+
+    /// Sets the image to draw (may be null); must have the RGB24 format
+    void SetImage(const Cairo::RefPtr<Cairo::ImageSurface> &img);
+
+    /// Discards the contents derived from the image; has to be called after the image is modified
+    void Invalidate();
+
+    /// Draws the image zoomed by 'zoom' in the area (in zoomed coordinates) covered by 'clipRects'
+    void Draw(const Cairo::RefPtr<Cairo::Context> &cr, double zoom, Cairo::Filter filter,
+              const std::vector<Cairo::Rectangle> &clipRects);
+
+private:
+    /// Zoom factor (in 1/1000s), filter, tile column, tile row
+    typedef std::tuple<int, int, int, int> TileKey_t;
+
+    struct Tile_t
+    {
+        Cairo::RefPtr<Cairo::ImageSurface> surface;
+        std::list<TileKey_t>::iterator lruPos;
+    };
+
+    /// Element [0] is the original image
+    std::vector<Cairo::RefPtr<Cairo::ImageSurface>> m_Levels;
+
+    std::map<TileKey_t, Tile_t> m_Tiles;
+    std::list<TileKey_t> m_TilesLRU; ///< The most recently used tile is at the front
+    size_t m_TilesBytes = 0;
+
+    /// Returns the specified level (creating it if necessary)
+    const Cairo::RefPtr<Cairo::ImageSurface> &GetLevel(size_t level);
+
+    Cairo::RefPtr<Cairo::ImageSurface> GetTile(int col, int row, double zoom, Cairo::Filter filter);
+
+    Cairo::RefPtr<Cairo::ImageSurface> RenderTile(int col, int row, double zoom, Cairo::Filter filter);
+};
+
+#endif // STACKISTRY_IMAGE_PYRAMID_HEADER
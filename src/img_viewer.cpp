@@ -21,6 +21,7 @@ File description:
     Image viewer widget implementation.
 */
 
+#include <cmath>
 #include <vector>
 
 #include <glibmm/i18n.h>
@@ -128,6 +129,13 @@ c_ImageViewer::c_ImageViewer()
     ));
     evtBox->show();
 
+    for (auto adjustment: { m_ScrWin.get_hadjustment(), m_ScrWin.get_vadjustment() })
+    {
+        // "changed" is emitted e.g. when the page size changes after resizing
+        adjustment->signal_value_changed().connect([this]() { m_VisibleAreaChangedSignal.emit(); });
+        adjustment->signal_changed().connect([this]() { m_VisibleAreaChangedSignal.emit(); });
+    }
+
     m_ScrWin.get_size_request(m_PrevScrWinWidth, m_PrevScrWinHeight);
     m_ScrWin.add(*evtBox);
     m_ScrWin.signal_draw().connect(sigc::slot<bool, const Cairo::RefPtr<Cairo::Context>&>(
@@ -152,7 +160,29 @@ c_ImageViewer::c_ImageViewer()
     ));
     m_ScrWin.show();
 
+#if defined(USE_OPENGL)
+    // The image is drawn by 'm_GLView' beneath; only the overlays drawn
+    // by the users of 'signal_DrawImageArea' remain in Cairo
+    const Gdk::RGBA transparent("rgba(0,0,0,0)");
+    Utils::SetBackgroundColor(m_ScrWin, transparent);
+    Utils::SetBackgroundColor(*m_ScrWin.get_child(), transparent); // the viewport
+    evtBox->set_visible_window(false);
+
+    for (auto adjustment: { m_ScrWin.get_hadjustment(), m_ScrWin.get_vadjustment() })
+    {
+        adjustment->signal_value_changed().connect(sigc::mem_fun(*this, &c_ImageViewer::UpdateGLView));
+        adjustment->signal_changed().connect(sigc::mem_fun(*this, &c_ImageViewer::UpdateGLView));
+    }
+    m_GLView.signal_realize().connect(sigc::mem_fun(*this, &c_ImageViewer::UpdateGLView));
+    m_GLView.show();
+
+    m_GLOverlay.add(m_GLView);
+    m_GLOverlay.add_overlay(m_ScrWin);
+    m_GLOverlay.show();
+    contents->pack_start(m_GLOverlay, Gtk::PackOptions::PACK_EXPAND_WIDGET);
+#else
     contents->pack_start(m_ScrWin, Gtk::PackOptions::PACK_EXPAND_WIDGET);
+#endif
 
     pack_start(*contents);
 }
@@ -163,11 +193,14 @@ void c_ImageViewer::OnChangeZoom()
     {
         if (m_Img)
         {
-            m_DrawArea.set_size_request(GetZoomPercentValIfEnabled() * m_Img->get_width() / 100,
-                                        GetZoomPercentValIfEnabled() * m_Img->get_height() / 100);
+            m_DrawArea.set_size_request(GetZoomPercentValIfEnabled() * m_FullWidth / 100,
+                                        GetZoomPercentValIfEnabled() * m_FullHeight / 100);
             m_DrawArea.queue_draw();
         }
 
+#if defined(USE_OPENGL)
+        UpdateGLView();
+#endif
         m_ZoomChangedSignal.emit(GetZoomPercentVal());
     }
 }
@@ -191,13 +224,13 @@ unsigned c_ImageViewer::GetZoomPercentVal() const
         int viewW = m_ScrWin.get_allocated_width(),
             viewH = m_ScrWin.get_allocated_height();
 
-        if ((double)viewW/viewH > (double)m_Img->get_width()/m_Img->get_height())
+        if ((double)viewW/viewH > (double)m_FullWidth/m_FullHeight)
         {
-            return viewH * 100 / m_Img->get_height();
+            return viewH * 100 / m_FullHeight;
         }
         else
         {
-            return viewW * 100 / m_Img->get_width();
+            return viewW * 100 / m_FullWidth;
         }
     }
     else
@@ -225,12 +258,35 @@ void c_ImageViewer::SetImage(const libskry::c_Image &img, bool refresh)
 /** Creates and uses a copy of 'img' for display; it can be
     later accessed (and modified) via GetImage(). */
 void c_ImageViewer::SetImage(const Cairo::RefPtr<Cairo::ImageSurface> &img, bool refresh)
+{
+    if (img)
+        SetImageFragment(img, img->get_width(), img->get_height(), 0, 0, refresh);
+    else
+        SetImageFragment(img, 0, 0, 0, 0, refresh);
+}
+
+void c_ImageViewer::SetImageFragment(const Cairo::RefPtr<Cairo::ImageSurface> &img,
+                                     int fullWidth, int fullHeight, int xOffset, int yOffset, bool refresh)
 {
     m_Img = img;
+    m_FullWidth = fullWidth;
+    m_FullHeight = fullHeight;
+    m_FragmentX = xOffset;
+    m_FragmentY = yOffset;
+
+    m_UsePyramid = (xOffset == 0 && yOffset == 0 && c_ImagePyramid::IsWorthUsing(img) &&
+                    img->get_width() == fullWidth && img->get_height() == fullHeight);
+    m_Pyramid.SetImage(m_UsePyramid ? img : Cairo::RefPtr<Cairo::ImageSurface>(nullptr));
+
+#if defined(USE_OPENGL)
+    m_GLView.SetImage(img);
+    UpdateGLView();
+#endif
+
     if (m_Img)
     {
-        m_DrawArea.set_size_request(GetZoomPercentValIfEnabled() * m_Img->get_width() / 100,
-                                    GetZoomPercentValIfEnabled() * m_Img->get_height() / 100);
+        m_DrawArea.set_size_request(GetZoomPercentValIfEnabled() * m_FullWidth / 100,
+                                    GetZoomPercentValIfEnabled() * m_FullHeight / 100);
     }
     else if (refresh)
     {
@@ -255,13 +311,6 @@ bool c_ImageViewer::OnDraw(const Cairo::RefPtr<Cairo::Context>& cr)
     if (!m_Img)
         return false;
 
-    auto src = Cairo::SurfacePattern::create(m_Img);
-    src->set_matrix(Cairo::scaling_matrix(
-                        100.0/GetZoomPercentValIfEnabled(),
-                        100.0/GetZoomPercentValIfEnabled()));
-    src->set_filter(Utils::GetFilter((Utils::Const::InterpolationMethod)m_InterpolationMethod.get_active_row_number()));
-    cr->set_source(src);
-
     std::vector<Cairo::Rectangle> clipRects;
 
     try
@@ -278,10 +327,35 @@ bool c_ImageViewer::OnDraw(const Cairo::RefPtr<Cairo::Context>& cr)
         clipRects.push_back(fullRect);
     }
 
-    for (Cairo::Rectangle &rect: clipRects)
-        cr->rectangle(rect.x, rect.y, rect.width, rect.height);
+    const Cairo::Filter filter = Utils::GetFilter((Utils::Const::InterpolationMethod)m_InterpolationMethod.get_active_row_number());
+    const int zoomPercent = GetZoomPercentValIfEnabled();
 
-    cr->fill();
+#if defined(USE_OPENGL)
+    if (m_GLView.IsUsable())
+    {
+        // The image has been drawn by 'm_GLView'; the draw area's position may have changed without scrolling (e.g. after resizing)
+        UpdateGLView();
+    }
+    else
+#endif
+    if (m_UsePyramid && zoomPercent != 100)
+    {
+        // Filtering the whole large image on every redraw would be too slow
+        m_Pyramid.Draw(cr, zoomPercent / 100.0, filter, clipRects);
+    }
+    else
+    {
+        auto src = Cairo::SurfacePattern::create(m_Img);
+        const double scale = 100.0/zoomPercent;
+        src->set_matrix(Cairo::Matrix(scale, 0, 0, scale, -m_FragmentX, -m_FragmentY));
+        src->set_filter(filter);
+        cr->set_source(src);
+
+        for (Cairo::Rectangle &rect: clipRects)
+            cr->rectangle(rect.x, rect.y, rect.width, rect.height);
+
+        cr->fill();
+    }
 
     // Call the external signal handler (if any)
     m_DrawImageAreaSignal.emit(cr);
@@ -292,12 +366,23 @@ bool c_ImageViewer::OnDraw(const Cairo::RefPtr<Cairo::Context>& cr)
 /// Refresh on screen the whole image
 void c_ImageViewer::Refresh()
 {
+    m_Pyramid.Invalidate();
+#if defined(USE_OPENGL)
+    if (m_Img)
+        m_GLView.InvalidateImageArea(Gdk::Rectangle(0, 0, m_Img->get_width(), m_Img->get_height()));
+#endif
     m_DrawArea.queue_draw();
 }
 
 /// Refresh on screen the specified rectangle in the image
 void c_ImageViewer::Refresh(const Cairo::Rectangle rect)
 {
+#if defined(USE_OPENGL)
+    const int x0 = (int)std::floor(rect.x) - m_FragmentX, y0 = (int)std::floor(rect.y) - m_FragmentY;
+    m_GLView.InvalidateImageArea(Gdk::Rectangle(x0, y0,
+                                                (int)std::ceil(rect.x + rect.width) - m_FragmentX - x0,
+                                                (int)std::ceil(rect.y + rect.height) - m_FragmentY - y0));
+#endif
     unsigned zoom = GetZoomPercentValIfEnabled();
     m_DrawArea.queue_draw_area(rect.x * zoom / 100,
                                rect.y * zoom / 100,
@@ -311,6 +396,24 @@ void c_ImageViewer::GetDisplayOffset(double &xofs, double &yofs)
     yofs = m_ScrWin.get_vadjustment()->get_value();
 }
 
+#if defined(USE_OPENGL)
+void c_ImageViewer::UpdateGLView()
+{
+    int x = 0, y = 0;
+    if (!m_GLView.get_realized() || !m_DrawArea.translate_coordinates(m_GLView, 0, 0, x, y))
+        return;
+
+    const double zoom = GetZoomPercentValIfEnabled() / 100.0;
+    m_GLView.SetView(x + m_FragmentX * zoom, y + m_FragmentY * zoom, zoom, GetInterpolationMethod());
+}
+#endif
+
+Cairo::Rectangle c_ImageViewer::GetVisibleArea()
+{
+    auto hadj = m_ScrWin.get_hadjustment(), vadj = m_ScrWin.get_vadjustment();
+    return Cairo::Rectangle { hadj->get_value(), vadj->get_value(), hadj->get_page_size(), vadj->get_page_size() };
+}
+
 void c_ImageViewer::SetZoom(double zoom, Utils::Const::InterpolationMethod interpMethod)
 {
     if (zoom < 0.01) zoom = 0.01;
@@ -29,12 +29,15 @@ File description:
 #include <gtkmm/image.h>
 #include <gtkmm/drawingarea.h>
 #include <gtkmm/layout.h>
+#include <gtkmm/overlay.h>
 #include <gtkmm/scale.h>
 #include <gtkmm/scrolledwindow.h>
 #include <gtkmm/togglebutton.h>
 #include <sigc++/sigc++.h>
 #include <skry/skry_cpp.hpp>
 
+#include "gl_image_view.h"
+#include "img_pyramid.h"
 #include "utils.h"
 
 
@@ -69,6 +72,15 @@ protected:
     Gtk::DrawingArea m_DrawArea;
     Cairo::RefPtr<Cairo::ImageSurface> m_Img;
 
+    /// Size of the full image; differs from 'm_Img' size if only a fragment is displayed
+    int m_FullWidth = 0, m_FullHeight = 0;
+    /// Position of 'm_Img' within the full image
+    int m_FragmentX = 0, m_FragmentY = 0;
+
+    /// Used for drawing large images zoomed (if not used, has no image set)
+    c_ImagePyramid m_Pyramid;
+    bool m_UsePyramid = false;
+
 private:
 
 
@@ -80,6 +92,15 @@ private:
 
     int m_PrevScrWinWidth, m_PrevScrWinHeight;
 
+#if defined(USE_OPENGL)
+    /// Draws the image beneath 'm_ScrWin' (which becomes transparent); overlays are still drawn by 'm_DrawArea'
+    c_GLImageView m_GLView;
+    Gtk::Overlay m_GLOverlay;
+
+    /// Passes the current image position, zoom and interpolation to 'm_GLView'
+    void UpdateGLView();
+#endif
+
     /// If false, zoom controls do not change image scale
     bool m_ApplyZoom;
 
@@ -90,6 +111,7 @@ private:
     ImageAreaBtnPressSignal_t m_ImageAreaBtnPressSignal;
     ZoomChangedSignal_t       m_ZoomChangedSignal;
     sigc::signal<void>        m_ImageSetSignal;
+    sigc::signal<void>        m_VisibleAreaChangedSignal;
     //------------------------------
 
     int GetZoomPercentValIfEnabled() const;
@@ -110,12 +132,20 @@ public:
         later accessed (and modified) via GetImage(). */
     void SetImage(const Cairo::RefPtr<Cairo::ImageSurface> &img, bool refresh = true);
 
+    /// Displays 'img' as a fragment (at 'xOffset', 'yOffset') of a larger image of size 'fullWidth' x 'fullHeight'
+    /** The rest of the image area is left blank. Zooming (if enabled) applies to the full image. */
+    void SetImageFragment(const Cairo::RefPtr<Cairo::ImageSurface> &img, int fullWidth, int fullHeight,
+                          int xOffset, int yOffset, bool refresh = true);
+
     void RemoveImage() { SetImage(Cairo::RefPtr<Cairo::ImageSurface>(nullptr)); }
 
+    /// Returns the area currently shown on screen (after zooming); may extend beyond the image
+    Cairo::Rectangle GetVisibleArea();
+
     /// Changes to the returned surface will be visible after refresh
     Cairo::RefPtr<Cairo::ImageSurface> GetImage();
 
-    /// Refresh on screen the whole image
+    /// Refresh on screen the whole image (also needed after modifying the image returned by GetImage())
     void Refresh();
 
     /// Refresh on screen the specified rectangle in the image
@@ -167,6 +197,12 @@ public:
         return m_ImageSetSignal;
     }
 
+    /// Emitted after scrolling or resizing
+    sigc::signal<void> signal_VisibleAreaChanged()
+    {
+        return m_VisibleAreaChangedSignal;
+    }
+
     Utils::Const::InterpolationMethod GetInterpolationMethod() const
     {
         return (Utils::Const::InterpolationMethod)m_InterpolationMethod.get_active_row_number();
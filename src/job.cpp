@@ -0,0 +1,444 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Job-related operations implementation.
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+#include <glibmm/ustring.h>
+
+#include "analysis_cache.h"
+#include "image_writer.h"
+#include "job.h"
+#include "partial_stack.h"
+#include "utils.h"
+#include "version.h"
+
+
+namespace Job
+{
+
+void SetDefaultSettings(Job_t &job)
+{
+    assert(job.imgSeq);
+
+    job.frameCacheId = FrameCache::CreateSeqId();
+    job.outputSaveMode = Utils::Const::Defaults::saveMode;
+    job.outputFmt = Utils::Const::Defaults::outputFmt;
+    job.alignmentMethod = Utils::Const::Defaults::alignmentMethod;
+    job.refPtAutoPlacementParams.spacing = Utils::Const::Defaults::referencePointSpacing;
+    job.refPtAutoPlacementParams.brightnessThreshold = Utils::Const::Defaults::placementBrightnessThreshold;
+    job.refPtAutoPlacementParams.structureScale = Utils::Const::Defaults::refPtStructureScale;
+    job.refPtAutoPlacementParams.structureThreshold = Utils::Const::Defaults::refPtStructureThreshold;
+    job.quality.criterion = Utils::Const::Defaults::qualityCriterion;
+    job.quality.threshold = Utils::Const::Defaults::qualityThreshold;
+    job.automaticRefPointsPlacement = true;
+    job.automaticAnchorPlacement = true;
+    job.roi = { 0, 0, 0, 0 };
+    job.precomputedAnchor.points.clear();
+    job.precomputedAnchor.imgIdx = 0;
+    job.precomputedAnchor.cfaPattern = SKRY_CFA_NONE;
+    job.precomputedAnchor.roi = { 0, 0, 0, 0 };
+    job.part.index = 0;
+    job.part.count = 1;
+    job.part.firstFrame = 0;
+    job.part.stackOrigin = { 0, 0 };
+    job.binning = 1;
+    job.cfaPattern = SKRY_CFA_NONE;
+    job.refPtBlockSize = Utils::Const::Defaults::refPtRefBlockSize;
+    job.refPtSearchRadius = Utils::Const::Defaults::refPtSearchRadius;
+    job.exportQualityData = false;
+    job.overlapQualityRead = false;
+    job.useAnalysisCache = false;
+    job.analysisOnly = false;
+    job.qualityDataReadyNotification = false;
+    job.cachedQualityDataNotification = false;
+}
+
+size_t GetFirstActiveImgIdx(const Job_t &job)
+{
+    const uint8_t *activeFlags = job.imgSeq.GetImgActiveFlags();
+    size_t idx = 0;
+    while (idx < job.imgSeq.GetImageCount() && !activeFlags[idx])
+        idx++;
+    return idx;
+}
+
+std::vector<struct SKRY_point> GetAnchors(const Job_t &job)
+{
+    if (!job.automaticAnchorPlacement)
+        return job.anchors;
+
+    const auto &precomputed = job.precomputedAnchor;
+    if (precomputed.imgIdx == GetFirstActiveImgIdx(job) &&
+        precomputed.cfaPattern == job.cfaPattern &&
+        precomputed.roi.x == job.roi.x && precomputed.roi.y == job.roi.y &&
+        precomputed.roi.width == job.roi.width && precomputed.roi.height == job.roi.height)
+    {
+        return precomputed.points;
+    }
+
+    return { };
+}
+
+bool SelectPart(Job_t &job, unsigned index, unsigned count)
+{
+    const uint8_t *activeFlags = job.imgSeq.GetImgActiveFlags();
+    std::vector<size_t> activeImages;
+    for (size_t i = 0; i < job.imgSeq.GetImageCount(); i++)
+        if (activeFlags[i])
+            activeImages.push_back(i);
+
+    if (count == 0 || index >= count)
+        return false;
+
+    const size_t first = index * activeImages.size() / count;
+    const size_t end = (index + 1) * activeImages.size() / count;
+    if (end - first < 2)
+        return false;
+
+    // Remembered for using the whole job's analysis
+    job.part.jobActiveFlags.assign(activeFlags, activeFlags + job.imgSeq.GetImageCount());
+    job.part.jobAnchors = GetAnchors(job);
+    job.part.firstFrame = first;
+
+    std::vector<uint8_t> newActiveFlags(job.imgSeq.GetImageCount(), 0);
+    for (size_t i = first; i < end; i++)
+        newActiveFlags[activeImages[i]] = 1;
+    job.imgSeq.SetActiveImages(newActiveFlags.data());
+
+    job.part.index = index;
+    job.part.count = count;
+    return true;
+}
+
+std::string GetPartSuffix(const Job_t &job)
+{
+    if (job.part.count <= 1)
+        return "";
+
+    return "_part" + (std::string)Glib::ustring::format(job.part.index + 1) + "of" + (std::string)Glib::ustring::format(job.part.count);
+}
+
+std::string GetDestDir(const Job_t &job)
+{
+    if (job.outputSaveMode == Utils::Const::OutputSaveMode::SOURCE_PATH)
+    {
+        return (job.imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES
+                ? job.sourcePath
+                : Glib::path_get_dirname(job.sourcePath));
+    }
+    else
+        return job.destDir;
+}
+
+/// Saves 'stackedImg' as 'destFName' + 'destExt' in 'destDir'; a numeric suffix is added to the name if the file exists
+static bool SaveStack(const libskry::c_Image &stackedImg, const ImageWriter::OutputFormat_t &outputFmt,
+                      const std::string &destDir, const std::string &destFName, const std::string &destExt)
+{
+    unsigned replaceCounter = 0;
+    while (Glib::file_test(Glib::build_filename(destDir, destFName +
+                            (replaceCounter ? (std::string)Glib::ustring::format(replaceCounter) + destExt : destExt)),
+                           Glib::FileTest::FILE_TEST_EXISTS))
+    {
+        replaceCounter++;
+    }
+
+    std::string destPath = Glib::build_filename(destDir, destFName +
+                            (replaceCounter ? (std::string)Glib::ustring::format(replaceCounter) + destExt : destExt));
+    if (SKRY_SUCCESS != ImageWriter::Save(stackedImg, destPath, outputFmt))
+    {
+        std::cout << "Could not save stack as " << destPath << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/// Saves 'stack' as partial stack 'destFName' in 'destDir' (overwriting an existing file)
+static bool SavePartialStack(const libskry::c_Image &stack, const PartialStack::Info_t &info,
+                             const std::string &destDir, const std::string &destFName)
+{
+    std::string destPath = Glib::build_filename(destDir, destFName);
+    if (!PartialStack::Save(destPath, stack, info))
+    {
+        std::cout << "Could not save partial stack as " << destPath << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static std::string GetThresholdSuffix(unsigned threshold)
+{
+    return "_q" + (std::string)Glib::ustring::format(threshold);
+}
+
+static size_t GetImageSize(const libskry::c_Image &img)
+{
+    return (size_t)img.GetWidth() * img.GetHeight() * NUM_CHANNELS[img.GetPixelFormat()] * BITS_PER_CHANNEL[img.GetPixelFormat()] / 8;
+}
+
+Output_t PrepareStackSaving(const Job_t &job)
+{
+    struct Stack_t
+    {
+        std::shared_ptr<const libskry::c_Image> img;
+        std::string fileName; ///< Without extension
+        size_t numFrames; ///< Number of stacked frames; used for a partial stack
+    };
+    std::vector<Stack_t> stacks;
+
+    std::shared_ptr<const libskry::c_Image> stackedImg = job.stackedImg.Get();
+    assert(stackedImg && *stackedImg);
+
+    const bool multipleStacks = !job.quality.additionalThresholds.empty();
+
+    const std::string baseName = (job.imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES
+                                    ? "stack"
+                                    : Glib::path_get_basename(job.sourcePath) + "_stacked");
+
+    // Quick look stacks are smaller than the regular ones, so make them easy to tell apart
+    const std::string binningSuffix = (job.binning > 1 ? "_bin" + (std::string)Glib::ustring::format(job.binning) : "");
+    const std::string partSuffix = GetPartSuffix(job);
+
+    // Element [0] is for the main threshold, the others are in the order of 'job.quality.additionalThresholds' (see c_Worker)
+    auto getNumStackedFrames = [&job](size_t stackIdx)
+        {
+            return (stackIdx < job.part.numStackedFrames.size() ? job.part.numStackedFrames[stackIdx] : 0);
+        };
+
+    stacks.push_back({ stackedImg, baseName + binningSuffix + partSuffix +
+                                   (multipleStacks ? GetThresholdSuffix(job.quality.threshold) : ""),
+                       getNumStackedFrames(0) });
+
+    if (auto additionalStacks = job.additionalStacks.Get())
+        for (const ThresholdStack_t &stack: *additionalStacks)
+            stacks.push_back({ stack.img, baseName + binningSuffix + partSuffix + GetThresholdSuffix(stack.threshold),
+                               getNumStackedFrames(stacks.size()) });
+
+    const std::string destDir = GetDestDir(job);
+    const bool isPart = (job.part.count > 1);
+    const std::string destExt = (isPart ? PartialStack::FILE_SUFFIX : Utils::GetOutputFormatDescr(job.outputFmt).defaultExtension);
+    const ImageWriter::OutputFormat_t outputFmt = job.outputFmt;
+
+    // Partial stacks can be merged only with the other parts of the same analysis
+    PartialStack::Info_t partInfo;
+    if (isPart)
+    {
+        partInfo.analysisKey = AnalysisCache::GetKey(job);
+        partInfo.partIndex = job.part.index;
+        partInfo.partCount = job.part.count;
+        partInfo.origin = job.part.stackOrigin;
+    }
+
+    Output_t output;
+    output.numBytes = 0;
+    for (const Stack_t &stack: stacks)
+        output.numBytes += GetImageSize(*stack.img); // ImageWriter converts only a few rows at a time
+
+    output.write = [stacks, destDir, destExt, outputFmt, isPart, partInfo]() -> bool
+        {
+            bool success = true;
+            for (const Stack_t &stack: stacks)
+            {
+                PartialStack::Info_t info = partInfo;
+                info.numFrames = stack.numFrames;
+                success = (isPart ? SavePartialStack(*stack.img, info, destDir, stack.fileName + destExt)
+                                  : SaveStack(*stack.img, outputFmt, destDir, stack.fileName, destExt)) && success;
+            }
+            return success;
+        };
+
+    return output;
+}
+
+bool AutoSaveStack(const Job_t &job)
+{
+    return PrepareStackSaving(job).write();
+}
+
+Output_t PrepareQualityDataExport(const std::string &fileName, const Job_t &job, bool exportInactive)
+{
+    std::shared_ptr<const QualityData_t> quality = job.quality.data.Get();
+    assert(quality && !quality->framesChrono.empty());
+
+    const uint8_t *activeFlags = job.imgSeq.GetImgActiveFlags();
+    const std::vector<uint8_t> imgIsActive(activeFlags, activeFlags + job.imgSeq.GetImageCount());
+    const std::string sourcePath = job.sourcePath;
+
+    Output_t output;
+    output.numBytes = imgIsActive.size();
+
+    output.write = [fileName, quality, imgIsActive, sourcePath, exportInactive]() -> bool
+        {
+            std::ofstream file(fileName.c_str());
+            if (file.fail())
+                return false;
+
+            file << "Stackistry " << VERSION_MAJOR << "." << VERSION_MINOR << "." << VERSION_SUBMINOR << "\n"
+                 << "Normalized frame quality of \"" << sourcePath << "\"\n\n"
+                 << "Frame;Active frame;Quality\n";
+
+            auto minmaxQuality = std::minmax_element(quality->framesChrono.begin(),
+                                                     quality->framesChrono.end());
+
+            double range = *minmaxQuality.second - *minmaxQuality.first;
+
+            size_t activeImgIdx = 0;
+            for (size_t i = 0; i < imgIsActive.size(); i++)
+            {
+                if (imgIsActive[i] || exportInactive)
+                {
+                    file << i << ";";
+
+                    if (imgIsActive[i])
+                    {
+                        file << activeImgIdx << ";" << (quality->framesChrono[activeImgIdx] - *minmaxQuality.first) / range << "\n";
+                        activeImgIdx++;
+                    }
+                    else if (exportInactive)
+                        file << "-1;0\n";
+                }
+            }
+
+            return !file.fail();
+        };
+
+    return output;
+}
+
+bool ExportQualityData(const std::string &fileName, const Job_t &job, bool exportInactive)
+{
+    return PrepareQualityDataExport(fileName, job, exportInactive).write();
+}
+
+/// Returns the path of an output file in the job's destination directory
+static std::string GetOutputFilePath(const Job_t &job, const std::string &fileName)
+{
+    std::string destFName = fileName;
+
+    // For video files, prepend with the source file name
+    if (job.imgSeq.GetType() != SKRY_IMG_SEQ_IMAGE_FILES)
+        destFName = Glib::path_get_basename(job.sourcePath) + "_" + destFName;
+
+    return Glib::build_filename(GetDestDir(job), destFName);
+}
+
+std::string GetQualityDataPath(const Job_t &job)
+{
+    return GetOutputFilePath(job, "frame_quality.txt");
+}
+
+std::string GetProfilePath(const Job_t &job)
+{
+    return GetOutputFilePath(job, "processing_profile.json");
+}
+
+Output_t PrepareProfileExport(const std::string &fileName, const Job_t &job)
+{
+    std::shared_ptr<const RunProfile_t> profile = job.profile.Get();
+    std::ostringstream contents;
+    if (profile)
+        WriteProfile(contents, job, *profile);
+
+    const std::string text = contents.str();
+
+    Output_t output;
+    output.numBytes = text.size();
+    output.write = [fileName, profile, text]() -> bool
+        {
+            if (!profile)
+                return false;
+
+            std::ofstream file(fileName.c_str());
+            file << text;
+            return !file.fail();
+        };
+
+    return output;
+}
+
+bool ExportProfile(const std::string &fileName, const Job_t &job)
+{
+    return PrepareProfileExport(fileName, job).write();
+}
+
+void WriteProfile(std::ostream &out, const Job_t &job, const RunProfile_t &profile)
+{
+    out << "{\n"
+         << "  \"stackistryVersion\": \"" << VERSION_MAJOR << "." << VERSION_MINOR << "." << VERSION_SUBMINOR << "\",\n"
+         << "  \"libskryVersion\": \"" << LIBSKRY_MAJOR_VERSION << "." << LIBSKRY_MINOR_VERSION << "." << LIBSKRY_SUBMINOR_VERSION << "\",\n"
+         << "  \"source\": " << Utils::JsonString(job.sourcePath) << ",\n"
+         << "  \"numActiveImages\": " << job.imgSeq.GetActiveImageCount() << ",\n"
+         << "  \"numThreads\": " << profile.numThreads << ",\n"
+         << "  \"totalTimeSec\": " << profile.totalTimeSec << ",\n"
+         << "  \"waitingForUserSec\": " << profile.waitingForUserSec << ",\n"
+         << "  \"peakMemoryBytes\": " << profile.peakMemoryBytes << ",\n"
+         << "  \"phases\": [";
+
+    for (size_t i = 0; i < profile.phases.size(); i++)
+    {
+        const RunProfile_t::Phase_t &phase = profile.phases[i];
+        out << (i > 0 ? "," : "") << "\n"
+             << "    {\n"
+             << "      \"name\": " << Utils::JsonString(phase.name) << ",\n"
+             << "      \"wallTimeSec\": " << phase.wallTimeSec << ",\n"
+             << "      \"numSteps\": " << phase.numSteps << ",\n"
+             << "      \"framesPerSec\": " << phase.framesPerSec << ",\n"
+             << "      \"stepTimeSec\": " << phase.stepTimeSec << ",\n"
+             << "      \"readStallTimeSec\": " << phase.readStallTimeSec << ",\n"
+             << "      \"numBytesRead\": " << phase.numBytesRead << ",\n"
+             << "      \"visualizationTimeSec\": " << phase.visualizationTimeSec << ",\n"
+             << "      \"notificationTimeSec\": " << phase.notificationTimeSec << "\n"
+             << "    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::string FormatProfile(const RunProfile_t &profile)
+{
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(2);
+    for (const RunProfile_t::Phase_t &phase: profile.phases)
+    {
+        result << phase.name << ": " << phase.wallTimeSec << " s, " << phase.numSteps << " steps, "
+               << std::setprecision(1) << phase.framesPerSec << " frames/s" << std::setprecision(2)
+               << " (steps " << phase.stepTimeSec << " s, of which read stalls " << phase.readStallTimeSec << " s; "
+               << "visualization " << phase.visualizationTimeSec << " s; "
+               << "notifications " << phase.notificationTimeSec << " s; "
+               << phase.numBytesRead / (1024*1024) << " MiB read)\n";
+    }
+    result << "Total: " << profile.totalTimeSec << " s (waiting for user: " << profile.waitingForUserSec << " s), "
+           << profile.numThreads << " thread(s), peak memory " << profile.peakMemoryBytes / (1024*1024) << " MiB";
+
+    return result.str();
+}
+
+} // namespace Job
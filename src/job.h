@@ -24,22 +24,87 @@ File description:
 #define STACKISTRY_JOB_STRUCT_HEADER
 
 
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <skry/skry_cpp.hpp>
 
+#include "frame_cache.h"
+#include "utils.h"
+
+
+class c_LiveCapture;
+
+struct QualityData_t
+{
+    /// Frame quality in chronological order (of the active frames)
+    std::vector<SKRY_quality_t> framesChrono;
+
+    /// Frame quality, sorted descending
+    std::vector<SKRY_quality_t> framesSorted;
+};
+
+/// Stack produced for one of the additional quality thresholds
+struct ThresholdStack_t
+{
+    unsigned threshold;
+    std::shared_ptr<const libskry::c_Image> img;
+};
+
+/// Performance measurements of a job's processing run
+struct RunProfile_t
+{
+    struct Phase_t
+    {
+        std::string name;      ///< Not localized
+        double wallTimeSec;
+        size_t numSteps;
+        double framesPerSec;
+
+        /// Time spent in the processing steps
+        /** Decoding of frames and computation both happen inside libskry's Step(),
+            so they cannot be measured separately; 'readStallTimeSec' is the part
+            of it spent waiting for frames which had not been read ahead. */
+        double stepTimeSec;
+        double readStallTimeSec;
+        uint64_t numBytesRead; ///< Read ahead during the phase (0 if reading ahead is disabled)
+
+        double visualizationTimeSec; ///< Spent by the worker thread on capturing visualization data
+        double notificationTimeSec;  ///< Spent by the worker thread on notifying the main thread
+    };
+
+    std::vector<Phase_t> phases; ///< In order of execution
+    double totalTimeSec;
+    double waitingForUserSec;    ///< Time spent waiting for the user to place reference points
+    uint64_t peakMemoryBytes;    ///< Peak memory usage of the whole process (0 if unknown)
+    unsigned numThreads;         ///< Number of threads assigned at the end of processing
+};
 
 struct Job_t
 {
     libskry::c_ImageSequence imgSeq; // has to be the first field
 
-    enum SKRY_output_format outputFmt;
+    /// Identifies 'imgSeq' in the frame cache; assigned by Job::SetDefaultSettings()
+    FrameCache::SeqId_t frameCacheId;
+
+    ImageWriter::OutputFormat_t outputFmt;
     Utils::Const::OutputSaveMode outputSaveMode;
 
-    /// If worker is running, access must be synchronized using Worker::GetAccessGuard()
-    libskry::c_Image stackedImg;
+    // Processing results are published by the worker thread (and can be read at any time)
+
+    Utils::Types::c_Published<libskry::c_Image> stackedImg; ///< Stack for 'quality.threshold'
 
-    /** Composite of best fragments of all images in 'imgSeq'.
-        If worker is running, access must be synchronized using Worker::GetAccessGuard(). */
-    libskry::c_Image bestFragmentsImg;
+    /// Stacks for 'quality.additionalThresholds' (in the same order), as they become available
+    Utils::Types::c_Published<std::vector<ThresholdStack_t>> additionalStacks;
+
+    /// Composite of best fragments of all images in 'imgSeq'
+    Utils::Types::c_Published<libskry::c_Image> bestFragmentsImg;
+
+    /// Updated after every completed processing phase
+    Utils::Types::c_Published<RunProfile_t> profile;
 
     enum SKRY_img_alignment_method alignmentMethod;
 
@@ -48,19 +113,41 @@ struct Job_t
         enum SKRY_quality_criterion criterion;
         unsigned threshold; ///< Interpreted according to 'criterion'
 
-        /// Frame quality in chronological order
-        std::vector<SKRY_quality_t> framesChrono;
+        /// Each one produces an additional stack; image alignment and quality estimation are shared
+        std::vector<unsigned> additionalThresholds;
 
-        /// Frame quality, sorted descending
-        std::vector<SKRY_quality_t> framesSorted;
+        Utils::Types::c_Published<QualityData_t> data;
+
+        /// Quality of the frames estimated so far; published during quality estimation and reset afterwards
+        Utils::Types::c_Published<QualityData_t> partialData;
     } quality;
 
     std::string sourcePath; ///< For image series: directory only; for videos: full path to the video file
+    std::vector<std::string> imageFileNames; ///< For image series only: full paths of all images
     std::string destDir; ///< Effective if outputSaveMode==OutputSaveMode::SPECIFIED_PATH
 
+    /// Part of the images to be processed (in the images' coordinates); if 'width' is 0, whole images are processed
+    /** Reference points (unlike anchors) are relative to this region. */
+    struct SKRY_rect roi;
+
+    /// Quick look mode: if greater than 1, every 'binning' x 'binning' pixels of the frames are averaged before processing
+    /** All coordinates and sizes in the job's settings still refer to the full-resolution images;
+        they are scaled by the worker. */
+    unsigned binning;
+
     bool automaticAnchorPlacement;
     std::vector<struct SKRY_point> anchors; ///< Used when automaticAnchorPlacement==false
 
+    /// Anchor placed automatically in advance (by c_JobLoader), together with the job's state it depends on
+    /** Used when automaticAnchorPlacement==true, as long as the state has not changed (see Job::GetAnchors()). */
+    struct
+    {
+        std::vector<struct SKRY_point> points; ///< Empty if not placed
+        size_t imgIdx; ///< Absolute index of the (first active) image the anchor was placed on
+        enum SKRY_CFA_pattern cfaPattern;
+        struct SKRY_rect roi;
+    } precomputedAnchor;
+
     bool automaticRefPointsPlacement;
     std::vector<struct SKRY_point> refPoints; ///< Used when automaticRefPointsPlacement==false
 
@@ -88,14 +175,128 @@ struct Job_t
 
     std::string flatFieldFileName; /// If empty, no flat-fielding will be performed
 
+    /// If not empty, the job creates a flat-field from 'imgSeq' and saves it as this file (in 'outputFmt') instead of stacking
+    std::string flatFieldOutputFileName;
+
     /// If not SKRY_CFA_NONE, mono images will be treated as raw color with this filter pattern
     enum SKRY_CFA_pattern cfaPattern;
 
     /// If 'true', frame quality data will be saved to a file in the same location as the stack
     bool exportQualityData;
 
+    /** If 'true', the input data of the first frames is read ahead for quality estimation
+        already during the final steps of image alignment. */
+    bool overlapQualityRead;
+
+    /// If 'true', the analysis results are stored in (and reused from) a file next to the input (see AnalysisCache)
+    bool useAnalysisCache;
+
+    /// If 'true', processing ends after quality estimation and the results are stored in the analysis cache
+    /** Prepares a distributed job, whose parts use this analysis of all its frames (see Job::SelectPart()). */
+    bool analysisOnly;
+
     /// 'True' if quality data has been calculated by the worker thread
-    bool qualityDataReadyNotification;
+    Utils::Types::c_CopyableAtomic<bool> qualityDataReadyNotification;
+
+    /// 'True' if quality data has been loaded from the analysis cache by the worker thread
+    /** Unlike 'qualityDataReadyNotification', the data is only to be shown (it is exported once calculated). */
+    Utils::Types::c_CopyableAtomic<bool> cachedQualityDataNotification;
+
+    /// 'True' if new partial quality data has been published by the worker thread
+    Utils::Types::c_CopyableAtomic<bool> partialQualityDataNotification;
+
+    /// Distributed stacking: if 'count' is greater than 1, only one of 'count' disjoint ranges of the active frames is processed
+    /** The result is saved as a partial stack, to be merged with the other parts (see Job::SelectPart(), PartialStack). */
+    struct
+    {
+        unsigned index; ///< Counted from 0
+        unsigned count;
+
+        // The whole job, as before selecting the part; its analysis (see 'analysisOnly') is shared by all parts
+
+        std::vector<uint8_t> jobActiveFlags; ///< Element count = number of images in 'imgSeq'
+        std::vector<struct SKRY_point> jobAnchors; ///< See Job::GetAnchors()
+        size_t firstFrame; ///< Index of the part's first frame within the job's active frames
+
+        // Set by the worker thread
+
+        /// Position of the stack in the job's first active frame (in the coordinates of the processed frames)
+        struct SKRY_point stackOrigin;
+        /// Number of frames stacked for 'quality.threshold' and each of 'quality.additionalThresholds'
+        std::vector<size_t> numStackedFrames;
+    } part;
+
+    /// Set for live stacking jobs only; then 'imgSeq' contains the current batch of new frames
+    std::shared_ptr<c_LiveCapture> live;
 };
 
-#endif // STACKISTRY_JOB_STRUCT_HEADER
+/// Job-related operations shared by the GUI and the command-line front end
+namespace Job
+{
+    /// Output file(s) of a job, prepared for writing from any thread
+    /** Contains copies of all the job's data needed, so it is not affected by later changes of the job. */
+    struct Output_t
+    {
+        std::function<bool()> write; ///< Writes the file(s); returns 'false' on failure
+        size_t numBytes; ///< Approximate amount of memory held until written
+    };
+
+    void SetDefaultSettings(Job_t &job);
+
+    /// Restricts the job to the 'index'-th (counted from 0) of 'count' equal ranges of its active frames
+    /** Has to be called after all other settings are applied. The part requires the analysis of the whole job
+        to be in the analysis cache (see Job_t::analysisOnly): it starts image alignment from the same anchors and
+        stacks as many of its frames as fall within the whole job's quality threshold, so that the partial stacks
+        share the coordinates and can be merged by weighted summation (see PartialStack::Merge()).
+        Returns 'false' if 'index' is invalid or the range would contain fewer than 2 frames. */
+    bool SelectPart(Job_t &job, unsigned index, unsigned count);
+
+    /// Returns the part of file names identifying the job's part (empty if the job is not distributed)
+    std::string GetPartSuffix(const Job_t &job);
+
+    /// Returns the anchors to be used by image alignment; empty if they are to be placed automatically by libskry
+    /** In automatic mode, the precomputed anchor is returned if it is still valid, i.e. if the first active image,
+        the raw color filter pattern and the region of interest have not changed since placing it. */
+    std::vector<struct SKRY_point> GetAnchors(const Job_t &job);
+
+    /// Returns the absolute index of the job's first active image (the number of images if there are none)
+    size_t GetFirstActiveImgIdx(const Job_t &job);
+
+    /// Returns the directory where the job's output files are to be saved
+    std::string GetDestDir(const Job_t &job);
+
+    /// Saves the stacked image(s) in the job's destination directory; returns 'false' on failure
+    /** An existing file is not overwritten; a numeric suffix is added to the file name instead.
+        If there are additional quality thresholds, the file names include the threshold;
+        in quick look mode, they include the binning factor. A part of a distributed job
+        is saved (overwriting the previous one) as a partial stack, with the part in the file name. */
+    bool AutoSaveStack(const Job_t &job);
+
+    /// Prepares AutoSaveStack() to be performed later
+    Output_t PrepareStackSaving(const Job_t &job);
+
+    /// Returns 'false' on failure
+    /** Inactive frames are also listed if 'exportInactive' is true. */
+    bool ExportQualityData(const std::string &fileName, const Job_t &job, bool exportInactive);
+
+    /// Prepares ExportQualityData() to be performed later
+    Output_t PrepareQualityDataExport(const std::string &fileName, const Job_t &job, bool exportInactive);
+
+    /// Returns the default path of the frame quality file (in the job's destination directory)
+    std::string GetQualityDataPath(const Job_t &job);
+
+    /// Saves the job's processing profile as JSON; returns 'false' on failure
+    bool ExportProfile(const std::string &fileName, const Job_t &job);
+
+    /// Prepares ExportProfile() to be performed later
+    Output_t PrepareProfileExport(const std::string &fileName, const Job_t &job);
+
+    /// Writes 'profile' of 'job' as a JSON object
+    void WriteProfile(std::ostream &out, const Job_t &job, const RunProfile_t &profile);
+
+    /// Returns the default path of the processing profile file (next to the frame quality file)
+    std::string GetProfilePath(const Job_t &job);
+
+    /// Returns a human-readable summary of 'profile' (one phase per line)
+    std::string FormatProfile(const RunProfile_t &profile);
+}
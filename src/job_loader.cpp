@@ -0,0 +1,167 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Background job loader implementation.
+*/
+
+#include <algorithm>
+#include <utility>
+
+#include <glibmm/i18n.h>
+#include <glibmm/ustring.h>
+
+#include "job_loader.h"
+#include "utils.h"
+
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(m_Mtx)
+
+/// Opens the input of 'request' and prepares the job; executed by a loader thread
+static c_JobLoader::Result_t Load(const c_JobLoader::Request_t &request, uint64_t seqNum)
+{
+    c_JobLoader::Result_t res = { request, seqNum, nullptr, "", 0, 0, 0, 0 };
+    enum SKRY_result result = SKRY_SUCCESS;
+
+    if (request.type == c_JobLoader::InputType::VIDEO)
+    {
+        res.job = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitVideoFile(request.path.c_str(), &result) });
+        res.job->sourcePath = request.path;
+    }
+    else
+    {
+        std::vector<std::string> fileNames = (request.type == c_JobLoader::InputType::IMAGE_FOLDER
+                                              ? Utils::ListImageFiles(request.path) : request.imageFileNames);
+        if (fileNames.size() <= 1)
+        {
+            res.errorMsg = _("at least two image files (BMP, TIFF) are required.");
+            return res;
+        }
+
+        res.job = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitImageList(fileNames) });
+        res.job->sourcePath = request.path;
+        res.job->imageFileNames = fileNames;
+    }
+
+    Job_t &job = *res.job;
+    if (!job.imgSeq)
+    {
+        res.errorMsg = (result != SKRY_SUCCESS ? Utils::GetErrorMsg(result) : _("Failed to initialize image sequence."));
+        res.job = nullptr;
+        return res;
+    }
+    Job::SetDefaultSettings(job);
+
+    // Decoding the first frame also validates the input
+    const size_t firstImgIdx = Job::GetFirstActiveImgIdx(job);
+    libskry::c_Image firstImg = job.imgSeq.GetImageByIdx(firstImgIdx, &result);
+    if (!firstImg)
+    {
+        res.errorMsg = Glib::ustring::compose(_("Error loading the first image:\n%1"), Utils::GetErrorMsg(result));
+        job.imgSeq.Deactivate();
+        res.job = nullptr;
+        return res;
+    }
+
+    // Used by image alignment instead of placing it automatically (which would decode the first frame again),
+    // unless the first active frame, the CFA pattern or the ROI is changed meanwhile (see Job::GetAnchors())
+    job.precomputedAnchor.points = { libskry::c_ImageAlignment::SuggestAnchorPos(
+        firstImg, Utils::Const::Defaults::placementBrightnessThreshold, Utils::Const::imgAlignmentRefBlockSize) };
+    job.precomputedAnchor.imgIdx = firstImgIdx;
+    job.precomputedAnchor.cfaPattern = job.cfaPattern;
+    job.precomputedAnchor.roi = job.roi;
+
+    const enum SKRY_pixel_format pixFmt = firstImg.GetPixelFormat();
+    res.width = firstImg.GetWidth();
+    res.height = firstImg.GetHeight();
+    res.numFrames = job.imgSeq.GetImageCount();
+    res.footprintBytes = (uint64_t)res.width * res.height * NUM_CHANNELS[pixFmt] * BITS_PER_CHANNEL[pixFmt] / 8 * res.numFrames;
+
+    // Do not keep hundreds of inputs open
+    job.imgSeq.Deactivate();
+
+    return res;
+}
+
+c_JobLoader::c_JobLoader(unsigned maxThreads, const sigc::slot<void> &loadedNotification)
+: m_MaxThreads(std::max(1U, maxThreads)), m_LoadedNotification(loadedNotification)
+{ }
+
+c_JobLoader::~c_JobLoader()
+{
+    { LOCK();
+        m_Finish = true;
+        m_Queue.clear();
+        m_Cond.broadcast();
+    }
+    for (Glib::Threads::Thread *thread: m_Threads)
+        thread->join();
+}
+
+void c_JobLoader::Submit(const Request_t &request)
+{
+    LOCK();
+    m_Queue.push_back(std::make_pair(m_NextSeqNum++, request));
+
+    // Threads are started when needed
+    if (m_Threads.size() < m_MaxThreads)
+        m_Threads.push_back(Glib::Threads::Thread::create(sigc::mem_fun(*this, &c_JobLoader::ThreadFunc)));
+    else
+        m_Cond.signal();
+}
+
+std::vector<c_JobLoader::Result_t> c_JobLoader::GetResults()
+{
+    LOCK();
+    std::vector<Result_t> results;
+    results.swap(m_Results);
+    m_NumReturned += results.size();
+    return results;
+}
+
+size_t c_JobLoader::GetNumPending()
+{
+    LOCK();
+    return (m_NextSeqNum - 1) - m_NumReturned;
+}
+
+void c_JobLoader::ThreadFunc()
+{
+    while (true)
+    {
+        std::pair<uint64_t, Request_t> request;
+        { LOCK();
+            while (m_Queue.empty() && !m_Finish)
+                m_Cond.wait(m_Mtx);
+
+            if (m_Finish)
+                return;
+
+            request = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        Result_t result = Load(request.second, request.first);
+
+        { LOCK();
+            m_Results.push_back(std::move(result));
+        }
+        m_LoadedNotification();
+    }
+}
@@ -0,0 +1,106 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Background job loader header.
+*/
+
+#ifndef STACKISTRY_JOB_LOADER_HEADER
+#define STACKISTRY_JOB_LOADER_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glibmm/threads.h>
+#include <sigc++/sigc++.h>
+
+#include "job.h"
+
+
+/// Opens the inputs of new jobs using a pool of background threads
+/** Besides opening the video or image series, every input's first frame is decoded
+    and the video stabilization anchor is placed, so that the job can be started without delay. */
+class c_JobLoader
+{
+public:
+    enum class InputType
+    {
+        VIDEO,        ///< 'path' is a video file
+        IMAGE_FILES,  ///< 'imageFileNames' is the image series; 'path' is its directory
+        IMAGE_FOLDER  ///< 'path' is a directory; all its images form the image series
+    };
+
+    struct Request_t
+    {
+        InputType type;
+        std::string path;
+        std::vector<std::string> imageFileNames;
+    };
+
+    struct Result_t
+    {
+        Request_t request;
+        uint64_t seqNum; ///< Order of submission (counted from 1)
+        std::shared_ptr<Job_t> job; ///< Null on failure
+        std::string errorMsg; ///< Set on failure
+        unsigned width, height;  ///< Of the first frame
+        size_t numFrames;
+        uint64_t footprintBytes; ///< Estimated size of all decoded frames
+    };
+
+    /// 'loadedNotification' is called from the loader threads after every loaded (or failed) input
+    c_JobLoader(unsigned maxThreads, const sigc::slot<void> &loadedNotification);
+
+    /// Discards the requests not being loaded; waits for the others
+    ~c_JobLoader();
+
+    c_JobLoader(const c_JobLoader &) = delete;
+    c_JobLoader &operator =(const c_JobLoader &) = delete;
+
+    void Submit(const Request_t &request);
+
+    /// Returns the results available since the previous call, in the order of completion
+    /** Each result is available as soon as its input is loaded; use 'seqNum' to restore the order of submission. */
+    std::vector<Result_t> GetResults();
+
+    /// Returns the number of submitted requests whose results have not been returned yet
+    size_t GetNumPending();
+
+private:
+    unsigned m_MaxThreads;
+    sigc::slot<void> m_LoadedNotification;
+
+    std::vector<Glib::Threads::Thread *> m_Threads;
+    Glib::Threads::Mutex m_Mtx; ///< Guards all the variables below
+    Glib::Threads::Cond m_Cond;  ///< Signaled by Submit() and the destructor
+    bool m_Finish = false;
+    /// Requests not being loaded yet, with their sequence numbers
+    std::deque<std::pair<uint64_t, Request_t>> m_Queue;
+    uint64_t m_NextSeqNum = 1; ///< Assigned to the next submitted request
+    size_t m_NumReturned = 0; ///< Number of results returned by GetResults()
+    std::vector<Result_t> m_Results; ///< Not returned yet, in the order of completion
+
+    void ThreadFunc();
+};
+
+#endif // STACKISTRY_JOB_LOADER_HEADER
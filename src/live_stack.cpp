@@ -0,0 +1,352 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Live stacking implementation.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+
+#include <glib/gstdio.h>
+#include <glibmm/fileutils.h>
+
+#include "live_stack.h"
+#include "ser_writer.h"
+#include "utils.h"
+
+
+/// Returns the centroid of brightness of a MONO32F or RGB32F image
+static void GetCentroid(const libskry::c_Image &img, unsigned numChannels, double &x, double &y)
+{
+    double sum = 0, sumX = 0, sumY = 0;
+    for (unsigned row = 0; row < img.GetHeight(); row++)
+    {
+        const float *line = static_cast<const float *>(img.GetLine(row));
+        for (unsigned col = 0; col < img.GetWidth(); col++)
+        {
+            double value = 0;
+            for (unsigned ch = 0; ch < numChannels; ch++)
+                value += line[col * numChannels + ch];
+
+            sum += value;
+            sumX += value * col;
+            sumY += value * row;
+        }
+    }
+
+    x = (sum > 0 ? sumX / sum : 0.5 * img.GetWidth());
+    y = (sum > 0 ? sumY / sum : 0.5 * img.GetHeight());
+}
+
+/// Returns the brightness (sum of channels) of a MONO32F or RGB32F image
+static std::vector<float> GetBrightness(const libskry::c_Image &img, unsigned numChannels)
+{
+    std::vector<float> result((size_t)img.GetWidth() * img.GetHeight(), 0);
+    for (unsigned row = 0; row < img.GetHeight(); row++)
+    {
+        const float *line = static_cast<const float *>(img.GetLine(row));
+        for (unsigned col = 0; col < img.GetWidth(); col++)
+            for (unsigned ch = 0; ch < numChannels; ch++)
+                result[col + (size_t)row * img.GetWidth()] += line[col * numChannels + ch];
+    }
+    return result;
+}
+
+/// Returns the sum of squared differences between the reference block centered at 'anchor' and the block of 'img' at 'anchor' - (dx, dy)
+/** Returns a negative value if the latter block does not fit in 'img'. */
+static double GetBlockDifference(const std::vector<float> &ref, unsigned refWidth, struct SKRY_point anchor,
+                                 const std::vector<float> &img, unsigned imgWidth, unsigned imgHeight,
+                                 int dx, int dy)
+{
+    const int halfBlock = (int)Utils::Const::imgAlignmentRefBlockSize / 2;
+    const int x0 = anchor.x - dx - halfBlock;
+    const int y0 = anchor.y - dy - halfBlock;
+    if (x0 < 0 || y0 < 0 || x0 + 2*halfBlock > (int)imgWidth || y0 + 2*halfBlock > (int)imgHeight)
+        return -1;
+
+    double sum = 0;
+    for (int y = 0; y < 2*halfBlock; y++)
+        for (int x = 0; x < 2*halfBlock; x++)
+        {
+            const double diff = ref[(anchor.x - halfBlock + x) + (size_t)(anchor.y - halfBlock + y) * refWidth]
+                                - img[(x0 + x) + (size_t)(y0 + y) * imgWidth];
+            sum += diff * diff;
+        }
+    return sum;
+}
+
+/// Finds the offset (dx, dy) of 'img' relative to the reference by block matching around 'anchor'
+/** Works like anchor-based image alignment: the position in 'img' with the smallest
+    difference from the reference block is searched for (first every 2nd pixel, then refined).
+    Returns 'false' if no position fits. */
+static bool FindOffsetByBlockMatching(const std::vector<float> &ref, unsigned refWidth, struct SKRY_point anchor,
+                                      const std::vector<float> &img, unsigned imgWidth, unsigned imgHeight,
+                                      int &dx, int &dy)
+{
+    const int radius = (int)Utils::Const::liveStackingSearchRadius;
+
+    double minDiff = -1;
+    auto checkOffset = [&](int x, int y)
+        {
+            const double diff = GetBlockDifference(ref, refWidth, anchor, img, imgWidth, imgHeight, x, y);
+            if (diff >= 0 && (minDiff < 0 || diff < minDiff))
+            {
+                minDiff = diff;
+                dx = x;
+                dy = y;
+            }
+        };
+
+    for (int y = -radius; y <= radius; y += 2)
+        for (int x = -radius; x <= radius; x += 2)
+            checkOffset(x, y);
+
+    if (minDiff < 0)
+        return false;
+
+    const int coarseX = dx, coarseY = dy;
+    for (int y = coarseY - 1; y <= coarseY + 1; y++)
+        for (int x = coarseX - 1; x <= coarseX + 1; x++)
+            checkOffset(x, y);
+
+    return true;
+}
+
+void c_RunningStack::Add(const libskry::c_Image &stack, size_t numFrames, enum SKRY_img_alignment_method alignmentMethod)
+{
+    const unsigned numChannels = NUM_CHANNELS[stack.GetPixelFormat()];
+    const enum SKRY_pixel_format floatFmt = (numChannels == 3 ? SKRY_PIX_RGB32F : SKRY_PIX_MONO32F);
+
+    if (numFrames == 0 || (m_Image && numChannels != m_NumChannels))
+        return;
+
+    libskry::c_Image img = libskry::c_Image::ConvertPixelFormat(stack, floatFmt);
+    if (!img)
+        return;
+
+    if (!m_Image)
+    {
+        m_Width = img.GetWidth();
+        m_Height = img.GetHeight();
+        m_NumChannels = numChannels;
+        m_AlignmentMethod = alignmentMethod;
+        if (m_AlignmentMethod == SKRY_IMG_ALGN_ANCHORS)
+        {
+            m_RefBrightness = GetBrightness(img, numChannels);
+            struct SKRY_point anchor = libskry::c_ImageAlignment::SuggestAnchorPos(
+                libskry::c_Image::ConvertPixelFormat(img, SKRY_PIX_MONO8),
+                Utils::Const::Defaults::placementBrightnessThreshold, Utils::Const::imgAlignmentRefBlockSize);
+
+            // Keep the whole reference block inside the image
+            const int halfBlock = (int)Utils::Const::imgAlignmentRefBlockSize / 2;
+            anchor.x = std::max(halfBlock, std::min(anchor.x, (int)m_Width - halfBlock));
+            anchor.y = std::max(halfBlock, std::min(anchor.y, (int)m_Height - halfBlock));
+            m_RefAnchor = anchor;
+        }
+        else
+            GetCentroid(img, numChannels, m_RefCentroidX, m_RefCentroidY);
+
+        m_Sum.assign((size_t)m_Width * m_Height * m_NumChannels, 0);
+        m_Weight.assign((size_t)m_Width * m_Height, 0);
+        m_Image = std::make_shared<libskry::c_Image>(libskry::c_Image::ConvertPixelFormat(img, floatFmt));
+    }
+
+    // Image alignment is done separately in each batch and crops the stacks differently,
+    // so they are registered (with whole-pixel accuracy) to the first one using the job's alignment method
+    int dx = 0, dy = 0;
+    if (m_AlignmentMethod == SKRY_IMG_ALGN_ANCHORS)
+    {
+        if (img.GetWidth() < Utils::Const::imgAlignmentRefBlockSize || img.GetHeight() < Utils::Const::imgAlignmentRefBlockSize ||
+            !FindOffsetByBlockMatching(m_RefBrightness, m_Width, m_RefAnchor,
+                                       GetBrightness(img, numChannels), img.GetWidth(), img.GetHeight(), dx, dy))
+        {
+            return;
+        }
+    }
+    else
+    {
+        double centroidX, centroidY;
+        GetCentroid(img, numChannels, centroidX, centroidY);
+        dx = (int)std::lround(m_RefCentroidX - centroidX);
+        dy = (int)std::lround(m_RefCentroidY - centroidY);
+    }
+
+    for (unsigned y = 0; y < img.GetHeight(); y++)
+    {
+        const int destY = (int)y + dy;
+        if (destY < 0 || destY >= (int)m_Height)
+            continue;
+
+        const float *src = static_cast<const float *>(img.GetLine(y));
+        for (unsigned x = 0; x < img.GetWidth(); x++)
+        {
+            const int destX = (int)x + dx;
+            if (destX < 0 || destX >= (int)m_Width)
+                continue;
+
+            const size_t destIdx = destX + (size_t)destY * m_Width;
+            for (unsigned ch = 0; ch < m_NumChannels; ch++)
+                m_Sum[destIdx * m_NumChannels + ch] += numFrames * src[x * m_NumChannels + ch];
+            m_Weight[destIdx] += numFrames;
+        }
+    }
+    m_NumFrames += numFrames;
+
+    // The previous image may still be displayed, so a new one is created
+    auto newImage = std::make_shared<libskry::c_Image>(libskry::c_Image::ConvertPixelFormat(*m_Image, floatFmt));
+    for (unsigned y = 0; y < m_Height; y++)
+    {
+        float *dest = static_cast<float *>(newImage->GetLine(y));
+        for (unsigned x = 0; x < m_Width; x++)
+        {
+            const float weight = m_Weight[x + (size_t)y * m_Width];
+            for (unsigned ch = 0; ch < m_NumChannels; ch++)
+            {
+                const size_t idx = (x + (size_t)y * m_Width) * m_NumChannels + ch;
+                dest[x * m_NumChannels + ch] = (weight > 0 ? m_Sum[idx] / weight : 0);
+            }
+        }
+    }
+    m_Image = newImage;
+}
+
+c_LiveCapture::c_LiveCapture(const std::string &path)
+: m_Path(path), m_IsVideo(!Glib::file_test(path, Glib::FileTest::FILE_TEST_IS_DIR))
+{ }
+
+c_LiveCapture::~c_LiveCapture()
+{
+    for (const std::string &fileName: m_BatchFiles)
+        if (!fileName.empty())
+            g_remove(fileName.c_str());
+}
+
+bool c_LiveCapture::GetNewFrames(size_t minFrames, size_t maxFrames, Batch_t &batch)
+{
+    // Image sequences need at least 2 images
+    minFrames = std::max(minFrames, (size_t)2);
+
+    if (m_IsVideo)
+    {
+        std::string fileName = CopyNewVideoFrames(minFrames, maxFrames);
+        if (fileName.empty())
+            return false;
+
+        if (!m_BatchFiles[1].empty())
+            g_remove(m_BatchFiles[1].c_str());
+        m_BatchFiles[1] = m_BatchFiles[0];
+        m_BatchFiles[0] = fileName;
+
+        batch.sourcePath = fileName;
+        batch.imageFileNames.clear();
+    }
+    else
+    {
+        std::vector<std::string> fileNames = GetNewImageFiles(maxFrames);
+        if (fileNames.size() < minFrames)
+            return false;
+
+        m_UsedImageFiles.insert(fileNames.begin(), fileNames.end());
+        batch.sourcePath = m_Path;
+        batch.imageFileNames = fileNames;
+    }
+
+    return true;
+}
+
+static size_t GetFileSize(const std::string &fileName)
+{
+    GStatBuf stat;
+    return (0 == g_stat(fileName.c_str(), &stat) ? stat.st_size : 0);
+}
+
+std::vector<std::string> c_LiveCapture::GetNewImageFiles(size_t maxFrames)
+{
+    const std::vector<std::string> allFiles = Utils::ListImageFiles(m_Path);
+
+    std::vector<std::string> newFiles;
+    for (size_t i = 0; i < allFiles.size() && newFiles.size() < maxFrames; i++)
+    {
+        if (m_UsedImageFiles.count(allFiles[i]))
+            continue;
+
+        if (i == allFiles.size() - 1)
+        {
+            // The last file may be still being written; consider it complete if its size has not changed since the previous check
+            const size_t size = GetFileSize(allFiles[i]);
+            const bool isComplete = (size > 0 && allFiles[i] == m_LastImageFile && size == m_LastImageFileSize);
+            m_LastImageFile = allFiles[i];
+            m_LastImageFileSize = size;
+            if (!isComplete)
+                break;
+        }
+
+        newFiles.push_back(allFiles[i]);
+    }
+
+    return newFiles;
+}
+
+std::string c_LiveCapture::CopyNewVideoFrames(size_t minFrames, size_t maxFrames)
+{
+    SER::Header_t header;
+    if (!SER::ReadHeader(m_Path, header))
+        return "";
+
+    const size_t frameSize = header.GetFrameSize();
+    const size_t fileSize = GetFileSize(m_Path);
+    size_t numComplete = (fileSize > SER::HEADER_SIZE ? (fileSize - SER::HEADER_SIZE) / frameSize : 0);
+    // The header's frame count is usually updated only after recording; if set, it also excludes the trailing timestamps
+    if (header.numFrames > 0)
+        numComplete = std::min(numComplete, header.numFrames);
+
+    if (numComplete < m_NumUsedFrames + minFrames)
+        return "";
+    const size_t numFrames = std::min(maxFrames, numComplete - m_NumUsedFrames);
+
+    // The extension tells libskry the video format
+    std::string fileName = Utils::CreateTempFile("stackistry_live_XXXXXX.ser");
+    if (fileName.empty())
+        return "";
+
+    std::ifstream src(m_Path.c_str(), std::ios_base::in | std::ios_base::binary);
+    src.seekg(SER::HEADER_SIZE + m_NumUsedFrames * frameSize);
+
+    c_SerWriter writer(fileName);
+    bool success = writer && writer.WriteHeader(header.colorId, header.width, header.height, header.bitsPerChannel,
+                                                numFrames, "Stackistry live", header.littleEndian);
+    std::vector<char> frame(frameSize);
+    for (size_t i = 0; i < numFrames && success; i++)
+    {
+        src.read(frame.data(), frameSize);
+        success = !src.fail() && writer.WriteFrameData(frame.data(), frameSize);
+    }
+
+    if (!writer.Close() || !success)
+    {
+        g_remove(fileName.c_str());
+        return "";
+    }
+
+    m_NumUsedFrames += numFrames;
+    return fileName;
+}
@@ -0,0 +1,127 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Live stacking header.
+*/
+
+#ifndef STACKISTRY_LIVE_STACK_HEADER
+#define STACKISTRY_LIVE_STACK_HEADER
+
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <skry/skry_cpp.hpp>
+
+
+/// Average of stacks of consecutive batches of frames, registered to the first one
+/** Each stack is weighted by its number of frames. Parts of the stacks outside
+    the first one are discarded. */
+class c_RunningStack
+{
+public:
+    /// Stacks are registered by block matching around an anchor (for SKRY_IMG_ALGN_ANCHORS) or by their centroids
+    /** The method of the first call is used for all subsequent ones. A stack which cannot be registered is skipped. */
+    void Add(const libskry::c_Image &stack, size_t numFrames, enum SKRY_img_alignment_method alignmentMethod);
+
+    /// Returns null if nothing has been added
+    std::shared_ptr<const libskry::c_Image> GetImage() const { return m_Image; }
+
+    size_t GetNumFrames() const { return m_NumFrames; }
+
+private:
+    unsigned m_Width = 0, m_Height = 0, m_NumChannels = 0;
+    enum SKRY_img_alignment_method m_AlignmentMethod = SKRY_IMG_ALGN_ANCHORS;
+    double m_RefCentroidX = 0, m_RefCentroidY = 0; ///< Used for SKRY_IMG_ALGN_CENTROID
+    std::vector<float> m_RefBrightness; ///< Brightness of the first stack; used for SKRY_IMG_ALGN_ANCHORS
+    struct SKRY_point m_RefAnchor = { 0, 0 }; ///< Center of the reference block in the first stack
+    std::vector<float> m_Sum; ///< Weighted sum of pixel values
+    std::vector<float> m_Weight; ///< Sum of weights of each pixel
+    size_t m_NumFrames = 0;
+    std::shared_ptr<libskry::c_Image> m_Image;
+};
+
+/// Watches a capture in progress (an image series directory or a SER video) for new frames
+/** The new frames are processed in batches (as separate image sequences),
+    and their stacks are combined into a running stack. */
+class c_LiveCapture
+{
+public:
+    /// Frames which appeared since the previous batch
+    struct Batch_t
+    {
+        /// For a SER video, a temporary copy of the new frames; otherwise the watched directory
+        std::string sourcePath;
+        std::vector<std::string> imageFileNames; ///< Empty for a SER video
+    };
+
+    /// 'path' is a directory or a SER video
+    c_LiveCapture(const std::string &path);
+
+    /// Deletes the temporary files of the batches
+    ~c_LiveCapture();
+
+    c_LiveCapture(const c_LiveCapture &) = delete;
+    c_LiveCapture &operator =(const c_LiveCapture &) = delete;
+
+    const std::string &GetPath() const { return m_Path; }
+
+    /// Returns 'false' if there are fewer than 'minFrames' completely written new frames
+    /** The batch contains at most 'maxFrames' frames; they are not returned again.
+        Deletes the temporary file of the previous but one batch. */
+    bool GetNewFrames(size_t minFrames, size_t maxFrames, Batch_t &batch);
+
+    c_RunningStack &GetStack() { return m_Stack; }
+
+    bool IsWatching() const { return m_IsWatching; }
+    void SetWatching(bool watching) { m_IsWatching = watching; }
+
+    /// Returns 'true' if the last batch has not been stacked yet
+    bool IsBatchPending() const { return m_IsBatchPending; }
+    void SetBatchPending(bool pending) { m_IsBatchPending = pending; }
+
+private:
+    std::string m_Path;
+    bool m_IsVideo;
+    bool m_IsWatching = false;
+    bool m_IsBatchPending = false;
+
+    /// Image files already used in batches
+    std::set<std::string> m_UsedImageFiles;
+    /// Image file which was the last one at the previous check and its size then
+    std::string m_LastImageFile;
+    size_t m_LastImageFileSize = 0;
+
+    /// Number of SER frames already used in batches
+    size_t m_NumUsedFrames = 0;
+    /// Temporary files of the current and previous batch (the latter may still be open)
+    std::string m_BatchFiles[2];
+
+    c_RunningStack m_Stack;
+
+    std::vector<std::string> GetNewImageFiles(size_t maxFrames);
+
+    /// Copies the new frames to a temporary SER video; returns its name (empty if there are too few)
+    std::string CopyNewVideoFrames(size_t minFrames, size_t maxFrames);
+};
+
+#endif // STACKISTRY_LIVE_STACK_HEADER
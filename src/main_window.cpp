@@ -32,6 +32,7 @@ File description:
 #include <gdkmm.h>
 #include <glibmm/fileutils.h>
 #include <glibmm/i18n.h>
+#include <glibmm/main.h>
 #include <glibmm/miscutils.h>
 #include <glibmm/threads.h>
 #include <glibmm/ustring.h>
@@ -49,20 +50,19 @@ File description:
 
 #include "select_points.h"
 #include "config.h"
+#include "frame_cache.h"
 #include "frame_select.h"
+#include "image_writer.h"
+#include "live_stack.h"
 #include "main_window.h"
 #include "preferences.h"
 #include "settings_dlg.h"
 #include "utils.h"
+#include "version.h"
 #include "worker.h"
 
 
-#define LOCK() Glib::Threads::RecMutex::Lock lock(Worker::GetAccessGuard())
 
-#define VERSION_MAJOR 0
-#define VERSION_MINOR 3
-#define VERSION_SUBMINOR 0
-#define VERSION_DATE "2017-06-05"
 
 namespace ActionName
 {
@@ -70,10 +70,13 @@ namespace ActionName
     const char *addFolders = "add_folders";
     const char *addImages = "add_images";
     const char *addVideos = "add_videos";
+    const char *watchFolder = "watch_folder";
+    const char *watchVideo = "watch_video";
     const char *startProcessing = "start_processing";
     const char *pauseResumeProcessing = "pause_resume_processing";
     const char *stopProcessing = "stop_processing";
     const char *setAnchors = "set_anchors";
+    const char *setRoi = "set_roi";
     const char *saveStackedImage = "save_stacked_image";
     const char *saveBestFragmentsImage = "save_best_fragments_image";
     const char *selectFrames = "select_frames";
@@ -85,6 +88,7 @@ namespace ActionName
     const char *about = "about";
     const char *toggleQualityWnd = "toggle_quality_wnd";
     const char *exportQualityData = "export_quality_data";
+    const char *showProfile = "show_profile";
 }
 
 namespace WidgetName
@@ -100,6 +104,29 @@ namespace WidgetName
     const char *MenuView = "MenuView";
 }
 
+/// Min. interval (in seconds) between updates of the displayed processing progress
+const double UI_FRAME_INTERVAL = 1.0 / 60;
+
+static
+libskry::c_ImageSequence InitLiveBatchImgSeq(const c_LiveCapture::Batch_t &batch, enum SKRY_result &result)
+{
+    result = SKRY_SUCCESS;
+    if (batch.imageFileNames.empty())
+        return libskry::c_ImageSequence::InitVideoFile(batch.sourcePath.c_str(), &result);
+    else
+        return libskry::c_ImageSequence::InitImageList(batch.imageFileNames);
+}
+
+/// For a live stacking job, returns the running stack also while a new batch is being processed
+static
+std::shared_ptr<const libskry::c_Image> GetStackToShow(const Job_t &job)
+{
+    std::shared_ptr<const libskry::c_Image> stack = job.stackedImg.Get();
+    if (!stack && job.live)
+        stack = job.live->GetStack().GetImage();
+    return stack;
+}
+
 static
 libskry::c_Image GetFirstActiveImage(libskry::c_ImageSequence &imgSeq, enum SKRY_result &result)
 {
@@ -138,9 +165,138 @@ std::shared_ptr<Job_t> c_MainWindow::GetJobPtrAt(const Gtk::ListStore::iterator
     return (decltype(m_Jobs.columns.job)::ElementType)((*iter)[m_Jobs.columns.job]);
 }
 
+Gtk::ListStore::iterator c_MainWindow::AppendJob(const std::shared_ptr<Job_t> &job, const Glib::ustring &source)
+{
+    return InsertJob(m_Jobs.data->children().end(), job, source);
+}
+
+Gtk::ListStore::iterator c_MainWindow::InsertJob(const Gtk::ListStore::iterator &before, const std::shared_ptr<Job_t> &job, const Glib::ustring &source)
+{
+    Gtk::ListStore::iterator iter = m_Jobs.data->insert(before);
+    auto row = *iter;
+    row[m_Jobs.columns.jobSource] = source;
+    row[m_Jobs.columns.state]     = _("Waiting");
+    row[m_Jobs.columns.progressText] = "";
+    row[m_Jobs.columns.tooltip]   = source;
+    row[m_Jobs.columns.loadSeqNum] = 0;
+    row[m_Jobs.columns.job]       = job;
+    return iter;
+}
+
 void c_MainWindow::OnAddFolders()
 {
-    //
+    Gtk::FileChooserDialog dlg(*this, _("Add image series from folder(s)"), Gtk::FileChooserAction::FILE_CHOOSER_ACTION_SELECT_FOLDER);
+    dlg.add_button(_("OK"), Gtk::ResponseType::RESPONSE_OK);
+    dlg.add_button(_("Cancel"), Gtk::ResponseType::RESPONSE_CANCEL);
+    dlg.set_current_folder(Configuration::LastOpenDir);
+    dlg.set_select_multiple();
+
+    PrepareDialog(dlg);
+    if (Gtk::ResponseType::RESPONSE_OK == dlg.run())
+    {
+        // The jobs are appended in OnJobsLoaded()
+        for (auto &dirName: dlg.get_filenames())
+            m_JobLoader.Submit({ c_JobLoader::InputType::IMAGE_FOLDER, dirName, { } });
+        OnJobsLoaded(); // shows the loading status
+    }
+    Configuration::LastOpenDir = dlg.get_current_folder();
+}
+
+void c_MainWindow::OnWatchCapture(bool isFolder)
+{
+    Gtk::FileChooserDialog dlg(*this, isFolder ? _("Watch folder (live stacking)") : _("Watch SER video (live stacking)"),
+                               isFolder ? Gtk::FileChooserAction::FILE_CHOOSER_ACTION_SELECT_FOLDER
+                                        : Gtk::FileChooserAction::FILE_CHOOSER_ACTION_OPEN);
+    dlg.add_button(_("OK"), Gtk::ResponseType::RESPONSE_OK);
+    dlg.add_button(_("Cancel"), Gtk::ResponseType::RESPONSE_CANCEL);
+    dlg.set_current_folder(Configuration::LastOpenDir);
+
+    if (!isFolder)
+    {
+        auto fltSer = Gtk::FileFilter::create();
+        fltSer->add_pattern("*.ser");
+        fltSer->set_name("SER (*.ser)");
+        dlg.add_filter(fltSer);
+    }
+
+    PrepareDialog(dlg);
+    if (Gtk::ResponseType::RESPONSE_OK == dlg.run())
+    {
+        const std::string path = dlg.get_filename();
+        auto live = std::make_shared<c_LiveCapture>(path);
+        c_LiveCapture::Batch_t batch;
+        enum SKRY_result result = SKRY_SUCCESS;
+        std::shared_ptr<Job_t> newJob;
+
+        if (!live->GetNewFrames(2, Utils::Const::liveStackingMaxBatch, batch))
+        {
+            ShowMsg(dlg, _("Error"),
+                    Glib::ustring::compose(_("%1 does not contain at least two complete frames yet."), path),
+                    Gtk::MessageType::MESSAGE_ERROR);
+        }
+        else if (!(newJob = std::make_shared<Job_t>(Job_t { InitLiveBatchImgSeq(batch, result) }))->imgSeq)
+        {
+            ShowMsg(dlg, _("Error"),
+                    Glib::ustring::compose(_("Could not open %1:\n%2"), path, Utils::GetErrorMsg(result)),
+                    Gtk::MessageType::MESSAGE_ERROR);
+        }
+        else
+        {
+            newJob->sourcePath = batch.sourcePath;
+            newJob->imageFileNames = batch.imageFileNames;
+            Job::SetDefaultSettings(*newJob);
+            // Stacks are saved by the user (each batch would produce another file)
+            newJob->outputSaveMode = Utils::Const::OutputSaveMode::NONE;
+            newJob->live = live;
+            live->SetBatchPending(true);
+            AppendJob(newJob, path);
+        }
+    }
+    Configuration::LastOpenDir = dlg.get_current_folder();
+}
+
+bool c_MainWindow::OnLiveCapturePoll()
+{
+    bool anyJobQueued = false;
+    for (auto &row: m_Jobs.data->children())
+    {
+        std::shared_ptr<Job_t> job = GetJobPtrAt(row);
+        if (!job->live || !job->live->IsWatching() || job->live->IsBatchPending() || IsJobRunning(row))
+            continue;
+
+        c_LiveCapture::Batch_t batch;
+        if (!job->live->GetNewFrames(Utils::Const::liveStackingMinBatch, Utils::Const::liveStackingMaxBatch, batch))
+            continue;
+
+        enum SKRY_result result;
+        libskry::c_ImageSequence imgSeq = InitLiveBatchImgSeq(batch, result);
+        if (!imgSeq)
+        {
+            std::cerr << "Could not open the new frames of " << job->live->GetPath() << ": " << Utils::GetErrorMsg(result) << std::endl;
+            continue;
+        }
+        imgSeq.ReinterpretAsCFA(job->cfaPattern);
+        // The new batch's frames must not be mistaken for the previous one's
+        FrameCache::Invalidate(job->frameCacheId);
+        job->frameCacheId = FrameCache::CreateSeqId();
+        job->imgSeq = std::move(imgSeq);
+        job->sourcePath = batch.sourcePath;
+        job->imageFileNames = batch.imageFileNames;
+        job->live->SetBatchPending(true);
+
+        m_JobsToProcess.push(m_Jobs.data->get_path(row));
+        (*row)[m_Jobs.columns.state] = _("Waiting");
+        anyJobQueued = true;
+    }
+
+    if (anyJobQueued)
+    {
+        StartQueuedJobs();
+        UpdateActionsState();
+        UpdateOutputViewZoomControlsState();
+    }
+
+    return true;
 }
 
 void c_MainWindow::OnAddImageSeries()
@@ -176,22 +332,9 @@ void c_MainWindow::OnAddImageSeries()
             return;
         }
 
-        std::shared_ptr<Job_t> newJob = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitImageList(fileNames) });
-        newJob->sourcePath = Glib::path_get_dirname(fileNames[0]);
-        SetDefaultSettings(*newJob);
-
-        if (!newJob->imgSeq)
-        {
-            std::cout << "Failed to initialize image sequence." << std::endl;
-        }
-        else
-        {
-            auto row = *m_Jobs.data->append();
-            row[m_Jobs.columns.jobSource] = newJob->sourcePath;
-            row[m_Jobs.columns.state]     = _("Waiting");
-            row[m_Jobs.columns.progressText] = "";
-            row[m_Jobs.columns.job]       = newJob;
-        }
+        // The job is appended in OnJobsLoaded()
+        m_JobLoader.Submit({ c_JobLoader::InputType::IMAGE_FILES, Glib::path_get_dirname(fileNames[0]), fileNames });
+        OnJobsLoaded(); // shows the loading status
     }
     Configuration::LastOpenDir = dlg.get_current_folder();
 }
@@ -204,9 +347,9 @@ void c_MainWindow::PrepareDialog(Gtk::Dialog &dlg)
 
 void c_MainWindow::OnStartProcessing()
 {
-    if (Worker::IsRunning())
+    if (IsProcessing())
     {
-        std::cerr << "Cannot start processing, worker is still running." << std::endl;
+        std::cerr << "Cannot start processing, workers are still running." << std::endl;
         return;
     }
 
@@ -214,40 +357,194 @@ void c_MainWindow::OnStartProcessing()
         m_JobsToProcess.pop();
 
     for (auto &row: m_Jobs.view.get_selection()->get_selected_rows())
-        m_JobsToProcess.push(row);
-
-    m_RunningJob = m_Jobs.data->get_iter(m_JobsToProcess.front());
-    m_JobsToProcess.pop();
-    Job_t &job = GetJobAt(m_RunningJob);
-    if (job.anchors.empty() && !job.automaticAnchorPlacement)
     {
-        if (!SetAnchors(job))
+        Job_t &job = GetJobAt(row);
+        if (job.live)
         {
-            m_RunningJob = Gtk::ListStore::iterator(nullptr);
-            return;
+            job.live->SetWatching(true);
+            if (!job.live->IsBatchPending())
+            {
+                // The batch has been stacked already; new frames are queued by OnLiveCapturePoll()
+                (*m_Jobs.data->get_iter(row))[m_Jobs.columns.state] = _("Watching");
+                continue;
+            }
         }
+        m_JobsToProcess.push(row);
     }
 
-    Worker::StartProcessing(&job);
+    ApplyWorkerSettings();
+    StartQueuedJobs();
     UpdateActionsState();
     UpdateOutputViewZoomControlsState();
+    UpdateVisualizationZoom();
 }
 
-bool c_MainWindow::SetAnchorsAutomatically(Job_t &job)
+void c_MainWindow::ApplyWorkerSettings()
 {
-    enum SKRY_result result;
-    libskry::c_Image firstImg = GetFirstActiveImage(job.imgSeq, result);
-    if (!firstImg)
+    Worker::SetThreadBudget(Configuration::WorkerThreadBudget);
+    Worker::SetReadAheadDepth(Configuration::ReadAheadFrames);
+    Worker::SetVisualizationMaxFps(Configuration::VisualizationMaxFps);
+}
+
+size_t c_MainWindow::GetNumBusyJobs() const
+{
+    // Jobs waiting for reference points may wait long (e.g. during unattended processing); let the queue proceed meanwhile
+    size_t numBusyJobs = 0;
+    for (auto &runningJob: m_RunningJobs)
+        if (!runningJob.worker->IsWaitingForReferencePoints())
+            numBusyJobs++;
+
+    return numBusyJobs;
+}
+
+void c_MainWindow::StartQueuedJobs()
+{
+    // Jobs may finish (or start waiting) while the anchor selection dialog is shown, so the count is taken anew each time.
+    // However many jobs wait for reference points, at most one job more is started (each one holds its sequences,
+    // prefetcher and visualization), so that there are never more than MaxConcurrentJobs+1 workers.
+    while (!m_JobsToProcess.empty() && GetNumBusyJobs() < Configuration::MaxConcurrentJobs &&
+           m_RunningJobs.size() <= Configuration::MaxConcurrentJobs)
     {
-        ShowMsg(*this, _("Error"),
-                Glib::ustring::compose(_("Error loading the first image of %1:\n%2"),
-                                 job.sourcePath.c_str(), Utils::GetErrorMsg(result)),
-                Gtk::MessageType::MESSAGE_ERROR);
-        return false;
+        Gtk::ListStore::iterator row = m_Jobs.data->get_iter(m_JobsToProcess.front());
+        m_JobsToProcess.pop();
+
+        std::shared_ptr<Job_t> job = GetJobPtrAt(row);
+        if (job->flatFieldOutputFileName.empty() && job->anchors.empty() && !job->automaticAnchorPlacement)
+        {
+            // The dialog's main loop must not handle the workers' progress (which starts queued jobs, too)
+            const bool wasHandlingModalDialog = m_HandlingModalDialog;
+            m_HandlingModalDialog = true;
+            const bool anchorsSet = SetAnchors(*job);
+            m_HandlingModalDialog = wasHandlingModalDialog;
+            if (!wasHandlingModalDialog)
+                ResumeWorkerProgress();
+
+            if (!anchorsSet)
+            {
+                // The user canceled anchor selection; do not start any more jobs
+                while (!m_JobsToProcess.empty())
+                    m_JobsToProcess.pop();
+                break;
+            }
+        }
+
+        auto worker = std::make_shared<Worker::c_Worker>(
+            job, sigc::mem_fun(m_WorkerDispatcher, &Glib::Dispatcher::emit));
+        m_RunningJobs.push_back({ row, worker, NONE, Worker::ProcPhase::IDLE, 0 });
+        worker->StartProcessing();
+    }
+}
+
+bool c_MainWindow::IsJobRunning(const Gtk::ListStore::iterator &iter) const
+{
+    for (auto &runningJob: m_RunningJobs)
+        if (runningJob.row == iter)
+            return true;
+
+    return false;
+}
+
+void c_MainWindow::UpdateVisualizationZoom()
+{
+    if (IsProcessing() && m_OutputView.GetOutputImgType() == OutputImgType::Visualization)
+    {
+        double zoom = m_OutputView.GetZoomPercentVal() / 100.0;
+        Cairo::Rectangle visibleArea = m_OutputView.GetVisibleArea();
+        Worker::SetZoomFactor(zoom, m_OutputView.GetInterpolationMethod(),
+                              { visibleArea.x / zoom, visibleArea.y / zoom,
+                                visibleArea.width / zoom, visibleArea.height / zoom });
+    }
+}
+
+void c_MainWindow::ShowVisualizationImage(const Worker::VisualizationImage_t &visImg, bool refresh)
+{
+    if (visImg.img)
+        m_OutputView.SetImageFragment(visImg.img, visImg.fullWidth, visImg.fullHeight,
+                                      visImg.xOffset, visImg.yOffset, refresh);
+}
+
+c_MainWindow::RunningJob_t *c_MainWindow::GetVisualizedJob()
+{
+    if (m_RunningJobs.empty())
+        return nullptr;
+
+    if (GetJobsListFocusedRow())
+    {
+        Gtk::ListStore::iterator focused = m_Jobs.data->get_iter(GetJobsListFocusedRow());
+        for (auto &runningJob: m_RunningJobs)
+            if (runningJob.row == focused)
+                return &runningJob;
+    }
+
+    return &m_RunningJobs.front();
+}
+
+void c_MainWindow::ResetJobRow(const Gtk::ListStore::iterator &iter)
+{
+    (*iter)[m_Jobs.columns.progress] = 0;
+    (*iter)[m_Jobs.columns.percentageProgress] = 0;
+    (*iter)[m_Jobs.columns.progressText] = "";
+}
+
+void c_MainWindow::ShowRefPointsDialog(RunningJob_t &runningJob)
+{
+    const Job_t &job = GetJobAt(runningJob.row);
+
+    // The image and the automatic placement have been prepared by the worker, so the dialog opens at once
+    runningJob.refPtDlg = std::make_shared<c_SelectPointsDlg>(runningJob.worker->GetBestQualityAlignedImage(),
+                                                              job.refPoints,
+                                                              runningJob.worker->GetSuggestedReferencePoints());
+    c_SelectPointsDlg &dlg = *runningJob.refPtDlg;
+    dlg.set_title(Glib::ustring::compose(_("Set reference points \u2013 %1"), job.sourcePath)); // \u2013 = N-dash
+    dlg.SetInfoText(_("Place reference points by left-clicking on the image. Avoid blank areas "
+                    "with little or no detail. Click Cancel to set points automatically."));
+    // Not modal: the other jobs continue to be processed (and shown) in the meantime
+    dlg.set_transient_for(*this);
+    Utils::RestorePosSize(Configuration::SelectRefPointsDlgPosSize, dlg);
+    dlg.signal_response().connect(sigc::bind(sigc::mem_fun(*this, &c_MainWindow::OnRefPointsDlgResponse),
+                                             runningJob.worker.get()));
+    dlg.show();
+}
+
+void c_MainWindow::OnRefPointsDlgResponse(int responseId, Worker::c_Worker *worker)
+{
+    for (auto &runningJob: m_RunningJobs)
+    {
+        if (runningJob.worker.get() != worker || !runningJob.refPtDlg)
+            continue;
+
+        c_SelectPointsDlg &dlg = *runningJob.refPtDlg;
+        Job_t &job = GetJobAt(runningJob.row);
+        if (responseId == Gtk::ResponseType::RESPONSE_OK)
+        {
+            dlg.GetPoints(job.refPoints);
+            // The image is binned in quick look mode, but the job's settings refer to full resolution
+            for (struct SKRY_point &refPt: job.refPoints)
+            {
+                refPt.x *= job.binning;
+                refPt.y *= job.binning;
+            }
+        }
+        else
+            job.automaticRefPointsPlacement = true;
+
+        Utils::SavePosSize(dlg, Configuration::SelectRefPointsDlgPosSize);
+        dlg.hide();
+        worker->NotifyReferencePointsSet();
+
+        // Do not destroy the dialog from its own signal handler
+        Glib::signal_idle().connect(sigc::slot<bool>(
+            [this, worker]()
+            {
+                for (auto &runningJob: m_RunningJobs)
+                    if (runningJob.worker.get() == worker)
+                        runningJob.refPtDlg.reset();
+
+                return false; // do not call again
+            }
+        ));
+        break;
     }
-    job.anchors.push_back(libskry::c_ImageAlignment::SuggestAnchorPos(
-        firstImg, Utils::Const::Defaults::placementBrightnessThreshold, Utils::Const::imgAlignmentRefBlockSize));
-    return true;
 }
 
 void c_MainWindow::OnPauseResumeProcessing()
@@ -256,20 +553,33 @@ void c_MainWindow::OnPauseResumeProcessing()
 
 void c_MainWindow::OnStopProcessing()
 {
-    Worker::AbortProcessing();
-    if (m_RunningJob)
+    while (!m_JobsToProcess.empty())
+        m_JobsToProcess.pop();
+
+    for (auto &row: m_Jobs.data->children())
     {
-        (*m_RunningJob)[m_Jobs.columns.progress] = 0;
-        (*m_RunningJob)[m_Jobs.columns.percentageProgress] = 0;
-        (*m_RunningJob)[m_Jobs.columns.progressText] = "";
-        (*m_RunningJob)[m_Jobs.columns.state] = _("Waiting");
-        GetJobAt(m_RunningJob).imgSeq.Deactivate();
+        Job_t &job = GetJobAt(row);
+        if (job.live && job.live->IsWatching())
+        {
+            job.live->SetWatching(false);
+            (*row)[m_Jobs.columns.state] = _("Waiting");
+        }
+    }
+
+    for (auto &runningJob: m_RunningJobs)
+        runningJob.worker->AbortProcessing();
 
-        m_RunningJob = Gtk::ListStore::iterator(nullptr);
+    for (auto &runningJob: m_RunningJobs)
+    {
+        ResetJobRow(runningJob.row);
+        (*runningJob.row)[m_Jobs.columns.state] = _("Waiting");
+        GetJobAt(runningJob.row).imgSeq.Deactivate();
+    }
+    if (!m_RunningJobs.empty())
+    {
+        m_RunningJobs.clear();
         SetStatusBarText(_("Idle"));
     }
-    while (!m_JobsToProcess.empty())
-        m_JobsToProcess.pop();
 
     UpdateActionsState();
     UpdateOutputViewZoomControlsState();
@@ -330,14 +640,56 @@ void c_MainWindow::OnSetAnchors()
     GetCurrentJob().imgSeq.Deactivate();
 }
 
+void c_MainWindow::OnSetRoi()
+{
+    Job_t &job = GetCurrentJob();
+
+    enum SKRY_result result;
+    libskry::c_Image firstImg = GetFirstActiveImage(job.imgSeq, result);
+    job.imgSeq.Deactivate();
+    if (!firstImg)
+    {
+        ShowMsg(*this, _("Error"),
+                Glib::ustring::compose(_("Error loading the first image of %1:\n%2"),
+                                 job.sourcePath.c_str(), Utils::GetErrorMsg(result)),
+                Gtk::MessageType::MESSAGE_ERROR);
+        return;
+    }
+
+    std::vector<struct SKRY_point> corners;
+    if (job.roi.width > 0)
+        corners = { { job.roi.x, job.roi.y },
+                    { job.roi.x + (int)job.roi.width - 1, job.roi.y + (int)job.roi.height - 1 } };
+
+    c_SelectPointsDlg dlg(firstImg, corners, { });
+    dlg.SetRectangleMode();
+    dlg.set_title(_("Set region of interest"));
+    dlg.SetInfoText(_("Click two opposite corners of the region to be processed. "
+                    "To process whole images, remove the points and click OK."));
+    PrepareDialog(dlg);
+    Utils::RestorePosSize(Configuration::AnchorSelectDlgPosSize, dlg);
+    if (dlg.run() == Gtk::ResponseType::RESPONSE_OK)
+    {
+        struct SKRY_rect roi = { 0, 0, 0, 0 };
+        dlg.GetRectangle(roi);
+        if (roi.x != job.roi.x || roi.y != job.roi.y || roi.width != job.roi.width || roi.height != job.roi.height)
+        {
+            job.roi = roi;
+            // Ref. points are relative to the region
+            job.refPoints.clear();
+        }
+    }
+    Utils::SavePosSize(dlg, Configuration::AnchorSelectDlgPosSize);
+}
+
 static
 void GetOutputFormatFromFilter(Glib::ustring filterName,
-                               enum SKRY_output_format &outputFmt)
+                               ImageWriter::OutputFormat_t &outputFmt)
 {
     for (auto &outfDescr: Utils::Vars::outputFormatDescription)
         if (filterName == outfDescr.name)
         {
-            outputFmt = outfDescr.skryOutpFmt;
+            outputFmt = outfDescr.outputFmt;
             return;
         }
 
@@ -346,12 +698,14 @@ void GetOutputFormatFromFilter(Glib::ustring filterName,
 
 void c_MainWindow::OnSaveStackedImage()
 {
-    SaveImage(GetCurrentJob().stackedImg, _("Save stacked image"), true);
+    if (auto img = GetCurrentJob().stackedImg.Get())
+        SaveImage(*img, _("Save stacked image"), true);
 }
 
 void c_MainWindow::OnSaveBestFragmentsImage()
 {
-    SaveImage(GetCurrentJob().bestFragmentsImg, _("Save best fragments composite"), false);
+    if (auto img = GetCurrentJob().bestFragmentsImg.Get())
+        SaveImage(*img, _("Save best fragments composite"), false);
 }
 
 void c_MainWindow::SaveImage(const libskry::c_Image &img, const Glib::ustring &dlgTitle, bool preselectHiBitDephtFilter)
@@ -371,7 +725,7 @@ void c_MainWindow::SaveImage(const libskry::c_Image &img, const Glib::ustring &d
         filter->set_name(filterName);
         dlg.add_filter(filter);
 
-        if (preselectHiBitDephtFilter && !hiBitDepthFilterSelected && OUTPUT_FMT_BITS_PER_CHANNEL[outFmt.skryOutpFmt] >= 16)
+        if (preselectHiBitDephtFilter && !hiBitDepthFilterSelected && ImageWriter::GetBitsPerChannel(outFmt.outputFmt) >= 16)
         {
             dlg.set_filter(filter);
             hiBitDepthFilterSelected = true;
@@ -381,13 +735,11 @@ void c_MainWindow::SaveImage(const libskry::c_Image &img, const Glib::ustring &d
     PrepareDialog(dlg);
     if (dlg.run() == Gtk::ResponseType::RESPONSE_OK)
     {
-        enum SKRY_output_format outpFmt;
+        ImageWriter::OutputFormat_t outpFmt;
 
         GetOutputFormatFromFilter(dlg.get_filter()->get_name(), outpFmt);
-        enum SKRY_pixel_format pixFmt = Utils::FindMatchingFormat(outpFmt, NUM_CHANNELS[img.GetPixelFormat()]);
-        libskry::c_Image finalImg = libskry::c_Image::ConvertPixelFormat(img, pixFmt);
         enum SKRY_result result;
-        if (SKRY_SUCCESS != (result = finalImg.Save(dlg.get_filename().c_str(), outpFmt)))
+        if (SKRY_SUCCESS != (result = ImageWriter::Save(img, dlg.get_filename(), outpFmt)))
         {
             std::cout << "Failed to save image" << std::endl;
 
@@ -423,49 +775,54 @@ void c_MainWindow::UpdateActionsState()
     for (auto &action: { ActionName::pauseResumeProcessing,
                          ActionName::stopProcessing })
     {
-        m_ActionGroup->get_action(action)->set_sensitive(Worker::IsRunning());
+        m_ActionGroup->get_action(action)->set_sensitive(IsProcessing());
     }
 
     for (auto &action: { ActionName::addFolders,
                          ActionName::addImages,
-                         ActionName::addVideos })
+                         ActionName::addVideos,
+                         ActionName::watchFolder,
+                         ActionName::watchVideo })
     {
-        m_ActionGroup->get_action(action)->set_sensitive(!Worker::IsRunning());
+        m_ActionGroup->get_action(action)->set_sensitive(!IsProcessing());
     }
 
-    m_ActionGroup->get_action(ActionName::startProcessing)->set_sensitive(numSelJobs > 0 && !Worker::IsRunning());
+    m_ActionGroup->get_action(ActionName::startProcessing)->set_sensitive(numSelJobs > 0 && !IsProcessing());
 
     for (auto &action: { ActionName::setAnchors,
+                         ActionName::setRoi,
                          ActionName::selectFrames })
     {
         m_ActionGroup->get_action(action)->set_sensitive(
             numSelJobs == 1
             && GetJobsListFocusedRow()
-            && !(Worker::IsRunning() && m_RunningJob == m_Jobs.data->get_iter(GetJobsListFocusedRow()))
+            && !IsJobRunning(m_Jobs.data->get_iter(GetJobsListFocusedRow()))
         );
     }
 
     m_ActionGroup->get_action(ActionName::settings)->set_sensitive(numSelJobs > 0);
-    m_ActionGroup->get_action(ActionName::removeJobs)->set_sensitive(numSelJobs > 0 && !Worker::IsRunning());
+    m_ActionGroup->get_action(ActionName::removeJobs)->set_sensitive(numSelJobs > 0 && !IsProcessing());
 
     bool oneJobSelected = (numSelJobs == 1 && GetJobsListFocusedRow());
 
-    { LOCK();
-        m_ActionGroup->get_action(ActionName::saveStackedImage)->set_sensitive(
-            oneJobSelected && GetCurrentJob().stackedImg);
+    m_ActionGroup->get_action(ActionName::saveStackedImage)->set_sensitive(
+        oneJobSelected && GetCurrentJob().stackedImg.Get());
 
-        m_ActionGroup->get_action(ActionName::saveBestFragmentsImage)->set_sensitive(
-            oneJobSelected && GetCurrentJob().bestFragmentsImg);
+    m_ActionGroup->get_action(ActionName::saveBestFragmentsImage)->set_sensitive(
+        oneJobSelected && GetCurrentJob().bestFragmentsImg.Get());
 
-        m_ActionGroup->get_action(ActionName::exportQualityData)->set_sensitive(
-            oneJobSelected && !GetCurrentJob().quality.framesChrono.empty()
-        );
-    }
+    m_ActionGroup->get_action(ActionName::exportQualityData)->set_sensitive(
+        oneJobSelected && GetCurrentJob().quality.data.Get()
+    );
+
+    m_ActionGroup->get_action(ActionName::showProfile)->set_sensitive(
+        oneJobSelected && GetCurrentJob().profile.Get());
 }
 
 void c_MainWindow::OnSelectFrames()
 {
-    c_FrameSelectDlg dlg(GetCurrentJob().imgSeq);
+    std::shared_ptr<const QualityData_t> quality = GetCurrentJob().quality.data.Get();
+    c_FrameSelectDlg dlg(GetCurrentJob().imgSeq, GetCurrentJob().frameCacheId, quality ? quality->framesChrono : std::vector<SKRY_quality_t>());
     PrepareDialog(dlg);
     do
     {
@@ -484,8 +841,7 @@ void c_MainWindow::OnSelectFrames()
                 // after image alignment, so old ref. points may be invalid
                 job.refPoints.clear();
 
-                job.quality.framesChrono.clear();
-                job.quality.framesSorted.clear();
+                job.quality.data.Reset();
                 m_QualityWnd.Update();
 
                 break;
@@ -498,28 +854,6 @@ void c_MainWindow::OnSelectFrames()
     GetCurrentJob().imgSeq.Deactivate();
 }
 
-void c_MainWindow::SetDefaultSettings(Job_t &job)
-{
-    assert(job.imgSeq);
-
-    job.outputSaveMode = Utils::Const::Defaults::saveMode;
-    job.outputFmt = Utils::Const::Defaults::outputFmt;
-    job.alignmentMethod = Utils::Const::Defaults::alignmentMethod;
-    job.refPtAutoPlacementParams.spacing = Utils::Const::Defaults::referencePointSpacing;
-    job.refPtAutoPlacementParams.brightnessThreshold = Utils::Const::Defaults::placementBrightnessThreshold;
-    job.refPtAutoPlacementParams.structureScale = Utils::Const::Defaults::refPtStructureScale;
-    job.refPtAutoPlacementParams.structureThreshold = Utils::Const::Defaults::refPtStructureThreshold;
-    job.quality.criterion = Utils::Const::Defaults::qualityCriterion;
-    job.quality.threshold = Utils::Const::Defaults::qualityThreshold;
-    job.automaticRefPointsPlacement = true;
-    job.automaticAnchorPlacement = true;
-    job.cfaPattern = SKRY_CFA_NONE;
-    job.refPtBlockSize = Utils::Const::Defaults::refPtRefBlockSize;
-    job.refPtSearchRadius = Utils::Const::Defaults::refPtSearchRadius;
-    job.exportQualityData = false;
-    job.qualityDataReadyNotification = false;
-}
-
 void c_MainWindow::OnAddVideos()
 {
     Gtk::FileChooserDialog dlg(*this, _("Add video(s)"), Gtk::FileChooserAction::FILE_CHOOSER_ACTION_OPEN);
@@ -548,35 +882,10 @@ void c_MainWindow::OnAddVideos()
     PrepareDialog(dlg);
     if (Gtk::ResponseType::RESPONSE_OK == dlg.run())
     {
+        // The jobs are appended in OnJobsLoaded()
         for (auto &fname: dlg.get_filenames())
-        {
-            enum SKRY_result result;
-            std::shared_ptr<Job_t> newJob = std::make_shared<Job_t>(Job_t { libskry::c_ImageSequence::InitVideoFile(fname.c_str(), &result) });
-            if (!newJob->imgSeq)
-            {
-                ShowMsg(dlg, _("Error"),
-                        Glib::ustring::compose(_("Could not open video file %1:\n%2"),
-                                         fname.c_str(), Utils::GetErrorMsg(result)),
-                        Gtk::MessageType::MESSAGE_ERROR);
-                continue;
-            }
-
-            newJob->sourcePath = fname;
-            SetDefaultSettings(*newJob);
-
-            if (!newJob->imgSeq)
-            {
-                std::cout << "Failed to initialize image sequence." << std::endl;
-            }
-            else
-            {
-                auto row = *m_Jobs.data->append();
-                row[m_Jobs.columns.jobSource] = newJob->sourcePath;
-                row[m_Jobs.columns.state]     = _("Waiting");
-                row[m_Jobs.columns.progressText] = "";
-                row[m_Jobs.columns.job]       = newJob;
-            }
-        }
+            m_JobLoader.Submit({ c_JobLoader::InputType::VIDEO, fname, { } });
+        OnJobsLoaded(); // shows the loading status
     }
     Configuration::LastOpenDir = dlg.get_current_folder();
 }
@@ -598,6 +907,10 @@ void c_MainWindow::InitActions()
                   sigc::mem_fun(*this, &c_MainWindow::OnAddFolders));
     m_ActionGroup->add(Gtk::Action::create(ActionName::addVideos, _("Add video(s)..."), _("Add video(s)...")),
                   sigc::mem_fun(*this, &c_MainWindow::OnAddVideos));
+    m_ActionGroup->add(Gtk::Action::create(ActionName::watchFolder, _("Watch folder (live stacking)...")),
+                  sigc::bind(sigc::mem_fun(*this, &c_MainWindow::OnWatchCapture), true));
+    m_ActionGroup->add(Gtk::Action::create(ActionName::watchVideo, _("Watch SER video (live stacking)...")),
+                  sigc::bind(sigc::mem_fun(*this, &c_MainWindow::OnWatchCapture), false));
     m_ActionGroup->add(Gtk::Action::create(ActionName::saveStackedImage, _("Save stacked image...")),
                   sigc::mem_fun(*this, &c_MainWindow::OnSaveStackedImage));
     m_ActionGroup->add(Gtk::Action::create(ActionName::saveBestFragmentsImage, _("Save best fragments composite...")),
@@ -609,6 +922,8 @@ void c_MainWindow::InitActions()
     m_ActionGroup->add(Gtk::Action::create(WidgetName::MenuEdit, _("_Edit")));
     m_ActionGroup->add(Gtk::Action::create(ActionName::setAnchors, _("Set video stabilization anchors...")),
                   sigc::mem_fun(*this, &c_MainWindow::OnSetAnchors));
+    m_ActionGroup->add(Gtk::Action::create(ActionName::setRoi, _("Set region of interest...")),
+                  sigc::mem_fun(*this, &c_MainWindow::OnSetRoi));
     m_ActionGroup->add(Gtk::Action::create(ActionName::selectFrames, _("Select frames...")),
                   sigc::mem_fun(*this, &c_MainWindow::OnSelectFrames));
     m_ActionGroup->add(Gtk::Action::create(ActionName::settings, _("Processing settings..."),
@@ -620,6 +935,8 @@ void c_MainWindow::InitActions()
                   sigc::mem_fun(*this, &c_MainWindow::OnPreferences));
     m_ActionGroup->add(Gtk::Action::create(ActionName::exportQualityData, _("Export frame quality data...")),
                   sigc::mem_fun(*this, &c_MainWindow::OnExportQualityData));
+    m_ActionGroup->add(Gtk::Action::create(ActionName::showProfile, _("Show processing profile...")),
+                  sigc::mem_fun(*this, &c_MainWindow::OnShowProfile));
 
     m_ActionGroup->add(Gtk::Action::create(WidgetName::MenuProcessing, _("_Processing")));
     m_ActionGroup->add(Gtk::Action::create(ActionName::startProcessing, _("Start processing"),
@@ -651,7 +968,9 @@ void c_MainWindow::InitActions()
     "        <menu action='" + WidgetName::MenuFile + "'>"
     "            <menuitem action='" + ActionName::addVideos + "' />"
     "            <menuitem action='" + ActionName::addImages + "' />"
-    //"            <menuitem action='" + ActionName::addFolders + "' />"  TODO: implement this
+    "            <menuitem action='" + ActionName::addFolders + "' />"
+    "            <menuitem action='" + ActionName::watchFolder + "' />"
+    "            <menuitem action='" + ActionName::watchVideo + "' />"
     "            <menuitem action='" + ActionName::saveStackedImage + "' />"
     "            <menuitem action='" + ActionName::saveBestFragmentsImage + "' />"
     "            <menuitem action='" + ActionName::exportQualityData + "' />"
@@ -664,6 +983,7 @@ void c_MainWindow::InitActions()
     "            <menuitem action='" + ActionName::selectFrames + "' />"
     "            <menuitem action='" + ActionName::settings + "' />"
     "            <menuitem action='" + ActionName::setAnchors + "' />"
+    "            <menuitem action='" + ActionName::setRoi + "' />"
     "            <separator />"
     "            <menuitem action='" + ActionName::removeJobs + "' />"
     "            <separator />"
@@ -706,9 +1026,11 @@ void c_MainWindow::InitActions()
     "        <menuitem action='" + ActionName::selectFrames + "' />"
     "        <menuitem action='" + ActionName::settings + "' />"
     "        <menuitem action='" + ActionName::setAnchors + "' />"
+    "        <menuitem action='" + ActionName::setRoi + "' />"
     "        <menuitem action='" + ActionName::saveStackedImage + "' />"
     "        <menuitem action='" + ActionName::saveBestFragmentsImage + "' />"
     "        <menuitem action='" + ActionName::exportQualityData + "' />"
+    "        <menuitem action='" + ActionName::showProfile + "' />"
     "        <separator/>"
     "        <menuitem action='" + ActionName::removeJobs + "'/>"
     "    </popup>"
@@ -732,19 +1054,16 @@ void c_MainWindow::OnJobCursorChanged()
     {
         m_QualityWnd.SetJob(GetCurrentJobPtr());
 
-        { LOCK();
-
-            const Job_t &job = GetCurrentJob();
-            switch(m_OutputView.GetOutputImgType())
-            {
-            case OutputImgType::Stack:
-                m_OutputView.SetImage(job.stackedImg);
-                break;
+        const Job_t &job = GetCurrentJob();
+        switch(m_OutputView.GetOutputImgType())
+        {
+        case OutputImgType::Stack:
+            m_OutputView.SetImage(GetStackToShow(job));
+            break;
 
-            case OutputImgType::BestFragments:
-                m_OutputView.SetImage(job.bestFragmentsImg);
-                break;
-            }
+        case OutputImgType::BestFragments:
+            m_OutputView.SetImage(job.bestFragmentsImg.Get());
+            break;
         }
     }
     else
@@ -775,7 +1094,7 @@ void c_MainWindow::CreateJobsListView()
     m_Jobs.view.signal_cursor_changed().connect(sigc::mem_fun(*this, &c_MainWindow::OnJobCursorChanged));
     m_Jobs.view.get_selection()->signal_changed().connect(sigc::mem_fun(*this, &c_MainWindow::OnSelectionChanged));
 
-    m_Jobs.view.set_tooltip_column(m_Jobs.columns.jobSource.index());
+    m_Jobs.view.set_tooltip_column(m_Jobs.columns.tooltip.index());
     m_Jobs.view.get_selection()->set_mode(Gtk::SelectionMode::SELECTION_MULTIPLE);
 
     m_Jobs.view.get_column(0)->set_fixed_width(Configuration::JobColWidth);
@@ -818,7 +1137,7 @@ void c_MainWindow::UpdateOutputViewZoomControlsState()
     m_OutputView.SetZoomControlsEnabled(
             m_OutputView.GetOutputImgType() != OutputImgType::Visualization
             ||
-            Worker::IsRunning() && m_ActVisualization->get_active());
+            IsProcessing() && m_ActVisualization->get_active());
 }
 
 void c_MainWindow::SetStatusBarText(const Glib::ustring &text)
@@ -827,199 +1146,334 @@ void c_MainWindow::SetStatusBarText(const Glib::ustring &text)
     m_StatusBar.push(text);
 }
 
-void c_MainWindow::AutoSaveStack(const Job_t &job)
+void c_MainWindow::OnWorkerNotification()
 {
-    assert(job.stackedImg);
-
-    enum SKRY_pixel_format pixFmt = Utils::FindMatchingFormat(job.outputFmt, NUM_CHANNELS[job.stackedImg.GetPixelFormat()]);
-    libskry::c_Image convImg = libskry::c_Image::ConvertPixelFormat(job.stackedImg, pixFmt);
-
-    std::string destDir = GetDestDir(job);
-
-    std::string destFName = (job.imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES
-                                ? "stack"
-                                : Glib::path_get_basename(job.sourcePath) + "_stacked");
-    std::string destExt = Utils::GetOutputFormatDescr(job.outputFmt).defaultExtension;
+    // Notifications from all workers received within one UI frame are handled by a single OnWorkerProgress() call
+    if (m_WorkerProgressScheduled)
+        return;
 
-    unsigned replaceCounter = 0;
-    while (Glib::file_test(Glib::build_filename(destDir, destFName +
-                            (replaceCounter ? (std::string)Glib::ustring::format(replaceCounter) + destExt : destExt)),
-                           Glib::FileTest::FILE_TEST_EXISTS))
-    {
-        replaceCounter++;
-    }
+    m_WorkerProgressScheduled = true;
+    const double sinceLast = m_SinceLastWorkerProgress.elapsed();
+    const unsigned delayMs = (sinceLast >= UI_FRAME_INTERVAL ? 0 : (unsigned)((UI_FRAME_INTERVAL - sinceLast) * 1000));
 
-    std::string destPath = Glib::build_filename(destDir, destFName +
-                            (replaceCounter ? (std::string)Glib::ustring::format(replaceCounter) + destExt : destExt));
-    if (SKRY_SUCCESS != convImg.Save(destPath.c_str(), job.outputFmt))
-    {
-        std::cout << "Could not save stack as " << destPath << std::endl;
-    }
+    Glib::signal_timeout().connect(sigc::slot<bool>(
+        [this]()
+        {
+            m_WorkerProgressScheduled = false;
+            m_SinceLastWorkerProgress.reset();
+            OnWorkerProgress();
+            return false;
+        }), delayMs);
 }
 
-std::string c_MainWindow::GetDestDir(const Job_t &job) const
+void c_MainWindow::ResumeWorkerProgress()
 {
-    if (job.outputSaveMode == Utils::Const::OutputSaveMode::SOURCE_PATH)
+    if (m_WorkerProgressDeferred)
     {
-        return (job.imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES
-                ? job.sourcePath
-                : Glib::path_get_dirname(job.sourcePath));
+        m_WorkerProgressDeferred = false;
+        OnWorkerNotification();
     }
-    else
-        return job.destDir;
 }
 
 void c_MainWindow::OnWorkerProgress()
 {
-    LOCK();
-
-    if (!m_RunningJob)
+    if (m_RunningJobs.empty())
         return; // an outdated notification, ignore
 
-    // As of GTK 3.22 on Linux, something got broken in Glib::Dispatcher() - calling Gtk::Dialog::run() (to have the user
-    // set the reference points manually) from OnWorkerProgress() causes a recursive entry into OnWorkerProgress() from
+    // As of GTK 3.22 on Linux, something got broken in Glib::Dispatcher() - calling Gtk::Dialog::run() (e.g. to have the user
+    // set the anchors of a queued job) from OnWorkerProgress() causes a recursive entry into OnWorkerProgress() from
     // the new dialog's main loop.
     // Prevent this via an additional bool flag:
-    if (m_HandlingManualRefPoints)
+    if (m_HandlingModalDialog)
+    {
+        // The workers' notifications remain unacknowledged; handle them once the dialog closes
+        m_WorkerProgressDeferred = true;
         return;
+    }
 
-    // Update "Save stacked image", "Save best fragments composite image", "Export quality data"
-    // actions' state
-    UpdateActionsState();
+    bool stateChanged = false;
+    for (auto &runningJob: m_RunningJobs)
+    {
+        // Acknowledge before checking the state, so that any later change causes a new notification
+        runningJob.worker->AcknowledgeNotification();
+
+        if (runningJob.worker->GetPhase() != runningJob.lastPhase || !runningJob.worker->IsRunning())
+            stateChanged = true;
+    }
 
-    if (m_RunningJob)
+    for (auto &runningJob: m_RunningJobs)
     {
-        Job_t &job = GetJobAt(m_RunningJob);
+        Job_t &job = GetJobAt(runningJob.row);
+        if (job.partialQualityDataNotification)
+        {
+            job.partialQualityDataNotification = false;
+            m_QualityWnd.Update();
+        }
+
+        if (job.cachedQualityDataNotification)
+        {
+            job.cachedQualityDataNotification = false;
+            m_QualityWnd.Update();
+            UpdateActionsState();
+        }
+
         if (job.qualityDataReadyNotification)
         {
+            stateChanged = true;
             job.qualityDataReadyNotification = false;
 
             m_QualityWnd.Update();
             UpdateActionsState();
 
             if (job.exportQualityData)
-            {
-                std::string destDir = GetDestDir(job);
-                std::string destFName = "frame_quality";
-
-                // For video files, prepend with the source file name
-                if (job.imgSeq.GetType() != SKRY_IMG_SEQ_IMAGE_FILES)
-                    destFName = Glib::path_get_basename(job.sourcePath) + "_" + destFName;
-
-                std::string destPath = Glib::build_filename(destDir, destFName + ".txt");
-
-                ExportQualityData(destPath, job);
-            }
+                m_OutputWriter.Submit(GetJobPtrAt(runningJob.row), _("frame quality data"),
+                                      Job::PrepareQualityDataExport(Job::GetQualityDataPath(job), job,
+                                                                    Configuration::ExportInactiveFramesQuality));
         }
     }
 
 
-    if (GetJobsListFocusedRow())
+    if (stateChanged)
+    {
+        // Update "Save stacked image", "Save best fragments composite image", "Export quality data"
+        // actions' state
+        UpdateActionsState();
+    }
+
+    // The output images change only together with the processing phase
+    if (stateChanged && GetJobsListFocusedRow())
     {
         const Job_t &job = GetCurrentJob();
 
         switch (m_OutputView.GetOutputImgType())
         {
         case OutputImgType::Stack:
-            m_OutputView.SetImage(job.stackedImg);
+            m_OutputView.SetImage(GetStackToShow(job));
             break;
 
         case OutputImgType::BestFragments:
-            m_OutputView.SetImage(job.bestFragmentsImg);
+            m_OutputView.SetImage(job.bestFragmentsImg.Get());
             break;
         }
     }
 
-    if (Worker::IsWaitingForReferencePoints())
+    bool anyJobStartedWaiting = false;
+    for (auto &runningJob: m_RunningJobs)
     {
-        m_HandlingManualRefPoints = true;
-        struct Job_t &job = GetJobAt(*m_RunningJob);
-        c_SelectPointsDlg dlg(Worker::GetBestQualityAlignedImage(), job.refPoints, { });
-        dlg.set_title(_("Set reference points"));
-        dlg.SetInfoText(_("Place reference points by left-clicking on the image. Avoid blank areas "
-                        "with little or no detail. Click Cancel to set points automatically."));
-        PrepareDialog(dlg);
-        Utils::RestorePosSize(Configuration::SelectRefPointsDlgPosSize, dlg);
-        auto response = dlg.run();
-        if (response == Gtk::ResponseType::RESPONSE_OK)
-            dlg.GetPoints(job.refPoints);
-        else
-            job.automaticRefPointsPlacement = true;
-
-        Worker::NotifyReferencePointsSet();
-        Utils::SavePosSize(dlg, Configuration::SelectRefPointsDlgPosSize);
-        m_HandlingManualRefPoints = false;
+        if (runningJob.worker->IsWaitingForReferencePoints() && !runningJob.refPtDlg)
+        {
+            ShowRefPointsDialog(runningJob);
+            anyJobStartedWaiting = true;
+        }
     }
+    if (anyJobStartedWaiting)
+    {
+        StartQueuedJobs();
+    }
+
+    RunningJob_t *visualizedJob = GetVisualizedJob();
 
-    if (Worker::GetStep() != m_LastStepNotify)
+    for (auto &runningJob: m_RunningJobs)
     {
-        if (Worker::IsVisualizationEnabled() && m_OutputView.GetOutputImgType() == OutputImgType::Visualization)
-            if (Worker::GetVisualizationImage())
-                m_OutputView.SetImage(Worker::GetVisualizationImage());
-
-        (*m_RunningJob)[m_Jobs.columns.state] = Worker::GetProcPhaseStr(Worker::GetPhase());
-        (*m_RunningJob)[m_Jobs.columns.progress] = Worker::GetStep();
-        (*m_RunningJob)[m_Jobs.columns.percentageProgress] =
-            100*Worker::GetStep() / GetJobAt(m_RunningJob).imgSeq.GetActiveImageCount();
-        (*m_RunningJob)[m_Jobs.columns.progressText] =
-            Glib::ustring::format(Worker::GetStep(), "/", GetJobAt(m_RunningJob).imgSeq.GetActiveImageCount());
-
-        SetStatusBarText((*m_RunningJob)[m_Jobs.columns.jobSource] + " \u2013 " +        // /u2013 = N-dash
-                        Worker::GetProcPhaseStr(Worker::GetPhase()) + ", " + _("step") +
-                         " " + (*m_RunningJob)[m_Jobs.columns.progressText]);
-
-        m_LastStepNotify = Worker::GetStep();
+        Worker::c_Worker &worker = *runningJob.worker;
+
+        // Visualization images are rendered asynchronously, so check for a new one regardless of the step
+        if (&runningJob == visualizedJob && worker.GetVisualizationImageId() != runningJob.lastVisualizationId &&
+            Worker::IsVisualizationEnabled() && m_OutputView.GetOutputImgType() == OutputImgType::Visualization)
+        {
+            runningJob.lastVisualizationId = worker.GetVisualizationImageId();
+            ShowVisualizationImage(worker.GetVisualizationImage());
+        }
+
+        const Worker::Progress_t progress = worker.GetProgress();
+        if (progress.step != runningJob.lastStepNotify || progress.phase != runningJob.lastPhase)
+        {
+            const Gtk::ListStore::iterator &row = runningJob.row;
+
+            if (progress.phase != runningJob.lastPhase)
+                (*row)[m_Jobs.columns.state] = Worker::GetProcPhaseStr(progress.phase);
+            (*row)[m_Jobs.columns.progress] = progress.step;
+            (*row)[m_Jobs.columns.percentageProgress] =
+                100*progress.step / GetJobAt(row).imgSeq.GetActiveImageCount();
+            (*row)[m_Jobs.columns.progressText] =
+                Glib::ustring::format(progress.step, "/", GetJobAt(row).imgSeq.GetActiveImageCount());
+
+            runningJob.lastStepNotify = progress.step;
+            runningJob.lastPhase = progress.phase;
+        }
     }
-    if (!Worker::IsRunning())
+
+    if (visualizedJob)
     {
-        SetStatusBarText(_("Idle"));
+        const Gtk::ListStore::iterator &row = visualizedJob->row;
+        const Worker::Progress_t progress = visualizedJob->worker->GetProgress();
+        Glib::ustring statusText = (*row)[m_Jobs.columns.jobSource] + " \u2013 " +        // /u2013 = N-dash
+                                   Worker::GetProcPhaseStr(progress.phase) + ", " + _("step") +
+                                   " " + (*row)[m_Jobs.columns.progressText];
+        if (progress.framesPerSec > 0)
+            statusText += Glib::ustring::compose(_(" (%1 frames/s)"),
+                                                 Glib::ustring::format(std::fixed, std::setprecision(1), progress.framesPerSec));
+        if (m_RunningJobs.size() > 1)
+            statusText += Glib::ustring::compose(_(" (%1 jobs in progress)"), m_RunningJobs.size());
+
+        SetStatusBarText(statusText);
+    }
 
-        (*m_RunningJob)[m_Jobs.columns.progress] = 0;
-        (*m_RunningJob)[m_Jobs.columns.percentageProgress] = 0;
-        (*m_RunningJob)[m_Jobs.columns.progressText] = "";
-        if (Worker::GetLastResult() == SKRY_SUCCESS ||
-            Worker::GetLastResult() == SKRY_LAST_STEP)
+    bool anyJobFinished = false;
+    for (auto runningJob = m_RunningJobs.begin(); runningJob != m_RunningJobs.end(); )
+    {
+        Worker::c_Worker &worker = *runningJob->worker;
+        if (worker.IsRunning())
         {
-            (*m_RunningJob)[m_Jobs.columns.state] = _("Processed");
+            runningJob++;
+            continue;
         }
-        else
-            (*m_RunningJob)[m_Jobs.columns.state] = Glib::ustring::compose(_("Error: %1"), Utils::GetErrorMsg(Worker::GetLastResult()));
 
-        Worker::WaitUntilFinished();
+        const Gtk::ListStore::iterator &row = runningJob->row;
 
-        Job_t &job = GetJobAt(m_RunningJob);
-        job.imgSeq.Deactivate();
+        ResetJobRow(row);
+        if (worker.GetLastResult() == SKRY_SUCCESS ||
+            worker.GetLastResult() == SKRY_LAST_STEP)
+        {
+            (*row)[m_Jobs.columns.state] = _("Processed");
+        }
+        else
+            (*row)[m_Jobs.columns.state] = Glib::ustring::compose(_("Error: %1"), Utils::GetErrorMsg(worker.GetLastResult()));
 
-        if (job.outputSaveMode != Utils::Const::OutputSaveMode::NONE && job.stackedImg)
-            AutoSaveStack(job);
+        worker.WaitUntilFinished();
 
+        Job_t &job = GetJobAt(row);
         job.imgSeq.Deactivate();
 
-        if (m_JobsToProcess.empty())
+        if (job.live)
         {
-            m_RunningJob = Gtk::ListStore::iterator(nullptr);
+            // A batch which failed is skipped; the job keeps showing the running stack
+            c_RunningStack &runningStack = job.live->GetStack();
+            if (job.stackedImg.Get())
+                runningStack.Add(*job.stackedImg.Get(), job.imgSeq.GetActiveImageCount(), job.alignmentMethod);
+            job.stackedImg.Publish(runningStack.GetImage());
+            job.live->SetBatchPending(false);
+
+            if (job.live->IsWatching())
+                (*row)[m_Jobs.columns.state] = Glib::ustring::compose(_("Watching (%1 frames stacked)"), runningStack.GetNumFrames());
+
+            if (GetJobsListFocusedRow() == m_Jobs.data->get_path(row) &&
+                m_OutputView.GetOutputImgType() == OutputImgType::Stack)
+            {
+                m_OutputView.SetImage(job.stackedImg.Get());
+            }
         }
-        else
+
+        // The outputs are written in background; the state is updated in OnOutputWritten()
+        if (job.outputSaveMode != Utils::Const::OutputSaveMode::NONE && job.stackedImg.Get())
+            m_OutputWriter.Submit(GetJobPtrAt(row), _("stack"), Job::PrepareStackSaving(job));
+
+        if (job.exportQualityData && job.profile.Get())
+            m_OutputWriter.Submit(GetJobPtrAt(row), _("processing profile"),
+                                  Job::PrepareProfileExport(Job::GetProfilePath(job), job));
+
+        if (m_OutputWriter.IsPending(job) && !job.live &&
+            (worker.GetLastResult() == SKRY_SUCCESS || worker.GetLastResult() == SKRY_LAST_STEP))
         {
-            m_RunningJob = m_Jobs.data->get_iter(m_JobsToProcess.front());
-            m_JobsToProcess.pop();
-            Job_t &job = GetJobAt(m_RunningJob);
-            bool startNextJob = true;
-            if (job.anchors.empty() && !job.automaticAnchorPlacement)
-                if (!SetAnchors(job))
-                    startNextJob = false;
-
-            if (startNextJob)
-                Worker::StartProcessing(&job);
+            (*row)[m_Jobs.columns.state] = _("Processed, saving...");
         }
 
+        runningJob = m_RunningJobs.erase(runningJob);
+        anyJobFinished = true;
+    }
+
+    if (anyJobFinished)
+    {
+        StartQueuedJobs();
+
+        if (m_RunningJobs.empty())
+            SetStatusBarText(_("Idle"));
+
         UpdateActionsState();
         UpdateOutputViewZoomControlsState();
     }
 }
 
+void c_MainWindow::OnOutputWritten()
+{
+    for (const c_OutputWriter::Result_t &result: m_OutputWriter.GetResults())
+    {
+        std::shared_ptr<Job_t> job = result.job.lock();
+        if (!job)
+            continue; // the job has been removed in the meantime
+
+        if (!result.success)
+            std::cerr << "Failed to write " << result.description << " of " << job->sourcePath << std::endl;
+
+        for (auto &row: m_Jobs.data->children())
+        {
+            if (GetJobPtrAt(row) != job)
+                continue;
+
+            // The state of a job which has been started again is left as it is
+            if (IsJobRunning(row))
+                break;
+
+            const Glib::ustring state = (*row)[m_Jobs.columns.state];
+            if (!result.success)
+                (*row)[m_Jobs.columns.state] = Glib::ustring::compose(_("Error: failed to write %1"), result.description);
+            else if (!m_OutputWriter.IsPending(*job) && state == _("Processed, saving..."))
+                (*row)[m_Jobs.columns.state] = _("Processed");
+
+            break;
+        }
+    }
+}
+
+void c_MainWindow::OnJobsLoaded()
+{
+    for (c_JobLoader::Result_t &result: m_JobLoader.GetResults())
+    {
+        if (!result.job)
+        {
+            m_JobLoadErrors.push_back(Glib::ustring::compose("%1:\n%2", result.request.path, result.errorMsg));
+            continue;
+        }
+
+        // Each row appears as soon as its input is opened, but the rows are kept in the order of adding
+        Gtk::ListStore::iterator before = m_Jobs.data->children().end();
+        for (Gtk::ListStore::iterator it = m_Jobs.data->children().begin(); it != m_Jobs.data->children().end(); ++it)
+            if ((uint64_t)(*it)[m_Jobs.columns.loadSeqNum] > result.seqNum)
+            {
+                before = it;
+                break;
+            }
+
+        Gtk::ListStore::iterator row = InsertJob(before, result.job, result.job->sourcePath);
+        (*row)[m_Jobs.columns.loadSeqNum] = result.seqNum;
+        (*row)[m_Jobs.columns.tooltip] = Glib::ustring::compose(_("%1\n%2 frames, %3\u00D7%4, %5 MiB when decoded"), // u00D7 = multiplication sign
+                                                               result.job->sourcePath, result.numFrames,
+                                                               result.width, result.height,
+                                                               result.footprintBytes / (1024*1024));
+    }
+
+    const size_t numPending = m_JobLoader.GetNumPending();
+    if (!IsProcessing())
+        SetStatusBarText(numPending > 0 ? Glib::ustring::compose(_("Opening inputs (%1 remaining)..."), numPending)
+                                        : Glib::ustring(_("Idle")));
+
+    if (numPending == 0 && !m_JobLoadErrors.empty())
+    {
+        // Reported at once instead of a message per input; ShowMsg() runs a main loop, which may call this function again
+        std::vector<Glib::ustring> errors;
+        errors.swap(m_JobLoadErrors);
+        Glib::ustring msg = _("Could not open:");
+        for (const Glib::ustring &error: errors)
+            msg += "\n\n" + error;
+
+        ShowMsg(*this, _("Error"), msg, Gtk::MessageType::MESSAGE_ERROR);
+    }
+}
+
 c_MainWindow::c_MainWindow()
-    : m_LastStepNotify(NONE)
+: m_OutputWriter(Utils::Const::outputWriterMaxPendingBytes,
+                 sigc::mem_fun(m_OutputWriterDispatcher, &Glib::Dispatcher::emit)),
+  m_JobLoader(Utils::Const::jobLoaderMaxThreads, sigc::mem_fun(m_JobLoaderDispatcher, &Glib::Dispatcher::emit))
 {
     set_title("Stackistry");
     set_border_width(Utils::Const::widgetPaddingInPixels);
@@ -1032,7 +1486,12 @@ c_MainWindow::c_MainWindow()
         maximize();
 
     signal_delete_event().connect(sigc::mem_fun(*this, &c_MainWindow::OnDelete));
-    Worker::ConnectProgressSignal(sigc::mem_fun(*this, &c_MainWindow::OnWorkerProgress));
+    m_WorkerDispatcher.connect(sigc::mem_fun(*this, &c_MainWindow::OnWorkerNotification));
+    m_OutputWriterDispatcher.connect(sigc::mem_fun(*this, &c_MainWindow::OnOutputWritten));
+    m_JobLoaderDispatcher.connect(sigc::mem_fun(*this, &c_MainWindow::OnJobsLoaded));
+    Glib::signal_timeout().connect(sigc::mem_fun(*this, &c_MainWindow::OnLiveCapturePoll),
+                                   Utils::Const::liveStackingPollIntervalMs);
+    FrameCache::SetBudget((size_t)Configuration::FrameCacheSizeMiB * 1024*1024);
 }
 
 void c_MainWindow::SetToolbarIcons()
@@ -1103,12 +1562,9 @@ void c_MainWindow::InitControls()
 
     m_OutputView.SetApplyZoom(false);
     m_OutputView.signal_ZoomChanged().connect(sigc::slot<void, int>(
-        [this](int zoomPercentVal)
-            {
-                if (Worker::IsRunning() && m_OutputView.GetOutputImgType() == OutputImgType::Visualization)
-                    Worker::SetZoomFactor(zoomPercentVal / 100.0, m_OutputView.GetInterpolationMethod());
-            }
+        [this](int) { UpdateVisualizationZoom(); }
     ));
+    m_OutputView.signal_VisibleAreaChanged().connect(sigc::mem_fun(*this, &c_MainWindow::UpdateVisualizationZoom));
     m_OutputView.signal_OutputImgTypeChanged().connect(sigc::mem_fun(*this, &c_MainWindow::OnOutputImgTypeChanged));
 
     UpdateOutputViewZoomControlsState();
@@ -1137,6 +1593,10 @@ void c_MainWindow::InitControls()
 
 c_MainWindow::~c_MainWindow()
 {
+    // Normally done by Finalize(); the workers must not notify 'm_WorkerDispatcher' once it is destroyed
+    for (auto &runningJob: m_RunningJobs)
+        runningJob.worker->AbortProcessing();
+    m_RunningJobs.clear();
 }
 
 bool c_MainWindow::OnDelete(GdkEventAny *event)
@@ -1188,6 +1648,13 @@ void c_MainWindow::OnPreferences()
 
         // The number of histogram bins might have changed
         m_QualityWnd.Update();
+
+        // The thread budget, visualization rate and the max. number of concurrent jobs might have changed
+        Worker::SetThreadBudget(Configuration::WorkerThreadBudget);
+        Worker::SetVisualizationMaxFps(Configuration::VisualizationMaxFps);
+        FrameCache::SetBudget((size_t)Configuration::FrameCacheSizeMiB * 1024*1024);
+        if (IsProcessing())
+            StartQueuedJobs();
     }
 }
 
@@ -1200,7 +1667,10 @@ void c_MainWindow::Finalize()
     Configuration::MainWndPanedPos = m_MainPaned.get_position();
     Utils::SavePosSize(m_QualityWnd, Configuration::QualityWndPosSize);
 
-    Worker::AbortProcessing(); //TODO: show message? status bar text? while waiting
+    //TODO: show message? status bar text? while waiting
+    for (auto &runningJob: m_RunningJobs)
+        runningJob.worker->AbortProcessing();
+    m_RunningJobs.clear();
 }
 
 void c_MainWindow::OnSelectionChanged()
@@ -1213,6 +1683,7 @@ void c_MainWindow::OnRemoveJobs()
     auto selRows = m_Jobs.view.get_selection()->get_selected_rows();
     for (auto job = selRows.rbegin(); job != selRows.rend(); job++)
     {
+        FrameCache::Invalidate(GetJobAt(*job).frameCacheId);
         m_Jobs.data->erase(m_Jobs.data->get_iter(*job));
     }
 }
@@ -1247,16 +1718,6 @@ void c_MainWindow::OnCreateFlatField()
             return;
         }
 
-        libskry::c_Image flatField = imgSeq.CreateFlatField(&result);
-        if (!flatField)
-        {
-            ShowMsg(dlgOpen, _("Error"),
-                    Glib::ustring::compose(_("Failed to create flat-field:\n%1"),
-                                     Utils::GetErrorMsg(result)),
-                    Gtk::MessageType::MESSAGE_ERROR);
-            return;
-        }
-
         Gtk::FileChooserDialog dlgSave(_("Save flat-field"), Gtk::FileChooserAction::FILE_CHOOSER_ACTION_SAVE);
         dlgSave.add_button(_("OK"), Gtk::ResponseType::RESPONSE_OK);
         dlgSave.add_button(_("Cancel"), Gtk::ResponseType::RESPONSE_CANCEL);
@@ -1275,18 +1736,22 @@ void c_MainWindow::OnCreateFlatField()
         PrepareDialog(dlgSave);
         if (dlgSave.run() == Gtk::ResponseType::RESPONSE_OK)
         {
-            enum SKRY_output_format outpFmt;
-            GetOutputFormatFromFilter(dlgSave.get_filter()->get_name(), outpFmt);
-            enum SKRY_pixel_format pixFmt = Utils::FindMatchingFormat(outpFmt, 1);
-            libskry::c_Image finalImg = libskry::c_Image::ConvertPixelFormat(flatField, pixFmt);
-            if (SKRY_SUCCESS != (result = finalImg.Save(dlgSave.get_filename().c_str(), outpFmt)))
-            {
-                ShowMsg(dlgSave, _("Error"),
-                        Glib::ustring::compose(_("Error saving %1:\n%2"),
-                                         dlgSave.get_filename().c_str(),
-                                         Utils::GetErrorMsg(result)),
-                        Gtk::MessageType::MESSAGE_ERROR);
-            }
+            // The flat-field is created in background like any other job
+            std::shared_ptr<Job_t> newJob = std::make_shared<Job_t>(Job_t { std::move(imgSeq) });
+            newJob->sourcePath = dlgOpen.get_filename();
+            Job::SetDefaultSettings(*newJob);
+            GetOutputFormatFromFilter(dlgSave.get_filter()->get_name(), newJob->outputFmt);
+            newJob->outputSaveMode = Utils::Const::OutputSaveMode::NONE;
+            newJob->exportQualityData = false;
+            newJob->flatFieldOutputFileName = dlgSave.get_filename();
+
+            Gtk::ListStore::iterator row = AppendJob(newJob, Glib::ustring::compose(_("Flat-field: %1"), dlgSave.get_filename()));
+            m_JobsToProcess.push(m_Jobs.data->get_path(row));
+            if (!IsProcessing())
+                ApplyWorkerSettings();
+            StartQueuedJobs();
+            UpdateActionsState();
+            UpdateOutputViewZoomControlsState();
         }
     }
 }
@@ -1297,6 +1762,7 @@ void c_MainWindow::OnAbout()
 #if defined(_OPENMP)
     numLogCpus = omp_get_num_procs();
 #endif
+    const unsigned peakMemMiB = Utils::GetPeakMemoryUsage() / (1024*1024);
 
     Gtk::MessageDialog msg(
         *this,
@@ -1314,7 +1780,8 @@ void c_MainWindow::OnAbout()
 
         "version %1.%2.%3 (%4).\n"), LIBSKRY_MAJOR_VERSION, LIBSKRY_MINOR_VERSION, LIBSKRY_SUBMINOR_VERSION, LIBSKRY_RELEASE_DATE) +
 
-        Glib::ustring::compose(_("Using %1 logical CPU(s).\n"), numLogCpus),
+        Glib::ustring::compose(_("Using %1 logical CPU(s).\n"), numLogCpus) +
+        (peakMemMiB > 0 ? Glib::ustring::compose(_("Peak memory usage: %1 MiB.\n"), peakMemMiB) : Glib::ustring()),
 
         true, Gtk::MessageType::MESSAGE_INFO, Gtk::ButtonsType::BUTTONS_OK, true);
 
@@ -1325,49 +1792,11 @@ void c_MainWindow::OnAbout()
     msg.run();
 }
 
-/// Returns 'false' on failure
-bool c_MainWindow::ExportQualityData(const std::string &fileName, const Job_t &job) const
+void c_MainWindow::OnShowProfile()
 {
-    bool success = false;
-
-    std::ofstream file(fileName.c_str());
-    if (!file.fail())
-    {
-        assert(!job.quality.framesChrono.empty());
-
-        file << "Stackistry " << VERSION_MAJOR << "." << VERSION_MINOR << "." << VERSION_SUBMINOR << "\n"
-             << "Normalized frame quality of \"" << job.sourcePath << "\"\n\n"
-             << "Frame;Active frame;Quality\n";
-
-        auto minmaxQuality = std::minmax_element(job.quality.framesChrono.begin(),
-                                                 job.quality.framesChrono.end());
-
-        double range = *minmaxQuality.second - *minmaxQuality.first;
-
-        const uint8_t *imgIsActive = job.imgSeq.GetImgActiveFlags();
-        bool exportInactive = Configuration::ExportInactiveFramesQuality;
-
-        size_t activeImgIdx = 0;
-        for (size_t i = 0; i < job.imgSeq.GetImageCount(); i++)
-        {
-            if (imgIsActive[i] || exportInactive)
-            {
-                file << i << ";";
-
-                if (imgIsActive[i])
-                {
-                    file << activeImgIdx << ";" << (job.quality.framesChrono[activeImgIdx] - *minmaxQuality.first) / range << "\n";
-                    activeImgIdx++;
-                }
-                else if (exportInactive)
-                    file << "-1;0\n";
-            }
-        }
-
-        success = !file.fail();
-    }
-
-    return success;
+    std::shared_ptr<const RunProfile_t> profile = GetCurrentJob().profile.Get();
+    if (profile)
+        ShowMsg(*this, _("Processing profile"), Job::FormatProfile(*profile), Gtk::MessageType::MESSAGE_INFO);
 }
 
 void c_MainWindow::OnExportQualityData()
@@ -1393,7 +1822,7 @@ void c_MainWindow::OnExportQualityData()
         Glib::ustring errorMsg = Glib::ustring::compose(_("Failed to export the quality data as %1."),
                                                         dlg.get_filename().c_str());
 
-        if (!ExportQualityData(dlg.get_filename(), GetCurrentJob()))
+        if (!Job::ExportQualityData(dlg.get_filename(), GetCurrentJob(), Configuration::ExportInactiveFramesQuality))
         {
             ShowMsg(*this, _("Error"),
                     Glib::ustring::compose(errorMsg, dlg.get_filename()),
@@ -1410,7 +1839,11 @@ void c_MainWindow::OnOutputImgTypeChanged()
     {
     case OutputImgType::Visualization:
         {
-            m_OutputView.SetImage(Worker::GetVisualizationImage(), false);
+            RunningJob_t *visualizedJob = GetVisualizedJob();
+            if (visualizedJob)
+                ShowVisualizationImage(visualizedJob->worker->GetVisualizationImage(), false);
+            else
+                m_OutputView.SetImage(Cairo::RefPtr<Cairo::ImageSurface>(nullptr), false);
             auto prevZoom = Worker::GetZoomFactor();
             m_OutputView.SetZoom(std::get<0>(prevZoom), std::get<1>(prevZoom));
         }
@@ -1418,14 +1851,14 @@ void c_MainWindow::OnOutputImgTypeChanged()
 
     case OutputImgType::Stack:
         if (GetJobsListFocusedRow())
-            m_OutputView.SetImage(GetCurrentJob().stackedImg);
+            m_OutputView.SetImage(GetStackToShow(GetCurrentJob()));
         else
             m_OutputView.RemoveImage();
         break;
 
     case OutputImgType::BestFragments:
         if (GetJobsListFocusedRow())
-            m_OutputView.SetImage(GetCurrentJob().bestFragmentsImg);
+            m_OutputView.SetImage(GetCurrentJob().bestFragmentsImg.Get());
         else
             m_OutputView.RemoveImage();
         break;
@@ -26,6 +26,8 @@ File description:
 
 #include <climits>
 #include <cstddef>
+#include <cstdint>
+#include <list>
 #include <memory>
 #include <queue>
 #include <string>
@@ -35,6 +37,7 @@ File description:
 #include <gdkmm/pixbuf.h>
 #include <glibmm/threads.h>
 #include <glibmm/dispatcher.h>
+#include <glibmm/timer.h>
 #include <gtkmm/actiongroup.h>
 #include <gtkmm/button.h>
 #include <gtkmm/image.h>
@@ -47,12 +50,17 @@ File description:
 #include <skry/skry_cpp.hpp>
 
 #include "job.h"
+#include "job_loader.h"
+#include "output_writer.h"
 #include "output_view.h"
 #include "quality_wnd.h"
+#include "worker.h"
 
 
 const size_t NONE = SIZE_MAX;
 
+class c_SelectPointsDlg;
+
 class c_MainWindow: public Gtk::Window
 {
 public:
@@ -79,6 +87,9 @@ private:
         Gtk::TreeModelColumn<size_t> progress;
         Gtk::TreeModelColumn<unsigned> percentageProgress;
         Gtk::TreeModelColumn<Glib::ustring> progressText;
+        Gtk::TreeModelColumn<Glib::ustring> tooltip;
+        /// Order of adding of the jobs opened by 'm_JobLoader' (see c_JobLoader::Result_t::seqNum); 0 for other jobs
+        Gtk::TreeModelColumn<uint64_t> loadSeqNum;
 
         // Another owner of the shared pointer can be 'm_QualityWnd'
         Gtk::TreeModelColumn<std::shared_ptr<Job_t>> job;
@@ -90,6 +101,8 @@ private:
             add(progress);
             add(percentageProgress);
             add(progressText);
+            add(tooltip);
+            add(loadSeqNum);
             add(job);
         }
     };
@@ -101,15 +114,52 @@ private:
         Gtk::TreeView                view;
     } m_Jobs;
 
-    /// Last step for which a notification has been received from worker; may equal NONE
-    size_t m_LastStepNotify;
+    struct RunningJob_t
+    {
+        Gtk::ListStore::iterator row;
+        std::shared_ptr<Worker::c_Worker> worker;
+
+        /// Last step for which a notification has been received from worker; may equal NONE
+        size_t lastStepNotify;
 
-    Gtk::ListStore::iterator m_RunningJob; ///< May be null
+        Worker::ProcPhase lastPhase;
+
+        /// Id of the last visualization image shown (see Worker::c_Worker::GetVisualizationImageId())
+        uint64_t lastVisualizationId;
+
+        /// Shown (non-modally) while the worker waits for reference points; null otherwise
+        std::shared_ptr<c_SelectPointsDlg> refPtDlg;
+    };
+
+    /// Receives (coalesced) progress notifications from all workers
+    /** Declared before 'm_RunningJobs', so that it outlives the workers (which notify it until they are joined). */
+    Glib::Dispatcher m_WorkerDispatcher;
+
+    /// Jobs being processed simultaneously (at most Configuration::MaxConcurrentJobs)
+    std::list<RunningJob_t> m_RunningJobs;
 
     std::queue<Gtk::TreeModel::Path> m_JobsToProcess;
 
-    /// True if handling of manual reference point selection is in progress
-    bool m_HandlingManualRefPoints = false;
+    /// Receives notifications of written outputs from 'm_OutputWriter'
+    Glib::Dispatcher m_OutputWriterDispatcher;
+    /// Saves the jobs' results, so that the next job can start right away
+    c_OutputWriter m_OutputWriter;
+
+    /// Receives notifications of loaded inputs from 'm_JobLoader'
+    Glib::Dispatcher m_JobLoaderDispatcher;
+    /// Opens the inputs of added jobs, so that adding many of them does not block the UI
+    c_JobLoader m_JobLoader;
+    /// Errors of the inputs loaded since the loader was last idle; reported together
+    std::vector<Glib::ustring> m_JobLoadErrors;
+
+    /// True if a modal dialog (e.g. anchor selection for a queued job, see StartQueuedJobs()) is being shown
+    bool m_HandlingModalDialog = false;
+
+    /// True if an OnWorkerProgress() call has been scheduled (see OnWorkerNotification())
+    bool m_WorkerProgressScheduled = false;
+    /// True if OnWorkerProgress() has been skipped while showing a modal dialog
+    bool m_WorkerProgressDeferred = false;
+    Glib::Timer m_SinceLastWorkerProgress;
 
 
     // Signal handlers -------------
@@ -117,12 +167,19 @@ private:
     void OnJobCursorChanged();
     bool OnJobBtnPressed(GdkEventButton *event);
     void OnAddFolders();
+    void OnWatchCapture(bool isFolder);
+    /// Queues the new frames of live stacking jobs; called periodically
+    bool OnLiveCapturePoll();
     void OnAddImageSeries();
+    void OnWorkerNotification();
     void OnWorkerProgress();
     void OnStartProcessing();
+    void OnOutputWritten();
+    void OnJobsLoaded();
     void OnStopProcessing();
     void OnPauseResumeProcessing();
     void OnSetAnchors();
+    void OnSetRoi();
     void OnSaveStackedImage();
     void OnSaveBestFragmentsImage();
     void SaveImage(const libskry::c_Image &img, const Glib::ustring &dlgTitle, bool preselectHiBitDephtFilter);
@@ -139,7 +196,9 @@ private:
     void OnQuit();
     void OnAbout();
     void OnExportQualityData();
+    void OnShowProfile();
     void OnOutputImgTypeChanged();
+    void OnRefPointsDlgResponse(int responseId, Worker::c_Worker *worker);
     //------------------------------
 
     Job_t &GetJobAt(const Gtk::TreeModel::Path &path);
@@ -149,24 +208,44 @@ private:
     void InitControls();
     void CreateJobsListView();
     void PrepareDialog(Gtk::Dialog &dlg);
-    void ClearRunningJobRef();
+    /// Appends 'job' to the jobs list
+    Gtk::ListStore::iterator AppendJob(const std::shared_ptr<Job_t> &job, const Glib::ustring &source);
+    /// Inserts a row before 'before' (which can be the end of the list)
+    Gtk::ListStore::iterator InsertJob(const Gtk::ListStore::iterator &before, const std::shared_ptr<Job_t> &job, const Glib::ustring &source);
+    /// Passes the output view's zoom settings and visible area to the visualization renderers
+    void UpdateVisualizationZoom();
+
+    void ShowVisualizationImage(const Worker::VisualizationImage_t &visImg, bool refresh = true);
+
+    /// Handles the worker progress skipped while 'm_HandlingModalDialog' was set
+    void ResumeWorkerProgress();
+
+    /// Passes the processing-related preferences to the workers
+    void ApplyWorkerSettings();
+    /// Returns the number of running jobs not waiting for the user to set reference points
+    size_t GetNumBusyJobs() const;
+    /// Starts queued jobs until Configuration::MaxConcurrentJobs jobs are running
+    /** Jobs waiting for the user to set reference points are not counted, but at most one job
+        more than Configuration::MaxConcurrentJobs is running in total. */
+    void StartQueuedJobs();
+    bool IsProcessing() const { return !m_RunningJobs.empty(); }
+    bool IsJobRunning(const Gtk::ListStore::iterator &iter) const;
+    /// Returns the job whose visualization is shown (the focused one, if running); may return null
+    RunningJob_t *GetVisualizedJob();
+    void ResetJobRow(const Gtk::ListStore::iterator &iter);
     void SetStatusBarText(const Glib::ustring &text);
     Gtk::TreeModel::Path GetJobsListFocusedRow();
     Job_t &GetCurrentJob();
     std::shared_ptr<Job_t> GetCurrentJobPtr();
     void SetToolbarIcons();
     Gtk::ToolButton *GetToolButton(const char *actionName);
-    void SetDefaultSettings(Job_t &job);
-    void AutoSaveStack(const Job_t &job);
-    bool SetAnchorsAutomatically(Job_t &job); ///< Returns false on failure
     /** Sets the enabled state of certain actions depending
         on current processing state and jobs list selection. */
     void UpdateActionsState();
     /// Returns 'false' if user canceled the selection
     bool SetAnchors(Job_t &job);
-    std::string GetDestDir(const Job_t &job) const;
-    /// Returns 'false' on failure
-    bool ExportQualityData(const std::string &fileName, const Job_t &job) const;
+    /// Shows the reference points selection dialog for a job whose worker is waiting for them
+    void ShowRefPointsDialog(RunningJob_t &runningJob);
     void UpdateOutputViewZoomControlsState();
 };
 
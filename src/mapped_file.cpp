@@ -0,0 +1,160 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Memory-mapped file implementation.
+*/
+
+#include <algorithm>
+#include <limits>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+
+#if !defined(_WIN32)
+
+bool c_MappedFile::Open(const std::string &fileName)
+{
+    Close();
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if (0 != fstat(fd, &fileStat) || fileStat.st_size <= 0 ||
+        (uint64_t)fileStat.st_size > std::numeric_limits<size_t>::max())
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after closing the descriptor
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    m_Data = static_cast<uint8_t *>(data);
+    m_Size = fileStat.st_size;
+    m_PageSize = sysconf(_SC_PAGESIZE);
+    return true;
+}
+
+void c_MappedFile::Close()
+{
+    if (m_Data)
+    {
+        munmap(m_Data, m_Size);
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+}
+
+void c_MappedFile::SetAccessPattern(AccessPattern pattern)
+{
+    if (!m_Data)
+        return;
+
+    int advice = MADV_NORMAL;
+    switch (pattern)
+    {
+        case AccessPattern::NORMAL:     advice = MADV_NORMAL; break;
+        case AccessPattern::SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+        case AccessPattern::RANDOM:     advice = MADV_RANDOM; break;
+    }
+    madvise(m_Data, m_Size, advice);
+}
+
+bool c_MappedFile::ClampRange(uint64_t &offset, uint64_t &length) const
+{
+    if (!m_Data || offset >= m_Size)
+        return false;
+
+    length = std::min(length, m_Size - offset);
+
+    const uint64_t pageOffset = offset % m_PageSize;
+    offset -= pageOffset;
+    length += pageOffset;
+
+    return length > 0;
+}
+
+uint64_t c_MappedFile::Load(uint64_t offset, uint64_t length)
+{
+    if (!ClampRange(offset, length))
+        return 0;
+
+    // Start reading the whole range, then wait for it by touching every page
+    madvise(m_Data + offset, length, MADV_WILLNEED);
+
+    volatile uint8_t sink = 0;
+    for (uint64_t pos = 0; pos < length; pos += m_PageSize)
+        sink += m_Data[offset + pos];
+    (void)sink;
+
+    return length;
+}
+
+void c_MappedFile::Release(uint64_t offset, uint64_t length)
+{
+    if (ClampRange(offset, length))
+    {
+        // For a shared read-only mapping this only drops the pages from the mapping; they remain in the file cache
+        madvise(m_Data + offset, length, MADV_DONTNEED);
+    }
+}
+
+#else
+
+bool c_MappedFile::Open(const std::string &)
+{
+    return false;
+}
+
+void c_MappedFile::Close()
+{
+}
+
+void c_MappedFile::SetAccessPattern(AccessPattern)
+{
+}
+
+bool c_MappedFile::ClampRange(uint64_t &, uint64_t &) const
+{
+    return false;
+}
+
+uint64_t c_MappedFile::Load(uint64_t, uint64_t)
+{
+    return 0;
+}
+
+void c_MappedFile::Release(uint64_t, uint64_t)
+{
+}
+
+#endif // !defined(_WIN32)
@@ -0,0 +1,78 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Memory-mapped file header.
+*/
+
+#ifndef STACKISTRY_MAPPED_FILE_HEADER
+#define STACKISTRY_MAPPED_FILE_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/// Read-only memory mapping of a whole file
+/** Only supported on POSIX systems; elsewhere (or if the file cannot be mapped,
+    e.g. because it does not fit in the address space) Open() fails and the caller
+    is expected to fall back to regular reads. */
+class c_MappedFile
+{
+public:
+    enum class AccessPattern { NORMAL, SEQUENTIAL, RANDOM };
+
+    c_MappedFile() = default;
+
+    ~c_MappedFile() { Close(); }
+
+    c_MappedFile(const c_MappedFile &) = delete;
+    c_MappedFile &operator =(const c_MappedFile &) = delete;
+
+    /// Returns 'false' on failure
+    bool Open(const std::string &fileName);
+
+    void Close();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+
+    const uint8_t *GetData() const { return m_Data; }
+
+    uint64_t GetSize() const { return m_Size; }
+
+    /// Tells the operating system how the whole mapping will be accessed
+    void SetAccessPattern(AccessPattern pattern);
+
+    /// Makes sure the range [offset; offset+length) is in memory; returns the number of bytes loaded
+    /** The data are not copied anywhere, they only end up in the operating system's file cache. */
+    uint64_t Load(uint64_t offset, uint64_t length);
+
+    /// Tells the operating system that the range [offset; offset+length) will not be needed by this mapping soon
+    void Release(uint64_t offset, uint64_t length);
+
+private:
+    uint8_t *m_Data = nullptr;
+    uint64_t m_Size = 0;
+    size_t m_PageSize = 0;
+
+    /// Returns false if the range is empty after clamping to the file size; aligns 'offset' down to a page boundary
+    bool ClampRange(uint64_t &offset, uint64_t &length) const;
+};
+
+#endif // STACKISTRY_MAPPED_FILE_HEADER
@@ -50,6 +50,25 @@ c_OutputViewer::c_OutputViewer()
     m_ZoomBox.reorder_child(m_OutputTypeCombo, 0);
 }
 
+void c_OutputViewer::SetImage(const std::shared_ptr<const libskry::c_Image> &img)
+{
+    if (img && img == m_ShownResult && GetImage() == m_ShownResultSurface)
+        return;
+
+    if (img)
+    {
+        c_ImageViewer::SetImage(*img);
+        m_ShownResult = img;
+        m_ShownResultSurface = GetImage();
+    }
+    else
+    {
+        RemoveImage();
+        m_ShownResult.reset();
+        m_ShownResultSurface.clear();
+    }
+}
+
 void c_OutputViewer::UpdateTooltip()
 {
     if (!m_Img)
@@ -24,6 +24,10 @@ File description:
 #ifndef STACKISTRY_OUTPUT_VIEWER_WIDGET_HEADER
 #define STACKISTRY_OUTPUT_VIEWER_WIDGET_HEADER
 
+#include <memory>
+
+#include <skry/skry_cpp.hpp>
+
 #include "img_viewer.h"
 
 
@@ -48,6 +52,10 @@ private:
     Gtk::ComboBoxText m_OutputTypeCombo;
     OutputImgTypeChangedSignal_t m_OutputImgTypeChangedSignal;
 
+    /// Last processing result shown via SetImage() and the surface created for it
+    std::shared_ptr<const libskry::c_Image> m_ShownResult;
+    Cairo::RefPtr<Cairo::ImageSurface> m_ShownResultSurface;
+
     void UpdateTooltip();
     void OnOutputTypeChanged();
 
@@ -55,6 +63,12 @@ public:
 
     c_OutputViewer();
 
+    using c_ImageViewer::SetImage;
+
+    /// Shows a processing result (may be null)
+    /** Results are immutable, so if 'img' is already shown, it is not converted again. */
+    void SetImage(const std::shared_ptr<const libskry::c_Image> &img);
+
     OutputImgTypeChangedSignal_t signal_OutputImgTypeChanged()
     {
         return m_OutputImgTypeChangedSignal;
@@ -0,0 +1,107 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Background output writer implementation.
+*/
+
+#include <utility>
+
+#include "output_writer.h"
+
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(m_Mtx)
+
+c_OutputWriter::c_OutputWriter(size_t maxPendingBytes, const sigc::slot<void> &completionNotification)
+: m_MaxPendingBytes(maxPendingBytes), m_CompletionNotification(completionNotification)
+{ }
+
+c_OutputWriter::~c_OutputWriter()
+{
+    if (m_Thread)
+    {
+        { LOCK();
+            m_Finish = true;
+            m_Cond.broadcast();
+        }
+        m_Thread->join();
+    }
+}
+
+void c_OutputWriter::Submit(const std::shared_ptr<Job_t> &job, const std::string &description, const Job::Output_t &output)
+{
+    LOCK();
+    while (!m_Queue.empty() && m_PendingBytes + output.numBytes > m_MaxPendingBytes)
+        m_Cond.wait(m_Mtx);
+
+    m_Queue.push_back({ job, description, output });
+    m_PendingBytes += output.numBytes;
+
+    if (!m_Thread)
+        m_Thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &c_OutputWriter::ThreadFunc));
+    else
+        m_Cond.broadcast();
+}
+
+std::vector<c_OutputWriter::Result_t> c_OutputWriter::GetResults()
+{
+    LOCK();
+    std::vector<Result_t> results;
+    results.swap(m_Results);
+    return results;
+}
+
+bool c_OutputWriter::IsPending(const Job_t &job)
+{
+    LOCK();
+    for (const Pending_t &pending: m_Queue)
+        if (pending.job.get() == &job)
+            return true;
+
+    return false;
+}
+
+void c_OutputWriter::ThreadFunc()
+{
+    while (true)
+    {
+        Job::Output_t output;
+        { LOCK();
+            while (m_Queue.empty() && !m_Finish)
+                m_Cond.wait(m_Mtx);
+
+            if (m_Queue.empty())
+                return; // finishing, and everything has been written
+
+            // The element stays in the queue while being written (see IsPending())
+            output = std::move(m_Queue.front().output);
+        }
+
+        const bool success = output.write();
+
+        { LOCK();
+            Pending_t &written = m_Queue.front();
+            m_Results.push_back({ written.job, written.description, success });
+            m_PendingBytes -= written.output.numBytes;
+            m_Queue.pop_front();
+            m_Cond.broadcast();
+        }
+        m_CompletionNotification();
+    }
+}
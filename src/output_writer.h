@@ -0,0 +1,93 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Background output writer header.
+*/
+
+#ifndef STACKISTRY_OUTPUT_WRITER_HEADER
+#define STACKISTRY_OUTPUT_WRITER_HEADER
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glibmm/threads.h>
+#include <sigc++/sigc++.h>
+
+#include "job.h"
+
+
+/// Writes output files of jobs in a background thread, in the order of submission
+/** The memory held by pending outputs is bounded: if adding an output would exceed
+    the limit, Submit() waits until enough of the previous ones have been written. */
+class c_OutputWriter
+{
+public:
+    struct Result_t
+    {
+        std::weak_ptr<Job_t> job;
+        std::string description;
+        bool success;
+    };
+
+    /** 'completionNotification' is called from the writer thread after every written output.
+        An output larger than 'maxPendingBytes' is still accepted if there are no other pending outputs. */
+    c_OutputWriter(size_t maxPendingBytes, const sigc::slot<void> &completionNotification);
+
+    /// Writes all pending outputs before returning
+    ~c_OutputWriter();
+
+    c_OutputWriter(const c_OutputWriter &) = delete;
+    c_OutputWriter &operator =(const c_OutputWriter &) = delete;
+
+    /// Queues 'output' of 'job'; 'description' is for reporting the result only
+    void Submit(const std::shared_ptr<Job_t> &job, const std::string &description, const Job::Output_t &output);
+
+    /// Returns the results of outputs written since the previous call
+    std::vector<Result_t> GetResults();
+
+    /// Returns 'true' if any outputs of 'job' have not been written yet
+    bool IsPending(const Job_t &job);
+
+private:
+    struct Pending_t
+    {
+        std::shared_ptr<Job_t> job; ///< Kept alive only for comparison in IsPending()
+        std::string description;
+        Job::Output_t output;
+    };
+
+    size_t m_MaxPendingBytes;
+    sigc::slot<void> m_CompletionNotification;
+
+    Glib::Threads::Thread *m_Thread = nullptr;
+    Glib::Threads::Mutex m_Mtx; ///< Guards all the variables below
+    Glib::Threads::Cond m_Cond;  ///< Signaled by the writer thread after every output and by Submit()
+    bool m_Finish = false;
+    std::deque<Pending_t> m_Queue; ///< The front element is being written
+    size_t m_PendingBytes = 0;
+    std::vector<Result_t> m_Results;
+
+    void ThreadFunc();
+};
+
+#endif // STACKISTRY_OUTPUT_WRITER_HEADER
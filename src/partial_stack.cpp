@@ -0,0 +1,281 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Partial stacks implementation.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "partial_stack.h"
+
+
+namespace PartialStack
+{
+
+const char FILE_ID[8] = { 'S', 'T', 'K', 'Y', 'P', 'A', 'R', 'T' };
+
+/// Has to be increased whenever the file layout changes
+const uint32_t FILE_VERSION = 2;
+
+const char *FILE_SUFFIX = ".stackistry_part";
+
+// File layout: FILE_ID, FILE_VERSION, analysis key (uint64), part index, part count (uint32), origin X, Y (int32),
+// width, height, number of channels (uint32), number of frames (uint64),
+// rows of float pixel values (all in the host's byte order)
+
+template<typename T>
+static void Write(std::ofstream &file, const T &value)
+{
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool Read(std::ifstream &file, T &value)
+{
+    return !file.read(reinterpret_cast<char *>(&value), sizeof(value)).fail();
+}
+
+static enum SKRY_pixel_format GetFloatFormat(unsigned numChannels)
+{
+    return (numChannels == 3 ? SKRY_PIX_RGB32F : SKRY_PIX_MONO32F);
+}
+
+bool Save(const std::string &fileName, const libskry::c_Image &stack, const Info_t &info)
+{
+    const unsigned numChannels = NUM_CHANNELS[stack.GetPixelFormat()];
+    const enum SKRY_pixel_format floatFmt = GetFloatFormat(numChannels);
+
+    // Stacks are already floating-point, so usually there is nothing to convert
+    if (stack.GetPixelFormat() != floatFmt)
+    {
+        libskry::c_Image convImg = libskry::c_Image::ConvertPixelFormat(stack, floatFmt);
+        return convImg && Save(fileName, convImg, info);
+    }
+
+    std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (file.fail())
+        return false;
+
+    file.write(FILE_ID, sizeof(FILE_ID));
+    Write(file, FILE_VERSION);
+    Write(file, (uint64_t)info.analysisKey);
+    Write(file, (uint32_t)info.partIndex);
+    Write(file, (uint32_t)info.partCount);
+    Write(file, (int32_t)info.origin.x);
+    Write(file, (int32_t)info.origin.y);
+    Write(file, (uint32_t)stack.GetWidth());
+    Write(file, (uint32_t)stack.GetHeight());
+    Write(file, (uint32_t)numChannels);
+    Write(file, (uint64_t)info.numFrames);
+
+    const size_t rowBytes = (size_t)stack.GetWidth() * numChannels * sizeof(float);
+    for (unsigned y = 0; y < stack.GetHeight() && !file.fail(); y++)
+        file.write(static_cast<const char *>(stack.GetLine(y)), rowBytes);
+
+    file.close();
+    return !file.fail();
+}
+
+std::shared_ptr<libskry::c_Image> Load(const std::string &fileName, Info_t &info)
+{
+    std::ifstream file(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (file.fail())
+        return nullptr;
+
+    char fileId[sizeof(FILE_ID)];
+    uint32_t version, partIndex, partCount, width, height, numChannels;
+    int32_t originX, originY;
+    uint64_t analysisKey, numFrames;
+    if (!Read(file, fileId) || 0 != memcmp(fileId, FILE_ID, sizeof(FILE_ID)) ||
+        !Read(file, version) || version != FILE_VERSION ||
+        !Read(file, analysisKey) || !Read(file, partIndex) || !Read(file, partCount) ||
+        !Read(file, originX) || !Read(file, originY) ||
+        !Read(file, width) || !Read(file, height) || !Read(file, numChannels) || !Read(file, numFrames) ||
+        partIndex >= partCount || width == 0 || height == 0 || (numChannels != 1 && numChannels != 3))
+    {
+        return nullptr;
+    }
+
+    auto img = std::make_shared<libskry::c_Image>(width, height, GetFloatFormat(numChannels), nullptr, false);
+    if (!*img)
+        return nullptr;
+
+    const size_t rowBytes = (size_t)width * numChannels * sizeof(float);
+    for (unsigned y = 0; y < height; y++)
+        if (file.read(static_cast<char *>(img->GetLine(y)), rowBytes).fail())
+            return nullptr;
+
+    info.analysisKey = analysisKey;
+    info.partIndex = partIndex;
+    info.partCount = partCount;
+    info.origin = { originX, originY };
+    info.numFrames = numFrames;
+    return img;
+}
+
+size_t GetNumFramesToStack(const std::vector<SKRY_quality_t> &jobQuality, size_t first, size_t end,
+                           enum SKRY_quality_criterion criterion, unsigned threshold)
+{
+    end = std::min(end, jobQuality.size());
+    if (first >= end)
+        return 1;
+
+    std::vector<SKRY_quality_t> sorted = jobQuality;
+    // Sort descending
+    std::sort(sorted.begin(), sorted.end(), [](const SKRY_quality_t &a, const SKRY_quality_t &b) { return a > b; });
+
+    // The lowest quality selected by the threshold in the whole job
+    SKRY_quality_t minSelected;
+    switch (criterion)
+    {
+    case SKRY_MIN_REL_QUALITY:
+        minSelected = sorted.back() + (sorted.front() - sorted.back()) * threshold / 100;
+        break;
+
+    case SKRY_NUMBER_BEST:
+        minSelected = sorted[std::min(std::max((size_t)threshold, (size_t)1), sorted.size()) - 1];
+        break;
+
+    case SKRY_PERCENTAGE_BEST:
+    default:
+        minSelected = sorted[std::min(std::max((size_t)threshold * sorted.size() / 100, (size_t)1), sorted.size()) - 1];
+        break;
+    }
+
+    size_t numFrames = 0;
+    for (size_t i = first; i < end; i++)
+        if (jobQuality[i] >= minSelected)
+            numFrames++;
+
+    return std::max(numFrames, (size_t)1);
+}
+
+std::shared_ptr<const libskry::c_Image> Merge(const std::vector<std::string> &fileNames,
+                                              size_t &totalNumFrames, std::string &errorMsg)
+{
+    struct Part_t
+    {
+        std::shared_ptr<libskry::c_Image> img;
+        Info_t info;
+    };
+    std::vector<Part_t> parts;
+    std::vector<bool> partPresent;
+
+    for (const std::string &fileName: fileNames)
+    {
+        Part_t part;
+        part.img = Load(fileName, part.info);
+        if (!part.img)
+        {
+            errorMsg = "Could not read partial stack " + fileName;
+            return nullptr;
+        }
+
+        if (!parts.empty())
+        {
+            const Part_t &first = parts[0];
+            if (part.info.analysisKey != first.info.analysisKey || part.info.partCount != first.info.partCount)
+            {
+                errorMsg = "Partial stack " + fileName + " belongs to a different job or analysis than the previous ones";
+                return nullptr;
+            }
+            if (NUM_CHANNELS[part.img->GetPixelFormat()] != NUM_CHANNELS[first.img->GetPixelFormat()])
+            {
+                errorMsg = "Partial stack " + fileName + " has a different number of channels than the previous ones";
+                return nullptr;
+            }
+        }
+        else
+            partPresent.assign(part.info.partCount, false);
+
+        if (partPresent[part.info.partIndex])
+        {
+            errorMsg = "Partial stack " + fileName + " is a duplicate of a previous part";
+            return nullptr;
+        }
+        partPresent[part.info.partIndex] = true;
+
+        parts.push_back(part);
+    }
+
+    if (parts.empty())
+    {
+        errorMsg = "No frames to merge";
+        return nullptr;
+    }
+    if (std::find(partPresent.begin(), partPresent.end(), false) != partPresent.end())
+    {
+        errorMsg = "Some parts of the job are missing";
+        return nullptr;
+    }
+
+    // All parts are aligned to the same reference; their stacks differ only by the cropping
+    int left = parts[0].info.origin.x, top = parts[0].info.origin.y;
+    int right = left + (int)parts[0].img->GetWidth(), bottom = top + (int)parts[0].img->GetHeight();
+    totalNumFrames = 0;
+    for (const Part_t &part: parts)
+    {
+        left = std::max(left, part.info.origin.x);
+        top = std::max(top, part.info.origin.y);
+        right = std::min(right, part.info.origin.x + (int)part.img->GetWidth());
+        bottom = std::min(bottom, part.info.origin.y + (int)part.img->GetHeight());
+        totalNumFrames += part.info.numFrames;
+    }
+    if (right <= left || bottom <= top || totalNumFrames == 0)
+    {
+        errorMsg = "The partial stacks have no common area";
+        return nullptr;
+    }
+
+    const unsigned numChannels = NUM_CHANNELS[parts[0].img->GetPixelFormat()];
+    const unsigned width = right - left, height = bottom - top;
+    const size_t rowValues = (size_t)width * numChannels;
+
+    auto result = std::make_shared<libskry::c_Image>(width, height, GetFloatFormat(numChannels), nullptr, false);
+    if (!*result)
+    {
+        errorMsg = "Out of memory";
+        return nullptr;
+    }
+
+    std::vector<double> sum(rowValues);
+    for (unsigned y = 0; y < height; y++)
+    {
+        std::fill(sum.begin(), sum.end(), 0.0);
+        for (const Part_t &part: parts)
+        {
+            const float *src = static_cast<const float *>(part.img->GetLine(y + top - part.info.origin.y))
+                               + (size_t)(left - part.info.origin.x) * numChannels;
+            for (size_t i = 0; i < rowValues; i++)
+                sum[i] += (double)part.info.numFrames * src[i];
+        }
+
+        float *dest = static_cast<float *>(result->GetLine(y));
+        for (size_t i = 0; i < rowValues; i++)
+            dest[i] = (float)(sum[i] / totalNumFrames);
+    }
+
+    return result;
+}
+
+} // namespace PartialStack
@@ -0,0 +1,71 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Partial stacks header.
+*/
+
+#ifndef STACKISTRY_PARTIAL_STACK_HEADER
+#define STACKISTRY_PARTIAL_STACK_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <skry/skry_cpp.hpp>
+
+
+/// Stacks of disjoint ranges of a sequence's frames (e.g. processed on several machines) and their merging
+/** All parts use the whole job's image alignment reference and quality threshold
+    (see Job::SelectPart()), so their stacks are merged by weighted summation. */
+namespace PartialStack
+{
+    extern const char *FILE_SUFFIX;
+
+    /// Describes a partial stack
+    struct Info_t
+    {
+        uint64_t analysisKey; ///< Fingerprint of the whole job's analysis (see AnalysisCache::GetKey())
+        unsigned partIndex, partCount;
+        struct SKRY_point origin; ///< Position of the stack's top-left corner in the whole job's first active frame
+        size_t numFrames; ///< Number of frames the stack has been created from
+    };
+
+    /// Saves 'stack' (as 32-bit floating-point values) and its description
+    bool Save(const std::string &fileName, const libskry::c_Image &stack, const Info_t &info);
+
+    /// Returns null on failure
+    std::shared_ptr<libskry::c_Image> Load(const std::string &fileName, Info_t &info);
+
+    /// Returns the number of frames of a part selected by applying a quality threshold to the whole job
+    /** 'jobQuality' is the whole job's quality of active frames (chronological order), the part
+        consists of frames [first; end). The result (at least 1) is to be used with SKRY_NUMBER_BEST. */
+    size_t GetNumFramesToStack(const std::vector<SKRY_quality_t> &jobQuality, size_t first, size_t end,
+                               enum SKRY_quality_criterion criterion, unsigned threshold);
+
+    /// Combines the partial stacks saved as 'fileNames'; each one is weighted by its number of frames
+    /** The stacks have to be all parts of the same analysis; only their common area is kept.
+        Returns null on failure (and sets 'errorMsg'). */
+    std::shared_ptr<const libskry::c_Image> Merge(const std::vector<std::string> &fileNames,
+                                                  size_t &totalNumFrames, std::string &errorMsg);
+}
+
+#endif // STACKISTRY_PARTIAL_STACK_HEADER
@@ -0,0 +1,546 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Pixel format to Cairo RGB24 conversion implementation.
+*/
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The NEON kernels store bytes in the order of a little-endian 0x00RRGGBB value
+#if defined(__ARM_NEON) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PIX_CONV_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pix_conv.h"
+
+
+namespace PixConv
+{
+
+static inline uint32_t GrayToRGB24(uint32_t value)
+{
+    return value * 0x010101;
+}
+
+/// Rounds by adding 0.5 and truncating, in the precision of 'T'; the vector kernels do the same
+template <typename T>
+static inline uint32_t FloatToByte(T value)
+{
+    return (value <= 0 ? 0 : (value >= 1 ? 255 : (uint32_t)(value * (T)255 + (T)0.5)));
+}
+
+#if defined(__SSE2__)
+/// Stores 16 gray values as RGB24
+static inline void StoreGray16_SSE2(__m128i gray, uint32_t *dest)
+{
+    const __m128i noAlpha = _mm_set1_epi32(0x00FFFFFF);
+
+    __m128i lo = _mm_unpacklo_epi8(gray, gray);
+    __m128i hi = _mm_unpackhi_epi8(gray, gray);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest),      _mm_and_si128(_mm_unpacklo_epi16(lo, lo), noAlpha));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 4),  _mm_and_si128(_mm_unpackhi_epi16(lo, lo), noAlpha));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 8),  _mm_and_si128(_mm_unpacklo_epi16(hi, hi), noAlpha));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 12), _mm_and_si128(_mm_unpackhi_epi16(hi, hi), noAlpha));
+}
+
+/// Returns the RGB24 values of the 4 RGB8 pixels in bytes 0-11 of 'rgb' (bytes 12-15 are ignored)
+static inline __m128i RGB8x4ToRGB24_SSE2(__m128i rgb)
+{
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -128,  5, 4, 3, -128,  8, 7, 6, -128,  11, 10, 9, -128);
+    return _mm_shuffle_epi8(rgb, shuffle);
+#else
+    // Move each pixel to its own 32-bit lane (as 0x00BBGGRR)...
+    const __m128i lane0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+    __m128i px = _mm_and_si128(rgb, lane0);
+    px = _mm_or_si128(px, _mm_and_si128(_mm_slli_si128(rgb, 1), _mm_slli_si128(lane0, 4)));
+    px = _mm_or_si128(px, _mm_and_si128(_mm_slli_si128(rgb, 2), _mm_slli_si128(lane0, 8)));
+    px = _mm_or_si128(px, _mm_and_si128(_mm_slli_si128(rgb, 3), _mm_slli_si128(lane0, 12)));
+
+    // ...and swap red and blue
+    const __m128i lowByte = _mm_set1_epi32(0xFF), green = _mm_set1_epi32(0xFF00);
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(px, lowByte), 16), _mm_and_si128(px, green)),
+                        _mm_and_si128(_mm_srli_epi32(px, 16), lowByte));
+#endif
+}
+
+/// Returns the RGB24 values of 4 RGB pixels, whose 12 channel values (0-255) are in 'c0', 'c1', 'c2'
+static inline __m128i RGB32x4ToRGB24_SSE2(__m128i c0, __m128i c1, __m128i c2)
+{
+    return RGB8x4ToRGB24_SSE2(_mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c2)));
+}
+
+/// Returns 'v' * 255 (for 'v' clamped to [0; 1]) rounded as by FloatToByte()
+static inline __m128i FloatToByte_SSE2(__m128 v)
+{
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), scale), half));
+}
+#endif
+
+#if defined(__AVX2__)
+static inline __m256i FloatToByte_AVX2(__m256 v)
+{
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), scale = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(v, zero), one), scale), half));
+}
+#endif
+
+static void ConvertMono8(const uint8_t *src, size_t numPixels, uint32_t *dest)
+{
+    size_t x = 0;
+
+#if defined(__AVX2__)
+    const __m256i mult = _mm256_set1_epi32(0x010101);
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        __m256i gray = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x), _mm256_mullo_epi32(gray, mult));
+    }
+#elif defined(__SSE2__)
+    for (; x + 16 <= numPixels; x += 16)
+        StoreGray16_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)), dest + x);
+#elif defined(PIX_CONV_NEON)
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        uint8x8x4_t bgrx;
+        bgrx.val[0] = bgrx.val[1] = bgrx.val[2] = vld1_u8(src + x);
+        bgrx.val[3] = vdup_n_u8(0);
+        vst4_u8(reinterpret_cast<uint8_t *>(dest + x), bgrx);
+    }
+#endif
+
+    for (; x < numPixels; x++)
+        dest[x] = GrayToRGB24(src[x]);
+}
+
+static void ConvertMono16(const uint16_t *src, size_t numPixels, uint32_t *dest)
+{
+    size_t x = 0;
+
+#if defined(__AVX2__)
+    const __m256i mult = _mm256_set1_epi32(0x010101);
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        __m256i gray = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)));
+        gray = _mm256_srli_epi32(gray, 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x), _mm256_mullo_epi32(gray, mult));
+    }
+#elif defined(__SSE2__)
+    for (; x + 16 <= numPixels; x += 16)
+    {
+        __m128i lo = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)), 8);
+        __m128i hi = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x + 8)), 8);
+        StoreGray16_SSE2(_mm_packus_epi16(lo, hi), dest + x);
+    }
+#elif defined(PIX_CONV_NEON)
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        uint8x8x4_t bgrx;
+        bgrx.val[0] = bgrx.val[1] = bgrx.val[2] = vshrn_n_u16(vld1q_u16(src + x), 8);
+        bgrx.val[3] = vdup_n_u8(0);
+        vst4_u8(reinterpret_cast<uint8_t *>(dest + x), bgrx);
+    }
+#endif
+
+    for (; x < numPixels; x++)
+        dest[x] = GrayToRGB24(src[x] >> 8);
+}
+
+static void ConvertMono32f(const float *src, size_t numPixels, uint32_t *dest)
+{
+    size_t x = 0;
+
+#if defined(__AVX2__)
+    const __m256i mult = _mm256_set1_epi32(0x010101);
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        __m256i gray = FloatToByte_AVX2(_mm256_loadu_ps(src + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x), _mm256_mullo_epi32(gray, mult));
+    }
+#elif defined(__SSE2__)
+    for (; x + 4 <= numPixels; x += 4)
+    {
+        __m128i gray = FloatToByte_SSE2(_mm_loadu_ps(src + x));
+        // No 32-bit multiplication in SSE2; replicate the byte with shifts
+        gray = _mm_or_si128(gray, _mm_or_si128(_mm_slli_epi32(gray, 8), _mm_slli_epi32(gray, 16)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x), gray);
+    }
+#endif
+
+    for (; x < numPixels; x++)
+        dest[x] = GrayToRGB24(FloatToByte(src[x]));
+}
+
+static void ConvertMono64f(const double *src, size_t numPixels, uint32_t *dest)
+{
+    for (size_t x = 0; x < numPixels; x++)
+        dest[x] = GrayToRGB24(FloatToByte(src[x]));
+}
+
+static void ConvertRGB8(const uint8_t *src, size_t numPixels, uint32_t *dest)
+{
+    size_t x = 0;
+
+#if defined(__AVX2__)
+    // Each iteration converts 8 pixels, but loads 28 bytes (i.e. 9 1/3 pixels)
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, -128,  5, 4, 3, -128,  8, 7, 6, -128,  11, 10, 9, -128,
+                                             2, 1, 0, -128,  5, 4, 3, -128,  8, 7, 6, -128,  11, 10, 9, -128);
+    for (; x + 10 <= numPixels; x += 8)
+    {
+        __m256i rgb = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3*x))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3*x + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x), _mm256_shuffle_epi8(rgb, shuffle));
+    }
+#endif
+#if defined(__SSE2__)
+    // Each iteration converts 4 pixels, but loads 16 bytes (i.e. 5 1/3 pixels)
+    for (; x + 6 <= numPixels; x += 4)
+    {
+        __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3*x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x), RGB8x4ToRGB24_SSE2(rgb));
+    }
+#elif defined(PIX_CONV_NEON)
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        uint8x8x3_t rgb = vld3_u8(src + 3*x);
+        uint8x8x4_t bgrx;
+        bgrx.val[0] = rgb.val[2];
+        bgrx.val[1] = rgb.val[1];
+        bgrx.val[2] = rgb.val[0];
+        bgrx.val[3] = vdup_n_u8(0);
+        vst4_u8(reinterpret_cast<uint8_t *>(dest + x), bgrx);
+    }
+#endif
+
+    for (; x < numPixels; x++)
+        dest[x] = (src[3*x] << 16) | (src[3*x + 1] << 8) | src[3*x + 2];
+}
+
+static void ConvertRGB16(const uint16_t *src, size_t numPixels, uint32_t *dest)
+{
+    size_t x = 0;
+
+#if defined(__AVX2__)
+    for (; x + 16 <= numPixels; x += 16)
+    {
+        const __m256i *src256 = reinterpret_cast<const __m256i *>(src + 3*x);
+        __m256i c0 = _mm256_srli_epi16(_mm256_loadu_si256(src256), 8);
+        __m256i c1 = _mm256_srli_epi16(_mm256_loadu_si256(src256 + 1), 8);
+        __m256i c2 = _mm256_srli_epi16(_mm256_loadu_si256(src256 + 2), 8);
+
+        // Packing works within 128-bit lanes; restore the order of the 64-bit halves
+        __m256i rgb01 = _mm256_permute4x64_epi64(_mm256_packus_epi16(c0, c1), 0xD8);
+        __m128i rgb0 = _mm256_castsi256_si128(rgb01), rgb1 = _mm256_extracti128_si256(rgb01, 1);
+        __m128i rgb2 = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(c2, c2), 0xD8));
+
+        // The 48 channel bytes: pixels 0-3 start at byte 0, 4-7 at 12, 8-11 at 24, 12-15 at 36
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x),      RGB8x4ToRGB24_SSE2(rgb0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x + 4),  RGB8x4ToRGB24_SSE2(_mm_alignr_epi8(rgb1, rgb0, 12)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x + 8),  RGB8x4ToRGB24_SSE2(_mm_alignr_epi8(rgb2, rgb1, 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x + 12), RGB8x4ToRGB24_SSE2(_mm_srli_si128(rgb2, 4)));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        const __m128i *src128 = reinterpret_cast<const __m128i *>(src + 3*x);
+        __m128i c0 = _mm_srli_epi16(_mm_loadu_si128(src128), 8);
+        __m128i c1 = _mm_srli_epi16(_mm_loadu_si128(src128 + 1), 8);
+        __m128i c2 = _mm_srli_epi16(_mm_loadu_si128(src128 + 2), 8);
+
+        // The 24 channel bytes: pixels 0-3 start at byte 0, 4-7 at 12
+        __m128i rgb0 = _mm_packus_epi16(c0, c1), rgb1 = _mm_packus_epi16(c2, c2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x), RGB8x4ToRGB24_SSE2(rgb0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x + 4),
+                         RGB8x4ToRGB24_SSE2(_mm_or_si128(_mm_srli_si128(rgb0, 12), _mm_slli_si128(rgb1, 4))));
+    }
+#elif defined(PIX_CONV_NEON)
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        uint16x8x3_t rgb = vld3q_u16(src + 3*x);
+        uint8x8x4_t bgrx;
+        bgrx.val[0] = vshrn_n_u16(rgb.val[2], 8);
+        bgrx.val[1] = vshrn_n_u16(rgb.val[1], 8);
+        bgrx.val[2] = vshrn_n_u16(rgb.val[0], 8);
+        bgrx.val[3] = vdup_n_u8(0);
+        vst4_u8(reinterpret_cast<uint8_t *>(dest + x), bgrx);
+    }
+#endif
+
+    for (; x < numPixels; x++)
+        dest[x] = ((src[3*x] >> 8) << 16) | ((src[3*x + 1] >> 8) << 8) | (src[3*x + 2] >> 8);
+}
+
+template <typename T>
+static void ConvertRGBFloat(const T *src, size_t numPixels, uint32_t *dest, size_t x = 0)
+{
+    for (; x < numPixels; x++)
+        dest[x] = (FloatToByte(src[3*x]) << 16) | (FloatToByte(src[3*x + 1]) << 8) | FloatToByte(src[3*x + 2]);
+}
+
+static void ConvertRGB32f(const float *src, size_t numPixels, uint32_t *dest)
+{
+    size_t x = 0;
+
+#if defined(__AVX2__)
+    for (; x + 8 <= numPixels; x += 8)
+    {
+        __m256i c0 = FloatToByte_AVX2(_mm256_loadu_ps(src + 3*x));
+        __m256i c1 = FloatToByte_AVX2(_mm256_loadu_ps(src + 3*x + 8));
+        __m256i c2 = FloatToByte_AVX2(_mm256_loadu_ps(src + 3*x + 16));
+
+        // Pixels 0-3 are in the 128-bit halves c0.lo, c0.hi, c1.lo; pixels 4-7 in c1.hi, c2.lo, c2.hi
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x),
+                         RGB32x4ToRGB24_SSE2(_mm256_castsi256_si128(c0), _mm256_extracti128_si256(c0, 1),
+                                             _mm256_castsi256_si128(c1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x + 4),
+                         RGB32x4ToRGB24_SSE2(_mm256_extracti128_si256(c1, 1), _mm256_castsi256_si128(c2),
+                                             _mm256_extracti128_si256(c2, 1)));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; x + 4 <= numPixels; x += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x),
+                         RGB32x4ToRGB24_SSE2(FloatToByte_SSE2(_mm_loadu_ps(src + 3*x)),
+                                             FloatToByte_SSE2(_mm_loadu_ps(src + 3*x + 4)),
+                                             FloatToByte_SSE2(_mm_loadu_ps(src + 3*x + 8))));
+    }
+#endif
+
+    ConvertRGBFloat(src, numPixels, dest, x);
+}
+
+bool IsSupported(enum SKRY_pixel_format pixFmt)
+{
+    switch (pixFmt)
+    {
+    case SKRY_PIX_MONO8:
+    case SKRY_PIX_MONO16:
+    case SKRY_PIX_MONO32F:
+    case SKRY_PIX_MONO64F:
+    case SKRY_PIX_RGB8:
+    case SKRY_PIX_RGB16:
+    case SKRY_PIX_RGB32F:
+    case SKRY_PIX_RGB64F:
+    case SKRY_PIX_BGRA8:
+        return true;
+
+    default: return false;
+    }
+}
+
+void ConvertRow(const void *src, enum SKRY_pixel_format pixFmt, size_t numPixels, uint32_t *dest)
+{
+    switch (pixFmt)
+    {
+    case SKRY_PIX_MONO8:   ConvertMono8(static_cast<const uint8_t *>(src), numPixels, dest); break;
+    case SKRY_PIX_MONO16:  ConvertMono16(static_cast<const uint16_t *>(src), numPixels, dest); break;
+    case SKRY_PIX_MONO32F: ConvertMono32f(static_cast<const float *>(src), numPixels, dest); break;
+    case SKRY_PIX_MONO64F: ConvertMono64f(static_cast<const double *>(src), numPixels, dest); break;
+    case SKRY_PIX_RGB8:    ConvertRGB8(static_cast<const uint8_t *>(src), numPixels, dest); break;
+    case SKRY_PIX_RGB16:   ConvertRGB16(static_cast<const uint16_t *>(src), numPixels, dest); break;
+    case SKRY_PIX_RGB32F:  ConvertRGB32f(static_cast<const float *>(src), numPixels, dest); break;
+    case SKRY_PIX_RGB64F:  ConvertRGBFloat(static_cast<const double *>(src), numPixels, dest); break;
+
+    // Same memory layout as RGB24 on little-endian machines (the 4th byte is ignored by Cairo)
+    case SKRY_PIX_BGRA8:   std::memcpy(dest, src, numPixels * sizeof(uint32_t)); break;
+
+    default: break;
+    }
+}
+
+enum SKRY_CFA_pattern GetCFAPattern(enum SKRY_pixel_format pixFmt)
+{
+    switch (pixFmt)
+    {
+    case SKRY_PIX_CFA_RGGB8:
+    case SKRY_PIX_CFA_RGGB16: return SKRY_CFA_RGGB;
+
+    case SKRY_PIX_CFA_BGGR8:
+    case SKRY_PIX_CFA_BGGR16: return SKRY_CFA_BGGR;
+
+    case SKRY_PIX_CFA_GRBG8:
+    case SKRY_PIX_CFA_GRBG16: return SKRY_CFA_GRBG;
+
+    case SKRY_PIX_CFA_GBRG8:
+    case SKRY_PIX_CFA_GBRG16: return SKRY_CFA_GBRG;
+
+    default: return SKRY_CFA_NONE;
+    }
+}
+
+/// Fills 'colors' with the filter color indices (0 = red, 1 = green, 2 = blue) at [y % 2][x % 2]
+static void GetCFAColors(enum SKRY_CFA_pattern pattern, unsigned colors[2][2])
+{
+    for (unsigned i = 0; i < 4; i++)
+    {
+        const char color = SKRY_CFA_pattern_str[pattern][i];
+        colors[i / 2][i % 2] = (color == 'R' ? 0 : (color == 'G' ? 1 : 2));
+    }
+}
+
+/// Returns the neighbor 'pos' (may be -1 or 'size') mirrored into [0; size), which preserves its filter color
+static inline unsigned Mirror(int pos, unsigned size)
+{
+    if (pos < 0)
+        return (size > 1 ? 1 : 0);
+    else if (pos >= (int)size)
+        return (size > 1 ? size - 2 : 0);
+    else
+        return pos;
+}
+
+template <typename T>
+static inline uint32_t ChannelToByte(uint32_t value)
+{
+    return (sizeof(T) == 1 ? value : value >> 8);
+}
+
+template <typename T>
+static inline uint32_t AveragesToRGB24(const uint32_t sum[3], const unsigned count[3])
+{
+    uint32_t rgb[3];
+    for (unsigned ch = 0; ch < 3; ch++)
+        rgb[ch] = (count[ch] ? ChannelToByte<T>((sum[ch] + count[ch] / 2) / count[ch]) : 0);
+
+    return (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+}
+
+template <typename T>
+static void DemosaicRowBilinear(const libskry::c_Image &img, enum SKRY_CFA_pattern pattern,
+                                unsigned y, unsigned x0, size_t numPixels, uint32_t *dest)
+{
+    unsigned colors[2][2];
+    GetCFAColors(pattern, colors);
+
+    const unsigned width = img.GetWidth();
+    const unsigned rows[3] = { Mirror((int)y - 1, img.GetHeight()), y, Mirror((int)y + 1, img.GetHeight()) };
+    const T *lines[3];
+    for (unsigned i = 0; i < 3; i++)
+        lines[i] = static_cast<const T *>(img.GetLine(rows[i]));
+
+    for (size_t i = 0; i < numPixels; i++)
+    {
+        const unsigned x = x0 + i;
+        const unsigned cols[3] = { Mirror((int)x - 1, width), x, Mirror((int)x + 1, width) };
+        const unsigned ownColor = colors[y % 2][x % 2];
+
+        // Each missing color is the average of the neighbors having it
+        uint32_t sum[3] = { 0, 0, 0 };
+        unsigned count[3] = { 0, 0, 0 };
+        for (unsigned dy = 0; dy < 3; dy++)
+            for (unsigned dx = 0; dx < 3; dx++)
+            {
+                const unsigned color = colors[rows[dy] % 2][cols[dx] % 2];
+                if (color != ownColor)
+                {
+                    sum[color] += lines[dy][cols[dx]];
+                    count[color]++;
+                }
+            }
+        sum[ownColor] = lines[1][x];
+        count[ownColor] = 1;
+
+        dest[i] = AveragesToRGB24<T>(sum, count);
+    }
+}
+
+template <typename T>
+static void DemosaicRowSuperpixel(const libskry::c_Image &img, enum SKRY_CFA_pattern pattern,
+                                  unsigned y, unsigned x0, size_t numPixels, uint32_t *dest)
+{
+    unsigned colors[2][2];
+    GetCFAColors(pattern, colors);
+
+    const T *lines[2] = { static_cast<const T *>(img.GetLine(2 * y)),
+                          static_cast<const T *>(img.GetLine(2 * y + 1)) };
+
+    for (size_t i = 0; i < numPixels; i++)
+    {
+        const unsigned x = 2 * (x0 + i);
+
+        uint32_t sum[3] = { 0, 0, 0 };
+        unsigned count[3] = { 0, 0, 0 };
+        for (unsigned dy = 0; dy < 2; dy++)
+            for (unsigned dx = 0; dx < 2; dx++)
+            {
+                sum[colors[dy][dx]] += lines[dy][x + dx];
+                count[colors[dy][dx]]++;
+            }
+
+        dest[i] = AveragesToRGB24<T>(sum, count);
+    }
+}
+
+void DemosaicRow(const libskry::c_Image &img, unsigned y, unsigned x0, size_t numPixels, uint32_t *dest)
+{
+    const enum SKRY_pixel_format pixFmt = img.GetPixelFormat();
+    const enum SKRY_CFA_pattern pattern = GetCFAPattern(pixFmt);
+    if (pattern == SKRY_CFA_NONE)
+        return;
+
+    if (BITS_PER_CHANNEL[pixFmt] == 8)
+        DemosaicRowBilinear<uint8_t>(img, pattern, y, x0, numPixels, dest);
+    else
+        DemosaicRowBilinear<uint16_t>(img, pattern, y, x0, numPixels, dest);
+}
+
+void DemosaicRowHalfRes(const libskry::c_Image &img, unsigned y, unsigned x0, size_t numPixels, uint32_t *dest)
+{
+    const enum SKRY_pixel_format pixFmt = img.GetPixelFormat();
+    const enum SKRY_CFA_pattern pattern = GetCFAPattern(pixFmt);
+    if (pattern == SKRY_CFA_NONE)
+        return;
+
+    if (BITS_PER_CHANNEL[pixFmt] == 8)
+        DemosaicRowSuperpixel<uint8_t>(img, pattern, y, x0, numPixels, dest);
+    else
+        DemosaicRowSuperpixel<uint16_t>(img, pattern, y, x0, numPixels, dest);
+}
+
+const char *GetInstructionSet()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSSE3__)
+    return "SSSE3";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(PIX_CONV_NEON)
+    return "NEON";
+#else
+    return "none";
+#endif
+}
+
+} // namespace PixConv
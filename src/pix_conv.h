@@ -0,0 +1,63 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Pixel format to Cairo RGB24 conversion header.
+*/
+
+#ifndef STACKISTRY_PIX_CONV_HEADER
+#define STACKISTRY_PIX_CONV_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+#include <skry/skry_cpp.hpp>
+
+
+/// Direct conversion of image rows to the Cairo RGB24 format (without intermediate images)
+/** Vector instructions are used if enabled in the compiler settings (see SIMD_FLAGS in Makefile). */
+namespace PixConv
+{
+    /// Returns true if ConvertRow() handles 'pixFmt'
+    /** Palettized and raw color (CFA) images are not supported (for the latter, see DemosaicRow()). */
+    bool IsSupported(enum SKRY_pixel_format pixFmt);
+
+    /// Converts 'numPixels' pixels of 'src' to 'dest' (native-endian 0x00RRGGBB values)
+    /** 16-bit values are truncated to 8 bits, floating-point values are expected
+        to be in the [0; 1] range. */
+    void ConvertRow(const void *src, enum SKRY_pixel_format pixFmt, size_t numPixels, uint32_t *dest);
+
+    /// Returns the filter pattern of a raw color (CFA) pixel format; SKRY_CFA_NONE for other formats
+    enum SKRY_CFA_pattern GetCFAPattern(enum SKRY_pixel_format pixFmt);
+
+    /// Demosaics (bilinearly) and converts 'numPixels' pixels of row 'y' of a raw color image, starting at 'x0'
+    /** Intended for display only; much faster than libskry's high-quality demosaicing
+        (which is still used for stacking). */
+    void DemosaicRow(const libskry::c_Image &img, unsigned y, unsigned x0, size_t numPixels, uint32_t *dest);
+
+    /// Converts 'numPixels' 2x2 blocks of the filter pattern ("superpixels") of a raw color image to single pixels
+    /** 'y' and 'x0' are expressed in blocks, i.e. the source rows are 2*y, 2*y+1 and the first source column is 2*x0.
+        Produces a half-resolution image (for zoom levels of 50% or less) without any interpolation. */
+    void DemosaicRowHalfRes(const libskry::c_Image &img, unsigned y, unsigned x0, size_t numPixels, uint32_t *dest);
+
+    /// Returns the name of the vector instruction set used by ConvertRow()
+    const char *GetInstructionSet();
+}
+
+#endif // STACKISTRY_PIX_CONV_HEADER
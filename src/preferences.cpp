@@ -30,6 +30,7 @@ File description:
 #include <gtkmm/separator.h>
 
 #include "config.h"
+#include "frame_cache.h"
 #include "preferences.h"
 #include "utils.h"
 
@@ -100,6 +101,46 @@ void c_PreferencesDlg::InitControls()
               &m_NumQualHistBins }),
             Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
 
+    m_MaxConcurrentJobs.set_adjustment(Gtk::Adjustment::create(Configuration::MaxConcurrentJobs, 1, Utils::Const::MaxConcurrentJobsLimit,
+            1, 1, 0));
+    m_MaxConcurrentJobs.set_tooltip_text(_("While jobs wait for reference points to be set, one more job may be started"));
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>(
+            { Gtk::manage(new Gtk::Label(_("Max. number of jobs processed simultaneously:"))),
+              &m_MaxConcurrentJobs }),
+            Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
+    m_WorkerThreadBudget.set_adjustment(Gtk::Adjustment::create(Configuration::WorkerThreadBudget, 0, 256, 1, 4, 0));
+    m_WorkerThreadBudget.set_tooltip_text(_("Processing threads shared by all running jobs; 0 = use all CPUs"));
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>(
+            { Gtk::manage(new Gtk::Label(_("Total number of processing threads:"))),
+              &m_WorkerThreadBudget }),
+            Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
+    m_FrameCacheSize.set_adjustment(Gtk::Adjustment::create(Configuration::FrameCacheSizeMiB, 0, 1024*1024, 64, 256, 0));
+    m_FrameCacheSize.set_tooltip_text(_("Memory used for keeping decoded frames for visualization and frame selection; 0 = disabled"));
+    FrameCache::Stats_t cacheStats = FrameCache::GetStats();
+    Gtk::Label *cacheStatsLabel = Gtk::manage(new Gtk::Label(
+        Glib::ustring::compose(_("(in use: %1 MiB, %2 frames; hits: %3, misses: %4)"),
+                               cacheStats.usedBytes / (1024*1024), cacheStats.numFrames, cacheStats.hits, cacheStats.misses)));
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>(
+            { Gtk::manage(new Gtk::Label(_("Decoded frame cache size (MiB):"))),
+              &m_FrameCacheSize, cacheStatsLabel }),
+            Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
+    m_ReadAheadFrames.set_adjustment(Gtk::Adjustment::create(Configuration::ReadAheadFrames, 0, 256, 1, 8, 0));
+    m_ReadAheadFrames.set_tooltip_text(_("Input data of this many upcoming frames is read in background during processing; 0 = disabled"));
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>(
+            { Gtk::manage(new Gtk::Label(_("Number of frames to read ahead:"))),
+              &m_ReadAheadFrames }),
+            Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
+    m_VisualizationMaxFps.set_adjustment(Gtk::Adjustment::create(Configuration::VisualizationMaxFps, 1, 120, 1, 10, 0));
+    m_VisualizationMaxFps.set_tooltip_text(_("Lower values make processing with visualization enabled faster"));
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>(
+            { Gtk::manage(new Gtk::Label(_("Max. visualization refresh rate (frames per second):"))),
+              &m_VisualizationMaxFps }),
+            Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
     auto separator = Gtk::manage(new Gtk::Separator());
     separator->show();
     get_content_area()->pack_end(*separator, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
@@ -118,6 +159,11 @@ void c_PreferencesDlg::OnResponse(int responseId)
     {
         Configuration::ExportInactiveFramesQuality = m_ExportInactiveFramesQuality.get_active();
         Configuration::NumQualityHistogramBins = (size_t)m_NumQualHistBins.get_value();
+        Configuration::MaxConcurrentJobs = (unsigned)m_MaxConcurrentJobs.get_value();
+        Configuration::WorkerThreadBudget = (unsigned)m_WorkerThreadBudget.get_value();
+        Configuration::FrameCacheSizeMiB = (int)m_FrameCacheSize.get_value();
+        Configuration::ReadAheadFrames = (int)m_ReadAheadFrames.get_value();
+        Configuration::VisualizationMaxFps = (unsigned)m_VisualizationMaxFps.get_value();
     }
 }
 
@@ -41,6 +41,11 @@ class c_PreferencesDlg: public Gtk::Dialog, public Utils::Types::IValidatedInput
     Gtk::ComboBoxText m_UILanguage;
     Gtk::CheckButton m_ExportInactiveFramesQuality;
     Gtk::SpinButton m_NumQualHistBins;
+    Gtk::SpinButton m_MaxConcurrentJobs;
+    Gtk::SpinButton m_WorkerThreadBudget;
+    Gtk::SpinButton m_FrameCacheSize;
+    Gtk::SpinButton m_ReadAheadFrames;
+    Gtk::SpinButton m_VisualizationMaxFps;
 
     void InitControls();
 
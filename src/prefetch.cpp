@@ -0,0 +1,306 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Frame read-ahead implementation.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "prefetch.h"
+
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(m_Mtx)
+
+const size_t READ_BUF_SIZE = 1 << 20;
+
+namespace SER
+{
+    const size_t HEADER_SIZE = 178;
+
+    // Offsets of the header's 32-bit little-endian fields
+    const size_t COLOR_ID = 18;
+    const size_t IMAGE_WIDTH = 26;
+    const size_t IMAGE_HEIGHT = 30;
+    const size_t PIXEL_DEPTH = 34;
+
+    const uint32_t COLOR_RGB = 100;
+    const uint32_t COLOR_BGR = 101;
+}
+
+static uint32_t GetLE32(const unsigned char *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/// Performs a case-insensitive comparison; 'ext' must be lowercase
+static bool HasExtension(const std::string &fileName, const char *ext)
+{
+    const size_t extLen = strlen(ext);
+    if (fileName.length() < extLen)
+        return false;
+
+    std::string fileExt = fileName.substr(fileName.length() - extLen);
+    std::transform(fileExt.begin(), fileExt.end(), fileExt.begin(), ::tolower);
+    return fileExt == ext;
+}
+
+static uint64_t GetFileSize(const std::string &fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+    file.seekg(0, std::ios_base::end);
+    return file.fail() ? 0 : (uint64_t)file.tellg();
+}
+
+/// Returns the size of a single frame; returns 0 on failure
+static uint64_t GetSERFrameSize(const std::string &fileName)
+{
+    unsigned char header[SER::HEADER_SIZE];
+    std::ifstream file(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!file.read(reinterpret_cast<char *>(header), SER::HEADER_SIZE))
+        return 0;
+
+    uint32_t colorId = GetLE32(header + SER::COLOR_ID);
+    uint32_t bitsPerChannel = GetLE32(header + SER::PIXEL_DEPTH);
+    uint64_t numChannels = (colorId == SER::COLOR_RGB || colorId == SER::COLOR_BGR) ? 3 : 1;
+
+    return (uint64_t)GetLE32(header + SER::IMAGE_WIDTH) * GetLE32(header + SER::IMAGE_HEIGHT)
+           * numChannels * (bitsPerChannel <= 8 ? 1 : 2);
+}
+
+void c_Prefetcher::DetermineFrameLocations(const libskry::c_ImageSequence &imgSeq, const std::string &sourcePath,
+                                           const std::vector<std::string> &imageFileNames)
+{
+    const size_t imgCount = imgSeq.GetImageCount();
+
+    if (imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES)
+    {
+        if (imageFileNames.size() != imgCount)
+            return;
+        m_FileNames = imageFileNames;
+    }
+    else
+    {
+        m_FileNames = { sourcePath };
+        // All processing phases read the active frames in order
+        if (m_MappedVideo.Open(sourcePath))
+            m_MappedVideo.SetAccessPattern(c_MappedFile::AccessPattern::SEQUENTIAL);
+    }
+
+    const uint64_t fileSize = GetFileSize(m_FileNames[0]);
+
+    uint64_t serFrameSize = 0;
+    if (imgSeq.GetType() != SKRY_IMG_SEQ_IMAGE_FILES && HasExtension(sourcePath, ".ser"))
+        serFrameSize = GetSERFrameSize(sourcePath);
+
+    const uint8_t *isActive = imgSeq.GetImgActiveFlags();
+    for (size_t i = 0; i < imgCount; i++)
+    {
+        if (!isActive[i])
+            continue;
+
+        if (imgSeq.GetType() == SKRY_IMG_SEQ_IMAGE_FILES)
+        {
+            // Whole file
+            m_Frames.push_back({ &m_FileNames[i], 0, std::numeric_limits<uint64_t>::max() });
+        }
+        else if (serFrameSize)
+        {
+            m_Frames.push_back({ &m_FileNames[0], SER::HEADER_SIZE + i * serFrameSize, serFrameSize });
+        }
+        else
+        {
+            // Other videos (AVI): assume the frames are spread evenly over the file
+            // (true for uncompressed data, apart from the headers and the index)
+            uint64_t length = fileSize / imgCount + 1;
+            m_Frames.push_back({ &m_FileNames[0], fileSize / imgCount * i, length });
+        }
+    }
+}
+
+c_Prefetcher::c_Prefetcher(const libskry::c_ImageSequence &imgSeq,
+                           const std::string &sourcePath,
+                           const std::vector<std::string> &imageFileNames,
+                           unsigned depth, unsigned numPasses, unsigned phaseBoundaryDepth)
+: m_Depth(depth), m_PhaseBoundaryDepth(phaseBoundaryDepth)
+{
+    m_Stats = Stats_t { 0, 0, 0, 0, 0.0, 0.0, 0 };
+
+    if (depth == 0)
+        return;
+
+    DetermineFrameLocations(imgSeq, sourcePath, imageFileNames);
+    if (m_Frames.empty())
+        return;
+
+    m_NumOrdinals = m_Frames.size() * numPasses;
+    m_Thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &c_Prefetcher::ThreadFunc));
+}
+
+c_Prefetcher::~c_Prefetcher()
+{
+    if (m_Thread)
+    {
+        { LOCK();
+            m_StopRequested = true;
+            m_Cond.signal();
+        }
+        m_Thread->join();
+    }
+}
+
+void c_Prefetcher::NotifyStep(size_t activeImgIdx, double stepTimeSec)
+{
+    if (!m_Thread)
+        return;
+
+    LOCK();
+
+    if (m_AnyStepNotified && activeImgIdx < m_LastActiveIdx)
+        m_Pass++; // the next processing phase has started
+
+    m_LastActiveIdx = activeImgIdx;
+    m_AnyStepNotified = true;
+
+    size_t ordinal = m_Pass * m_Frames.size() + activeImgIdx;
+
+    m_Stats.numSteps++;
+    if (m_NumRead > ordinal)
+    {
+        size_t queueDepth = m_NumRead - ordinal - 1;
+        m_QueueDepthSum += queueDepth;
+        m_Stats.maxQueueDepth = std::max(m_Stats.maxQueueDepth, queueDepth);
+    }
+    else
+    {
+        m_Stats.numStalls++;
+        m_Stats.stallTimeSec += stepTimeSec;
+        // Processing got ahead of us; skip the frames already processed
+        m_NumRead = ordinal + 1;
+    }
+
+    m_NextOrdinal = ordinal + 1;
+    m_Paused = false;
+    m_Cond.signal();
+}
+
+void c_Prefetcher::Pause()
+{
+    LOCK();
+    m_Paused = true;
+}
+
+c_Prefetcher::Stats_t c_Prefetcher::GetStats()
+{
+    LOCK();
+    Stats_t stats = m_Stats;
+    stats.avgQueueDepth = (stats.numSteps ? (double)m_QueueDepthSum / stats.numSteps : 0.0);
+    return stats;
+}
+
+size_t c_Prefetcher::GetReadLimit() const
+{
+    size_t limit = std::min(m_NextOrdinal + m_Depth, m_NumOrdinals);
+
+    const size_t passLength = m_Frames.size();
+    if (m_PhaseBoundaryDepth && m_NextOrdinal < passLength && limit >= passLength)
+    {
+        // The first pass (image alignment) is about to end; start reading for the second one
+        // (quality estimation) while the remaining steps are being computed
+        limit = std::min(std::max(limit, passLength + m_PhaseBoundaryDepth), m_NumOrdinals);
+    }
+
+    return limit;
+}
+
+void c_Prefetcher::ThreadFunc()
+{
+    std::vector<char> buffer;
+    std::ifstream file;
+    const std::string *openedFileName = nullptr;
+
+    size_t numReleased = 0; ///< Ordinals [0; numReleased) have been dropped from 'm_MappedVideo'
+
+    LOCK();
+    while (!m_StopRequested)
+    {
+        if (m_Paused || m_NumRead >= GetReadLimit())
+        {
+            m_Cond.wait(m_Mtx);
+            continue;
+        }
+
+        const size_t ordinal = m_NumRead;
+        const FrameLocation_t location = m_Frames[ordinal % m_Frames.size()];
+        const size_t releaseEnd = m_NextOrdinal;
+
+        lock.release();
+
+        uint64_t numBytesRead = 0;
+        if (m_MappedVideo.IsOpen())
+        {
+            // Frames already processed do not need to stay mapped
+            // (a later pass finds them in the file cache, if they still fit there)
+            for (; numReleased < releaseEnd; numReleased++)
+            {
+                const FrameLocation_t &processed = m_Frames[numReleased % m_Frames.size()];
+                m_MappedVideo.Release(processed.offset, processed.length);
+            }
+
+            numBytesRead = m_MappedVideo.Load(location.offset, location.length);
+        }
+        else
+        {
+            if (buffer.empty())
+                buffer.resize(READ_BUF_SIZE);
+
+            if (openedFileName != location.fileName)
+            {
+                file.close();
+                file.clear();
+                file.open(location.fileName->c_str(), std::ios_base::in | std::ios_base::binary);
+                openedFileName = location.fileName;
+            }
+
+            if (file.is_open())
+            {
+                file.clear();
+                file.seekg(location.offset);
+                while (numBytesRead < location.length && !file.fail())
+                {
+                    file.read(buffer.data(), std::min<uint64_t>(READ_BUF_SIZE, location.length - numBytesRead));
+                    numBytesRead += file.gcount();
+                }
+            }
+        }
+
+        lock.acquire();
+
+        // NotifyStep() may have moved 'm_NumRead' past this frame meanwhile
+        if (m_NumRead == ordinal)
+            m_NumRead++;
+
+        m_Stats.numFramesRead++;
+        m_Stats.numBytesRead += numBytesRead;
+    }
+}
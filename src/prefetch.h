@@ -0,0 +1,131 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Frame read-ahead header.
+*/
+
+#ifndef STACKISTRY_PREFETCH_HEADER
+#define STACKISTRY_PREFETCH_HEADER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glibmm/threads.h>
+
+#include "job.h"
+#include "mapped_file.h"
+
+
+/// Reads the input data of upcoming frames in a background thread
+/** libskry decodes frames inside its processing phases, so the data read here
+    is discarded; the point is to have it in the operating system's file cache
+    by the time a phase's Step() needs it, so that disk reads overlap with
+    computation of the preceding steps.
+
+    Video files are memory-mapped if possible, so that the data are not copied
+    anywhere; otherwise they are read into a scratch buffer.
+
+    The frames are read in the order of the active images' subset; after the last
+    active image, reading continues from the first one (for the next phase). */
+class c_Prefetcher
+{
+public:
+    struct Stats_t
+    {
+        size_t numFramesRead;
+        uint64_t numBytesRead;
+        size_t numSteps;        ///< Number of reported processing steps
+        size_t numStalls;       ///< Steps whose frame had not been read ahead
+        double stallTimeSec;    ///< Total duration of the stalled steps
+        double avgQueueDepth;   ///< Avg. number of frames read ahead at the time of a step
+        size_t maxQueueDepth;
+    };
+
+    /** Starts the background thread (unless 'depth' is 0). 'numPasses' is the number of
+        times all active images will be read by the processing phases.
+        If 'phaseBoundaryDepth' is not zero, once reading ahead reaches the end of the first
+        pass, up to this many frames of the second pass are read (instead of 'depth'). */
+    c_Prefetcher(const Job_t &job, unsigned depth, unsigned numPasses, unsigned phaseBoundaryDepth = 0)
+    : c_Prefetcher(job.imgSeq, job.sourcePath, job.imageFileNames, depth, numPasses, phaseBoundaryDepth)
+    { }
+
+    /// Reads the images of 'imgSeq' (which has to outlive the prefetcher); file names as in Job_t
+    c_Prefetcher(const libskry::c_ImageSequence &imgSeq,
+                 const std::string &sourcePath,
+                 const std::vector<std::string> &imageFileNames,
+                 unsigned depth, unsigned numPasses, unsigned phaseBoundaryDepth = 0);
+
+    /// Stops the background thread
+    ~c_Prefetcher();
+
+    c_Prefetcher(const c_Prefetcher &) = delete;
+    c_Prefetcher &operator =(const c_Prefetcher &) = delete;
+
+    /// Called after every processing step
+    void NotifyStep(size_t activeImgIdx, ///< Index of the processed image within the active images' subset
+                    double stepTimeSec);
+
+    /// Pauses reading ahead until the next call to NotifyStep() (e.g. while waiting for user input)
+    void Pause();
+
+    Stats_t GetStats();
+
+private:
+    struct FrameLocation_t
+    {
+        const std::string *fileName;
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    std::vector<FrameLocation_t> m_Frames; ///< Locations of active images' data
+    std::vector<std::string> m_FileNames;
+    c_MappedFile m_MappedVideo; ///< Mapping of the video file (if supported); not used for image series
+    unsigned m_Depth;
+    unsigned m_PhaseBoundaryDepth;
+    size_t m_NumOrdinals = 0; ///< Number of active images times the number of passes
+
+    Glib::Threads::Thread *m_Thread = nullptr;
+    Glib::Threads::Mutex m_Mtx; ///< Guards all the variables below
+    Glib::Threads::Cond m_Cond;
+    bool m_StopRequested = false;
+    bool m_Paused = false;
+
+    // Ordinals enumerate the active images of subsequent passes, i.e.:
+    //   ordinal = pass * numActiveImages + activeImgIdx
+
+    size_t m_Pass = 0;
+    size_t m_LastActiveIdx = 0;
+    size_t m_NextOrdinal = 0;     ///< Ordinal of the image to be processed next
+    size_t m_NumRead = 0;         ///< Ordinals [0; m_NumRead) have been read (or skipped)
+    bool m_AnyStepNotified = false;
+
+    Stats_t m_Stats;
+    uint64_t m_QueueDepthSum = 0;
+
+    void DetermineFrameLocations(const libskry::c_ImageSequence &imgSeq, const std::string &sourcePath,
+                                 const std::vector<std::string> &imageFileNames);
+    /// Returns the number of ordinals which may be read ahead at the moment; must be called with 'm_Mtx' locked
+    size_t GetReadLimit() const;
+    void ThreadFunc();
+};
+
+#endif // STACKISTRY_PREFETCH_HEADER
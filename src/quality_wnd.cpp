@@ -128,16 +128,36 @@ void c_QualityWindow::InitControls()
 
 static
 void DrawGraph(const Cairo::RefPtr<Cairo::Context> &cr,
-               const std::vector<SKRY_quality_t> &values,
-               int height, double lineWidth, const GdkRGBA &color,
-               double hstep, double vscale, double minValue)
+               const Utils::Types::c_MinMaxPyramid<SKRY_quality_t> &values,
+               int width, int height, double lineWidth, const GdkRGBA &color,
+               double vscale, double minValue)
 {
     cr->set_dash(std::vector<double>{ } , 0);
     Utils::SetColor(cr, color);
     cr->set_line_width(lineWidth);
-    cr->move_to(0, height - vscale * (values[0] - minValue));
-    for (size_t i = 1; i < values.size(); i++)
-        cr->line_to(i * hstep, height - vscale * (values[i] - minValue));
+
+    const size_t numValues = values.GetSize();
+    if (numValues <= (size_t)width)
+    {
+        const double hstep = (double)width / (numValues - 1);
+        cr->move_to(0, height - vscale * (values.GetValue(0) - minValue));
+        for (size_t i = 1; i < numValues; i++)
+            cr->line_to(i * hstep, height - vscale * (values.GetValue(i) - minValue));
+    }
+    else
+    {
+        // Draw the min-max envelope of the values corresponding to each pixel column
+        for (int x = 0; x < width; x++)
+        {
+            SKRY_quality_t minQ, maxQ;
+            values.GetMinMax(x * numValues / width, (x + 1) * numValues / width, minQ, maxQ);
+            if (x == 0)
+                cr->move_to(x, height - vscale * (maxQ - minValue));
+            else
+                cr->line_to(x, height - vscale * (maxQ - minValue));
+            cr->line_to(x, height - vscale * (minQ - minValue));
+        }
+    }
 
     cr->stroke();
 }
@@ -183,7 +203,7 @@ void DrawGrid(const Cairo::RefPtr<Cairo::Context> &cr, int width, int height, co
 
 bool c_QualityWindow::OnDraw(const Cairo::RefPtr<Cairo::Context>& cr)
 {
-    if (!m_Job || m_Job->quality.framesChrono.empty())
+    if (!m_Job || !m_Quality || m_Quality->framesChrono.empty())
         return false; // fall back to default - fill with background color
 
     int width = m_DrawArea.get_width(),
@@ -205,13 +225,12 @@ bool c_QualityWindow::OnDraw(const Cairo::RefPtr<Cairo::Context>& cr)
     else
     {
         double vscale = height  / (m_MaxQ - m_MinQ);
-        double hstep = (double)width / (m_Job->quality.framesChrono.size() - 1);
 
         if (m_DrawItems.sorted)
-            DrawGraph(cr, m_Job->quality.framesSorted, height, sortedLineWidth, Color::sortedGraph, hstep, vscale, m_MinQ);
+            DrawGraph(cr, m_SortedEnvelope, width, height, sortedLineWidth, Color::sortedGraph, vscale, m_MinQ);
 
         if (m_DrawItems.chrono)
-            DrawGraph(cr, m_Job->quality.framesChrono, height, chronoLineWidth, Color::chronoGraph, hstep, vscale, m_MinQ);
+            DrawGraph(cr, m_ChronoEnvelope, width, height, chronoLineWidth, Color::chronoGraph, vscale, m_MinQ);
     }
 
     return true;
@@ -224,6 +243,8 @@ void c_QualityWindow::JobDeletionNotify()
         // If we remain the sole owner, the job has been just deleted
         // from the job list in the main window.
         m_Job.reset();
+        m_Quality.reset();
+        m_IsPartial = false;
 
         if (is_visible())
             queue_draw();
@@ -233,6 +254,7 @@ void c_QualityWindow::JobDeletionNotify()
 void c_QualityWindow::SetJob(std::shared_ptr<Job_t> job)
 {
     m_Job = job;
+    m_Quality.reset();
     Update();
 }
 
@@ -240,18 +262,34 @@ void c_QualityWindow::SetJob(std::shared_ptr<Job_t> job)
     Redraws the graph. */
 void c_QualityWindow::Update()
 {
-    if (m_Job && !m_Job->quality.framesChrono.empty())
-    {
-        auto minmaxq = std::minmax_element(m_Job->quality.framesChrono.begin(),
-                                           m_Job->quality.framesChrono.end());
-        m_MinQ = *minmaxq.first;
-        m_MaxQ = *minmaxq.second;
+    std::shared_ptr<const QualityData_t> prevQuality = m_Quality;
+    const bool prevIsPartial = m_IsPartial;
 
-        m_Histogram.CreateFromData(std::min((size_t)Configuration::NumQualityHistogramBins, m_Job->quality.framesChrono.size()),
-                                   m_Job->quality.framesChrono, m_MinQ, m_MaxQ);
+    m_Quality = (m_Job ? m_Job->quality.data.Get() : nullptr);
+    m_IsPartial = false;
+    if (!m_Quality && m_Job)
+    {
+        m_Quality = m_Job->quality.partialData.Get();
+        m_IsPartial = true;
+    }
 
-        m_JobName.set_text(m_Job->sourcePath);
-        m_Export.set_sensitive(true);
+    if (m_Quality && !m_Quality->framesChrono.empty())
+    {
+        if (m_Quality == prevQuality)
+            ; // nothing changed
+        else if (prevQuality && prevIsPartial && m_IsPartial
+                 && prevQuality->framesChrono.size() <= m_Quality->framesChrono.size()
+                 && prevQuality->framesChrono.back() == m_Quality->framesChrono[prevQuality->framesChrono.size() - 1])
+        {
+            // Partial data of the same quality estimation are extended with the values of subsequent frames
+            UpdateStatistics(prevQuality->framesChrono.size());
+        }
+        else
+            UpdateStatistics(0);
+
+        m_JobName.set_text(m_IsPartial ? Glib::ustring::compose(_("%1 (quality estimation in progress)"), m_Job->sourcePath)
+                                       : Glib::ustring(m_Job->sourcePath));
+        m_Export.set_sensitive(!m_IsPartial);
     }
     else
     {
@@ -262,3 +300,40 @@ void c_QualityWindow::Update()
     if (is_visible())
         queue_draw();
 }
+
+void c_QualityWindow::UpdateStatistics(size_t firstNew)
+{
+    const std::vector<SKRY_quality_t> &framesChrono = m_Quality->framesChrono;
+    const size_t numBins = std::min((size_t)Configuration::NumQualityHistogramBins, framesChrono.size());
+    bool recreateHistogram = (firstNew == 0 || numBins != m_Histogram.GetBins().size());
+
+    if (firstNew == 0)
+    {
+        m_MinQ = m_MaxQ = framesChrono[0];
+        m_ChronoEnvelope.Clear();
+    }
+
+    for (size_t i = firstNew; i < framesChrono.size(); i++)
+    {
+        const SKRY_quality_t q = framesChrono[i];
+        m_ChronoEnvelope.Append(q);
+
+        if (q < m_MinQ || q > m_MaxQ)
+        {
+            // The histogram's range has to be extended
+            m_MinQ = std::min(m_MinQ, q);
+            m_MaxQ = std::max(m_MaxQ, q);
+            recreateHistogram = true;
+        }
+        else if (!recreateHistogram)
+            m_Histogram.Add(q);
+    }
+
+    if (recreateHistogram)
+        m_Histogram.CreateFromData(numBins, framesChrono, m_MinQ, m_MaxQ);
+
+    // Sorted values are all new every time
+    m_SortedEnvelope.Clear();
+    for (const SKRY_quality_t &q: m_Quality->framesSorted)
+        m_SortedEnvelope.Append(q);
+}
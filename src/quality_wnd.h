@@ -44,9 +44,16 @@ public:
 private:
 
     std::shared_ptr<Job_t> m_Job;
+    /// Quality data of 'm_Job' obtained by the last Update(); may be null
+    std::shared_ptr<const QualityData_t> m_Quality;
+    /// 'True' if 'm_Quality' is partial data published during quality estimation
+    bool m_IsPartial = false;
     SKRY_quality_t m_MinQ, m_MaxQ;
     Utils::Types::c_Histogram m_Histogram;
 
+    /// Envelopes of 'm_Quality' (so that drawing the graphs does not depend on the number of frames)
+    Utils::Types::c_MinMaxPyramid<SKRY_quality_t> m_ChronoEnvelope, m_SortedEnvelope;
+
     Gtk::DrawingArea m_DrawArea;
     Gtk::Label m_JobName;
     Gtk::Button m_Export;
@@ -63,6 +70,9 @@ private:
 
     void InitControls();
 
+    /// Adds 'm_Quality' values from 'firstNew' on to the statistics and envelopes
+    void UpdateStatistics(size_t firstNew);
+
     ExportSignal_t m_ExportSignal;
 
 public:
@@ -0,0 +1,172 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Region of interest extraction implementation.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "pix_conv.h"
+#include "roi_extraction.h"
+
+
+c_RoiExtraction::c_RoiExtraction(libskry::c_ImageSequence &imgSeq, const struct SKRY_rect &roi,
+                                 enum SKRY_CFA_pattern cfaPattern, unsigned binning, const std::string &destFileName)
+: m_ImgSeq(imgSeq), m_Roi(roi), m_CfaPattern(cfaPattern), m_Binning(binning), m_Writer(destFileName)
+{
+    m_IsValid = m_Writer && binning > 0 && imgSeq.GetActiveImageCount() > 0;
+}
+
+/// Returns the coordinate of the 'k'-th source pixel binned into the output pixel 'outPos' (relative to the region)
+/** For raw color data, only pixels of the same color are binned, which preserves the filter pattern. */
+inline unsigned c_RoiExtraction::GetSrcPos(unsigned outPos, unsigned k) const
+{
+    if (m_CfaPattern != SKRY_CFA_NONE)
+        return ((outPos / 2) * m_Binning + k) * 2 + outPos % 2;
+    else
+        return outPos * m_Binning + k;
+}
+
+bool c_RoiExtraction::WriteHeader(const libskry::c_Image &img)
+{
+    const enum SKRY_pixel_format pixFmt = img.GetPixelFormat();
+
+    // Images with raw color pixel formats carry their own pattern (unless the job overrides it)
+    if (m_CfaPattern == SKRY_CFA_NONE)
+        m_CfaPattern = PixConv::GetCFAPattern(pixFmt);
+
+    SER::ColorId colorId;
+    if (pixFmt == SKRY_PIX_MONO8 || pixFmt == SKRY_PIX_MONO16)
+        colorId = SER::ColorId::MONO;
+    else if (pixFmt == SKRY_PIX_RGB8 || pixFmt == SKRY_PIX_RGB16)
+        colorId = SER::ColorId::RGB;
+    else if (m_CfaPattern != SKRY_CFA_NONE && NUM_CHANNELS[pixFmt] == 1 &&
+             (BITS_PER_CHANNEL[pixFmt] == 8 || BITS_PER_CHANNEL[pixFmt] == 16))
+    {
+        // Raw color data is stored as mono; the video will be reinterpreted with 'm_CfaPattern'
+        colorId = SER::ColorId::MONO;
+    }
+    else
+        return false;
+
+    if (m_Roi.width == 0 || m_Roi.height == 0)
+        m_Roi = { 0, 0, img.GetWidth(), img.GetHeight() };
+
+    const int right = m_Roi.x + (int)m_Roi.width;
+    const int bottom = m_Roi.y + (int)m_Roi.height;
+    m_Roi.x = std::max(0, std::min(m_Roi.x, (int)img.GetWidth() - 1));
+    m_Roi.y = std::max(0, std::min(m_Roi.y, (int)img.GetHeight() - 1));
+    if (m_CfaPattern != SKRY_CFA_NONE)
+    {
+        // Keep the filter pattern of the extracted region the same as of the whole image
+        m_Roi.x -= m_Roi.x % 2;
+        m_Roi.y -= m_Roi.y % 2;
+    }
+    m_Roi.width = std::max(0, std::min(right, (int)img.GetWidth()) - m_Roi.x);
+    m_Roi.height = std::max(0, std::min(bottom, (int)img.GetHeight()) - m_Roi.y);
+    if (m_CfaPattern != SKRY_CFA_NONE)
+    {
+        m_OutWidth = 2 * (m_Roi.width / 2 / m_Binning);
+        m_OutHeight = 2 * (m_Roi.height / 2 / m_Binning);
+    }
+    else
+    {
+        m_OutWidth = m_Roi.width / m_Binning;
+        m_OutHeight = m_Roi.height / m_Binning;
+    }
+    if (m_OutWidth == 0 || m_OutHeight == 0)
+        return false;
+
+    m_PixFmt = pixFmt;
+    return m_Writer.WriteHeader(colorId, m_OutWidth, m_OutHeight, BITS_PER_CHANNEL[pixFmt],
+                                m_ImgSeq.GetActiveImageCount(), "Stackistry ROI");
+}
+
+template<typename T>
+void c_RoiExtraction::BinRow(const libskry::c_Image &img, unsigned outY, T *outRow) const
+{
+    const unsigned numChannels = NUM_CHANNELS[m_PixFmt];
+    const unsigned numBinned = m_Binning * m_Binning;
+
+    std::vector<uint32_t> sums(m_OutWidth * numChannels, 0);
+    for (unsigned ky = 0; ky < m_Binning; ky++)
+    {
+        const T *srcLine = static_cast<const T *>(img.GetLine(m_Roi.y + GetSrcPos(outY, ky))) + m_Roi.x * numChannels;
+        for (unsigned x = 0; x < m_OutWidth; x++)
+            for (unsigned kx = 0; kx < m_Binning; kx++)
+            {
+                const T *srcPixel = srcLine + GetSrcPos(x, kx) * numChannels;
+                for (unsigned ch = 0; ch < numChannels; ch++)
+                    sums[x * numChannels + ch] += srcPixel[ch];
+            }
+    }
+
+    for (size_t i = 0; i < sums.size(); i++)
+        outRow[i] = (T)((sums[i] + numBinned / 2) / numBinned);
+}
+
+enum SKRY_result c_RoiExtraction::Step()
+{
+    if (m_NextImgIdx >= m_ImgSeq.GetActiveImageCount())
+        return SKRY_LAST_STEP;
+
+    enum SKRY_result result;
+    libskry::c_Image img = m_ImgSeq.GetImageByIdx(m_ImgSeq.GetAbsoluteImgIdx(m_NextImgIdx), &result);
+    if (!img)
+        return result;
+
+    if (m_NextImgIdx == 0 && !WriteHeader(img))
+        return SKRY_UNSUPPORTED_PIXEL_FORMAT;
+
+    if (img.GetPixelFormat() != m_PixFmt ||
+        img.GetWidth() < m_Roi.x + m_Roi.width || img.GetHeight() < m_Roi.y + m_Roi.height)
+    {
+        return SKRY_INVALID_IMG_DIMENSIONS;
+    }
+
+    const size_t bytesPerPixel = NUM_CHANNELS[m_PixFmt] * BITS_PER_CHANNEL[m_PixFmt] / 8;
+    std::vector<uint8_t> row(m_OutWidth * bytesPerPixel);
+    bool writeOk = true;
+    for (unsigned y = 0; y < m_OutHeight; y++)
+    {
+        if (m_Binning == 1)
+            writeOk &= m_Writer.WriteRow(static_cast<const uint8_t *>(img.GetLine(m_Roi.y + y)) + m_Roi.x * bytesPerPixel);
+        else
+        {
+            if (BITS_PER_CHANNEL[m_PixFmt] == 8)
+                BinRow(img, y, row.data());
+            else
+                BinRow(img, y, reinterpret_cast<uint16_t *>(row.data()));
+
+            writeOk &= m_Writer.WriteRow(row.data());
+        }
+    }
+
+    if (!writeOk)
+        return SKRY_CANNOT_CREATE_FILE;
+
+    m_NextImgIdx++;
+    if (m_NextImgIdx == m_ImgSeq.GetActiveImageCount())
+        return (m_Writer.Close() ? SKRY_LAST_STEP : SKRY_CANNOT_CREATE_FILE);
+    else
+        return SKRY_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Region of interest extraction header.
+*/
+
+#ifndef STACKISTRY_ROI_EXTRACTION_HEADER
+#define STACKISTRY_ROI_EXTRACTION_HEADER
+
+#include <string>
+
+#include <skry/skry_cpp.hpp>
+
+#include "ser_writer.h"
+
+
+/// Copies the region of interest of the active images of a sequence to a SER video, optionally binned
+/** Works in steps (one image each), like the libskry processing phases.
+    The resulting video contains only the active images; for raw color input
+    (reinterpreted mono or a raw color pixel format), the region's origin is moved
+    to even coordinates and only pixels of the same color are binned (to preserve
+    the filter pattern); such a video is stored as mono and is expected to be
+    reinterpreted with GetCfaPattern(). */
+class c_RoiExtraction
+{
+public:
+    /** 'roi' is clipped to the images' size; if its width is 0, whole images are copied.
+        'cfaPattern' is the pattern mono images are to be treated with; if SKRY_CFA_NONE,
+        the pattern of raw color pixel formats (if any) is used.
+        Every 'binning' x 'binning' pixels are averaged into one (1 = no binning). */
+    c_RoiExtraction(libskry::c_ImageSequence &imgSeq, const struct SKRY_rect &roi,
+                    enum SKRY_CFA_pattern cfaPattern, unsigned binning, const std::string &destFileName);
+
+    c_RoiExtraction(const c_RoiExtraction &) = delete;
+    c_RoiExtraction &operator =(const c_RoiExtraction &) = delete;
+
+    /// Returns 'false' if the output file could not be created
+    explicit operator bool() const { return m_IsValid; }
+
+    /// Returns SKRY_LAST_STEP after the last image
+    /** Returns SKRY_UNSUPPORTED_PIXEL_FORMAT if the images cannot be stored in a SER video
+        or the region lies outside them. */
+    enum SKRY_result Step();
+
+    /// Index (within the active images' subset) of the image copied by the last Step()
+    size_t GetCurrentImgIdx() const { return m_NextImgIdx - 1; }
+
+    /// Returns the region actually extracted (in the source images' coordinates)
+    const struct SKRY_rect &GetRoi() const { return m_Roi; }
+
+    /// Returns the pattern the extracted video has to be reinterpreted with (valid after the first Step())
+    enum SKRY_CFA_pattern GetCfaPattern() const { return m_CfaPattern; }
+
+private:
+    libskry::c_ImageSequence &m_ImgSeq;
+    struct SKRY_rect m_Roi;
+    enum SKRY_CFA_pattern m_CfaPattern;
+    unsigned m_Binning;
+    unsigned m_OutWidth = 0, m_OutHeight = 0; ///< Size of the output images
+    c_SerWriter m_Writer;
+    bool m_IsValid = false;
+
+    size_t m_NextImgIdx = 0; ///< Index within the active images' subset
+    enum SKRY_pixel_format m_PixFmt = SKRY_PIX_INVALID; ///< Pixel format of the first image
+
+    /// Clips the region to 'img' and writes the SER header; returns 'false' if 'img' cannot be used
+    bool WriteHeader(const libskry::c_Image &img);
+
+    unsigned GetSrcPos(unsigned outPos, unsigned k) const;
+
+    template<typename T>
+    void BinRow(const libskry::c_Image &img, unsigned outY, T *outRow) const;
+};
+
+#endif // STACKISTRY_ROI_EXTRACTION_HEADER
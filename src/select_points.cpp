@@ -21,6 +21,9 @@ File description:
     Point selection dialog implementation.
 */
 
+#include <algorithm>
+#include <cstdlib>
+
 #include <cairomm/surface.h>
 #include <glibmm/i18n.h>
 #include <gtkmm/buttonbox.h>
@@ -43,14 +46,21 @@ c_SelectPointsDlg::c_SelectPointsDlg(const libskry::c_Image &img,
 
     m_ImgView.SetImage(m_Img);
 
-    set_response_sensitive(Gtk::ResponseType::RESPONSE_OK, !m_Points.empty());
+    UpdateOkButtonState();
+}
+
+void c_SelectPointsDlg::UpdateOkButtonState()
+{
+    set_response_sensitive(Gtk::ResponseType::RESPONSE_OK,
+                           // In rectangle mode, no points means "no rectangle"
+                           m_RectangleMode ? m_Points.size() != 1 : !m_Points.empty());
 }
 
 void c_SelectPointsDlg::OnRemoveClick()
 {
     m_Points.clear();
     m_ImgView.SetImage(m_Img);
-    set_response_sensitive(Gtk::ResponseType::RESPONSE_OK, false);
+    UpdateOkButtonState();
 }
 
 void c_SelectPointsDlg::OnAutoClick()
@@ -61,7 +71,7 @@ void c_SelectPointsDlg::OnAutoClick()
     for (auto &autoPt: m_AutomaticPoints)
         m_Points.push_back(autoPt);
 
-    set_response_sensitive(Gtk::ResponseType::RESPONSE_OK, true);
+    UpdateOkButtonState();
 }
 
 void c_SelectPointsDlg::InitControls(bool hasAutoBtn)
@@ -76,6 +86,14 @@ void c_SelectPointsDlg::InitControls(bool hasAutoBtn)
                                        m_ImgView.GetZoomPercentVal() * pt.x / 100,
                                        m_ImgView.GetZoomPercentVal() * pt.y / 100);
 
+            struct SKRY_rect rect;
+            if (GetRectangle(rect))
+            {
+                const double zoom = m_ImgView.GetZoomPercentVal() / 100.0;
+                cr->rectangle(zoom * rect.x, zoom * rect.y, zoom * rect.width, zoom * rect.height);
+                cr->stroke();
+            }
+
             return false;
         }
     ));
@@ -130,10 +148,16 @@ bool c_SelectPointsDlg::OnImageBtnPress(GdkEventButton *event)
         if (imgX >= 0 && imgX < m_ImgView.GetImage()->get_width() &&
             imgY >= 0 && imgY < m_ImgView.GetImage()->get_height())
         {
+            if (m_RectangleMode && m_Points.size() == 2)
+            {
+                m_Points.clear();
+                m_ImgView.SetImage(m_Img);
+            }
+
             m_Points.push_back({ imgX, imgY });
             m_ImgView.Refresh();
 
-            set_response_sensitive(Gtk::ResponseType::RESPONSE_OK, true);
+            UpdateOkButtonState();
         }
     }
     return true;
@@ -155,3 +179,26 @@ void c_SelectPointsDlg::SetInfoText(std::string text)
     else
         m_InfoText.show();
 }
+
+void c_SelectPointsDlg::SetRectangleMode()
+{
+    m_RectangleMode = true;
+    if (m_Points.size() > 2)
+        m_Points.clear();
+    m_ImgView.Refresh();
+    UpdateOkButtonState();
+}
+
+bool c_SelectPointsDlg::GetRectangle(struct SKRY_rect &rect) const
+{
+    if (!m_RectangleMode || m_Points.size() != 2)
+        return false;
+
+    const struct SKRY_point &p0 = m_Points[0], &p1 = m_Points[1];
+    rect.x = std::min(p0.x, p1.x);
+    rect.y = std::min(p0.y, p1.y);
+    // Both corners are included
+    rect.width = std::abs(p1.x - p0.x) + 1;
+    rect.height = std::abs(p1.y - p0.y) + 1;
+    return true;
+}
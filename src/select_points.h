@@ -38,6 +38,7 @@ class c_SelectPointsDlg: public Gtk::Dialog
     std::vector<struct SKRY_point> m_Points;
     std::vector<struct SKRY_point> m_AutomaticPoints;
     Gtk::Label m_InfoText;
+    bool m_RectangleMode = false;
 
     // Signal handlers -------------
     bool OnImageBtnPress(GdkEventButton *event);
@@ -46,6 +47,7 @@ class c_SelectPointsDlg: public Gtk::Dialog
     //------------------------------
 
     void InitControls(bool hasAutoBtn);
+    void UpdateOkButtonState();
 
 public:
     c_SelectPointsDlg(const libskry::c_Image &img,
@@ -57,4 +59,12 @@ public:
     void GetPoints(std::vector<struct SKRY_point> &points) const;
 
     void SetInfoText(std::string text);
+
+    /// Makes the dialog select a rectangle instead of points
+    /** The first two points are the rectangle's opposite corners; a third click starts a new rectangle.
+        The dialog can also be accepted with no points (i.e. no rectangle). */
+    void SetRectangleMode();
+
+    /// Returns 'false' if no rectangle has been selected
+    bool GetRectangle(struct SKRY_rect &rect) const;
 };
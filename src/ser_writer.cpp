@@ -0,0 +1,139 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    SER video writer implementation.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "ser_writer.h"
+
+
+namespace SER
+{
+    const char FILE_ID[] = "LUCAM-RECORDER";
+    const size_t STRING_FIELD_LENGTH = 40;
+
+    static unsigned GetNumChannels(ColorId colorId)
+    {
+        return ((uint32_t)colorId >= (uint32_t)ColorId::RGB ? 3 : 1);
+    }
+
+    size_t Header_t::GetFrameSize() const
+    {
+        return (size_t)width * height * GetNumChannels(colorId) * (bitsPerChannel > 8 ? 2 : 1);
+    }
+
+    static uint32_t GetLE32(const std::vector<uint8_t> &buf, size_t offset)
+    {
+        return buf[offset] | buf[offset + 1] << 8 | buf[offset + 2] << 16 | (uint32_t)buf[offset + 3] << 24;
+    }
+
+    bool ReadHeader(const std::string &fileName, Header_t &header)
+    {
+        std::ifstream file(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+        std::vector<uint8_t> buf(HEADER_SIZE);
+        file.read(reinterpret_cast<char *>(buf.data()), buf.size());
+        if (file.fail() || 0 != memcmp(buf.data(), FILE_ID, strlen(FILE_ID)))
+            return false;
+
+        header.colorId = (ColorId)GetLE32(buf, 18);
+        header.width = GetLE32(buf, 26);
+        header.height = GetLE32(buf, 30);
+        header.bitsPerChannel = GetLE32(buf, 34);
+        header.numFrames = GetLE32(buf, 38);
+        header.littleEndian = GetLE32(buf, 22);
+
+        return header.width > 0 && header.height > 0 && header.bitsPerChannel > 0 && header.bitsPerChannel <= 16;
+    }
+}
+
+static void PutLE32(std::vector<uint8_t> &buf, size_t offset, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        buf[offset + i] = (value >> (8 * i)) & 0xFF;
+}
+
+static bool IsHostLittleEndian()
+{
+    const uint16_t value = 1;
+    return *reinterpret_cast<const uint8_t *>(&value) == 1;
+}
+
+c_SerWriter::c_SerWriter(const std::string &fileName)
+{
+    m_File.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+}
+
+bool c_SerWriter::WriteHeader(SER::ColorId colorId, unsigned width, unsigned height, unsigned bitsPerChannel,
+                              size_t numFrames, const std::string &instrument, uint32_t littleEndian)
+{
+    std::vector<uint8_t> header(SER::HEADER_SIZE, 0);
+    memcpy(header.data(), SER::FILE_ID, strlen(SER::FILE_ID));
+    PutLE32(header, 18, (uint32_t)colorId);
+    // The data written by WriteRow() are little-endian; most capture programs (and readers)
+    // use 0 for that, contrary to the wording of the format's specification
+    PutLE32(header, 22, littleEndian);
+    PutLE32(header, 26, width);
+    PutLE32(header, 30, height);
+    PutLE32(header, 34, bitsPerChannel);
+    PutLE32(header, 38, numFrames);
+    memcpy(header.data() + 42 + SER::STRING_FIELD_LENGTH, instrument.c_str(),
+           std::min(instrument.size(), SER::STRING_FIELD_LENGTH));
+
+    m_File.write(reinterpret_cast<const char *>(header.data()), header.size());
+
+    m_RowBytes = width * SER::GetNumChannels(colorId) * (bitsPerChannel > 8 ? 2 : 1);
+    m_SwapBytes = (bitsPerChannel > 8 && !IsHostLittleEndian());
+    if (m_SwapBytes)
+        m_SwappedRow.resize(m_RowBytes);
+
+    return !m_File.fail();
+}
+
+bool c_SerWriter::WriteRow(const void *pixels)
+{
+    const uint8_t *row = static_cast<const uint8_t *>(pixels);
+    if (m_SwapBytes)
+    {
+        for (size_t i = 0; i + 1 < m_RowBytes; i += 2)
+        {
+            m_SwappedRow[i] = row[i + 1];
+            m_SwappedRow[i + 1] = row[i];
+        }
+        row = m_SwappedRow.data();
+    }
+
+    m_File.write(reinterpret_cast<const char *>(row), m_RowBytes);
+    return !m_File.fail();
+}
+
+bool c_SerWriter::WriteFrameData(const void *data, size_t numBytes)
+{
+    m_File.write(static_cast<const char *>(data), numBytes);
+    return !m_File.fail();
+}
+
+bool c_SerWriter::Close()
+{
+    m_File.close();
+    return !m_File.fail();
+}
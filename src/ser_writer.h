@@ -0,0 +1,95 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    SER video writer header.
+*/
+
+#ifndef STACKISTRY_SER_WRITER_HEADER
+#define STACKISTRY_SER_WRITER_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace SER
+{
+    const size_t HEADER_SIZE = 178;
+
+    /// Values of the header's "ColorID" field
+    /** Values 8-19 denote raw color (single channel) data, values >= 100 three channels. */
+    enum class ColorId: uint32_t { MONO = 0, RGB = 100 };
+
+    struct Header_t
+    {
+        ColorId colorId;
+        unsigned width, height;
+        unsigned bitsPerChannel;
+        size_t numFrames; ///< As stored in the header; may be 0 in a file being recorded
+        /// Value of the "LittleEndian" field (programs disagree on its meaning, so it is only passed on when copying frames)
+        uint32_t littleEndian;
+
+        size_t GetFrameSize() const;
+    };
+
+    /// Returns 'false' if 'fileName' is not a SER video
+    bool ReadHeader(const std::string &fileName, Header_t &header);
+}
+
+/// Writes a SER video row by row
+/** Raw color data are stored as mono (the reader has to know the filter pattern). */
+class c_SerWriter
+{
+public:
+    /// Creates (or truncates) the file; check the result with operator bool
+    c_SerWriter(const std::string &fileName);
+
+    c_SerWriter(const c_SerWriter &) = delete;
+    c_SerWriter &operator =(const c_SerWriter &) = delete;
+
+    /// Returns 'false' if the file could not be created or written to
+    explicit operator bool() const { return !m_File.fail(); }
+
+    /// Has to be called once, before writing any rows
+    /** 'bitsPerChannel' is 1 to 16 (values above 8 are stored as 16 bits); 'instrument' is stored in the header's "Instrument" field.
+        'littleEndian' is stored in the "LittleEndian" field; the default matches the data written by WriteRow().
+        When copying frames of another video with WriteFrameData(), pass that video's value. */
+    bool WriteHeader(SER::ColorId colorId, unsigned width, unsigned height, unsigned bitsPerChannel,
+                     size_t numFrames, const std::string &instrument, uint32_t littleEndian = 0);
+
+    /// Writes the next row of pixels (in the host's byte order) of the current frame
+    bool WriteRow(const void *pixels);
+
+    /// Writes whole frames already in the file's byte order (e.g. copied from another SER video)
+    bool WriteFrameData(const void *data, size_t numBytes);
+
+    /// Returns 'false' if any of the writes failed
+    bool Close();
+
+private:
+    std::ofstream m_File;
+    size_t m_RowBytes = 0;
+    bool m_SwapBytes = false; ///< Set if 16-bit values have to be stored in the opposite byte order
+    std::vector<uint8_t> m_SwappedRow;
+};
+
+#endif // STACKISTRY_SER_WRITER_HEADER
@@ -21,6 +21,7 @@ File description:
     Processing settings dialog implementation.
 */
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
@@ -32,6 +33,7 @@ File description:
 #include <gtkmm/textview.h>
 
 #include "config.h"
+#include "frame_cache.h"
 #include "settings_dlg.h"
 #include "utils.h"
 
@@ -84,16 +86,20 @@ c_SettingsDlg::c_SettingsDlg(const std::vector<std::string> &jobNames, const Job
         m_FlatFieldChooser.set_filename(firstJob.flatFieldFileName);
 
     m_ExportQualityData.set_active(firstJob.exportQualityData);
+    m_OverlapQualityRead.set_active(firstJob.overlapQualityRead);
+    m_UseAnalysisCache.set_active(firstJob.useAnalysisCache);
+    m_QuickLookBinning.set_active(std::min(std::max(firstJob.binning, 1U), Utils::Const::maxQuickLookBinning) - 1);
 
     m_AlignmentMethod.set_active((int)firstJob.alignmentMethod);
     m_VideoStbAnchorsMode.set_active(firstJob.automaticAnchorPlacement ? 0 : 1);
     m_QualityCriterion.set_active((int)firstJob.quality.criterion);
     m_QualityThreshold.set_value(firstJob.quality.threshold);
+    m_AdditionalThresholds.set_text(Utils::FormatUnsignedList(firstJob.quality.additionalThresholds));
 
     size_t index = 0;
     for (auto &descr: Utils::Vars::outputFormatDescription)
     {
-        if (descr.skryOutpFmt == firstJob.outputFmt)
+        if (descr.outputFmt == firstJob.outputFmt)
             m_AutoSaveOutputFormat.set_active(index);
         else
             index++;
@@ -145,11 +151,14 @@ void c_SettingsDlg::ApplySettings(Job_t &job)
     job.flatFieldFileName = m_FlatFieldChooser.get_filename();
     job.quality.criterion = (enum SKRY_quality_criterion)m_QualityCriterion.get_active_row_number();
     job.quality.threshold = m_QualityThreshold.get_value_as_int();
-    job.outputFmt = Utils::Vars::outputFormatDescription[m_AutoSaveOutputFormat.get_active_row_number()].skryOutpFmt;
+    if (!Utils::ParseUnsignedList(m_AdditionalThresholds.get_text(), job.quality.additionalThresholds))
+        job.quality.additionalThresholds.clear();
+    job.outputFmt = Utils::Vars::outputFormatDescription[m_AutoSaveOutputFormat.get_active_row_number()].outputFmt;
     job.cfaPattern = m_TreatMonoAsCFA.get_active()
                      ? (enum SKRY_CFA_pattern)m_CFAPattern.get_active_row_number()
                      : SKRY_CFA_NONE;
     job.imgSeq.ReinterpretAsCFA(job.cfaPattern);
+    FrameCache::Invalidate(job.frameCacheId); // decoded frames depend on the CFA pattern
 
     job.automaticAnchorPlacement = (m_VideoStbAnchorsMode.get_active_row_number() == 0);
     if (job.automaticAnchorPlacement)
@@ -161,6 +170,9 @@ void c_SettingsDlg::ApplySettings(Job_t &job)
     job.refPtAutoPlacementParams.structureScale = (unsigned)m_StructureScale.get_value();
 
     job.exportQualityData = m_ExportQualityData.get_active();
+    job.overlapQualityRead = m_OverlapQualityRead.get_active();
+    job.useAnalysisCache = m_UseAnalysisCache.get_active();
+    job.binning = m_QuickLookBinning.get_active_row_number() + 1;
 }
 
 void c_SettingsDlg::InitRefPointControls()
@@ -268,6 +280,30 @@ void c_SettingsDlg::InitControls(const std::vector<std::string> &jobNames)
                                                                     &m_VideoStbAnchorsModeLabel, &m_VideoStbAnchorsMode }),
                                    Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
 
+    m_OverlapQualityRead.set_label(_("Read quality estimation input during video stabilization"));
+    m_OverlapQualityRead.set_tooltip_text(_("Starts reading the frames for quality estimation in background while "
+                                            "video stabilization is finishing (speeds up processing of files on slow storage)"));
+    m_OverlapQualityRead.show();
+    get_content_area()->pack_start(m_OverlapQualityRead, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
+    m_UseAnalysisCache.set_label(_("Keep analysis results next to the input"));
+    m_UseAnalysisCache.set_tooltip_text(_("Saves the frame quality to a file next to the input, so that it is available "
+                                          "as soon as the input is processed again (with the same alignment settings)"));
+    m_UseAnalysisCache.show();
+    get_content_area()->pack_start(m_UseAnalysisCache, Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
+    auto lQuickLook = Gtk::manage(new Gtk::Label(_("Quick look:")));
+    lQuickLook->show();
+    m_QuickLookBinning.append(_("off"));
+    for (unsigned binning = 2; binning <= Utils::Const::maxQuickLookBinning; binning++)
+        m_QuickLookBinning.append(Glib::ustring::compose(_("%1\u00D7%1 binning"), binning)); // \u00D7 = multiplication sign
+    m_QuickLookBinning.set_active(0);
+    m_QuickLookBinning.set_tooltip_text(_("Stacks binned frames (much faster); the reference point settings are scaled "
+                                          "accordingly and can be used unchanged for full-resolution processing"));
+    m_QuickLookBinning.show();
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>({ lQuickLook, &m_QuickLookBinning }),
+                                   Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
     InitRefPointControls();
 
     auto lStack = Gtk::manage(new Gtk::Label(_("Stacking criterion:")));
@@ -286,6 +322,12 @@ void c_SettingsDlg::InitControls(const std::vector<std::string> &jobNames)
     get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>({ lStack, &m_QualityThreshold, &m_QualityCriterion }),
                                    Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
 
+    auto lAdditionalThresholds = Gtk::manage(new Gtk::Label(_("Also stack with thresholds:")));
+    m_AdditionalThresholds.set_tooltip_text(_("Comma-separated list of thresholds (e.g. 10,20,30); an additional stack "
+                                              "is produced for each of them, sharing image alignment and quality estimation"));
+    get_content_area()->pack_start(*Utils::PackIntoBox<Gtk::HBox>({ lAdditionalThresholds, &m_AdditionalThresholds }),
+                                   Gtk::PackOptions::PACK_SHRINK, Utils::Const::widgetPaddingInPixels);
+
 
     auto lOutp = Gtk::manage(new Gtk::Label());
     lOutp->set_text(_("Save stacked image automatically:"));
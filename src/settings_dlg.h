@@ -29,6 +29,7 @@ File description:
 #include <gtkmm/box.h>
 #include <gtkmm/checkbutton.h>
 #include <gtkmm/dialog.h>
+#include <gtkmm/entry.h>
 #include <gtkmm/comboboxtext.h>
 #include <gtkmm/filechooserbutton.h>
 #include <gtkmm/spinbutton.h>
@@ -60,6 +61,10 @@ private:
     Gtk::ComboBoxText m_CFAPattern;
     Gtk::ComboBoxText m_AlignmentMethod;
     Gtk::CheckButton m_ExportQualityData;
+    Gtk::CheckButton m_OverlapQualityRead;
+    Gtk::CheckButton m_UseAnalysisCache;
+    Gtk::ComboBoxText m_QuickLookBinning;
+    Gtk::Entry m_AdditionalThresholds;
 
     // Reference point placement parameters
     Gtk::ComboBoxText m_RefPtPlacementMode;
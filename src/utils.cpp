@@ -23,16 +23,28 @@ File description:
 
 #include <cassert>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
 
 #include <cairomm/context.h>
 #include <cairomm/surface.h>
+#include <glib/gstdio.h>
+#include <glibmm/fileutils.h>
 #include <glibmm/i18n.h>
 #include <glibmm/miscutils.h>
 #include <gtkmm/cssprovider.h>
 
 #include "config.h"
+#include "image_writer.h"
+#include "pix_conv.h"
 #include "utils.h"
 
 
@@ -45,25 +57,87 @@ namespace Vars
     std::string appLaunchPath; ///< Value of argv[0]
 }
 
-Cairo::RefPtr<Cairo::ImageSurface> ConvertImgToSurface(const libskry::c_Image &img)
+/// Returns 'dest' (flushed) if it is an RGB24 surface of the specified size; otherwise creates a new one
+static Cairo::RefPtr<Cairo::ImageSurface> GetRGB24Surface(const Cairo::RefPtr<Cairo::ImageSurface> &dest, int width, int height)
 {
-    libskry::c_Image imgBgra;
+    if (!dest || dest->get_format() != Cairo::Format::FORMAT_RGB24 ||
+        dest->get_width() != width || dest->get_height() != height)
+    {
+        return Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, width, height);
+    }
+
+    dest->flush();
+    return dest;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> ConvertImgToSurface(const libskry::c_Image &img,
+                                                       const Cairo::RefPtr<Cairo::ImageSurface> &dest,
+                                                       const struct SKRY_rect *srcRect)
+{
+    struct SKRY_rect rect;
+    if (srcRect)
+        rect = *srcRect;
+    else
+    {
+        rect.x = 0;
+        rect.y = 0;
+        rect.width = img.GetWidth();
+        rect.height = img.GetHeight();
+    }
+    assert(rect.x >= 0 && rect.y >= 0 &&
+           rect.x + rect.width <= img.GetWidth() && rect.y + rect.height <= img.GetHeight());
 
-    const libskry::c_Image *pRgba;
-    if (img.GetPixelFormat() != SKRY_PIX_BGRA8)
+    // Raw color images are demosaiced directly (only the converted fragment); other formats
+    // without a direct conversion (palettized) go through an intermediate image
+    const bool isCFA = (PixConv::GetCFAPattern(img.GetPixelFormat()) != SKRY_CFA_NONE);
+    libskry::c_Image imgBgra;
+    const libskry::c_Image *src = &img;
+    if (!isCFA && !PixConv::IsSupported(img.GetPixelFormat()))
     {
         imgBgra = libskry::c_Image::ConvertPixelFormat(img, SKRY_PIX_BGRA8);
         if (!imgBgra)
             return Cairo::RefPtr<Cairo::ImageSurface>(nullptr);
+        src = &imgBgra;
+    }
+
+    Cairo::RefPtr<Cairo::ImageSurface> surface = GetRGB24Surface(dest, rect.width, rect.height);
+
+    const enum SKRY_pixel_format pixFmt = src->GetPixelFormat();
+    const size_t bytesPerPixel = NUM_CHANNELS[pixFmt] * BITS_PER_CHANNEL[pixFmt] / 8;
+
+    for (unsigned row = 0; row < rect.height; row++)
+    {
+        uint32_t *destLine = reinterpret_cast<uint32_t *>(surface->get_data() + row * surface->get_stride());
+        if (isCFA)
+            PixConv::DemosaicRow(img, rect.y + row, rect.x, rect.width, destLine);
         else
-            pRgba = &imgBgra;
+        {
+            const uint8_t *srcLine = static_cast<const uint8_t *>(src->GetLine(rect.y + row)) + rect.x * bytesPerPixel;
+            PixConv::ConvertRow(srcLine, pixFmt, rect.width, destLine);
+        }
     }
-    else
-        pRgba = &img;
+    surface->mark_dirty();
+
+    return surface;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> ConvertCFAImgToHalfResSurface(const libskry::c_Image &img,
+                                                                 const Cairo::RefPtr<Cairo::ImageSurface> &dest,
+                                                                 const struct SKRY_rect &srcRect)
+{
+    assert(srcRect.x % 2 == 0 && srcRect.y % 2 == 0 && srcRect.width >= 2 && srcRect.height >= 2 &&
+           srcRect.x + srcRect.width <= img.GetWidth() && srcRect.y + srcRect.height <= img.GetHeight());
 
-    Cairo::RefPtr<Cairo::ImageSurface> surface = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, img.GetWidth(), img.GetHeight());
-    for (unsigned row = 0; row < pRgba->GetHeight(); row++)
-        std::memcpy(surface->get_data() + row * surface->get_stride(), pRgba->GetLine(row), surface->get_stride());
+    if (PixConv::GetCFAPattern(img.GetPixelFormat()) == SKRY_CFA_NONE)
+        return Cairo::RefPtr<Cairo::ImageSurface>(nullptr);
+
+    Cairo::RefPtr<Cairo::ImageSurface> surface = GetRGB24Surface(dest, srcRect.width / 2, srcRect.height / 2);
+    for (int row = 0; row < surface->get_height(); row++)
+    {
+        PixConv::DemosaicRowHalfRes(img, srcRect.y / 2 + row, srcRect.x / 2, surface->get_width(),
+                                    reinterpret_cast<uint32_t *>(surface->get_data() + row * surface->get_stride()));
+    }
+    surface->mark_dirty();
 
     return surface;
 }
@@ -94,7 +168,7 @@ void EnumerateSupportedOutputFmts()
     {
         Vars::outputFormatDescription.push_back(Vars::OutputFormatDescr_t());
         Vars::OutputFormatDescr_t &descr = Vars::outputFormatDescription.back();
-        descr.skryOutpFmt = (enum SKRY_output_format)supportedFmts[i];
+        descr.outputFmt = (enum SKRY_output_format)supportedFmts[i];
 
         switch (supportedFmts[i])
         {
@@ -117,6 +191,12 @@ void EnumerateSupportedOutputFmts()
             break;
         }
     }
+
+    // Written by Stackistry itself
+    Vars::outputFormatDescription.push_back({ ImageWriter::OwnFormat::TIFF_32F, _("TIFF 32-bit floating-point (uncompressed)"),
+                                              { "*.tif", "*.tiff" }, ".tif" });
+    Vars::outputFormatDescription.push_back({ ImageWriter::OwnFormat::FITS_32F, _("FITS 32-bit floating-point"),
+                                              { "*.fits", "*.fit", "*.fts" }, ".fits" });
 }
 
 void RestorePosSize(const Gdk::Rectangle &posSize, Gtk::Window &wnd)
@@ -137,12 +217,12 @@ void SavePosSize(const Gtk::Window &wnd, c_Property<Gdk::Rectangle> &destination
     destination = posSize;
 }
 
-enum SKRY_pixel_format FindMatchingFormat(enum SKRY_output_format outputFmt, size_t numChannels)
+enum SKRY_pixel_format FindMatchingFormat(const ImageWriter::OutputFormat_t &outputFmt, size_t numChannels)
 {
     for (int i = SKRY_PIX_INVALID+1; i < SKRY_NUM_PIX_FORMATS; i++)
         if (i != SKRY_PIX_PAL8
             && NUM_CHANNELS[i] == numChannels
-            && OUTPUT_FMT_BITS_PER_CHANNEL[outputFmt] == BITS_PER_CHANNEL[i])
+            && ImageWriter::GetBitsPerChannel(outputFmt) == BITS_PER_CHANNEL[i])
         {
             return (SKRY_pixel_format)i;
         }
@@ -150,11 +230,11 @@ enum SKRY_pixel_format FindMatchingFormat(enum SKRY_output_format outputFmt, siz
     return SKRY_PIX_INVALID;
 }
 
-const Vars::OutputFormatDescr_t &GetOutputFormatDescr(enum SKRY_output_format outpFmt)
+const Vars::OutputFormatDescr_t &GetOutputFormatDescr(const ImageWriter::OutputFormat_t &outpFmt)
 {
     for (auto &descr: Vars::outputFormatDescription)
     {
-        if (descr.skryOutpFmt == outpFmt)
+        if (descr.outputFmt == outpFmt)
             return descr;
     }
 
@@ -251,4 +331,108 @@ void SetColor(const Cairo::RefPtr<Cairo::Context> &cr, const GdkRGBA &color)
     cr->set_source_rgba(color.red, color.green, color.blue, color.alpha);
 }
 
+bool ParseUnsignedList(const std::string &str, std::vector<unsigned> &values)
+{
+    values.clear();
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        std::stringstream parser(item);
+        unsigned value;
+        parser >> value;
+        if (parser.fail() || value == 0 || !(parser >> std::ws).eof())
+            return false;
+        values.push_back(value);
+    }
+    return true;
+}
+
+std::string FormatUnsignedList(const std::vector<unsigned> &values)
+{
+    std::stringstream ss;
+    for (size_t i = 0; i < values.size(); i++)
+        ss << (i > 0 ? "," : "") << values[i];
+    return ss.str();
+}
+
+std::vector<std::string> ListImageFiles(const std::string &dir)
+{
+    std::vector<std::string> fileNames;
+    try
+    {
+        for (const std::string &name: Glib::Dir(dir))
+        {
+            const std::string ext = Glib::ustring(name.substr(name.find_last_of('.') + 1)).lowercase();
+            const std::string fullPath = Glib::build_filename(dir, name);
+            if (name.find('.') != std::string::npos && (ext == "bmp" || ext == "tif" || ext == "tiff") &&
+                Glib::file_test(fullPath, Glib::FileTest::FILE_TEST_IS_REGULAR))
+            {
+                fileNames.push_back(fullPath);
+            }
+        }
+    }
+    catch (const Glib::FileError &)
+    {
+        fileNames.clear();
+    }
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+std::string CreateTempFile(const char *nameTemplate)
+{
+    gchar *fileName = nullptr;
+    GError *error = nullptr;
+    const int fd = g_file_open_tmp(nameTemplate, &fileName, &error);
+    if (fd < 0)
+    {
+        std::cerr << "Could not create a temporary file: " << error->message << std::endl;
+        g_error_free(error);
+        return "";
+    }
+    g_close(fd, nullptr);
+
+    std::string result(fileName);
+    g_free(fileName);
+    return result;
+}
+
+std::string JsonString(const std::string &s)
+{
+    std::ostringstream result;
+    result << '"';
+    for (unsigned char c: s)
+    {
+        if (c == '"' || c == '\\')
+            result << '\\' << c;
+        else if (c < 0x20)
+            result << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (unsigned)c << std::dec;
+        else
+            result << c;
+    }
+    result << '"';
+    return result.str();
+}
+
+uint64_t GetPeakMemoryUsage()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    else
+        return 0;
+#else
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage))
+        return 0;
+  #if defined(__APPLE__)
+    return usage.ru_maxrss; // in bytes
+  #else
+    return (uint64_t)usage.ru_maxrss * 1024; // in kilobytes
+  #endif
+#endif
+}
+
 }
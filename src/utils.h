@@ -26,7 +26,10 @@ File description:
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -38,6 +41,8 @@ File description:
 #include <gtkmm/window.h>
 #include <skry/skry_cpp.hpp>
 
+#include "image_writer.h"
+
 
 namespace Utils
 {
@@ -61,6 +66,38 @@ namespace Types
         operator T() const { return m_Getter(); }
     };
 
+    /// Immutable value of type T, replaced as a whole by a single writer and read from any thread
+    /** Readers hold a reference to the value they obtained, so it stays valid
+        (and unchanged) after a new one is published. */
+    template <typename T>
+    class c_Published
+    {
+        std::shared_ptr<const T> m_Value;
+
+    public:
+        /// Returns null if nothing has been published
+        std::shared_ptr<const T> Get() const { return std::atomic_load(&m_Value); }
+
+        void Publish(const std::shared_ptr<const T> &value) { std::atomic_store(&m_Value, value); }
+
+        void Reset() { Publish(nullptr); }
+    };
+
+    /// Atomic variable which can be copied, so that it can be a member of e.g. Job_t
+    /** A copy is made with a plain load and store; it is meant for initialization only. */
+    template <typename T>
+    class c_CopyableAtomic: public std::atomic<T>
+    {
+    public:
+        c_CopyableAtomic(T value = T()): std::atomic<T>(value) { }
+
+        c_CopyableAtomic(const c_CopyableAtomic &other): std::atomic<T>(other.load()) { }
+
+        c_CopyableAtomic &operator =(const c_CopyableAtomic &other) { this->store(other.load()); return *this; }
+
+        T operator =(T value) { this->store(value); return value; }
+    };
+
     class IValidatedInput
     {
     public:
@@ -71,10 +108,22 @@ namespace Types
     {
         std::vector<size_t> Bins;
         size_t MaxBinCount; ///< Max value in 'Bins'
+        double ValMin, ValMax; ///< Range of values specified in CreateFromData()
+
+        template<typename T>
+        size_t GetBinIdx(T v) const
+        {
+            if (v == ValMin)
+                return 0;
+            else if (v == ValMax)
+                return Bins.size() - 1;
+            else
+                return static_cast<size_t>((v - ValMin) / (ValMax - ValMin) * Bins.size());
+        }
 
     public:
 
-        c_Histogram(): MaxBinCount(0) { }
+        c_Histogram(): MaxBinCount(0), ValMin(0), ValMax(0) { }
 
         /// Uses only elements of 'vals' that are >= 'valMin' and <= 'valMax'
         template<typename T>
@@ -82,27 +131,105 @@ namespace Types
         {
             assert(valMax >= valMin);
             Bins.assign(numBins, 0);
+            ValMin = valMin;
+            ValMax = valMax;
 
             for (const T &v: vals)
-            {
-                size_t binIdx;
-                if (v == valMin)
-                    binIdx = 0;
-                else if (v == valMax)
-                    binIdx = numBins - 1;
-                else
-                    binIdx = static_cast<size_t>((v - valMin) / (valMax - valMin) * numBins);
-
-                Bins[binIdx]++;
-            }
+                Bins[GetBinIdx(v)]++;
 
             MaxBinCount = *std::max_element(Bins.begin(), Bins.end());
         }
 
+        /// Adds a value to the histogram created by CreateFromData()
+        /** Returns 'false' (and does nothing) if 'v' is outside the range specified then. */
+        template<typename T>
+        bool Add(T v)
+        {
+            if (Bins.empty() || v < ValMin || v > ValMax)
+                return false;
+
+            size_t &bin = Bins[GetBinIdx(v)];
+            bin++;
+            MaxBinCount = std::max(MaxBinCount, bin);
+            return true;
+        }
+
         size_t GetMaxBinCount() const { return MaxBinCount; }
 
         const std::vector<size_t> &GetBins() const { return Bins; }
     };
+
+    /// Sequence of values with precomputed minima and maxima of blocks of 2^k consecutive values
+    /** Finding the min. and max. of any range takes O(log(num. of values)). */
+    template<typename T>
+    class c_MinMaxPyramid
+    {
+        struct MinMax_t { T min, max; };
+
+        /// Level k contains min. and max. of consecutive blocks of 2^k values (the last one may be incomplete)
+        std::vector<std::vector<MinMax_t>> m_Levels;
+
+    public:
+
+        void Clear() { m_Levels.clear(); }
+
+        /// Takes O(log(num. of values))
+        void Append(T value)
+        {
+            if (m_Levels.empty())
+                m_Levels.emplace_back();
+            m_Levels[0].push_back({ value, value });
+
+            for (size_t k = 1; m_Levels[k-1].size() > 1; k++)
+            {
+                if (k == m_Levels.size())
+                    m_Levels.emplace_back();
+
+                const std::vector<MinMax_t> &lower = m_Levels[k-1];
+                const size_t blockIdx = (lower.size() - 1) / 2;
+                MinMax_t block = lower[2*blockIdx];
+                if (2*blockIdx + 1 < lower.size())
+                {
+                    block.min = std::min(block.min, lower[2*blockIdx + 1].min);
+                    block.max = std::max(block.max, lower[2*blockIdx + 1].max);
+                }
+
+                if (blockIdx == m_Levels[k].size())
+                    m_Levels[k].push_back(block);
+                else
+                    m_Levels[k][blockIdx] = block;
+            }
+        }
+
+        size_t GetSize() const { return m_Levels.empty() ? 0 : m_Levels[0].size(); }
+
+        T GetValue(size_t idx) const { return m_Levels[0][idx].min; }
+
+        /// Finds the min. and max. of values [begin; end)
+        void GetMinMax(size_t begin, size_t end, T &minValue, T &maxValue) const
+        {
+            assert(begin < end && end <= GetSize());
+            minValue = maxValue = GetValue(begin);
+
+            size_t i = begin;
+            while (i < end)
+            {
+                // Use the largest block starting at 'i' and not exceeding 'end'
+                size_t k = 0;
+                while (k + 1 < m_Levels.size()
+                       && (i & ((size_t(2) << k) - 1)) == 0
+                       && i + (size_t(2) << k) <= end)
+                {
+                    k++;
+                }
+
+                const MinMax_t &block = m_Levels[k][i >> k];
+                minValue = std::min(minValue, block.min);
+                maxValue = std::max(maxValue, block.max);
+                i += size_t(1) << k;
+            }
+        }
+    };
 }
 
 namespace Const
@@ -110,6 +237,25 @@ namespace Const
     const int refPtDrawRadius = 10;
     const guint widgetPaddingInPixels = 5;
     const unsigned imgAlignmentRefBlockSize = 32;
+    const unsigned qualityEstimationAreaSize = 40;
+    const unsigned qualityEstimationDetailScale = 3;
+    /// Max. binning factor of the quick look mode
+    const unsigned maxQuickLookBinning = 3;
+    /// Live stacking: min. and max. number of new frames processed at a time
+    const unsigned liveStackingMinBatch = 10;
+    const unsigned liveStackingMaxBatch = 200;
+    /// Live stacking: max. offset (in pixels) searched for when registering a batch's stack by block matching
+    const unsigned liveStackingSearchRadius = 64;
+    /// Live stacking: interval between checks for new frames
+    const unsigned liveStackingPollIntervalMs = 2000;
+    /// Min. interval between publications of partial quality data during quality estimation
+    const double partialQualityDataIntervalSec = 0.5;
+    /// Max. amount of memory held by outputs waiting to be written in background (see c_OutputWriter)
+    const size_t outputWriterMaxPendingBytes = 1024 * 1024 * 1024;
+    /// Max. number of threads opening the inputs of added jobs (see c_JobLoader)
+    const unsigned jobLoaderMaxThreads = 4;
+    /// Number of image rows converted at a time when saving (see ImageWriter)
+    const unsigned imageWriterStripHeight = 64;
 
     enum MouseButtons { left = 1, MIDDLE = 2, RIGHT = 3 };
 
@@ -125,7 +271,7 @@ namespace Const
     namespace Defaults
     {
         const OutputSaveMode saveMode = SOURCE_PATH;
-        const enum SKRY_output_format outputFmt = SKRY_TIFF_16;
+        const ImageWriter::OutputFormat_t outputFmt = SKRY_TIFF_16;
         const enum SKRY_img_alignment_method alignmentMethod = SKRY_IMG_ALGN_ANCHORS;
         const int referencePointSpacing = 40; ///< Value in pixels
         const float placementBrightnessThreshold = 0.33f;
@@ -137,8 +283,15 @@ namespace Const
         const unsigned refPtStructureScale = 1;
         const float refPtStructureThreshold = 1.2;
         const size_t NumQualityHistogramBins = 32;
+        const unsigned MaxConcurrentJobs = 1;
+        const unsigned WorkerThreadBudget = 0; ///< 0 = use all logical CPUs
+        const int FrameCacheSizeMiB = 512;
+        const int ReadAheadFrames = 8;
+        const unsigned VisualizationMaxFps = 30;
     }
 
+    const unsigned MaxConcurrentJobsLimit = 16;
+
     struct Language_t
     {
         const char *langId; // format: <language>_<country>, e.g. "pl_PL"
@@ -159,7 +312,7 @@ namespace Vars
 {
     struct OutputFormatDescr_t
     {
-        enum SKRY_output_format skryOutpFmt;
+        ImageWriter::OutputFormat_t outputFmt;
         Glib::ustring name;
         std::vector<Glib::ustring> patterns;
         std::string defaultExtension;
@@ -170,7 +323,21 @@ namespace Vars
     extern std::string appLaunchPath; ///< Value of argv[0]
 }
 
-Cairo::RefPtr<Cairo::ImageSurface> ConvertImgToSurface(const libskry::c_Image &img);
+/// Converts 'img' (or its fragment 'srcRect') to a Cairo RGB24 surface
+/** If 'dest' is not null and has the required size, it is filled and returned
+    instead of creating a new surface. Returns null on failure.
+    Raw color images are demosaiced bilinearly (see PixConv::DemosaicRow()). */
+Cairo::RefPtr<Cairo::ImageSurface> ConvertImgToSurface(const libskry::c_Image &img,
+                                                       const Cairo::RefPtr<Cairo::ImageSurface> &dest = Cairo::RefPtr<Cairo::ImageSurface>(nullptr),
+                                                       const struct SKRY_rect *srcRect = nullptr);
+
+/// Converts the fragment 'srcRect' of a raw color image to a half-resolution surface (one pixel per 2x2 filter block)
+/** 'srcRect' has to have even coordinates. Much faster than ConvertImgToSurface() for zoom levels of 50% or less.
+    If 'dest' is not null and has the required size, it is filled and returned instead of creating a new surface.
+    Returns null if 'img' is not a raw color image. */
+Cairo::RefPtr<Cairo::ImageSurface> ConvertCFAImgToHalfResSurface(const libskry::c_Image &img,
+                                                                 const Cairo::RefPtr<Cairo::ImageSurface> &dest,
+                                                                 const struct SKRY_rect &srcRect);
 
 /// Returns the affected area of 'cr' (can be used for e.g. selective refresh on screen)
 Cairo::Rectangle DrawAnchorPoint(const Cairo::RefPtr<Cairo::Context> &cr, int x, int y);
@@ -180,9 +347,9 @@ void EnumerateSupportedOutputFmts();
 void SavePosSize(const Gtk::Window &wnd, Types::c_Property<Gdk::Rectangle> &destination);
 void RestorePosSize(const Gdk::Rectangle &posSize, Gtk::Window &wnd);
 
-enum SKRY_pixel_format FindMatchingFormat(enum SKRY_output_format outputFmt, size_t numChannels);
+enum SKRY_pixel_format FindMatchingFormat(const ImageWriter::OutputFormat_t &outputFmt, size_t numChannels);
 
-const Vars::OutputFormatDescr_t &GetOutputFormatDescr(enum SKRY_output_format);
+const Vars::OutputFormatDescr_t &GetOutputFormatDescr(const ImageWriter::OutputFormat_t &outputFmt);
 
 /// Loads specified file from the 'icons' subdirectory
 Glib::RefPtr<Gdk::Pixbuf> LoadIconFromFile(const char *fileName, ///< Just the filename+extension
@@ -214,6 +381,26 @@ void SetBackgroundColor(Gtk::Widget &w, const Gdk::RGBA &color);
 
 void SetColor(const Cairo::RefPtr<Cairo::Context> &cr, const GdkRGBA &color);
 
+/// Parses a list of positive integers separated by commas (e.g. "10,20,30"); returns 'false' on invalid input
+/** An empty string results in an empty list. */
+bool ParseUnsignedList(const std::string &str, std::vector<unsigned> &values);
+
+/// Returns 'values' separated by commas
+std::string FormatUnsignedList(const std::vector<unsigned> &values);
+
+/// Returns the full paths of the image files (BMP, TIFF) in 'dir', sorted by name
+std::vector<std::string> ListImageFiles(const std::string &dir);
+
+/// Creates an empty temporary file and returns its full path (empty on failure)
+/** 'nameTemplate' has to contain "XXXXXX", which is replaced to make the name unique. */
+std::string CreateTempFile(const char *nameTemplate);
+
+/// Returns 's' quoted and escaped as a JSON string
+std::string JsonString(const std::string &s);
+
+/// Returns the peak amount of physical memory used by the process so far; returns 0 if unknown
+uint64_t GetPeakMemoryUsage();
+
 }
 
 #endif // STACKISTRY_UTILS_HEADER
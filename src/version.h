@@ -0,0 +1,32 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Program version header.
+*/
+
+#ifndef STACKISTRY_VERSION_HEADER
+#define STACKISTRY_VERSION_HEADER
+
+#define VERSION_MAJOR 0
+#define VERSION_MINOR 3
+#define VERSION_SUBMINOR 0
+#define VERSION_DATE "2017-06-05"
+
+#endif // STACKISTRY_VERSION_HEADER
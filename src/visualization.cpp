@@ -0,0 +1,323 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Processing visualization renderer implementation.
+*/
+
+#include <algorithm>
+#define _USE_MATH_DEFINES
+#include <cmath>   // for M_PI
+
+#include <cairomm/context.h>
+
+#include "pix_conv.h"
+#include "visualization.h"
+
+
+#define LOCK() Glib::Threads::Mutex::Lock lock(m_Mtx)
+
+/// Fraction of the visible area's size additionally rendered on each side (so that small scrolls do not show blank areas)
+const double VISIBLE_AREA_MARGIN = 0.25;
+
+/// Number of source pixels converted beyond the rendered area (needed by the interpolation filters)
+const int INTERPOLATION_MARGIN = 2;
+
+namespace Worker
+{
+
+libskry::c_Image GetCroppedBGRAImage(const libskry::c_Image &srcImg, const struct SKRY_rect &rect)
+{
+    if (PixConv::GetCFAPattern(srcImg.GetPixelFormat()) != SKRY_CFA_NONE)
+    {
+        // The result is only displayed, so fast demosaicing (of the fragment only) suffices
+        libskry::c_Image croppedImg(rect.width, rect.height, SKRY_PIX_BGRA8, nullptr, false);
+        for (unsigned row = 0; row < rect.height; row++)
+        {
+            uint32_t *line = static_cast<uint32_t *>(croppedImg.GetLine(row));
+            PixConv::DemosaicRow(srcImg, rect.y + row, rect.x, rect.width, line);
+            // Same memory layout as BGRA8 on little-endian machines (see PixConv::ConvertRow()); make the pixels opaque
+            for (unsigned x = 0; x < rect.width; x++)
+                line[x] |= 0xFF000000;
+        }
+        return croppedImg;
+    }
+
+    libskry::c_Image img = libskry::c_Image::ConvertPixelFormat(srcImg, SKRY_PIX_BGRA8);
+
+    struct SKRY_palette srcPal;
+    img.GetPalette(srcPal);
+    libskry::c_Image croppedImg(rect.width, rect.height, img.GetPixelFormat(), &srcPal, false);
+    libskry::c_Image::ResizeAndTranslate(img, croppedImg, rect.x, rect.y,
+                                         rect.width, rect.height, 0, 0, false);
+    return croppedImg;
+}
+
+c_VisualizationRenderer::c_VisualizationRenderer(const sigc::slot<void> &imageReadyNotification)
+: m_ImageReadyNotification(imageReadyNotification)
+{
+}
+
+c_VisualizationRenderer::~c_VisualizationRenderer()
+{
+    if (m_Thread)
+    {
+        { LOCK();
+            m_StopRequested = true;
+            m_Cond.signal();
+        }
+        m_Thread->join();
+    }
+}
+
+bool c_VisualizationRenderer::IsSnapshotDue(unsigned maxFps)
+{
+    if (m_AnySnapshotSubmitted && maxFps > 0 && m_SinceLastSnapshot.elapsed() < 1.0 / maxFps)
+        return false;
+
+    LOCK();
+    return !m_Pending;
+}
+
+void c_VisualizationRenderer::Submit(std::unique_ptr<VisualizationSnapshot_t> snapshot)
+{
+    m_SinceLastSnapshot.reset();
+    m_AnySnapshotSubmitted = true;
+
+    LOCK();
+    // Started on first use, so that no thread is created if visualization is disabled
+    if (!m_Thread)
+        m_Thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &c_VisualizationRenderer::ThreadFunc));
+
+    m_Pending = std::move(snapshot);
+    m_Cond.signal();
+}
+
+VisualizationImage_t c_VisualizationRenderer::AcquireImage()
+{
+    LOCK();
+    if (m_FrontIdx < 0)
+        return VisualizationImage_t { Cairo::RefPtr<Cairo::ImageSurface>(nullptr), 0, 0, 0, 0 };
+
+    m_DisplayedIdx = m_FrontIdx;
+    return m_Buffers[m_FrontIdx];
+}
+
+uint64_t c_VisualizationRenderer::GetImageId()
+{
+    LOCK();
+    return m_ImageId;
+}
+
+void c_VisualizationRenderer::ThreadFunc()
+{
+    LOCK();
+    while (!m_StopRequested)
+    {
+        if (!m_Pending)
+        {
+            m_Cond.wait(m_Mtx);
+            continue;
+        }
+
+        std::unique_ptr<VisualizationSnapshot_t> snapshot = std::move(m_Pending);
+
+        const int destIdx = (m_DisplayedIdx == 0 ? 1 : 0);
+        if (m_FrontIdx == destIdx)
+        {
+            // Not acquired by the main thread yet; withdraw it, it is going to be overwritten
+            m_FrontIdx = m_DisplayedIdx;
+        }
+        VisualizationImage_t dest = m_Buffers[destIdx];
+
+        lock.release();
+        Render(*snapshot, dest);
+        lock.acquire();
+
+        if (dest.img)
+        {
+            m_Buffers[destIdx] = dest;
+            m_FrontIdx = destIdx;
+            m_ImageId++;
+
+            lock.release();
+            m_ImageReadyNotification();
+            lock.acquire();
+        }
+    }
+}
+
+/// Returns the part of [0; fullSize) to render, given the visible range [visibleStart; visibleStart + visibleSize)
+static void GetRenderRange(double visibleStart, double visibleSize, int fullSize, int &start, int &end)
+{
+    start = 0;
+    end = fullSize;
+    if (visibleSize <= 0)
+        return;
+
+    const double margin = VISIBLE_AREA_MARGIN * visibleSize;
+    int visStart = std::max(0, (int)std::floor(visibleStart - margin));
+    int visEnd = std::min(fullSize, (int)std::ceil(visibleStart + visibleSize + margin));
+    if (visStart < visEnd)
+    {
+        start = visStart;
+        end = visEnd;
+    }
+}
+
+/// Determines the fragment of a raw color image to convert at half resolution which covers 'srcRect' (relative to 'cropRect')
+/** The fragment has even coordinates and size (so that it consists of whole filter blocks).
+    Returns false if it would be too small. */
+static bool GetHalfResRect(const struct SKRY_rect &srcRect, const struct SKRY_rect &cropRect,
+                           const libskry::c_Image &img, struct SKRY_rect &halfResRect)
+{
+    const int x0 = srcRect.x + cropRect.x, y0 = srcRect.y + cropRect.y;
+    const int x1 = x0 + (int)srcRect.width, y1 = y0 + (int)srcRect.height;
+    const int maxX = img.GetWidth() - img.GetWidth() % 2, maxY = img.GetHeight() - img.GetHeight() % 2;
+
+    halfResRect.x = x0 - x0 % 2;
+    halfResRect.y = y0 - y0 % 2;
+    const int width = std::min(x1 + x1 % 2, maxX) - halfResRect.x;
+    const int height = std::min(y1 + y1 % 2, maxY) - halfResRect.y;
+    if (width < 2 || height < 2)
+        return false;
+
+    halfResRect.width = width;
+    halfResRect.height = height;
+    return true;
+}
+
+/// Renders 'snapshot' into 'dest'; reuses 'dest.img' if it has the required size, otherwise creates a new surface
+void c_VisualizationRenderer::Render(const VisualizationSnapshot_t &snapshot, VisualizationImage_t &dest)
+{
+    const double zoom = snapshot.zoom;
+    const int imgWidth = (snapshot.crop ? snapshot.cropRect.width : snapshot.img->GetWidth());
+    const int imgHeight = (snapshot.crop ? snapshot.cropRect.height : snapshot.img->GetHeight());
+    const int fullWidth = zoom * imgWidth;
+    const int fullHeight = zoom * imgHeight;
+    if (fullWidth <= 0 || fullHeight <= 0)
+        return;
+
+    // Rendered area of the zoomed image
+    int x0, x1, y0, y1;
+    GetRenderRange(zoom * snapshot.visibleArea.x, zoom * snapshot.visibleArea.width, fullWidth, x0, x1);
+    GetRenderRange(zoom * snapshot.visibleArea.y, zoom * snapshot.visibleArea.height, fullHeight, y0, y1);
+
+    // Corresponding area of the displayed image (with a margin for interpolation)
+    struct SKRY_rect srcRect;
+    srcRect.x = std::max(0, (int)std::floor(x0 / zoom) - INTERPOLATION_MARGIN);
+    srcRect.y = std::max(0, (int)std::floor(y0 / zoom) - INTERPOLATION_MARGIN);
+    srcRect.width = std::min(imgWidth, (int)std::ceil(x1 / zoom) + INTERPOLATION_MARGIN) - srcRect.x;
+    srcRect.height = std::min(imgHeight, (int)std::ceil(y1 / zoom) + INTERPOLATION_MARGIN) - srcRect.y;
+
+    // Position (in the displayed image) of 'm_SrcSurface' and the number of displayed pixels per its pixel
+    double srcX = srcRect.x, srcY = srcRect.y;
+    int srcScale = 1;
+
+    const enum SKRY_pixel_format pixFmt = snapshot.img->GetPixelFormat();
+    const bool isCFA = (PixConv::GetCFAPattern(pixFmt) != SKRY_CFA_NONE);
+    struct SKRY_rect halfResRect;
+
+    if (!snapshot.crop)
+        m_SrcSurface = Utils::ConvertImgToSurface(*snapshot.img, m_SrcSurface, &srcRect);
+    else if (isCFA && zoom <= 0.5 && GetHalfResRect(srcRect, snapshot.cropRect, *snapshot.img, halfResRect))
+    {
+        // Zoomed out by half or more: one pixel per 2x2 filter block is enough
+        m_SrcSurface = Utils::ConvertCFAImgToHalfResSurface(*snapshot.img, m_SrcSurface, halfResRect);
+        srcX = halfResRect.x - snapshot.cropRect.x;
+        srcY = halfResRect.y - snapshot.cropRect.y;
+        srcScale = 2;
+    }
+    else if (isCFA || PixConv::IsSupported(pixFmt))
+    {
+        // Raw color images are demosaiced by the fast method (only the converted fragment)
+        struct SKRY_rect rect = srcRect;
+        rect.x += snapshot.cropRect.x;
+        rect.y += snapshot.cropRect.y;
+        m_SrcSurface = Utils::ConvertImgToSurface(*snapshot.img, m_SrcSurface, &rect);
+    }
+    else
+    {
+        m_SrcSurface = Utils::ConvertImgToSurface(GetCroppedBGRAImage(*snapshot.img, snapshot.cropRect), m_SrcSurface, &srcRect);
+    }
+
+    if (!m_SrcSurface)
+        return;
+
+    const int destWidth = x1 - x0;
+    const int destHeight = y1 - y0;
+    if (!dest.img || dest.img->get_width() != destWidth || dest.img->get_height() != destHeight)
+        dest.img = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24, destWidth, destHeight);
+
+    dest.fullWidth = fullWidth;
+    dest.fullHeight = fullHeight;
+    dest.xOffset = x0;
+    dest.yOffset = y0;
+
+    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(dest.img);
+    // From now on use the full zoomed image's coordinates
+    cr->translate(-x0, -y0);
+
+    auto src = Cairo::SurfacePattern::create(m_SrcSurface);
+    src->set_matrix(Cairo::Matrix(1 / (srcScale * zoom), 0, 0, 1 / (srcScale * zoom), -srcX / srcScale, -srcY / srcScale));
+    src->set_filter(Utils::GetFilter(snapshot.interpolation));
+
+    cr->set_source(src);
+    cr->rectangle(x0, y0, destWidth, destHeight);
+    cr->fill();
+
+    for (const auto &anchor: snapshot.anchors)
+        Utils::DrawAnchorPoint(cr, zoom * anchor.x, zoom * anchor.y);
+
+    const double RADIUS_VALID_POS = 4.0;
+    const double RADIUS_INVALID_POS = 2.0;
+
+    cr->set_line_width(1);
+    for (const auto &refPt: snapshot.refPoints)
+    {
+        if (refPt.isValid)
+            cr->set_source_rgb(0.8, 0.15, 1);
+        else
+            cr->set_source_rgb(0.9, 0.3, 0.3);
+
+        cr->arc(zoom * refPt.x,
+                zoom * refPt.y,
+                refPt.isValid ? RADIUS_VALID_POS : RADIUS_INVALID_POS, 0, 2*M_PI);
+        cr->stroke();
+    }
+
+    cr->set_line_cap(Cairo::LineCap::LINE_CAP_ROUND);
+    cr->set_source_rgb(0.6, 0.2, 0.7);
+    for (size_t i = 0; i + 2 < snapshot.triangles.size(); i += 3)
+    {
+        const VisualizationSnapshot_t::Point_t &v0 = snapshot.triangles[i],
+                                               &v1 = snapshot.triangles[i + 1],
+                                               &v2 = snapshot.triangles[i + 2];
+
+        cr->move_to(zoom * v0.x, zoom * v0.y);
+        cr->line_to(zoom * v1.x, zoom * v1.y);
+        cr->line_to(zoom * v2.x, zoom * v2.y);
+        cr->line_to(zoom * v0.x, zoom * v0.y);
+        cr->stroke();
+    }
+
+    dest.img->flush();
+}
+
+} // namespace Worker
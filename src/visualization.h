@@ -0,0 +1,149 @@
+/*
+Stackistry - astronomical image stacking
+Copyright (C) 2016, 2017 Filip Szczerek <ga.software@yahoo.com>
+
+This file is part of Stackistry.
+
+Stackistry is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Stackistry is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Stackistry.  If not, see <http://www.gnu.org/licenses/>.
+
+File description:
+    Processing visualization renderer header.
+*/
+
+#ifndef STACKISTRY_VISUALIZATION_HEADER
+#define STACKISTRY_VISUALIZATION_HEADER
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <cairomm/context.h>
+#include <cairomm/surface.h>
+#include <glibmm/threads.h>
+#include <glibmm/timer.h>
+#include <skry/skry_cpp.hpp>
+
+#include "utils.h"
+
+
+namespace Worker
+{
+    /// Everything needed to render a single processing step's visualization
+    /** Captured by the worker thread between processing steps; afterwards
+        it does not refer to any libskry processing phase object. */
+    struct VisualizationSnapshot_t
+    {
+        struct Point_t
+        {
+            double x, y;
+        };
+
+        struct RefPoint_t
+        {
+            double x, y;
+            bool isValid;
+        };
+
+        std::shared_ptr<const libskry::c_Image> img;
+
+        /// If true, only the 'cropRect' fragment of 'img' is shown (converted to BGRA8 with demosaicing)
+        bool crop;
+        struct SKRY_rect cropRect;
+
+        double zoom;
+        Utils::Const::InterpolationMethod interpolation;
+
+        /// Area shown on screen (relative to the displayed image, before zooming); if empty, the whole image is rendered
+        Cairo::Rectangle visibleArea;
+
+        // Overlays; all coordinates are relative to the displayed image (before zooming)
+
+        std::vector<Point_t> anchors;
+        std::vector<RefPoint_t> refPoints;
+        std::vector<Point_t> triangles; ///< Subsequent triangles' vertices (3 per triangle)
+    };
+
+    /// Rendered visualization; only a fragment of the full (zoomed) image is rendered
+    struct VisualizationImage_t
+    {
+        Cairo::RefPtr<Cairo::ImageSurface> img; ///< May be null
+        int fullWidth, fullHeight;
+        int xOffset, yOffset; ///< Position of 'img' within the full image
+    };
+
+    /// Returns the BGRA8 fragment 'rect' of 'srcImg' (with fast demosaicing of raw color images; for display only)
+    libskry::c_Image GetCroppedBGRAImage(const libskry::c_Image &srcImg, const struct SKRY_rect &rect);
+
+    /// Renders visualization snapshots in a background thread
+    /** Only the most recent snapshot is rendered; the older ones (not yet rendered)
+        are discarded. Rendering is done into one of two surfaces: the one not being
+        displayed by the main thread (i.e. not returned by the last AcquireImage()),
+        so that the displayed surface never changes.
+
+        Only the visible area of the zoomed image (with a margin) is rendered, and only
+        the corresponding part of the source image is converted. */
+    class c_VisualizationRenderer
+    {
+    public:
+        /// 'imageReadyNotification' will be called from the renderer thread
+        c_VisualizationRenderer(const sigc::slot<void> &imageReadyNotification);
+
+        /// Stops the renderer thread
+        ~c_VisualizationRenderer();
+
+        c_VisualizationRenderer(const c_VisualizationRenderer &) = delete;
+        c_VisualizationRenderer &operator =(const c_VisualizationRenderer &) = delete;
+
+        /// Returns true if a new snapshot should be submitted
+        /** Returns false if the previous snapshot has not been rendered yet or if
+            submitting a snapshot now would exceed 'maxFps'. To be called from the worker thread. */
+        bool IsSnapshotDue(unsigned maxFps);
+
+        /// Queues 'snapshot' for rendering (replacing the queued one, if any)
+        void Submit(std::unique_ptr<VisualizationSnapshot_t> snapshot);
+
+        /// Returns the most recently rendered image (may be null); to be called from the main thread
+        VisualizationImage_t AcquireImage();
+
+        /// Returns the number of images rendered so far; can be used to check if AcquireImage() would return a new image
+        uint64_t GetImageId();
+
+    private:
+        sigc::slot<void> m_ImageReadyNotification;
+
+        Glib::Threads::Thread *m_Thread = nullptr;
+        Glib::Threads::Mutex m_Mtx; ///< Guards all the variables below
+        Glib::Threads::Cond m_Cond;
+        bool m_StopRequested = false;
+
+        std::unique_ptr<VisualizationSnapshot_t> m_Pending;
+
+        VisualizationImage_t m_Buffers[2];
+        int m_FrontIdx = -1;     ///< Buffer with the most recently rendered image; -1 if none
+        int m_DisplayedIdx = -1; ///< Buffer last returned by AcquireImage(); -1 if none
+        uint64_t m_ImageId = 0;
+
+        /// Used only by the renderer thread; reused for converting subsequent snapshots' images
+        Cairo::RefPtr<Cairo::ImageSurface> m_SrcSurface;
+
+        /// Used only by the worker thread
+        Glib::Timer m_SinceLastSnapshot;
+        bool m_AnySnapshotSubmitted = false;
+
+        void ThreadFunc();
+        void Render(const VisualizationSnapshot_t &snapshot, VisualizationImage_t &dest);
+    };
+}
+
+#endif // STACKISTRY_VISUALIZATION_HEADER
@@ -22,20 +22,32 @@ File description:
 */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #define _USE_MATH_DEFINES
 #include <cmath>   // for M_PI
 #include <cstddef>
 #include <iostream>
 #include <memory>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
-#include <glibmm/dispatcher.h>
+#include <glib.h>
+#include <glib/gstdio.h>
 #include <glibmm/i18n.h>
 #include <glibmm/thread.h>
 #include <glibmm/threads.h>
 #include <glibmm/timer.h>
 
+#include "flat_field.h"
+#include "frame_cache.h"
+#include "image_writer.h"
+#include "partial_stack.h"
+#include "prefetch.h"
+#include "roi_extraction.h"
 #include "utils.h"
+#include "visualization.h"
 #include "worker.h"
 
 
@@ -44,166 +56,396 @@ namespace Worker
 
 namespace Vars
 {
-    /// Currently processed job
-    static Job_t *job;
-    static bool abortRequested = false;
-    static size_t step;
-
-    /// Used only when returning the best-quality image to the main thread
-    static libskry::c_ImageAlignment *imgAlign = nullptr;
-    static libskry::c_QualityEstimation *qualEst = nullptr;
-
-    static bool isWorkerRunning = false;
-    static ProcPhase procPhase = ProcPhase::IDLE;
-    static Glib::Threads::Thread *workerThread;
-    static Glib::Dispatcher dispatcher;
-    static Cairo::RefPtr<Cairo::ImageSurface> visualizationImg;
-    static bool enableVisualization = false;
-    static bool isWaitingForReferencePoints;
-    static enum SKRY_result lastResult;
-    static Glib::Threads::RecMutex mtx; ///< Access guard for shared variables
-    /// Used for notification by main thread that reference points have been provided
-    static Glib::Threads::Mutex mtxRefPt;
-    static Glib::Threads::Cond condRefPt;
+    static std::atomic<bool> enableVisualization{false};
     /// Current zoom factor specified in the main window's visualization widget
     static double zoomFactor = 1.0;
     /// Current zoom interpolation method specified in the main window's visualization widget
     static auto interpolationMethod = Utils::Const::Defaults::interpolation;
+    /// Part of the visualization shown in the main window's widget (before zooming); empty if unknown
+    static Cairo::Rectangle visibleArea = { 0, 0, 0, 0 };
+    /// Max. number of visualization images rendered per second (by each worker)
+    static std::atomic<unsigned> visualizationMaxFps{Utils::Const::Defaults::VisualizationMaxFps};
+    /// Access guard for 'zoomFactor', 'interpolationMethod' and 'visibleArea'
+    /** 'enableVisualization' and 'visualizationMaxFps' are atomic, as they are checked after every processing step. */
+    static Glib::Threads::Mutex visualizationMtx;
+
+    /// Workers whose threads are currently running
+    static std::vector<c_Worker *> activeWorkers;
+    /// Total number of threads to split among 'activeWorkers'; 0 means "all logical CPUs"
+    static unsigned threadBudget = 0;
+    /// Access guard for 'activeWorkers' and 'threadBudget'
+    static Glib::Threads::Mutex schedulerMtx;
+
+    /// Number of frames read ahead by each worker; 0 disables reading ahead
+    static unsigned readAheadDepth = 0;
+    static Glib::Threads::Mutex readAheadMtx;
 }
 
-#define LOCK() Glib::Threads::RecMutex::Lock lock(Vars::mtx)
+/// Number of times the processing phases read all active images
+const unsigned NUM_FRAME_PASSES = 4;
 
-void WorkerThreadFunc();
+/// Number of quality estimation frames read during alignment (relative to the read-ahead depth)
+const unsigned QUALITY_READ_OVERLAP_FACTOR = 16;
+const unsigned MIN_QUALITY_READ_OVERLAP = 64;
 
-static libskry::c_Image GetAlignedCurrentImage(
-    const libskry::c_ImageSequence &imgSeq,
-    const libskry::c_ImageAlignment &imgAlignment);
+/// Min. reference block size used when the job's block size is scaled down for binned frames
+const unsigned MIN_REF_PT_BLOCK_SIZE = 8;
+
+#define LOCK() Glib::Threads::RecMutex::Lock lock(m_Mtx)
 
 // Function definitions ----------------------------
 
 /// Used by the main thread to indicate the current visualization zoom factor
-void SetZoomFactor(double zoom, Utils::Const::InterpolationMethod interpolationMethod)
+void SetZoomFactor(double zoom, Utils::Const::InterpolationMethod interpolationMethod,
+                   const Cairo::Rectangle &visibleArea)
 {
-    LOCK();
+    Glib::Threads::Mutex::Lock lock(Vars::visualizationMtx);
     Vars::zoomFactor = zoom;
     Vars::interpolationMethod = interpolationMethod;
+    Vars::visibleArea = visibleArea;
 }
 
 /// Returns the last values set with SetZoomFactor()
 std::tuple<double, Utils::Const::InterpolationMethod> GetZoomFactor()
 {
-    LOCK();
+    Glib::Threads::Mutex::Lock lock(Vars::visualizationMtx);
 
     return std::make_tuple(Vars::zoomFactor, Vars::interpolationMethod);
 }
 
+void SetReadAheadDepth(unsigned numFrames)
+{
+    Glib::Threads::Mutex::Lock lock(Vars::readAheadMtx);
+    Vars::readAheadDepth = numFrames;
+}
 
-Glib::Threads::Mutex &GetRefPtNotificationMtx()
+static unsigned GetReadAheadDepth()
 {
-    return Vars::mtxRefPt;
+    Glib::Threads::Mutex::Lock lock(Vars::readAheadMtx);
+    return Vars::readAheadDepth;
 }
 
-void AbortProcessing()
+void SetVisualizationEnabled(bool enabled)
 {
-    { LOCK();
-        Vars::abortRequested = true;
+    Vars::enableVisualization = enabled;
+}
+
+bool IsVisualizationEnabled()
+{
+    return Vars::enableVisualization;
+}
+
+void SetVisualizationMaxFps(unsigned fps)
+{
+    Vars::visualizationMaxFps = fps;
+}
+
+static unsigned GetVisualizationMaxFps()
+{
+    return Vars::visualizationMaxFps;
+}
+
+static unsigned GetNumLogicalCpus()
+{
+#if defined(_OPENMP)
+    return (unsigned)omp_get_num_procs();
+#else
+    return 1;
+#endif
+}
+
+/// Splits the thread budget evenly among the active workers
+/** Must be called with Vars::schedulerMtx locked. */
+void RebalanceThreads()
+{
+    if (Vars::activeWorkers.empty())
+        return;
+
+    unsigned budget = (Vars::threadBudget ? Vars::threadBudget : GetNumLogicalCpus());
+    unsigned numWorkers = Vars::activeWorkers.size();
+
+    for (unsigned i = 0; i < numWorkers; i++)
+    {
+        // The first 'budget % numWorkers' workers receive one additional thread
+        unsigned numThreads = budget / numWorkers + (i < budget % numWorkers ? 1 : 0);
+
+        Vars::activeWorkers[i]->m_NumThreads = std::max(1U, numThreads);
+    }
+}
+
+/// Sets the total number of threads to be split among all running workers
+void SetThreadBudget(unsigned numThreads)
+{
+    Glib::Threads::Mutex::Lock lock(Vars::schedulerMtx);
+    Vars::threadBudget = numThreads;
+    RebalanceThreads();
+}
+
+static void RegisterActiveWorker(c_Worker *worker)
+{
+    Glib::Threads::Mutex::Lock lock(Vars::schedulerMtx);
+    Vars::activeWorkers.push_back(worker);
+    RebalanceThreads();
+}
+
+static void UnregisterActiveWorker(c_Worker *worker)
+{
+    Glib::Threads::Mutex::Lock lock(Vars::schedulerMtx);
+    Vars::activeWorkers.erase(std::remove(Vars::activeWorkers.begin(), Vars::activeWorkers.end(), worker),
+                              Vars::activeWorkers.end());
+    RebalanceThreads();
+}
+
+c_Worker::c_Worker(std::shared_ptr<Job_t> job, const sigc::slot<void> &progressNotification)
+: m_Job(job), m_ProgressNotification(progressNotification),
+  m_Renderer(sigc::mem_fun(*this, &c_Worker::NotifyMainThread))
+{
+}
+
+c_Worker::~c_Worker()
+{
+    AbortProcessing();
+}
+
+void c_Worker::AbortProcessing()
+{
+    m_AbortRequested = true;
+    if (IsWaitingForReferencePoints())
+    {
+        // Wake up the worker thread; it will notice the abort request
+        NotifyReferencePointsSet();
     }
     WaitUntilFinished();
 }
 
-ProcPhase GetPhase()
+void c_Worker::NotifyMainThread()
 {
-    return Vars::procPhase;
+    // If the previous notification has not been acknowledged yet, its receiver
+    // is still going to check the state (including the current changes)
+    if (!m_NotificationPending.exchange(true))
+        m_ProgressNotification();
 }
 
-void NotifyMainThread()
+void c_Worker::AcknowledgeNotification()
 {
-    Vars::dispatcher();
+    m_NotificationPending = false;
 }
 
-void StartProcessingPhase(ProcPhase newPhase)
+/// Accumulates the time spent in its scope
+class c_ScopeTimer
+{
+    double &m_TotalSec;
+    Glib::Timer m_Timer;
+
+public:
+    c_ScopeTimer(double &totalSec): m_TotalSec(totalSec) { }
+
+    ~c_ScopeTimer() { m_TotalSec += m_Timer.elapsed(); }
+};
+
+static const char *GetProcPhaseName(ProcPhase phase)
 {
-    Vars::procPhase = newPhase;
-    Vars::step = 0;
+    switch (phase)
+    {
+        case ProcPhase::ROI_EXTRACTION:      return "frameExtraction";
+        case ProcPhase::IMAGE_ALIGNMENT:     return "imageAlignment";
+        case ProcPhase::QUALITY_ESTIMATION:  return "qualityEstimation";
+        case ProcPhase::REF_POINT_ALIGNMENT: return "refPointAlignment";
+        case ProcPhase::IMAGE_STACKING:      return "imageStacking";
+        case ProcPhase::FLAT_FIELD_CREATION: return "flatFieldCreation";
+        default: return "";
+    }
 }
 
-void SetVisualizationEnabled(bool enabled)
+void c_Worker::StartProcessingPhase(ProcPhase newPhase, c_Prefetcher &prefetcher)
 {
-    LOCK();
-    Vars::enableVisualization = enabled;
+    m_ProcPhase = newPhase;
+    m_Step = 0;
+    m_PhaseTimer.start();
+    PublishProgress();
+
+    m_PhaseProfile = RunProfile_t::Phase_t();
+    m_PhaseProfile.name = GetProcPhaseName(newPhase);
+    m_PhaseStartReadStats = prefetcher.GetStats();
 }
 
-void ConnectProgressSignal(const sigc::slot<void>& slot)
+void c_Worker::FinishProcessingPhase(c_Prefetcher &prefetcher)
 {
-    Vars::dispatcher.connect(slot);
+    const c_Prefetcher::Stats_t readStats = prefetcher.GetStats();
+
+    RunProfile_t::Phase_t &phase = m_PhaseProfile;
+    phase.wallTimeSec = m_PhaseTimer.elapsed();
+    phase.numSteps = m_Step;
+    phase.framesPerSec = (phase.wallTimeSec > 0 ? m_Step / phase.wallTimeSec : 0);
+    phase.stepTimeSec = std::max(0.0, phase.wallTimeSec - phase.visualizationTimeSec - phase.notificationTimeSec);
+    phase.readStallTimeSec = readStats.stallTimeSec - m_PhaseStartReadStats.stallTimeSec;
+    phase.numBytesRead = readStats.numBytesRead - m_PhaseStartReadStats.numBytesRead;
+    m_Profile.phases.push_back(phase);
+
+    m_Profile.totalTimeSec = m_RunTimer.elapsed();
+    m_Profile.peakMemoryBytes = Utils::GetPeakMemoryUsage();
+    m_Profile.numThreads = m_AppliedNumThreads;
+    m_Job->profile.Publish(std::make_shared<RunProfile_t>(m_Profile));
 }
 
-bool IsRunning()
+void c_Worker::NotifyProgress()
 {
-    return Vars::isWorkerRunning;
+    c_ScopeTimer timer(m_PhaseProfile.notificationTimeSec);
+    NotifyMainThread();
 }
 
-size_t GetStep()
+/// Must be called from the worker thread
+void c_Worker::PublishProgress()
 {
-    return Vars::step;
+    const double elapsed = m_PhaseTimer.elapsed();
+    const double framesPerSec = (elapsed > 0 ? m_Step / elapsed : 0);
+
+    const unsigned seq = m_Progress.seq.load(std::memory_order_relaxed);
+    m_Progress.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_Progress.phase.store((int)m_ProcPhase, std::memory_order_relaxed);
+    m_Progress.step.store(m_Step, std::memory_order_relaxed);
+    m_Progress.framesPerSec.store(framesPerSec, std::memory_order_relaxed);
+
+    m_Progress.seq.store(seq + 2, std::memory_order_release);
 }
 
-void WaitUntilFinished()
+Progress_t c_Worker::GetProgress() const
 {
-    if (Vars::workerThread)
+    Progress_t progress;
+    unsigned seqBefore, seqAfter;
+    do
     {
-        Vars::workerThread->join();
-        Vars::workerThread = 0;
+        seqBefore = m_Progress.seq.load(std::memory_order_acquire);
+
+        progress.phase = (ProcPhase)m_Progress.phase.load(std::memory_order_relaxed);
+        progress.step = m_Progress.step.load(std::memory_order_relaxed);
+        progress.framesPerSec = m_Progress.framesPerSec.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seqAfter = m_Progress.seq.load(std::memory_order_relaxed);
+    } while (seqBefore != seqAfter || (seqBefore & 1));
+
+    return progress;
+}
+
+bool c_Worker::IsRunning()
+{
+    LOCK();
+    return m_IsRunning;
+}
+
+unsigned c_Worker::GetNumThreads()
+{
+    return m_NumThreads;
+}
+
+void c_Worker::WaitUntilFinished()
+{
+    if (m_Thread)
+    {
+        m_Thread->join();
+        m_Thread = nullptr;
     }
 }
 
-ProcPhase GetProcessingPhase()
+void c_Worker::StartProcessing()
+{
+    m_Job->quality.data.Reset();
+    m_Job->quality.partialData.Reset();
+    m_Job->qualityDataReadyNotification = false;
+    m_Job->cachedQualityDataNotification = false;
+    m_Job->partialQualityDataNotification = false;
+
+    m_Job->stackedImg.Reset();
+    m_Job->additionalStacks.Reset();
+    m_Job->bestFragmentsImg.Reset();
+    m_Job->profile.Reset();
+
+    m_IsRunning = true;
+    m_AbortRequested = false;
+    RegisterActiveWorker(this);
+    m_Thread = Glib::Threads::Thread::create(sigc::mem_fun(*this, &c_Worker::ThreadFunc));
+}
+
+/// Applies the number of threads assigned by the scheduler to subsequent processing steps
+/** Must be called from the worker thread. */
+void c_Worker::ApplyThreadBudget()
 {
-    return Vars::procPhase;
+    const unsigned numThreads = m_NumThreads;
+    if (numThreads != m_AppliedNumThreads)
+    {
+#if defined(_OPENMP)
+        // Affects the parallel regions (inside libskry) started from this thread only
+        omp_set_num_threads(numThreads);
+#endif
+        m_AppliedNumThreads = numThreads;
+    }
 }
 
-void StartProcessing(Job_t *job)
+/// Returns a new snapshot with the current zoom settings
+static std::unique_ptr<VisualizationSnapshot_t> CreateSnapshot()
 {
-    job->quality.framesChrono.clear();
-    job->quality.framesSorted.clear();
-    job->qualityDataReadyNotification = false;
+    std::unique_ptr<VisualizationSnapshot_t> snapshot(new VisualizationSnapshot_t());
+    snapshot->crop = false;
 
-    Vars::visualizationImg = Cairo::RefPtr<Cairo::ImageSurface>(nullptr);
+    Glib::Threads::Mutex::Lock lock(Vars::visualizationMtx);
+    snapshot->zoom = Vars::zoomFactor;
+    snapshot->interpolation = Vars::interpolationMethod;
+    snapshot->visibleArea = Vars::visibleArea;
+
+    return snapshot;
+}
 
-    job->stackedImg = libskry::c_Image();
-    job->bestFragmentsImg = libskry::c_Image();
+/// Sets up 'snapshot' to show the specified image aligned (i.e. cropped to the images' intersection)
+/** Returns false on failure. */
+static bool SetAlignedImage(
+    VisualizationSnapshot_t &snapshot,
+    size_t imgIdx, ///< Image index within the active images' subset
+    const libskry::c_ImageSequence &imgSeq,
+    FrameCache::SeqId_t frameCacheId,
+    const libskry::c_ImageAlignment &imgAlignment)
+{
+    snapshot.img = FrameCache::GetImage(frameCacheId, imgSeq, imgSeq.GetAbsoluteImgIdx(imgIdx));
+    if (!snapshot.img)
+        return false;
 
-    Vars::job = job;
+    struct SKRY_rect intersection = imgAlignment.GetIntersection();
+    struct SKRY_point offset = imgAlignment.GetImageOffset(imgIdx);
 
-    Vars::isWorkerRunning = true;
-    Vars::abortRequested = false;
-    Vars::workerThread = Glib::Threads::Thread::create(sigc::ptr_fun(&WorkerThreadFunc));
+    snapshot.crop = true;
+    snapshot.cropRect = intersection;
+    snapshot.cropRect.x += offset.x;
+    snapshot.cropRect.y += offset.y;
+    return true;
 }
 
-/// Returns a version of 'srcImg' scaled by Vars::zoomFactor
-Cairo::RefPtr<Cairo::ImageSurface> GetScaledImg(const libskry::c_Image &srcImg)
+void c_Worker::SubmitRoiExtractionVisualization(const c_RoiExtraction &roiExtraction)
 {
-    auto src = Cairo::SurfacePattern::create(Utils::ConvertImgToSurface(srcImg));
-    src->set_matrix(Cairo::scaling_matrix(1 / Vars::zoomFactor, 1 / Vars::zoomFactor));
-    src->set_filter(Utils::GetFilter(Vars::interpolationMethod));
+    c_ScopeTimer timer(m_PhaseProfile.visualizationTimeSec);
+    auto snapshot = CreateSnapshot();
 
-    auto scaledImg = Cairo::ImageSurface::create(Cairo::Format::FORMAT_RGB24,
-                                                 Vars::zoomFactor * srcImg.GetWidth(),
-                                                 Vars::zoomFactor * srcImg.GetHeight());
+    const libskry::c_ImageSequence &imgSeq = m_Job->imgSeq;
+    snapshot->img = FrameCache::GetImage(m_Job->frameCacheId, imgSeq, imgSeq.GetAbsoluteImgIdx(roiExtraction.GetCurrentImgIdx()));
+    if (!snapshot->img)
+        return;
 
-    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(scaledImg);
-    cr->set_source(src);
-    cr->rectangle(0, 0, Vars::zoomFactor * srcImg.GetWidth(),
-                        Vars::zoomFactor * srcImg.GetHeight());
-    cr->fill();
+    snapshot->crop = true;
+    snapshot->cropRect = roiExtraction.GetRoi();
 
-    return scaledImg;
+    m_Renderer.Submit(std::move(snapshot));
 }
 
-static void CreateImgAlignmentVisualization(const libskry::c_ImageAlignment &imgAlignment)
+void c_Worker::SubmitImgAlignmentVisualization(const libskry::c_ImageAlignment &imgAlignment)
 {
-    Vars::visualizationImg = GetScaledImg(Vars::job->imgSeq.GetCurrentImage());
-    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(Vars::visualizationImg);
+    c_ScopeTimer timer(m_PhaseProfile.visualizationTimeSec);
+    auto snapshot = CreateSnapshot();
+
+    const libskry::c_ImageSequence &imgSeq = GetProcessedImgSeq();
+    snapshot->img = FrameCache::GetImage(GetProcessedSeqCacheId(), imgSeq, imgSeq.GetAbsoluteImgIdx(imgSeq.GetCurrentImgIdxWithinActiveSubset()));
+    if (!snapshot->img)
+        return;
 
     if (imgAlignment.GetAlignmentMethod() == SKRY_IMG_ALGN_ANCHORS)
     {
@@ -211,178 +453,412 @@ static void CreateImgAlignmentVisualization(const libskry::c_ImageAlignment &img
 
         for (size_t i = 0; i < anchors.size(); i++)
             if (imgAlignment.IsAnchorValid(i))
-                Utils::DrawAnchorPoint(cr, Vars::zoomFactor * anchors[i].x,
-                                           Vars::zoomFactor * anchors[i].y);
+                snapshot->anchors.push_back({ (double)anchors[i].x, (double)anchors[i].y });
     }
     else if (imgAlignment.GetAlignmentMethod() == SKRY_IMG_ALGN_CENTROID)
     {
         auto centroid = imgAlignment.GetCentroid();
-        Utils::DrawAnchorPoint(cr, Vars::zoomFactor * centroid.x,
-                                   Vars::zoomFactor * centroid.y);
+        snapshot->anchors.push_back({ (double)centroid.x, (double)centroid.y });
     }
+
+    m_Renderer.Submit(std::move(snapshot));
 }
 
-static void CreateQualityEstimationVisualization(
-    const libskry::c_ImageSequence &imgSeq,
-    const libskry::c_ImageAlignment &imgAlignment,
-    const libskry::c_QualityEstimation &qualEstimation)
+void c_Worker::SubmitQualityEstimationVisualization(const libskry::c_ImageAlignment &imgAlignment)
 {
-    Vars::visualizationImg = GetScaledImg(GetAlignedCurrentImage(imgSeq, imgAlignment));
+    c_ScopeTimer timer(m_PhaseProfile.visualizationTimeSec);
+    auto snapshot = CreateSnapshot();
+    const libskry::c_ImageSequence &imgSeq = GetProcessedImgSeq();
+    if (!SetAlignedImage(*snapshot, imgSeq.GetCurrentImgIdxWithinActiveSubset(), imgSeq, GetProcessedSeqCacheId(), imgAlignment))
+        return;
 
     //TODO: draw something?.. e.g. image in grayscale with quality color-mapped
+
+    m_Renderer.Submit(std::move(snapshot));
 }
 
 static
 libskry::c_Image GetAlignedImage(
     size_t imgIdx, ///< Image index within the active images' subset
     const libskry::c_ImageSequence &imgSeq,
+    FrameCache::SeqId_t frameCacheId,
     const libskry::c_ImageAlignment &imgAlignment)
 {
-    libskry::c_Image img = imgSeq.GetImageByIdx(imgSeq.GetAbsoluteImgIdx(imgIdx));
-    if (!img)
+    VisualizationSnapshot_t snapshot;
+    if (!SetAlignedImage(snapshot, imgIdx, imgSeq, frameCacheId, imgAlignment))
         return libskry::c_Image();
 
-    img = libskry::c_Image::ConvertPixelFormat(img, SKRY_PIX_BGRA8, SKRY_DEMOSAIC_HQLINEAR);
-
-    struct SKRY_rect intersection = imgAlignment.GetIntersection();
-
-    struct SKRY_point offset = imgAlignment.GetImageOffset(imgIdx);
-    int xmin = intersection.x + offset.x;
-    int ymin = intersection.y + offset.y;
-
-    struct SKRY_palette srcPal;
-    img.GetPalette(srcPal);
-    libskry::c_Image alignedImg(intersection.width, intersection.height, img.GetPixelFormat(), &srcPal, false);
-    libskry::c_Image::ResizeAndTranslate(img, alignedImg, xmin, ymin,
-                                         intersection.width, intersection.height, 0, 0, false);
-    return alignedImg;
+    return GetCroppedBGRAImage(*snapshot.img, snapshot.cropRect);
 }
 
-static libskry::c_Image GetAlignedCurrentImage(
-    const libskry::c_ImageSequence &imgSeq,
-    const libskry::c_ImageAlignment &imgAlignment)
-{
-    return GetAlignedImage(imgSeq.GetCurrentImgIdxWithinActiveSubset(), imgSeq, imgAlignment);
-}
-
-static void CreateRefPtAlignmentVisualization(
-    const libskry::c_ImageSequence &imgSeq,
+void c_Worker::SubmitRefPtAlignmentVisualization(
     const libskry::c_ImageAlignment &imgAlignment,
     const libskry::c_RefPointAlignment &refPtAlignment)
 {
-    Vars::visualizationImg = GetScaledImg(GetAlignedCurrentImage(imgSeq, imgAlignment));
-    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(Vars::visualizationImg);
-
-    const double RADIUS_VALID_POS = 4.0;
-    const double RADIUS_INVALID_POS = 2.0;
-
+    c_ScopeTimer timer(m_PhaseProfile.visualizationTimeSec);
+    const libskry::c_ImageSequence &imgSeq = GetProcessedImgSeq();
     int imgIdx = imgSeq.GetCurrentImgIdxWithinActiveSubset();
 
-    cr->set_line_width(1);
+    auto snapshot = CreateSnapshot();
+    if (!SetAlignedImage(*snapshot, imgIdx, imgSeq, GetProcessedSeqCacheId(), imgAlignment))
+        return;
 
     for (int i = 0; i < refPtAlignment.GetNumReferencePoints(); i++)
     {
         bool isValid;
         struct SKRY_point pos = refPtAlignment.GetReferencePointPos(i, imgIdx, isValid);
-
-        if (isValid)
-            cr->set_source_rgb(0.8, 0.15, 1);
-        else
-            cr->set_source_rgb(0.9, 0.3, 0.3);
-
-        cr->arc(Vars::zoomFactor * pos.x,
-                Vars::zoomFactor * pos.y,
-                isValid ? RADIUS_VALID_POS : RADIUS_INVALID_POS, 0, 2*M_PI);
-        cr->stroke();
+        snapshot->refPoints.push_back({ (double)pos.x, (double)pos.y, isValid });
     }
+
+    m_Renderer.Submit(std::move(snapshot));
 }
 
-static void CreateStackingVisualization(
+void c_Worker::SubmitStackingVisualization(
     const libskry::c_Stacking &stacking,
     const libskry::c_RefPointAlignment &refPtAlignment)
 {
-    Vars::visualizationImg = GetScaledImg(stacking.GetPartialImageStack());
-    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(Vars::visualizationImg);
-
+    c_ScopeTimer timer(m_PhaseProfile.visualizationTimeSec);
+    auto snapshot = CreateSnapshot();
+    snapshot->img = std::make_shared<const libskry::c_Image>(stacking.GetPartialImageStack());
 
     const struct SKRY_triangle *triangles = SKRY_get_triangles(refPtAlignment.GetTriangulation());
     const struct SKRY_point_flt *verts = stacking.GetRefPtStackingPositions();
     size_t numStackedTris;
     const size_t *stackedTris = stacking.GetCurrentStepStackedTriangles(numStackedTris);
 
-    cr->set_line_cap(Cairo::LineCap::LINE_CAP_ROUND);
-    cr->set_source_rgb(0.6, 0.2, 0.7);
     for (size_t i = 0; i < numStackedTris; i++)
     {
-        const struct SKRY_point_flt &v0 = verts[triangles[stackedTris[i]].v0],
-                                    &v1 = verts[triangles[stackedTris[i]].v1],
-                                    &v2 = verts[triangles[stackedTris[i]].v2];
+        const struct SKRY_triangle &tri = triangles[stackedTris[i]];
+        for (size_t v: { tri.v0, tri.v1, tri.v2 })
+            snapshot->triangles.push_back({ verts[v].x, verts[v].y });
+    }
+
+    m_Renderer.Submit(std::move(snapshot));
+}
+
+/// Returns true if the main thread needs to provide reference points
+bool c_Worker::IsWaitingForReferencePoints()
+{
+    LOCK();
+    return m_IsWaitingForReferencePoints;
+}
 
-        cr->move_to(Vars::zoomFactor * v0.x, Vars::zoomFactor * v0.y);
-        cr->line_to(Vars::zoomFactor * v1.x, Vars::zoomFactor * v1.y);
-        cr->line_to(Vars::zoomFactor * v2.x, Vars::zoomFactor * v2.y);
-        cr->line_to(Vars::zoomFactor * v0.x, Vars::zoomFactor * v0.y);
-        cr->stroke();
+/// Notifies the worker thread that it may continue
+void c_Worker::NotifyReferencePointsSet()
+{
+    { LOCK();
+        m_IsWaitingForReferencePoints = false;
     }
+    Glib::Threads::Mutex::Lock lock(m_MtxRefPt);
+    m_CondRefPt.signal();
 }
 
-bool IsVisualizationEnabled()
+/// Can be called while IsWaitingForReferencePoints() returns true
+const libskry::c_Image &c_Worker::GetBestQualityAlignedImage()
 {
-    return Vars::enableVisualization;
+    return m_RefPtSelection.bestQualityImg;
 }
 
-/// Returns true if the main thread needs to provide reference points
-bool IsWaitingForReferencePoints()
+/// Can be called while IsWaitingForReferencePoints() returns true
+const std::vector<struct SKRY_point> &c_Worker::GetSuggestedReferencePoints()
 {
-    return Vars::isWaitingForReferencePoints;
+    return m_RefPtSelection.suggestedPoints;
 }
 
-/// Notifies the worker thread that it may continue
-void NotifyReferencePointsSet()
+void c_Worker::PrepareReferencePointSelection(const libskry::c_ImageAlignment &imgAlignment,
+                                              const libskry::c_QualityEstimation &qualEstimation,
+                                              const RefPtParams_t &params)
+{
+    m_RefPtSelection.bestQualityImg = GetAlignedImage(qualEstimation.GetBestImageIdx(), GetProcessedImgSeq(),
+                                                        GetProcessedSeqCacheId(), imgAlignment);
+
+    // Automatic placement is performed on construction (the alignment itself only by the steps)
+    libskry::c_RefPointAlignment autoPlacement(qualEstimation,
+                                               { },
+
+                                               m_Job->quality.criterion,
+                                               m_Job->quality.threshold,
+
+                                               params.blockSize,
+                                               params.searchRadius,
+                                               nullptr,
+                                               m_Job->refPtAutoPlacementParams.brightnessThreshold,
+                                               m_Job->refPtAutoPlacementParams.structureThreshold,
+                                               params.structureScale,
+                                               params.spacing);
+    m_RefPtSelection.suggestedPoints.clear();
+    if (autoPlacement)
+    {
+        for (int i = 0; i < autoPlacement.GetNumReferencePoints(); i++)
+        {
+            bool isValid;
+            m_RefPtSelection.suggestedPoints.push_back(autoPlacement.GetReferencePointPos(i, 0, isValid));
+        }
+    }
+}
+
+static std::shared_ptr<QualityData_t> CreateQualityData(const std::vector<SKRY_quality_t> &framesChrono)
+{
+    auto qualityData = std::make_shared<QualityData_t>();
+    qualityData->framesChrono = framesChrono;
+    qualityData->framesSorted = framesChrono;
+
+    // Sort descending
+    std::sort(qualityData->framesSorted.begin(),
+              qualityData->framesSorted.end(),
+              [](const SKRY_quality_t &a, const SKRY_quality_t &b) { return a > b; });
+
+    return qualityData;
+}
+
+bool c_Worker::LoadAnalysisCache()
+{
+    m_Analysis = AnalysisCache::Data_t();
+    if (m_Job->part.count > 1)
+    {
+        m_Analysis = AnalysisCache::Load(*m_Job);
+        if (!m_Analysis.quality.valid || !m_Analysis.alignment.valid ||
+            m_Analysis.alignment.imgOffsets.size() != m_Analysis.quality.framesChrono.size())
+        {
+            std::cerr << "No analysis of the whole job in " << AnalysisCache::GetPath(*m_Job)
+                      << "; it has to be created first (with the same settings)." << std::endl;
+            return false;
+        }
+        // The quality data published by quality estimation refers to the part's frames only
+        return true;
+    }
+
+    if (!m_Job->useAnalysisCache)
+        return true;
+
+    m_Analysis = AnalysisCache::Load(*m_Job);
+    if (m_Analysis.quality.valid)
+    {
+        m_Job->quality.data.Publish(CreateQualityData(m_Analysis.quality.framesChrono));
+        m_Job->cachedQualityDataNotification = true;
+        NotifyMainThread();
+    }
+    return true;
+}
+
+void c_Worker::PublishPartialQualityData(const libskry::c_QualityEstimation &qualEstimation, size_t numEstimated)
 {
-    Vars::isWaitingForReferencePoints = false;
-    Glib::Threads::Mutex::Lock lock(Vars::mtxRefPt);
-    Vars::condRefPt.signal();
+    std::vector<SKRY_quality_t> framesChrono = qualEstimation.GetImagesQuality();
+    framesChrono.resize(std::min(numEstimated, framesChrono.size()));
+
+    m_Job->quality.partialData.Publish(CreateQualityData(framesChrono));
+    m_Job->partialQualityDataNotification = true;
 }
 
-/// Can be called after quality estimation completes
-libskry::c_Image GetBestQualityAlignedImage()
+void c_Worker::CacheAnalysis(const libskry::c_ImageAlignment &imgAlignment, const QualityData_t &qualityData)
 {
-    return GetAlignedImage(Vars::qualEst->GetBestImageIdx(),
-                           Vars::job->imgSeq,
-                           *Vars::imgAlign);
+    if (!m_Job->useAnalysisCache || m_Job->part.count > 1)
+        return;
 
+    if (!m_Analysis.quality.valid || m_Analysis.quality.framesChrono != qualityData.framesChrono ||
+        !m_Analysis.alignment.valid)
+    {
+        m_Analysis.quality.valid = true;
+        m_Analysis.quality.framesChrono = qualityData.framesChrono;
+
+        m_Analysis.alignment.valid = true;
+        m_Analysis.alignment.imgOffsets.clear();
+        for (size_t i = 0; i < qualityData.framesChrono.size(); i++)
+            m_Analysis.alignment.imgOffsets.push_back(imgAlignment.GetImageOffset(i));
+        m_Analysis.alignment.intersection = imgAlignment.GetIntersection();
+        m_Analysis.alignment.anchors.clear();
+        if (imgAlignment.GetAlignmentMethod() == SKRY_IMG_ALGN_ANCHORS)
+            m_Analysis.alignment.anchors = imgAlignment.GetAnchors();
+
+        if (!AnalysisCache::Save(*m_Job, m_Analysis))
+            std::cerr << "Could not save the analysis cache " << AnalysisCache::GetPath(*m_Job) << std::endl;
+    }
+}
+
+/// Tells the frame cache which frames will be needed soonest by the visualization
+static void UpdateFrameCacheScanPosition(const libskry::c_ImageSequence &imgSeq, FrameCache::SeqId_t frameCacheId, ProcPhase phase)
+{
+    // Stacking visualization does not read frames, so the ref. point alignment is the last pass
+    FrameCache::SetScanPosition(frameCacheId, imgSeq, imgSeq.GetAbsoluteImgIdx(imgSeq.GetCurrentImgIdxWithinActiveSubset()),
+                                phase < ProcPhase::REF_POINT_ALIGNMENT);
 }
 
-class c_PtrReset
+/// Performs cleanup on every exit path of the worker thread
+class c_WorkerExit
 {
+    c_Worker *m_Worker;
+    std::unique_ptr<libskry::c_ImageSequence> &m_RoiSeq;
+    const FrameCache::SeqId_t &m_RoiSeqCacheId;
+    std::string &m_RoiFileName;
+
 public:
-    ~c_PtrReset()
+    c_WorkerExit(c_Worker *worker, std::unique_ptr<libskry::c_ImageSequence> &roiSeq,
+                 const FrameCache::SeqId_t &roiSeqCacheId, std::string &roiFileName)
+    : m_Worker(worker), m_RoiSeq(roiSeq), m_RoiSeqCacheId(roiSeqCacheId), m_RoiFileName(roiFileName)
+    { }
+
+    ~c_WorkerExit()
     {
-        Vars::imgAlign = nullptr;
-        Vars::qualEst = nullptr;
+        FrameCache::ClearScanPosition(m_Worker->GetJob()->frameCacheId);
+        if (m_RoiSeq)
+        {
+            FrameCache::ClearScanPosition(m_RoiSeqCacheId);
+            FrameCache::Invalidate(m_RoiSeqCacheId);
+            m_RoiSeq.reset();
+        }
+        if (!m_RoiFileName.empty())
+        {
+            g_remove(m_RoiFileName.c_str());
+            m_RoiFileName.clear();
+        }
+        UnregisterActiveWorker(m_Worker);
     }
 };
 
 #define CHECK_ABORT()                                  \
     do {                                               \
-        if (Vars::abortRequested)                      \
+        if (m_AbortRequested)                          \
         {                                              \
-            Vars::abortRequested = false;              \
-            Vars::isWorkerRunning = false;             \
-            Vars::isWaitingForReferencePoints = false; \
+            LOCK();                                    \
+            m_AbortRequested = false;                  \
+            m_IsRunning = false;                       \
+            m_IsWaitingForReferencePoints = false;     \
             return;                                    \
         }                                              \
     } while (0)
 
-void WorkerThreadFunc()
+void c_Worker::ThreadFunc()
 {
-    c_PtrReset ptrReset;
+    c_WorkerExit workerExit(this, m_RoiSeq, m_RoiSeqCacheId, m_RoiFileName);
+
+    m_Profile = RunProfile_t();
+    m_RunTimer.start();
+
+    ApplyThreadBudget();
+
+    if (!m_Job->flatFieldOutputFileName.empty())
+    {
+        CreateFlatField();
+        return;
+    }
+
+    if (!LoadAnalysisCache())
+    { LOCK();
+        m_IsRunning = false;
+        m_LastResult = SKRY_CANNOT_OPEN_FILE;
+        NotifyMainThread();
+        return;
+    }
+
+    const bool isPart = (m_Job->part.count > 1);
+
+    std::vector<struct SKRY_point> anchors = Job::GetAnchors(*m_Job);
+
+    const unsigned binning = std::max(1U, m_Job->binning);
+
+    if (m_Job->roi.width > 0 || binning > 1)
+    {
+        // libskry always decodes whole frames, so the frames are cropped (and binned) into a temporary video first
+        // The extension tells libskry the video format
+        m_RoiFileName = Utils::CreateTempFile("stackistry_roi_XXXXXX.ser");
+        c_RoiExtraction roiExtraction(m_Job->imgSeq, m_Job->roi, m_Job->cfaPattern, binning, m_RoiFileName);
+        if (m_RoiFileName.empty() || !roiExtraction)
+        {
+            std::cerr << "Could not initialize region of interest extraction." << std::endl;
+            { LOCK();
+                m_IsRunning = false;
+                m_LastResult = SKRY_CANNOT_CREATE_FILE;
+                NotifyMainThread();
+                return;
+            }
+        }
+
+        c_Prefetcher srcPrefetcher(*m_Job, GetReadAheadDepth(), 1);
+
+        StartProcessingPhase(ProcPhase::ROI_EXTRACTION, srcPrefetcher);
+        Glib::Timer stepTimer;
+        while (SKRY_SUCCESS == (m_LastResult = roiExtraction.Step()))
+        {
+            srcPrefetcher.NotifyStep(roiExtraction.GetCurrentImgIdx(), stepTimer.elapsed());
+            CHECK_ABORT();
+            m_Step++;
+            PublishProgress();
+            if (IsVisualizationEnabled())
+            {
+                FrameCache::SetScanPosition(m_Job->frameCacheId, m_Job->imgSeq,
+                                            m_Job->imgSeq.GetAbsoluteImgIdx(roiExtraction.GetCurrentImgIdx()), false);
+                if (m_Renderer.IsSnapshotDue(GetVisualizationMaxFps()))
+                    SubmitRoiExtractionVisualization(roiExtraction);
+            }
+            NotifyProgress();
+            stepTimer.reset();
+        }
+        if (m_LastResult != SKRY_LAST_STEP)
+        { LOCK();
+            m_IsRunning = false;
+            NotifyMainThread();
+            return;
+        }
+        FinishProcessingPhase(srcPrefetcher);
+        FrameCache::ClearScanPosition(m_Job->frameCacheId);
+
+        m_RoiSeq.reset(new libskry::c_ImageSequence(
+            libskry::c_ImageSequence::InitVideoFile(m_RoiFileName.c_str(), &m_LastResult)));
+        m_RoiSeqCacheId = FrameCache::CreateSeqId();
+        if (!*m_RoiSeq)
+        {
+            std::cerr << "Could not open the region of interest video " << m_RoiFileName << std::endl;
+            { LOCK();
+                m_IsRunning = false;
+                NotifyMainThread();
+                return;
+            }
+        }
+        // Raw color frames are stored as mono in the video (with the filter pattern preserved)
+        m_RoiSeq->ReinterpretAsCFA(roiExtraction.GetCfaPattern());
+
+        // Anchors are specified in the whole (not binned) images' coordinates
+        const struct SKRY_rect &roi = roiExtraction.GetRoi();
+        const std::vector<struct SKRY_point> fullImgAnchors = std::move(anchors);
+        anchors.clear();
+        for (const struct SKRY_point &anchor: fullImgAnchors)
+            if (anchor.x >= roi.x && anchor.x < roi.x + (int)roi.width &&
+                anchor.y >= roi.y && anchor.y < roi.y + (int)roi.height)
+            {
+                anchors.push_back({ (anchor.x - roi.x) / (int)binning, (anchor.y - roi.y) / (int)binning });
+            }
+    }
+
+    libskry::c_ImageSequence &imgSeq = GetProcessedImgSeq();
+
+    // A part is aligned to the whole job's reference: its first frame gets the job's anchors moved by the frame's offset
+    struct SKRY_point partOffset = { 0, 0 };
+    if (isPart)
+    {
+        partOffset = m_Analysis.alignment.imgOffsets[m_Job->part.firstFrame];
+        anchors.clear();
+        for (const struct SKRY_point &anchor: m_Analysis.alignment.anchors)
+            anchors.push_back({ anchor.x + partOffset.x, anchor.y + partOffset.y });
+    }
+
+    // Destroyed (i.e. stopped) on every exit path, including an abort
+    unsigned readAheadDepth = GetReadAheadDepth();
+    unsigned phaseBoundaryDepth = 0;
+    if (m_Job->overlapQualityRead)
+    {
+        readAheadDepth = std::max(readAheadDepth, 1U);
+        phaseBoundaryDepth = std::max(QUALITY_READ_OVERLAP_FACTOR * readAheadDepth, MIN_QUALITY_READ_OVERLAP);
+    }
+    // Each additional threshold repeats the last two passes
+    const unsigned numPasses = NUM_FRAME_PASSES + 2 * m_Job->quality.additionalThresholds.size();
+    c_Prefetcher prefetcher(imgSeq, m_RoiSeq ? m_RoiFileName : m_Job->sourcePath,
+                            m_RoiSeq ? std::vector<std::string>() : m_Job->imageFileNames,
+                            readAheadDepth, numPasses, phaseBoundaryDepth);
 
     libskry::c_ImageAlignment imgAlignment(
-            Vars::job->imgSeq,
-            Vars::job->alignmentMethod,
-            Vars::job->anchors,
+            imgSeq,
+            m_Job->alignmentMethod,
+            anchors,
             Utils::Const::imgAlignmentRefBlockSize/2,
             Utils::Const::imgAlignmentRefBlockSize/2,
             Utils::Const::Defaults::placementBrightnessThreshold);
@@ -391,215 +867,352 @@ void WorkerThreadFunc()
     {
         std::cerr << "Could not initialize image alignment." << std::endl;
         { LOCK();
-            Vars::isWorkerRunning = false;
+            m_IsRunning = false;
             NotifyMainThread();
             return;
         }
     }
 
-    Vars::imgAlign = &imgAlignment;
-
-    { LOCK();
-        StartProcessingPhase(ProcPhase::IMAGE_ALIGNMENT);
-    }
-    while (SKRY_SUCCESS == (Vars::lastResult = imgAlignment.Step()))
+    StartProcessingPhase(ProcPhase::IMAGE_ALIGNMENT, prefetcher);
+    Glib::Timer stepTimer; // measures the duration of each step (for read-ahead stats)
+    while (SKRY_SUCCESS == (m_LastResult = imgAlignment.Step()))
     {
-        { LOCK();
-            CHECK_ABORT();
-            Vars::step++;
-            if (Vars::enableVisualization)
-                CreateImgAlignmentVisualization(imgAlignment);
+        prefetcher.NotifyStep(imgSeq.GetCurrentImgIdxWithinActiveSubset(), stepTimer.elapsed());
+        // Checked without locking, so that the steps of concurrent workers do not contend
+        CHECK_ABORT();
+        m_Step++;
+        PublishProgress();
+        ApplyThreadBudget();
+        if (IsVisualizationEnabled())
+        {
+            UpdateFrameCacheScanPosition(imgSeq, GetProcessedSeqCacheId(), m_ProcPhase);
+            if (m_Renderer.IsSnapshotDue(GetVisualizationMaxFps()))
+                SubmitImgAlignmentVisualization(imgAlignment);
         }
-        NotifyMainThread();
+        NotifyProgress();
+        stepTimer.reset();
     }
-    if (Vars::lastResult != SKRY_LAST_STEP)
+    if (m_LastResult != SKRY_LAST_STEP)
     { LOCK();
-        Vars::isWorkerRunning = false;
+        m_IsRunning = false;
         NotifyMainThread();
         return;
     }
+    FinishProcessingPhase(prefetcher);
 
-    libskry::c_QualityEstimation qualEstimation(imgAlignment, /*TODO: make it a param*/40, 3);
+    libskry::c_QualityEstimation qualEstimation(imgAlignment,
+                                                /*TODO: make it a param*/Utils::Const::qualityEstimationAreaSize,
+                                                Utils::Const::qualityEstimationDetailScale);
     if (!qualEstimation)
     {
         std::cerr << "Could not initialize quality estimation." << std::endl;
         { LOCK();
-            Vars::isWorkerRunning = false;
-            Vars::lastResult = SKRY_OUT_OF_MEMORY;
+            m_IsRunning = false;
+            m_LastResult = SKRY_OUT_OF_MEMORY;
             NotifyMainThread();
             return;
         }
     }
-    Vars::qualEst = &qualEstimation;
-
 
-    { LOCK();
-        StartProcessingPhase(ProcPhase::QUALITY_ESTIMATION);
-    }
-    while (SKRY_SUCCESS == (Vars::lastResult = qualEstimation.Step()))
+    StartProcessingPhase(ProcPhase::QUALITY_ESTIMATION, prefetcher);
+    stepTimer.reset();
+    m_PartialQualityTimer.start();
+    while (SKRY_SUCCESS == (m_LastResult = qualEstimation.Step()))
     {
-        { LOCK();
-            CHECK_ABORT();
-            Vars::step++;
-            if (Vars::enableVisualization)
-                CreateQualityEstimationVisualization(Vars::job->imgSeq, imgAlignment, qualEstimation);
+        prefetcher.NotifyStep(imgSeq.GetCurrentImgIdxWithinActiveSubset(), stepTimer.elapsed());
+        CHECK_ABORT();
+        m_Step++;
+        PublishProgress();
+        ApplyThreadBudget();
+        if (m_PartialQualityTimer.elapsed() >= Utils::Const::partialQualityDataIntervalSec)
+        {
+            PublishPartialQualityData(qualEstimation, imgSeq.GetCurrentImgIdxWithinActiveSubset() + 1);
+            m_PartialQualityTimer.start();
         }
-        NotifyMainThread();
+        if (IsVisualizationEnabled())
+        {
+            UpdateFrameCacheScanPosition(imgSeq, GetProcessedSeqCacheId(), m_ProcPhase);
+            if (m_Renderer.IsSnapshotDue(GetVisualizationMaxFps()))
+                SubmitQualityEstimationVisualization(imgAlignment);
+        }
+        NotifyProgress();
+        stepTimer.reset();
     }
+    if (m_LastResult != SKRY_LAST_STEP)
     { LOCK();
+        m_IsRunning = false;
+        NotifyMainThread();
+        return;
+    }
+    FinishProcessingPhase(prefetcher);
 
-        if (Vars::lastResult != SKRY_LAST_STEP)
-        {
-            Vars::isWorkerRunning = false;
-            NotifyMainThread();
-            return;
-        }
-        else
-        {
-            Vars::job->bestFragmentsImg = qualEstimation.GetBestFragmentsImage();
+    // The results are prepared before publishing, so that readers never see them incomplete
+    {
+        auto bestFragments = std::make_shared<libskry::c_Image>(qualEstimation.GetBestFragmentsImage());
 
-            Vars::job->quality.framesChrono = qualEstimation.GetImagesQuality();
-            Vars::job->quality.framesSorted = Vars::job->quality.framesChrono;
+        auto qualityData = CreateQualityData(qualEstimation.GetImagesQuality());
 
-            // Sort descending
-            std::sort(Vars::job->quality.framesSorted.begin(),
-                      Vars::job->quality.framesSorted.end(),
-                      [](const SKRY_quality_t &a, const SKRY_quality_t &b) { return a > b; });
+        m_Job->bestFragmentsImg.Publish(bestFragments);
+        m_Job->quality.data.Publish(qualityData);
+        m_Job->quality.partialData.Reset();
+        m_Job->qualityDataReadyNotification = true;
 
-            Vars::job->qualityDataReadyNotification = true;
-            NotifyMainThread(); // in order to refresh the quality graph window
-        }
+        CacheAnalysis(imgAlignment, *qualityData);
     }
+    NotifyMainThread(); // in order to refresh the quality graph window
 
-    if (!Vars::job->automaticRefPointsPlacement && Vars::job->refPoints.empty())
+    if (m_Job->analysisOnly)
     {
         { LOCK();
-            Vars::isWaitingForReferencePoints = true;
-            NotifyMainThread();
-        }
-
-        { Glib::Threads::Mutex::Lock lock(Vars::mtxRefPt);
-
-            Vars::condRefPt.wait(Vars::mtxRefPt);
-            if (Vars::job->refPoints.empty()) // the user canceled the "Select ref. points" dialog
-            {
-                Vars::job->automaticRefPointsPlacement = true;
-            }
+            m_AbortRequested = false;
+            m_IsRunning = false;
         }
+        NotifyMainThread();
+        return;
     }
 
-    libskry::c_RefPointAlignment refPtAlignment(qualEstimation,
-                                                Vars::job->refPoints,
+    if (isPart)
+    {
+        // The stack's top-left corner in the job's first active frame
+        const struct SKRY_rect intersection = imgAlignment.GetIntersection();
+        m_Job->part.stackOrigin = { intersection.x - partOffset.x, intersection.y - partOffset.y };
+    }
 
-                                                Vars::job->quality.criterion,
-                                                Vars::job->quality.threshold,
+    // The job's settings refer to full-resolution images; scale them to the binned ones (if binning)
+    RefPtParams_t refPtParams;
+    refPtParams.blockSize = std::max(MIN_REF_PT_BLOCK_SIZE, m_Job->refPtBlockSize / binning);
+    refPtParams.searchRadius = std::max(1U, m_Job->refPtSearchRadius / binning);
+    refPtParams.structureScale = std::max(1U, m_Job->refPtAutoPlacementParams.structureScale / binning);
+    refPtParams.spacing = std::max(1U, m_Job->refPtAutoPlacementParams.spacing / binning);
 
-                                                Vars::job->refPtBlockSize,
-                                                Vars::job->refPtSearchRadius,
-                                                &Vars::lastResult,
-                                                Vars::job->refPtAutoPlacementParams.brightnessThreshold,
-                                                Vars::job->refPtAutoPlacementParams.structureThreshold,
-                                                Vars::job->refPtAutoPlacementParams.structureScale,
-                                                Vars::job->refPtAutoPlacementParams.spacing);
-    if (!refPtAlignment)
+    if (!m_Job->automaticRefPointsPlacement && m_Job->refPoints.empty())
     {
-        std::cerr << "Could not initialize reference point alignment." << std::endl;
+        prefetcher.Pause();
+        // Prepared in advance, so that the main thread can show the selection dialog at once
+        PrepareReferencePointSelection(imgAlignment, qualEstimation, refPtParams);
+
+        // Waiting for the user may take long; meanwhile the other workers (and the next queued
+        // job, see c_MainWindow::StartQueuedJobs()) use this worker's threads
+        UnregisterActiveWorker(this);
         { LOCK();
-            Vars::isWorkerRunning = false;
-            Vars::lastResult = SKRY_OUT_OF_MEMORY;
+            m_IsWaitingForReferencePoints = true;
             NotifyMainThread();
-            return;
         }
-    }
-    { LOCK();
-        StartProcessingPhase(ProcPhase::REF_POINT_ALIGNMENT);
-    }
-    while (SKRY_SUCCESS == (Vars::lastResult = refPtAlignment.Step()))
-    {
-        { LOCK();
-            CHECK_ABORT();
-            Vars::step++;
-            if (Vars::enableVisualization)
-                CreateRefPtAlignmentVisualization(Vars::job->imgSeq, imgAlignment, refPtAlignment);
+
+        { Glib::Threads::Mutex::Lock lock(m_MtxRefPt);
+            c_ScopeTimer timer(m_Profile.waitingForUserSec);
+
+            while (IsWaitingForReferencePoints())
+                m_CondRefPt.wait(m_MtxRefPt);
+
+            // An abort also wakes the worker up (without ref. points); the job has to keep manual placement then
+            if (m_Job->refPoints.empty() && !m_AbortRequested) // the user canceled the "Select ref. points" dialog
+            {
+                m_Job->automaticRefPointsPlacement = true;
+            }
         }
-        NotifyMainThread();
-    }
-    if (Vars::lastResult != SKRY_LAST_STEP)
-    { LOCK();
-        Vars::isWorkerRunning = false;
-        NotifyMainThread();
-        return;
+        m_RefPtSelection = RefPtSelection_t();
+
+        CHECK_ABORT();
+        RegisterActiveWorker(this);
+        ApplyThreadBudget();
     }
 
-    libskry::c_Image flatField;
-    if (!Vars::job->flatFieldFileName.empty())
+    std::shared_ptr<const libskry::c_Image> flatField;
+    if (!m_Job->flatFieldFileName.empty())
     {
-        flatField = libskry::c_Image::Load(Vars::job->flatFieldFileName.c_str(), &Vars::lastResult);
+        flatField = FlatFieldCache::Get(m_Job->flatFieldFileName, m_LastResult);
         if (!flatField)
         {
-            std::cerr << "Could not load flat-field from " << Vars::job->flatFieldFileName << std::endl;
-            NotifyMainThread();
-            return;
+            std::cerr << "Could not load flat-field from " << m_Job->flatFieldFileName << std::endl;
+            { LOCK();
+                m_IsRunning = false;
+                NotifyMainThread();
+                return;
+            }
         }
     }
 
-    libskry::c_Stacking stacking(refPtAlignment,
-                                 Vars::job->flatFieldFileName.empty() ? nullptr : &flatField,
-                                 &Vars::lastResult);
-    if (!stacking)
+    // Ref. point alignment and stacking are repeated for each threshold; the preceding phases are shared
+    std::vector<unsigned> thresholds = { m_Job->quality.threshold };
+    thresholds.insert(thresholds.end(), m_Job->quality.additionalThresholds.begin(), m_Job->quality.additionalThresholds.end());
+
+    // A part stacks as many of its frames as the whole job's threshold selects among them
+    m_Job->part.numStackedFrames.clear();
+    if (isPart)
+        for (unsigned threshold: thresholds)
+            m_Job->part.numStackedFrames.push_back(
+                PartialStack::GetNumFramesToStack(m_Analysis.quality.framesChrono, m_Job->part.firstFrame,
+                                                  m_Job->part.firstFrame + imgSeq.GetActiveImageCount(),
+                                                  m_Job->quality.criterion, threshold));
+
+    std::vector<struct SKRY_point> refPoints = m_Job->refPoints;
+    for (struct SKRY_point &refPt: refPoints)
     {
-        std::cerr << "Could not initialize stacking." << std::endl;
+        refPt.x /= (int)binning;
+        refPt.y /= (int)binning;
+    }
+
+    for (size_t thrIdx = 0; thrIdx < thresholds.size(); thrIdx++)
+    {
+        libskry::c_RefPointAlignment refPtAlignment(qualEstimation,
+                                                    refPoints,
+
+                                                    isPart ? SKRY_NUMBER_BEST : m_Job->quality.criterion,
+                                                    isPart ? (unsigned)m_Job->part.numStackedFrames[thrIdx] : thresholds[thrIdx],
+
+                                                    refPtParams.blockSize,
+                                                    refPtParams.searchRadius,
+                                                    &m_LastResult,
+                                                    m_Job->refPtAutoPlacementParams.brightnessThreshold,
+                                                    m_Job->refPtAutoPlacementParams.structureThreshold,
+                                                    refPtParams.structureScale,
+                                                    refPtParams.spacing);
+        if (!refPtAlignment)
+        {
+            std::cerr << "Could not initialize reference point alignment." << std::endl;
+            { LOCK();
+                m_IsRunning = false;
+                m_LastResult = SKRY_OUT_OF_MEMORY;
+                NotifyMainThread();
+                return;
+            }
+        }
+        StartProcessingPhase(ProcPhase::REF_POINT_ALIGNMENT, prefetcher);
+        stepTimer.reset();
+        while (SKRY_SUCCESS == (m_LastResult = refPtAlignment.Step()))
+        {
+            prefetcher.NotifyStep(imgSeq.GetCurrentImgIdxWithinActiveSubset(), stepTimer.elapsed());
+            CHECK_ABORT();
+            m_Step++;
+            PublishProgress();
+            ApplyThreadBudget();
+            if (IsVisualizationEnabled())
+            {
+                UpdateFrameCacheScanPosition(imgSeq, GetProcessedSeqCacheId(), m_ProcPhase);
+                if (m_Renderer.IsSnapshotDue(GetVisualizationMaxFps()))
+                    SubmitRefPtAlignmentVisualization(imgAlignment, refPtAlignment);
+            }
+            NotifyProgress();
+            stepTimer.reset();
+        }
+        if (m_LastResult != SKRY_LAST_STEP)
         { LOCK();
-            Vars::isWorkerRunning = false;
+            m_IsRunning = false;
             NotifyMainThread();
             return;
         }
-    }
-    { LOCK();
-        StartProcessingPhase(ProcPhase::IMAGE_STACKING);
-    }
-    while (SKRY_SUCCESS == (Vars::lastResult = stacking.Step()))
-    {
-        { LOCK();
+        FinishProcessingPhase(prefetcher);
+
+        libskry::c_Stacking stacking(refPtAlignment,
+                                     flatField.get(),
+                                     &m_LastResult);
+        if (!stacking)
+        {
+            std::cerr << "Could not initialize stacking." << std::endl;
+            { LOCK();
+                m_IsRunning = false;
+                NotifyMainThread();
+                return;
+            }
+        }
+        StartProcessingPhase(ProcPhase::IMAGE_STACKING, prefetcher);
+        stepTimer.reset();
+        while (SKRY_SUCCESS == (m_LastResult = stacking.Step()))
+        {
+            prefetcher.NotifyStep(imgSeq.GetCurrentImgIdxWithinActiveSubset(), stepTimer.elapsed());
             CHECK_ABORT();
-            Vars::step++;
-            if (Vars::enableVisualization)
-                CreateStackingVisualization(stacking, refPtAlignment);
+            m_Step++;
+            PublishProgress();
+            ApplyThreadBudget();
+            if (IsVisualizationEnabled() && m_Renderer.IsSnapshotDue(GetVisualizationMaxFps()))
+                SubmitStackingVisualization(stacking, refPtAlignment);
+            NotifyProgress();
+            stepTimer.reset();
+        }
+        FinishProcessingPhase(prefetcher);
+
+        {
+            auto stackedImg = std::make_shared<libskry::c_Image>(stacking.GetFinalImageStack());
+            if (!*stackedImg)
+                std::cerr << "Failed to obtain the final image stack." << std::endl;
+            else if (thrIdx == 0)
+                m_Job->stackedImg.Publish(stackedImg);
+            else
+            {
+                auto additionalStacks = m_Job->additionalStacks.Get();
+                auto newStacks = std::make_shared<std::vector<ThresholdStack_t>>(
+                    additionalStacks ? *additionalStacks : std::vector<ThresholdStack_t>());
+                newStacks->push_back({ thresholds[thrIdx], stackedImg });
+                m_Job->additionalStacks.Publish(newStacks);
+            }
         }
-        NotifyMainThread();
     }
 
     { LOCK();
-        Vars::job->stackedImg = stacking.GetFinalImageStack();
+        m_AbortRequested = false;
+        m_IsRunning = false;
+        m_IsWaitingForReferencePoints = false;
     }
-    if (!Vars::job->stackedImg)
+    NotifyMainThread();
+}
+
+void c_Worker::CreateFlatField()
+{
+    c_FlatFieldCreation flatFieldCreation(m_Job->imgSeq);
+    c_Prefetcher prefetcher(*m_Job, GetReadAheadDepth(), 1);
+
+    StartProcessingPhase(ProcPhase::FLAT_FIELD_CREATION, prefetcher);
+    Glib::Timer stepTimer;
+    while (SKRY_SUCCESS == (m_LastResult = flatFieldCreation.Step()))
     {
-        std::cerr << "Failed to obtain the final image stack." << std::endl;
+        prefetcher.NotifyStep(flatFieldCreation.GetCurrentImgIdx(), stepTimer.elapsed());
+        CHECK_ABORT();
+        m_Step++;
+        PublishProgress();
+        ApplyThreadBudget();
+        NotifyProgress();
+        stepTimer.reset();
     }
+    if (m_LastResult != SKRY_LAST_STEP)
+    { LOCK();
+        m_IsRunning = false;
+        NotifyMainThread();
+        return;
+    }
+    FinishProcessingPhase(prefetcher);
+
+    auto flatField = std::make_shared<libskry::c_Image>(
+        libskry::c_Image::ConvertPixelFormat(flatFieldCreation.GetFlatField(),
+                                             Utils::FindMatchingFormat(m_Job->outputFmt, 1)));
+    enum SKRY_result saveResult = (*flatField ? ImageWriter::Save(*flatField, m_Job->flatFieldOutputFileName, m_Job->outputFmt)
+                                              : SKRY_OUT_OF_MEMORY);
+    if (saveResult == SKRY_SUCCESS)
+        m_Job->stackedImg.Publish(flatField);
 
     { LOCK();
-        Vars::abortRequested = false;
-        Vars::isWorkerRunning = false;
-        Vars::isWaitingForReferencePoints = false;
+        m_AbortRequested = false;
+        m_IsRunning = false;
+        if (saveResult != SKRY_SUCCESS)
+            m_LastResult = saveResult;
     }
     NotifyMainThread();
 }
 
-Glib::Threads::RecMutex &GetAccessGuard()
+VisualizationImage_t c_Worker::GetVisualizationImage()
 {
-    return Vars::mtx;
+    return m_Renderer.AcquireImage();
 }
 
-const Cairo::RefPtr<Cairo::ImageSurface> &GetVisualizationImage()
+uint64_t c_Worker::GetVisualizationImageId()
 {
-    return Vars::visualizationImg;
+    return m_Renderer.GetImageId();
 }
 
-std::unique_ptr<int> sth;
-
-enum SKRY_result GetLastResult()
+enum SKRY_result c_Worker::GetLastResult()
 {
-    return Vars::lastResult;
+    LOCK();
+    return m_LastResult;
 }
 
 std::string GetProcPhaseStr(ProcPhase phase)
@@ -607,10 +1220,12 @@ std::string GetProcPhaseStr(ProcPhase phase)
     switch (phase)
     {
         case ProcPhase::IDLE:                return _("Idle");
+        case ProcPhase::ROI_EXTRACTION:      return _("Frame extraction");
         case ProcPhase::IMAGE_ALIGNMENT:     return _("Image alignment");
         case ProcPhase::QUALITY_ESTIMATION:  return _("Quality estimation");
         case ProcPhase::REF_POINT_ALIGNMENT: return _("Reference point alignment");
         case ProcPhase::IMAGE_STACKING:      return _("Image stacking");
+        case ProcPhase::FLAT_FIELD_CREATION: return _("Flat-field creation");
         default: return "";
     }
 }
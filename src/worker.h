@@ -25,59 +25,235 @@ File description:
 #ifndef STACKISTRY_WORKER_THREAD_HEADER
 #define STACKISTRY_WORKER_THREAD_HEADER
 
+#include <atomic>
 #include <string>
 #include <tuple>
 #include <vector>
+#include <memory>
 
 #include <cairomm/surface.h>
 #include <glibmm/threads.h>
+#include <glibmm/timer.h>
 
+#include "analysis_cache.h"
 #include "job.h"
+#include "prefetch.h"
+#include "roi_extraction.h"
 #include "utils.h"
+#include "visualization.h"
 
 
 namespace Worker
 {
-    enum class ProcPhase { IDLE = 0, IMAGE_ALIGNMENT, QUALITY_ESTIMATION, REF_POINT_ALIGNMENT, IMAGE_STACKING, NUM_PHASES };
+    enum class ProcPhase { IDLE = 0, ROI_EXTRACTION, IMAGE_ALIGNMENT, QUALITY_ESTIMATION, REF_POINT_ALIGNMENT, IMAGE_STACKING,
+                           FLAT_FIELD_CREATION, NUM_PHASES };
 
     std::string GetProcPhaseStr(ProcPhase phase);
 
-    void StartProcessing(Job_t *job);
+    struct Progress_t
+    {
+        ProcPhase phase;
+        size_t step; ///< Steps completed in 'phase'
+        double framesPerSec; ///< Average throughput of 'phase' so far
+    };
 
-    size_t GetStep();
+    /// Processes a single job in its own thread
+    /** Multiple workers may run simultaneously; the total number of threads
+        they use is limited by the thread budget (see SetThreadBudget()). */
+    class c_Worker
+    {
+    public:
+        /// 'progressNotification' will be called from the worker thread
+        /** Notifications are coalesced: after one is sent, no more are sent until
+            the receiver calls AcknowledgeNotification(). */
+        c_Worker(std::shared_ptr<Job_t> job, const sigc::slot<void> &progressNotification);
 
-    bool IsRunning();
+        /// Aborts processing (if still running)
+        ~c_Worker();
 
-    /// Should be called only after checking that IsRunning returns 'false'
-    void WaitUntilFinished();
+        c_Worker(const c_Worker &) = delete;
+        c_Worker &operator =(const c_Worker &) = delete;
 
-    void ConnectProgressSignal(const sigc::slot<void>& slot);
+        void StartProcessing();
 
-    Glib::Threads::RecMutex &GetAccessGuard();
+        const std::shared_ptr<Job_t> &GetJob() const { return m_Job; }
 
-    ProcPhase GetPhase();
+        /// Has to be called by the receiver of a progress notification before it checks the worker's state
+        void AcknowledgeNotification();
 
-    const Cairo::RefPtr<Cairo::ImageSurface> &GetVisualizationImage();
+        /// Returns a consistent snapshot of the progress; never blocks the worker thread
+        Progress_t GetProgress() const;
 
-    /// Blocks until the worker thread finishes; calls WaitUntilFinished() internally
-    void AbortProcessing();
+        size_t GetStep() const { return GetProgress().step; }
 
-    void SetVisualizationEnabled(bool enabled);
-    bool IsVisualizationEnabled();
+        ProcPhase GetPhase() const { return GetProgress().phase; }
+
+        bool IsRunning();
+
+        /// Should be called only after checking that IsRunning returns 'false'
+        void WaitUntilFinished();
+
+        /// Blocks until the worker thread finishes; calls WaitUntilFinished() internally
+        void AbortProcessing();
+
+        /// Returns the most recent visualization image (may be null)
+        /** The returned surface is not modified afterwards. */
+        VisualizationImage_t GetVisualizationImage();
+
+        /// Changes whenever a new visualization image becomes available
+        uint64_t GetVisualizationImageId();
+
+        /// Returns true if the main thread needs to provide reference points
+        bool IsWaitingForReferencePoints();
+
+        /// Notifies the worker thread that it may continue
+        void NotifyReferencePointsSet();
+
+        /// Can be called while IsWaitingForReferencePoints() returns true
+        const libskry::c_Image &GetBestQualityAlignedImage();
+
+        /// Automatically placed reference points (to offer in the selection dialog); can be called while IsWaitingForReferencePoints() returns true
+        const std::vector<struct SKRY_point> &GetSuggestedReferencePoints();
+
+        enum SKRY_result GetLastResult();
+
+        /// Number of threads assigned by the scheduler
+        unsigned GetNumThreads();
+
+    private:
+        std::shared_ptr<Job_t> m_Job;
+        sigc::slot<void> m_ProgressNotification;
+
+        std::atomic<bool> m_AbortRequested{false};
+
+        /// Set when a notification has been sent and not yet acknowledged
+        std::atomic<bool> m_NotificationPending{false};
+
+        // Used only by the worker thread; published via 'm_Progress'
+        size_t m_Step = 0;
+        ProcPhase m_ProcPhase = ProcPhase::IDLE;
+        Glib::Timer m_PhaseTimer;
+        Glib::Timer m_PartialQualityTimer; ///< Time since the last PublishPartialQualityData()
+
+        // Used only by the worker thread; published via 'm_Job->profile'
+        RunProfile_t m_Profile;
+        RunProfile_t::Phase_t m_PhaseProfile; ///< Profile of the current phase
+        c_Prefetcher::Stats_t m_PhaseStartReadStats;
+        Glib::Timer m_RunTimer;
+
+        /// Contents of the job's analysis cache (if enabled); used only by the worker thread
+        AnalysisCache::Data_t m_Analysis;
+
+        /// Progress published by the worker thread; guarded by a sequence lock
+        struct
+        {
+            std::atomic<unsigned> seq{0}; ///< Odd while being updated
+            std::atomic<int> phase{(int)ProcPhase::IDLE};
+            std::atomic<size_t> step{0};
+            std::atomic<double> framesPerSec{0};
+        } m_Progress;
 
-    /// Returns true if the main thread needs to provide reference points
-    bool IsWaitingForReferencePoints();
+        /// Region of interest of the job's active images, binned if requested; processed instead of 'm_Job->imgSeq'
+        /** Exists only if the job has a region of interest or uses binning. Created by the worker thread
+            before image alignment and destroyed when the thread finishes. */
+        std::unique_ptr<libskry::c_ImageSequence> m_RoiSeq;
+        FrameCache::SeqId_t m_RoiSeqCacheId = 0; ///< Identifies 'm_RoiSeq' in the frame cache
+        std::string m_RoiFileName; ///< Temporary video file of 'm_RoiSeq'
 
-    /// Notifies the worker thread that it may continue
-    void NotifyReferencePointsSet();
+        /// Returns the image sequence processed by the libskry phases
+        libskry::c_ImageSequence &GetProcessedImgSeq() { return m_RoiSeq ? *m_RoiSeq : m_Job->imgSeq; }
 
-    /// Can be called after quality estimation completes
-    libskry::c_Image GetBestQualityAlignedImage();
+        /// Returns the frame cache ID of GetProcessedImgSeq()
+        FrameCache::SeqId_t GetProcessedSeqCacheId() const { return m_RoiSeq ? m_RoiSeqCacheId : m_Job->frameCacheId; }
+
+        /// Reference point settings scaled to the processed images (see 'm_RoiSeq')
+        struct RefPtParams_t
+        {
+            unsigned blockSize, searchRadius, structureScale, spacing;
+        };
+
+        /// Prepared for the main thread before waiting for reference points
+        struct RefPtSelection_t
+        {
+            libskry::c_Image bestQualityImg; ///< Aligned and cropped to the images' intersection
+            std::vector<struct SKRY_point> suggestedPoints;
+        } m_RefPtSelection;
+
+        void PrepareReferencePointSelection(const libskry::c_ImageAlignment &imgAlignment,
+                                            const libskry::c_QualityEstimation &qualEstimation,
+                                            const RefPtParams_t &params);
+
+        bool m_IsRunning = false;
+        Glib::Threads::Thread *m_Thread = nullptr;
+        bool m_IsWaitingForReferencePoints = false;
+        enum SKRY_result m_LastResult = SKRY_SUCCESS;
+        Glib::Threads::RecMutex m_Mtx; ///< Access guard for this worker's shared variables
+        /// Used for notification by main thread that reference points have been provided
+        Glib::Threads::Mutex m_MtxRefPt;
+        Glib::Threads::Cond m_CondRefPt;
+
+        /// Set by the scheduler; applied by the worker thread between processing steps
+        std::atomic<unsigned> m_NumThreads{1};
+        unsigned m_AppliedNumThreads = 0;
+
+        void ThreadFunc();
+        void NotifyMainThread();
+        /// Also starts profiling of the phase; 'prefetcher' is the one reading ahead the phase's input
+        void StartProcessingPhase(ProcPhase newPhase, c_Prefetcher &prefetcher);
+        /// Adds the completed phase to the job's profile
+        void FinishProcessingPhase(c_Prefetcher &prefetcher);
+        void PublishProgress();
+        /// Notifies the main thread about a completed step; used by the processing loops
+        void NotifyProgress();
+        void ApplyThreadBudget();
+
+        /// Creates and saves a flat-field instead of stacking (see Job_t::flatFieldOutputFileName)
+        void CreateFlatField();
+
+        /// Publishes the cached quality data (if valid), so that it is available before quality estimation completes
+        /** For a part of a distributed job, loads the whole job's analysis instead; returns 'false' if it is not available. */
+        bool LoadAnalysisCache();
+
+        /// Publishes the quality of the first 'numEstimated' active images (for live display of the quality graph)
+        void PublishPartialQualityData(const libskry::c_QualityEstimation &qualEstimation, size_t numEstimated);
+
+        /// Stores the results of image alignment and quality estimation in the analysis cache (if enabled)
+        void CacheAnalysis(const libskry::c_ImageAlignment &imgAlignment, const QualityData_t &qualityData);
+
+        /// Renders visualization of the processing steps (images are published via 'm_ProgressNotification')
+        c_VisualizationRenderer m_Renderer;
+
+        // Capture the current step's visualization data and submit them to 'm_Renderer'
+
+        void SubmitRoiExtractionVisualization(const c_RoiExtraction &roiExtraction);
+        void SubmitImgAlignmentVisualization(const libskry::c_ImageAlignment &imgAlignment);
+        void SubmitQualityEstimationVisualization(const libskry::c_ImageAlignment &imgAlignment);
+        void SubmitRefPtAlignmentVisualization(const libskry::c_ImageAlignment &imgAlignment,
+                                               const libskry::c_RefPointAlignment &refPtAlignment);
+        void SubmitStackingVisualization(const libskry::c_Stacking &stacking,
+                                         const libskry::c_RefPointAlignment &refPtAlignment);
+
+        friend void RebalanceThreads();
+    };
+
+    /// Sets the total number of threads to be split among all running workers
+    /** A value of 0 means "all logical CPUs". */
+    void SetThreadBudget(unsigned numThreads);
+
+    /// Sets the number of frames read ahead (in the background) by each worker; 0 disables reading ahead
+    void SetReadAheadDepth(unsigned numFrames);
+
+    void SetVisualizationEnabled(bool enabled);
+    bool IsVisualizationEnabled();
 
-    enum SKRY_result GetLastResult();
+    /// Sets the max. number of visualization images rendered per second; 0 = unlimited
+    void SetVisualizationMaxFps(unsigned fps);
 
-    /// Used by the main thread to indicate the current visualization zoom factor
-    void SetZoomFactor(double zoom, Utils::Const::InterpolationMethod interpolationMethod);
+    /// Used by the main thread to indicate the current visualization zoom factor and the visible area
+    /** 'visibleArea' is expressed in the visualization image's (not zoomed) coordinates;
+        only this area (with a margin) is rendered. If empty, the whole image is rendered. */
+    void SetZoomFactor(double zoom, Utils::Const::InterpolationMethod interpolationMethod,
+                       const Cairo::Rectangle &visibleArea);
 
     /// Returns the last values set with SetZoomFactor()
     std::tuple<double, Utils::Const::InterpolationMethod> GetZoomFactor();